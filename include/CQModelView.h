@@ -9,6 +9,12 @@
 #include <QPointer>
 #include <QModelIndex>
 #include <set>
+#include <map>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 
 class CQModelViewHeader;
 class CQModelViewCornerButton;
@@ -16,10 +22,14 @@ class CQModelViewSelectionModel;
 class CQModelViewFilterEdit;
 class CQModelViewHeaderEdit;
 
+class CIntervalSet;
+
 class QAbstractItemModel;
 class QItemSelectionModel;
 class QScrollBar;
 class QTextLayout;
+class QThreadPool;
+class QTimer;
 
 /*!
  * Viewer for QAbstractItemModel with support for:
@@ -58,6 +68,8 @@ class CQModelView : public QAbstractItemView {
   Q_PROPERTY(bool stretchLastColumn READ isStretchLastColumn WRITE setStretchLastColumn)
   Q_PROPERTY(bool multiHeaderLines  READ isMultiHeaderLines  WRITE setMultiHeaderLines )
   Q_PROPERTY(bool showFilter        READ isShowFilter        WRITE setShowFilter       )
+  Q_PROPERTY(bool filterTree        READ isFilterTree        WRITE setFilterTree       )
+  Q_PROPERTY(bool filterExpand      READ isFilterExpand      WRITE setFilterExpand     )
 
   Q_PROPERTY(bool         showVerticalHeader READ isShowVerticalHeader WRITE setShowVerticalHeader)
   Q_PROPERTY(VerticalType verticalType       READ verticalType         WRITE setVerticalType      )
@@ -67,6 +79,7 @@ class CQModelView : public QAbstractItemView {
 
   // qtableview+qtreeview
   Q_PROPERTY(bool sortingEnabled       READ isSortingEnabled      WRITE setSortingEnabled     )
+  Q_PROPERTY(bool viewSort             READ isViewSort            WRITE setViewSort           )
 //Q_PROPERTY(bool wordWrap             READ wordWrap              WRITE setWordWrap           )
 
   // qtableview
@@ -118,7 +131,7 @@ class CQModelView : public QAbstractItemView {
   QAbstractItemModel *model() const;
   void setModel(QAbstractItemModel *model) override;
 
-  QItemSelectionModel *selectionModel() const;
+  CQModelViewSelectionModel *selectionModel() const;
   void setSelectionModel(QItemSelectionModel *sm) override;
 
   void setRootIndex(const QModelIndex &index) override;
@@ -151,6 +164,8 @@ class CQModelView : public QAbstractItemView {
 
   void selectAll() override;
 
+  void invertSelection();
+
   //---
 
   void scrollContentsBy(int dx, int dy) override;
@@ -206,6 +221,14 @@ class CQModelView : public QAbstractItemView {
   bool isShowFilter() const { return showFilter_; }
   void setShowFilter(bool b);
 
+  // filter rows at all depths (keep ancestors of matches)
+  bool isFilterTree() const { return filterTree_; }
+  void setFilterTree(bool b);
+
+  // expand ancestors of tree filter matches
+  bool isFilterExpand() const { return filterExpand_; }
+  void setFilterExpand(bool b);
+
   bool isShowVerticalHeader() const { return showVerticalHeader_; }
   void setShowVerticalHeader(bool b);
 
@@ -225,6 +248,12 @@ class CQModelView : public QAbstractItemView {
   bool isSortingEnabled() const { return sortingEnabled_; }
   void setSortingEnabled(bool b);
 
+  // sort rows in view (model row order unchanged)
+  bool isViewSort() const { return viewSort_; }
+  void setViewSort(bool b);
+
+  bool isViewSorted() const { return ! viewSortKeys_.empty(); }
+
   bool isShowGrid() const { return showGrid_; }
   void setShowGrid(bool b);
 
@@ -286,6 +315,8 @@ class CQModelView : public QAbstractItemView {
   void sortByColumn(int column, Qt::SortOrder order);
   void sortByColumn(int column);
 
+  void addSortByColumn(int column);
+
   //---
 
   bool isColumnHidden(int column) const;
@@ -296,6 +327,12 @@ class CQModelView : public QAbstractItemView {
   bool isRowHidden(int row, const QModelIndex &parent) const;
   void setRowHidden(int row, const QModelIndex &parent, bool hide);
 
+  // set hidden state of all child rows of parent (single layout update)
+  void setRowsHidden(const QModelIndex &parent, const std::vector<bool> &hidden);
+
+  // number of non-hidden child rows of parent (before row if row >= 0)
+  int numVisibleRows(const QModelIndex &parent=QModelIndex(), int row=-1) const;
+
   //---
 
   bool isExpanded(const QModelIndex &index) const;
@@ -369,6 +406,9 @@ class CQModelView : public QAbstractItemView {
 
   void stateChanged();
 
+  // background view sort progress (percent)
+  void sortProgress(int percent);
+
  private:
   friend class CQModelViewHeader;
   friend class CQModelViewSelectionModel;
@@ -448,6 +488,36 @@ class CQModelView : public QAbstractItemView {
     GridFg
   };
 
+  // flat row and column range of drag selection
+  struct DragRect {
+    int flatRow1 { -1 };
+    int flatRow2 { -1 };
+    int column1  { -1 };
+    int column2  { -1 };
+
+    DragRect() { }
+
+    DragRect(int flatRow1, int flatRow2, int column1, int column2) :
+     flatRow1(flatRow1), flatRow2(flatRow2), column1(column1), column2(column2) {
+    }
+
+    bool isValid() const { return (flatRow1 >= 0 && flatRow2 >= flatRow1); }
+
+    bool intersects(const DragRect &r) const {
+      return (r.flatRow1 <= flatRow2 && r.flatRow2 >= flatRow1 &&
+              r.column1  <= column2  && r.column2  >= column1);
+    }
+
+    friend bool operator==(const DragRect &r1, const DragRect &r2) {
+      return (r1.flatRow1 == r2.flatRow1 && r1.flatRow2 == r2.flatRow2 &&
+              r1.column1  == r2.column1  && r1.column2  == r2.column2);
+    }
+
+    void reset() { *this = DragRect(); }
+  };
+
+  using DragRects = std::vector<DragRect>;
+
   struct MouseData {
     bool                  pressed      { false };
     Qt::KeyboardModifiers modifiers    { Qt::NoModifier };
@@ -456,6 +526,8 @@ class CQModelView : public QAbstractItemView {
     PositionData          releaseData;
     PositionData          menuData;
     int                   headerWidth  { 0 };
+    DragRect              dragRect;             // selected rect of drag so far
+    bool                  dragUpdate   { false }; // applying drag selection delta
 
     void reset() {
       pressed   = false;
@@ -464,18 +536,67 @@ class CQModelView : public QAbstractItemView {
       pressData  .reset();
       moveData   .reset();
       releaseData.reset();
+
+      dragRect.reset();
     }
   };
 
+  struct RowData;
   struct VisRowData;
   struct VisColumnData;
 
+  // expanded node (root or expanded row) with number of flat rows per child row
+  // (defined in source file)
+  struct ExpandNode;
+
+  // hidden child rows per parent (defined in source file)
+  struct HiddenRows;
+
+  // cached vertical header text widths (defined in source file)
+  struct VHeaderWidths;
+
+  // visible cell index to cell slot hash (defined in source file)
+  struct VisCellSlots;
+
+  // compiled filter evaluation of rows in thread pool (defined in source file)
+  struct FilterRun;
+  struct FilterTask;
+  struct ParallelTask;
+  struct SortColumnKeys;
+  struct SortRun;
+  struct SortTask;
+
+  struct SortKey {
+    int           column { -1 };
+    Qt::SortOrder order  { Qt::AscendingOrder };
+
+    SortKey(int column=-1, Qt::SortOrder order=Qt::AscendingOrder) :
+     column(column), order(order) {
+    }
+  };
+
+  using SortKeys            = std::vector<SortKey>;
+  using SortColumnKeysArray = std::vector<SortColumnKeys>;
+
+  struct IndexHash {
+    size_t operator()(const QModelIndex &ind) const { return qHash(ind); }
+    size_t operator()(const QPersistentModelIndex &ind) const { return qHash(ind); }
+  };
+
+  using ExpandedRows = std::unordered_map<QModelIndex, std::vector<int>, IndexHash>;
+
  private:
   int columnWidth(int column, const VisColumnData &visColumnData) const;
 
+  bool columnXRange(int column, int &xl, int &xr) const;
+
   bool hheaderPositionToIndex(PositionData &posData) const;
   bool vheaderPositionToIndex(PositionData &posData) const;
 
+  int positionFlatRow     (int y) const;
+  int positionCellColumn  (int x) const;
+  int positionHeaderColumn(int x) const;
+
   void initDrawGrid() const;
 
   void drawCells(QPainter *painter) const;
@@ -492,23 +613,32 @@ class CQModelView : public QAbstractItemView {
 
   void drawVHeader(QPainter *painter) const;
 
-  void updateRowDatas(); // nvr_, rowDatas_, indRow_
+  void updateRowDatas(); // nvr_, rootNode_
 
   void updateVisRows();    // visRowDatas_
-  void updateVisColumns(); // nvc_, visColumnDatas_
+  void updateVHeaderWidth(); // globalRowData_.vheaderWidth
+  void updateColumnOffsets(); // nvc_, columnOffsets_
+  void updateVisColumns(); // visColumnDatas_
   void updateVisCells();   // visCellDatas_
 
-  void updateHierSelection(const QItemSelection &selection);
+  int visCellRowSlot(int flatRow) const;
+  int visCellSlot(int flatRow, int c) const;
+
+  void updateHierSelection();
 
   bool isNumericColumn(int c) const;
 
   void updateCurrentIndices();
   void updateSelection();
 
+  CQModelViewSelectionModel *viewSelectionModel() const;
+
   void handleMousePress  ();
   void handleMouseMove   ();
   void handleMouseRelease();
 
+  void updateDragSelection(const DragRect &dragRect);
+
   void handleMouseDoubleClick();
 
   void showMenu(const QPoint &pos);
@@ -516,6 +646,9 @@ class CQModelView : public QAbstractItemView {
   void redraw();
   void redraw(const QRect &rect);
 
+  bool canScrollBlit() const;
+  void scrollBlit(int dx, int dy);
+
   void setRolePen  (QPainter *painter, ColorRole role, double alpha=1.0) const;
   void setRoleBrush(QPainter *painter, ColorRole role, double alpha=1.0) const;
 
@@ -526,7 +659,102 @@ class CQModelView : public QAbstractItemView {
   void updateWidgetGeometries();
   void updateScrollBars();
 
-  void initRowDatas(const QModelIndex &parent, int &nvr, int depth, int parentFlatRow);
+  ExpandedRows calcExpandedRows() const;
+  const ExpandedRows &expandedRows() const;
+  void rehashExpanded();
+  void expandedChanged();
+
+  ExpandNode *createExpandNode(const QModelIndex &parent, ExpandNode *parentNode, int row,
+                               int depth, const ExpandedRows &expandedRows);
+  void fillExpandNode(ExpandNode *node, const ExpandedRows &expandedRows);
+  void buildExpandNode(ExpandNode *node);
+  int countExpandRows(const QModelIndex &parent, const ExpandedRows &expandedRows,
+                      int &modelRows) const;
+  void addExpandedRows(const QModelIndex &parent);
+  ExpandNode *findExpandNode(const QModelIndex &parent) const;
+
+  int expandNodeFlatRow(const ExpandNode *node) const;
+  void addExpandNodeFlatRows(ExpandNode *node, int row, int n);
+
+  void setExpandNodeRowVisible(ExpandNode *node, int row, bool visible,
+                               const ExpandedRows &expandedRows);
+  void updateHiddenRows(const QModelIndex &parent, int row1, int row2);
+  void unionHiddenRows(const QModelIndex &parent);
+  void unionHiddenRows();
+  void rebuildRowDatas();
+
+  bool startViewSort();
+  bool restartViewSort();
+  void cancelSort();
+
+  SortKeys validSortKeys() const;
+
+  void sortRows(const QModelIndex &parent, int nr, std::vector<int> &order,
+                SortColumnKeysArray &keys);
+
+  // min rows for background sort and min chunks (cancel/progress granularity)
+  int minBackgroundSortRows  () const { return 100000; }
+  int minBackgroundSortChunks() const { return 64; }
+
+  // max time (ms) of background sort value read slice (gui thread)
+  int sortReadTime() const { return 20; }
+
+  void calcChunkBounds(int nr, std::vector<int> &bounds, int minChunks=1) const;
+
+  // max rows measured for vertical header text width (larger models are sampled)
+  int maxVHeaderMeasureRows() const { return 100000; }
+
+  int vheaderTextWidth(const QFontMetrics &fm, int row) const;
+
+  void readSortValues(const QModelIndex &parent, int nr, const SortKeys &sortKeys,
+                      SortColumnKeysArray &keys, int row1=0) const;
+  void calcSortKeys(int nr, SortColumnKeysArray &keys, SortRun *run=nullptr);
+  void calcSortColumnKeys(const std::vector<int> &bounds, SortColumnKeys &keys,
+                          SortRun *run=nullptr);
+
+  void sortKeyRows(const SortKeys &sortKeys, const SortColumnKeysArray &keys, int nr,
+                   std::vector<int> &order, SortRun *run=nullptr);
+  void partialSortKeyRows(const SortKeys &sortKeys, const SortColumnKeysArray &keys, int nr,
+                          int n, std::vector<int> &order, SortRun *run=nullptr);
+
+  bool isSortKeysValid(const SortColumnKeysArray &keys, const SortKeys &sortKeys,
+                       int nr) const;
+  void readSortKeys(const QModelIndex &parent, int row1, int nr, const SortKeys &sortKeys,
+                    SortColumnKeysArray &keys);
+  const SortColumnKeysArray &nodeSortKeys(ExpandNode *node, const SortKeys &sortKeys, int nr);
+
+  std::function<bool(int, int)> sortRowCompare(const SortKeys &sortKeys,
+                                               const SortColumnKeysArray &keys) const;
+
+  void insertSortedRows(const SortKeys &sortKeys, const SortColumnKeysArray &keys,
+                        std::vector<int> &order, std::vector<int> &rows);
+  void updateSortedRows(const QModelIndex &parent, int row1, int row2);
+
+  void parallelFor(int n, const std::function<void(int)> &func);
+
+  int flatRowPos(const QModelIndex &parent, int row) const;
+  int indexFlatRow(const QModelIndex &ind) const;
+
+  bool flatRowNode(int flatRow, ExpandNode* &node, int &row, int &parentFlatRow) const;
+
+  RowData flatRowData(int flatRow) const;
+
+  const VisRowData *visFlatRowData(int flatRow) const;
+
+  bool isFlatRowOrder() const;
+  QItemSelection flatRowsSelection(int flatRow1, int flatRow2, int column1, int column2) const;
+  QItemSelection flatRectSelection(const DragRect &rect) const;
+
+  QItemSelection visibleRowsSelection() const;
+  QModelIndex flatRowIndex(int flatRow, int column=0) const;
+
+  void updateRowWindow(int flatRow1, int flatRow2);
+
+  void rowDatasChanged();
+
+  bool expandRowDatas(const QModelIndex &index, bool expand);
+  void redrawFlatRows(int flatRow);
+  void redrawFlatRowRange(int flatRow1, int flatRow2);
 
   void drawRow(QPainter *painter, int r, const QModelIndex &parent,
                const VisRowData &visRowData) const;
@@ -544,7 +772,9 @@ class CQModelView : public QAbstractItemView {
   bool maxColumnWidth(int column, const QModelIndex &parent, int depth,
                       int &nvr, int &maxWidth, int maxRows);
 
-  void filterColumn(int column);
+  void applyFilters();
+  void cancelFilter();
+  void resetFilterResult();
 
   QColor roleColor(ColorRole role) const;
 
@@ -568,12 +798,23 @@ class CQModelView : public QAbstractItemView {
   void collapseAll();
   void expandToDepth(int depth);
 
+  void clearSelection();
+
   void selectAllSlot();
+  void invertSelectionSlot();
   void fitAllColumnsSlot();
 
  private Q_SLOTS:
   void modelChangedSlot();
 
+  void rowsAboutToBeInsertedSlot(const QModelIndex &parent, int start, int end);
+  void rowsRemovedSlot(const QModelIndex &parent, int start, int end);
+
+  void layoutAboutToBeChangedSlot();
+  void layoutChangedSlot();
+
+  void headerDataChangedSlot(Qt::Orientation orient, int first, int last);
+
   void hscrollSlot(int v);
   void vscrollSlot(int v);
 
@@ -602,6 +843,10 @@ class CQModelView : public QAbstractItemView {
   void showVerticalEmptySlot(bool b);
 
   void showFilterSlot(bool b);
+  void filterTreeSlot(bool b);
+  void filterExpandSlot(bool b);
+
+  void viewSortSlot(bool b);
   void filterByValueSlot();
 
   void hideColumnSlot();
@@ -616,6 +861,15 @@ class CQModelView : public QAbstractItemView {
   void setHeatmapSlot(bool b);
 
   void editFilterSlot();
+  void filterTextChangedSlot();
+  void filterFinishedSlot(int id);
+  void cancelFilterSlot();
+
+  void cancelSortSlot();
+  void sortReadSlot();
+  void sortProgressSlot(int id, int percent);
+  void sortPartialSlot(int id);
+  void sortFinishedSlot(int id);
 
  private:
   struct GlobalColumnData {
@@ -641,6 +895,7 @@ class CQModelView : public QAbstractItemView {
     int         parentFlatRow { -1 };
     int         flatRow       { 0 };
     int         row           { 0 };
+    int         pos           { 0 };
     int         numRows       { 0 };
     bool        children      { false };
     bool        expanded      { true };
@@ -649,7 +904,129 @@ class CQModelView : public QAbstractItemView {
     RowData(const QModelIndex &parent=QModelIndex(), int row=0, int numRows=0, int flatRow=0,
             bool children=false, bool expanded=true, int depth=0, int parentFlatRow=-1) :
      parent(parent), depth(depth), parentFlatRow(parentFlatRow), flatRow(flatRow), row(row),
-     numRows(numRows), children(children), expanded(expanded) {
+     pos(row), numRows(numRows), children(children), expanded(expanded) {
+    }
+  };
+
+  using IndRow = std::unordered_map<QModelIndex, int, IndexHash>;
+
+  // per flat row data for window of flat rows (visible rows and overscan) stored as
+  // contiguous arrays (structure of arrays), parent index and number of rows are shared
+  // by all rows of the same parent
+  struct RowDatas {
+    enum RowFlag : uchar {
+      CHILDREN = (1<<0),
+      EXPANDED = (1<<1),
+      HIDDEN   = (1<<2)
+    };
+
+    using Indices = std::vector<QModelIndex>;
+    using Ints    = std::vector<int>;
+    using Flags   = std::vector<uchar>;
+
+    int     start { 0 };    // first flat row
+    Indices parents;        // unique parent indices
+    Ints    parentNumRows;  // number of model rows per parent
+    Ints    parentIds;      // per flat row parent (index into parents)
+    Ints    rows;           // per flat row model row
+    Ints    positions;      // per flat row position in parent (sorted row order)
+    Ints    depths;         // per flat row depth
+    Ints    parentFlatRows; // per flat row parent flat row
+    Flags   flags;          // per flat row flags (RowFlag)
+    IndRow  indRow;         // column zero index to flat row
+
+    int size() const { return int(rows.size()); }
+
+    bool empty() const { return rows.empty(); }
+
+    // flat row after last row
+    int end() const { return start + size(); }
+
+    bool contains(int flatRow) const { return (flatRow >= start && flatRow < end()); }
+
+    // clear data (keeps allocated capacity for next window)
+    void clear(int start1=0) {
+      start = start1;
+
+      parents       .clear();
+      parentNumRows .clear();
+      parentIds     .clear();
+      rows          .clear();
+      positions     .clear();
+      depths        .clear();
+      parentFlatRows.clear();
+      flags         .clear();
+      indRow        .clear();
+    }
+
+    void reserve(int n) {
+      auto n1 = uint(std::max(n, 0));
+
+      parentIds     .reserve(n1);
+      rows          .reserve(n1);
+      positions     .reserve(n1);
+      depths        .reserve(n1);
+      parentFlatRows.reserve(n1);
+      flags         .reserve(n1);
+      indRow        .reserve(n1);
+    }
+
+    int addParent(const QModelIndex &parent, int nr) {
+      parents      .push_back(parent);
+      parentNumRows.push_back(nr);
+
+      return int(parents.size()) - 1;
+    }
+
+    int add(const QModelIndex &ind, int parentId, int row, int pos, int depth,
+            int parentFlatRow, bool children, bool expanded) {
+      int flatRow = end();
+
+      parentIds     .push_back(parentId);
+      rows          .push_back(row);
+      positions     .push_back(pos);
+      depths        .push_back(depth);
+      parentFlatRows.push_back(parentFlatRow);
+      flags         .push_back(uchar((children ? CHILDREN : 0) | (expanded ? EXPANDED : 0)));
+
+      indRow[ind] = flatRow;
+
+      return flatRow;
+    }
+
+    uint ind(int flatRow) const { return uint(flatRow - start); }
+
+    const QModelIndex &parent(int flatRow) const {
+      return parents[uint(parentIds[ind(flatRow)])];
+    }
+
+    int row          (int flatRow) const { return rows          [ind(flatRow)]; }
+    int pos          (int flatRow) const { return positions     [ind(flatRow)]; }
+    int depth        (int flatRow) const { return depths        [ind(flatRow)]; }
+    int parentFlatRow(int flatRow) const { return parentFlatRows[ind(flatRow)]; }
+
+    int numRows(int flatRow) const { return parentNumRows[uint(parentIds[ind(flatRow)])]; }
+
+    bool hasChildren(int flatRow) const { return (flags[ind(flatRow)] & CHILDREN); }
+    bool isExpanded (int flatRow) const { return (flags[ind(flatRow)] & EXPANDED); }
+    bool isHidden   (int flatRow) const { return (flags[ind(flatRow)] & HIDDEN  ); }
+
+    // flat row for column zero index (-1 if not in window)
+    int flatRow(const QModelIndex &ind) const {
+      auto p = indRow.find(ind);
+
+      return (p != indRow.end() ? (*p).second : -1);
+    }
+
+    RowData rowData(int flatRow) const {
+      RowData rowData(parent(flatRow), row(flatRow), numRows(flatRow), flatRow,
+                      hasChildren(flatRow), isExpanded(flatRow), depth(flatRow),
+                      parentFlatRow(flatRow));
+
+      rowData.pos    = pos(flatRow);
+      rowData.hidden = isHidden(flatRow);
+
+      return rowData;
     }
   };
 
@@ -657,15 +1034,24 @@ class CQModelView : public QAbstractItemView {
     bool updateScrollBars { false }; // update scrollbars (new rows, columns)
     bool updateRowDatas   { false }; // update flat vertical rows (visibility)
     bool updateVisRows    { false }; // update visible rows (resize, visibility)
+    bool updateColumnOffs { false }; // update column offsets (resize, visibility)
     bool updateVisColumns { false }; // update visible columns (resize, visibility)
     bool updateVisCells   { false }; // update visible cells (resize, visibility)
     bool updateGeometries { false }; // update widgets (resize)
     bool updateSelection  { false }; // update selection
+    bool updateSortOrder  { true  }; // update (not reuse) sorted order of root rows
 
     void updateAll() {
+      updateRowDatas = true;
+
+      updateLayout();
+    }
+
+    // update all but flat rows (column, size or decoration change keeps expanded nodes)
+    void updateLayout() {
       updateScrollBars = true;
-      updateRowDatas   = true;
       updateVisRows    = true;
+      updateColumnOffs = true;
       updateVisColumns = true;
       updateVisCells   = true;
       updateGeometries = true;
@@ -696,14 +1082,16 @@ class CQModelView : public QAbstractItemView {
   };
 
   struct VisCellData {
-    int   depth         { -1 };
-    int   parentFlatRow { -1 };
-    int   flatRow       { -1 };
-    int   r             { -1 };
-    int   nr            { 0 };
-    int   c             { -1 };
-    QRect rect;
-    bool  selected      { false };
+    QModelIndex ind;
+    int         depth         { -1 };
+    int         parentFlatRow { -1 };
+    int         flatRow       { -1 };
+    int         r             { -1 };
+    int         pos           { -1 };
+    int         nr            { 0 };
+    int         c             { -1 };
+    QRect       rect;
+    bool        selected      { false };
   };
 
   struct ScrollData {
@@ -754,15 +1142,14 @@ class CQModelView : public QAbstractItemView {
   using SelModelP          = QPointer<QItemSelectionModel>;
   using DelegateP          = QPointer<QAbstractItemDelegate>;
   using ColumnDatas        = std::vector<ColumnData>;
-  using RowDatas           = std::map<int, RowData>;
-  using IndRow             = std::map<QModelIndex, int>;
   using VisColumnDatas     = std::map<int, VisColumnData>;          // column data
-  using RowVisRowDatas     = std::map<int, VisRowData>;             // row data
-  using VisRowDatas        = std::map<QModelIndex, RowVisRowDatas>; // parent rows
+  using VisRowDatas        = std::vector<VisRowData>; // per visible flat row
   using VisFlatRows        = std::vector<int>;
-  using VisCellDatas       = std::map<QModelIndex, VisCellData>;
+  using VisCellDatas       = std::vector<VisCellData>; // per row slot, column slot
+  using VisCellColumns     = std::vector<int>;         // column slot per column
   using FilterEdits        = std::vector<CQModelViewFilterEdit *>;
   using IndexSet           = std::set<QModelIndex>;
+  using ExpandedSet        = std::unordered_set<QPersistentModelIndex, IndexHash>;
   using ColumnSpan         = std::pair<int, int>;
   using ColumnSpans        = std::vector<ColumnSpan>;
   using RowColumnSpans     = std::map<int, ColumnSpans>;
@@ -778,6 +1165,8 @@ class CQModelView : public QAbstractItemView {
   bool stretchLastColumn_ { false };
   bool multiHeaderLines_  { false };
   bool showFilter_        { false };
+  bool filterTree_        { false };
+  bool filterExpand_      { false };
 
   bool         showVerticalHeader_ { true };
   VerticalType verticalType_       { VerticalType::TEXT };
@@ -785,7 +1174,9 @@ class CQModelView : public QAbstractItemView {
   bool headerOnBottom_ { false };
   bool headerOnRight_  { false };
 
-  bool sortingEnabled_ { false };
+  bool          sortingEnabled_ { false };
+  bool          viewSort_       { false };
+  SortKeys      viewSortKeys_;                // view sort columns (by priority)
 
   bool         showGrid_         { false };
   bool         showHHeaderLines_ { true };
@@ -811,18 +1202,34 @@ class CQModelView : public QAbstractItemView {
   ColumnDatas       columnDatas_;      // per column data
 
   GlobalRowData     globalRowData_;    // global row data
-  RowDatas          rowDatas_;         // per flat row data
-  IndRow            indRow_;           // index to visual row
+  ExpandNode*       rootNode_ { nullptr };   // root expanded node (flat row counts)
+  HiddenRows*       hiddenRows_ { nullptr }; // hidden child rows per parent (user or filter)
+  HiddenRows*       userHiddenRows_ { nullptr }; // rows hidden by setRowHidden/setRowsHidden
+  HiddenRows*       filterHiddenRows_ { nullptr }; // rows hidden by filter
+  VHeaderWidths*    vheaderWidths_ { nullptr }; // cached vertical header text widths
+  RowDatas          rowDatas_;         // per flat row data for visible window
   RowColumnSpans    rowColumnSpans_;   // per header row column spans
 
   State             state_;            // state
 
   ScrollData        scrollData_;       // scroll data (updateScrollBars)
-  VisColumnDatas    visColumnDatas_;   // vis column data (updateVisibleColumns)
+  std::vector<int>  columnOffsets_;    // x of each column (prefix sum of shown widths)
+  int               firstColumn_ { -1 }; // first shown column
+  int               lastColumn_  { -1 }; // last shown column
+  VisColumnDatas    visColumnDatas_;   // vis column data for window (updateVisColumns)
+  std::vector<int>  visColumnOrder_;   // scrolled (not frozen) columns in x order
+  std::vector<int>  visColumnCellX2_;  // right x of cell area per visColumnOrder_ column
+  std::vector<int>  visColumnHeadX2_;  // right x of header section+handle per column
   VisRowDatas       visRowDatas_;      // vis row data (updateVisRows)
+  int               visRowsStart_ { 0 }; // flat row of first vis row data
   VisFlatRows       visFlatRows_;      // visible rows (flat index)
-  VisCellDatas      visCellDatas_;     // vis cell data (updateVisCells)
-  VisCellDatas      ivisCellDatas_;    // vis tree cell data (updateVisCells)
+  int               visRowsY_ { 0 };   // y of flat row zero (updateVisRows)
+  VisCellDatas      visCellDatas_;     // vis cell data per row, column slot (updateVisCells)
+  VisCellDatas      ivisCellDatas_;    // vis tree cell data per row slot (updateVisCells)
+  VisCellColumns    visCellColumns_;   // column slot per column (-1 if not visible)
+  VisCellColumns    visCellColumnIds_; // column per column slot
+  int               visCellNc_ { 0 };  // number of column slots
+  VisCellSlots*     visCellSlots_ { nullptr }; // vis cell index to slot hash
   int               currentFlatRow_ { -1 };
 
   DepthHierCellAreas selDepthHierCellAreas_;
@@ -830,12 +1237,28 @@ class CQModelView : public QAbstractItemView {
   mutable PaintData paintData_;
   MouseData         mouseData_;
   FilterEdits       filterEdits_;
+  FilterRun*        filterRun_    { nullptr }; // running filter (applyFilters)
+  FilterRun*        filterResult_ { nullptr }; // last applied filter (refinement base)
+  QThreadPool*      threadPool_   { nullptr }; // sort chunk thread pool (parallelFor)
+  QThreadPool*      filterPool_   { nullptr }; // filter chunk thread pool
+  SortRun*          sortRun_      { nullptr }; // running background sort
+  QThreadPool*      sortPool_     { nullptr }; // background sort thread
+  int               sortRunId_    { 0 };       // id of last background sort
+  int               sortPercent_  { -1 };      // background sort percent (-1 if none)
+  bool              sortRestart_  { false };   // restart background sort after model change
+  bool              sortStartPending_ { false }; // start background sort after node build
+  std::vector<int>  prevRootOrder_;            // sorted root rows kept for node rebuild
+  QTimer*           filterTimer_  { nullptr }; // filter typing debounce timer
+  QTimer*           sortReadTimer_ { nullptr }; // background sort value read slice timer
+  int               filterRunId_  { 0 };       // id of last filter run
   bool              hierarchical_ { false };
+  bool              hierChecked_  { false }; // hierarchical_ checked for all root rows
   int               freezeColumn_ { -1 };
   int               freezeWidth_  { 0 };
 
-  IndexSet expanded_;
-  bool     ignoreExpanded_ { false };
+  ExpandedSet          expanded_;
+  mutable ExpandedRows expandedRows_;                // expanded rows per parent (cached)
+  mutable bool         expandedRowsValid_ { false };
 
   int numRedraws_ { 0 };
 
@@ -888,8 +1311,102 @@ class CQModelViewSelectionModel : public QItemSelectionModel {
 
   void clearCurrentIndex() override;
 
+  //---
+
+  // selection queries from interval backend (base class selection is not used so
+  // these hide the non-virtual base class queries)
+  QItemSelection selection() const;
+
+  bool isSelected(const QModelIndex &ind) const;
+
+  bool isRowSelected   (int row   , const QModelIndex &parent=QModelIndex()) const;
+  bool isColumnSelected(int column, const QModelIndex &parent=QModelIndex()) const;
+
+  bool rowIntersectsSelection   (int row   , const QModelIndex &parent=QModelIndex()) const;
+  bool columnIntersectsSelection(int column, const QModelIndex &parent=QModelIndex()) const;
+
+  bool hasSelection() const;
+
+  QModelIndexList selectedIndexes() const;
+  QModelIndexList selectedRows   (int column=0) const;
+  QModelIndexList selectedColumns(int row=0) const;
+
+  //---
+
+  // fast (O(log n)) queries of selection backend
+  bool isCellSelected(const QModelIndex &ind) const;
+  bool isCellSelected(int row, int column, const QModelIndex &parent=QModelIndex()) const;
+
+  // any cell of row/column selected
+  bool isAnyRowCellSelected   (int row   , const QModelIndex &parent=QModelIndex()) const;
+  bool isAnyColumnCellSelected(int column, const QModelIndex &parent=QModelIndex()) const;
+
+  // any cell of column selected in any parent
+  bool isColumnInSelection(int column) const;
+
+  bool hasCellSelection() const;
+
+ public Q_SLOTS:
+  void clearSelection();
+
+ private Q_SLOTS:
+  void modelChangedSlot();
+
+  void rowsInsertedSlot        (const QModelIndex &parent, int start, int end);
+  void rowsAboutToBeRemovedSlot(const QModelIndex &parent, int start, int end);
+  void rowsRemovedSlot         (const QModelIndex &parent, int start, int end);
+
+  void columnsInsertedSlot(const QModelIndex &parent, int start, int end);
+  void columnsRemovedSlot (const QModelIndex &parent, int start, int end);
+
+  void layoutAboutToBeChangedSlot();
+  void layoutChangedSlot();
+
+  void modelResetSlot();
+
+ private:
+  struct ParentSelection;
+  struct LayoutColumns;
+  struct LayoutRow;
+
+  using ParentSelections = std::map<QPersistentModelIndex, ParentSelection *>;
+
+  void applySelectionData(const QItemSelection &selection, SelectionFlags command);
+
+  QItemSelection mergeSelectionRanges(const QItemSelection &selection,
+                                      SelectionFlags command) const;
+
+  void clearSelectionData(ParentSelections &parentSelections);
+
+  void copySelectionData(const ParentSelections &src, ParentSelections &dst);
+
+  void commitCurrentSelection();
+
+  void rehashSelectionData();
+
+  void selectionDataChanged();
+
+  void updateSelectionColumns();
+
+  ParentSelection *getParentSelection(const QModelIndex &parent);
+
+  ParentSelection       *findParentSelection(const QModelIndex &parent);
+  const ParentSelection *findParentSelection(const QModelIndex &parent) const;
+
  private:
-  CQModelView* view_ { nullptr };
+  using ModelP = QPointer<QAbstractItemModel>;
+
+  CQModelView*               view_ { nullptr };
+  ModelP                     model_;                      // connected model
+  ParentSelections           parentSelections_;           // selection intervals per parent
+  ParentSelections           currentBase_;                // selection before current update
+  bool                       currentBaseValid_ { false };
+  mutable QItemSelection     selection_;                  // ranges built from intervals
+  mutable bool               selectionValid_ { false };
+  CIntervalSet*              selectionColumns_ { nullptr }; // merged columns of all parents
+  bool                       selectionColumnsValid_ { false };
+  std::vector<LayoutColumns> layoutColumns_;              // columns saved over layout change
+  std::vector<LayoutRow>     layoutRows_;                 // rows saved over layout change
 };
 
 //---
@@ -0,0 +1,178 @@
+#ifndef CBitGrid_H
+#define CBitGrid_H
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+// Grid of bits stored as rows of 64 bit words with word level scanning of runs of
+// set bits and a one sweep decomposition of the set bits into disjoint rectangles.
+class CBitGrid {
+ public:
+  using Word  = uint64_t;
+  using Words = std::vector<Word>;
+
+  static const int WORD_BITS = 64;
+
+  struct Rect {
+    int left { 0 }, top { 0 }, width { -1 }, height { -1 };
+
+    Rect(int l=0, int t=0, int w=-1, int h=-1) :
+     left(l), top(t), width(w), height(h) {
+    }
+
+    int right () const { return left + width  - 1; }
+    int bottom() const { return top  + height - 1; }
+
+    bool isValid() const { return (width > 0 && height > 0); }
+  };
+
+  using Rects = std::vector<Rect>;
+
+ public:
+  CBitGrid() { }
+
+  CBitGrid(int width, int height) {
+    resize(width, height);
+  }
+
+  int width () const { return width_ ; }
+  int height() const { return height_; }
+
+  void resize(int width, int height) {
+    assert(width >= 0 && height >= 0);
+
+    width_  = width;
+    height_ = height;
+    nw_     = (width_ + WORD_BITS - 1)/WORD_BITS;
+
+    words_.assign(size_t(nw_*height_), Word(0));
+  }
+
+  void clear() {
+    std::fill(words_.begin(), words_.end(), Word(0));
+  }
+
+  bool test(int x, int y) const {
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+
+    return (words_[size_t(y*nw_ + x/WORD_BITS)] >> (x % WORD_BITS)) & 1;
+  }
+
+  void set(int x, int y, bool value=true) {
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+
+    Word &word = words_[size_t(y*nw_ + x/WORD_BITS)];
+    Word  mask = Word(1) << (x % WORD_BITS);
+
+    if (value)
+      word |= mask;
+    else
+      word &= ~mask;
+  }
+
+  // call func(x1, x2) for each run of set bits [x1, x2] in row (skips whole words)
+  template<typename FUNC>
+  void rowRuns(int y, FUNC func) const {
+    assert(y >= 0 && y < height_);
+
+    const Word *row = &words_[size_t(y*nw_)];
+
+    int x = 0;
+
+    while (x < width_) {
+      x = nextBit(row, x, true);
+
+      if (x >= width_)
+        break;
+
+      int x2 = nextBit(row, x, false);
+
+      func(x, x2 - 1);
+
+      x = x2;
+    }
+  }
+
+  // disjoint rectangles covering all set bits in O(words + runs): each row is split
+  // into runs and a run matching a run of the previous row extends that rectangle
+  Rects rects() const {
+    Rects rects, active, next;
+
+    for (int y = 0; y < height_; ++y) {
+      next.clear();
+
+      size_t ia = 0;
+
+      rowRuns(y, [&](int x1, int x2) {
+        // close active rectangles left of run
+        while (ia < active.size() && active[ia].left < x1)
+          rects.push_back(active[ia++]);
+
+        if (ia < active.size() && active[ia].left == x1 && active[ia].right() == x2) {
+          auto rect = active[ia++];
+
+          ++rect.height;
+
+          next.push_back(rect);
+        }
+        else
+          next.push_back(Rect(x1, y, x2 - x1 + 1, 1));
+      });
+
+      while (ia < active.size())
+        rects.push_back(active[ia++]);
+
+      std::swap(active, next);
+    }
+
+    for (const auto &rect : active)
+      rects.push_back(rect);
+
+    return rects;
+  }
+
+ private:
+  // index of first bit at or after x with value (width if none)
+  int nextBit(const Word *row, int x, bool value) const {
+    int w = x/WORD_BITS;
+
+    Word word = (value ? row[w] : ~row[w]) & (~Word(0) << (x % WORD_BITS));
+
+    while (! word) {
+      if (++w >= nw_)
+        return width_;
+
+      word = (value ? row[w] : ~row[w]);
+    }
+
+    return std::min(w*WORD_BITS + lowBit(word), width_);
+  }
+
+  // index of lowest set bit of non-zero word
+  static int lowBit(Word w) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#else
+    int i = 0;
+
+    while (! (w & 1)) {
+      w >>= 1;
+
+      ++i;
+    }
+
+    return i;
+#endif
+  }
+
+ private:
+  int   width_  { 0 };
+  int   height_ { 0 };
+  int   nw_     { 0 }; // words per row
+  Words words_;
+};
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef CFenwickTree_H
+#define CFenwickTree_H
+
+#include <vector>
+#include <cstddef>
+#include <cassert>
+
+// Template class for array of values of type VALUE with O(log n) prefix sums (binary
+// indexed tree).
+//
+// Values are expected to be non-negative for lowerBound.
+template<typename VALUE>
+class CFenwickTree {
+ public:
+  using Values = std::vector<VALUE>;
+
+ public:
+  CFenwickTree() { }
+
+  explicit CFenwickTree(const Values &values) {
+    build(values);
+  }
+
+  int size() const { return int(values_.size()); }
+
+  bool empty() const { return values_.empty(); }
+
+  const Values &values() const { return values_; }
+
+  // value at index
+  const VALUE &value(int i) const { return values_[size_t(i)]; }
+
+  // sum of all values
+  const VALUE &total() const { return total_; }
+
+  void clear() {
+    values_.clear();
+    tree_  .assign(1, VALUE());
+
+    total_ = VALUE();
+  }
+
+  // build from values in O(n)
+  void build(const Values &values) {
+    values_ = values;
+
+    buildTree();
+  }
+
+  // set value at index
+  void setValue(int i, const VALUE &v) {
+    addValue(i, v - value(i));
+  }
+
+  // add delta to value at index
+  void addValue(int i, const VALUE &d) {
+    assert(i >= 0 && i < size());
+
+    values_[size_t(i)] += d;
+    total_           += d;
+
+    int n = size();
+
+    for (int j = i + 1; j <= n; j += (j & -j))
+      tree_[size_t(j)] += d;
+  }
+
+  // sum of values [0, i)
+  VALUE prefixSum(int i) const {
+    assert(i >= 0 && i <= size());
+
+    VALUE sum = VALUE();
+
+    for (int j = i; j > 0; j -= (j & -j))
+      sum += tree_[size_t(j)];
+
+    return sum;
+  }
+
+  // sum of values [i1, i2)
+  VALUE rangeSum(int i1, int i2) const {
+    return prefixSum(i2) - prefixSum(i1);
+  }
+
+  // index containing position s, i.e. smallest i where prefixSum(i + 1) > s
+  // (returns size() if s >= total)
+  int lowerBound(VALUE s) const {
+    int n = size();
+
+    int mask = 1;
+
+    while (mask*2 <= n)
+      mask *= 2;
+
+    int pos = 0;
+
+    for ( ; mask > 0; mask /= 2) {
+      int pos1 = pos + mask;
+
+      if (pos1 <= n && tree_[size_t(pos1)] <= s) {
+        pos = pos1;
+        s  -= tree_[size_t(pos1)];
+      }
+    }
+
+    return pos;
+  }
+
+  // append value in O(log n)
+  void append(const VALUE &v) {
+    values_.push_back(v);
+
+    int i = size();
+
+    // node i covers values (i - lowbit(i), i]
+    tree_.push_back(v + prefixSum(i - 1) - prefixSum(i - (i & -i)));
+
+    total_ += v;
+  }
+
+  // insert n values at index (O(size) unless at end)
+  void insert(int i, int n, const VALUE &v) {
+    assert(i >= 0 && i <= size());
+
+    if (i == size()) {
+      for (int j = 0; j < n; ++j)
+        append(v);
+
+      return;
+    }
+
+    values_.insert(values_.begin() + i, size_t(n), v);
+
+    buildTree();
+  }
+
+  // erase n values at index (O(size) unless at end)
+  void erase(int i, int n) {
+    assert(i >= 0 && i + n <= size());
+
+    if (i + n == size()) {
+      // tree nodes only depend on values at or before node index
+      for (int j = 0; j < n; ++j)
+        total_ -= values_[size_t(i + j)];
+
+      values_.resize(size_t(i));
+      tree_  .resize(size_t(i + 1));
+
+      return;
+    }
+
+    values_.erase(values_.begin() + i, values_.begin() + i + n);
+
+    buildTree();
+  }
+
+ private:
+  void buildTree() {
+    int n = size();
+
+    tree_.assign(size_t(n + 1), VALUE());
+
+    total_ = VALUE();
+
+    for (int i = 1; i <= n; ++i) {
+      tree_[size_t(i)] += values_[size_t(i - 1)];
+
+      total_ += values_[size_t(i - 1)];
+
+      int j = i + (i & -i);
+
+      if (j <= n)
+        tree_[size_t(j)] += tree_[size_t(i)];
+    }
+  }
+
+ private:
+  Values values_;             // values
+  Values tree_ { Values(1) }; // tree partial sums (1 based)
+  VALUE  total_ {};           // sum of all values
+};
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef CIntervalSet_H
+#define CIntervalSet_H
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+
+// Set of integers stored as sorted, disjoint closed intervals [start, end].
+// Touching intervals are merged so the interval count is always minimal.
+// contains is O(log n), add/remove/toggle are O(log n + k) for k intervals touched.
+class CIntervalSet {
+ public:
+  struct Interval {
+    int start { 0 };
+    int end   { -1 };
+
+    Interval() { }
+
+    Interval(int start, int end) :
+     start(start), end(end) {
+    }
+
+    int length() const { return end - start + 1; }
+  };
+
+  using Intervals = std::vector<Interval>;
+
+ private:
+  using IntervalMap = std::map<int, int>; // start -> end
+
+ public:
+  using const_iterator = IntervalMap::const_iterator;
+
+ public:
+  CIntervalSet() { }
+
+  CIntervalSet(int start, int end) {
+    add(start, end);
+  }
+
+  bool empty() const { return map_.empty(); }
+
+  // number of intervals
+  int numIntervals() const { return int(map_.size()); }
+
+  // number of values
+  long count() const { return count_; }
+
+  void clear() {
+    map_.clear();
+
+    count_ = 0;
+  }
+
+  const_iterator begin() const { return map_.begin(); }
+  const_iterator end  () const { return map_.end  (); }
+
+  int front() const { assert(! empty()); return map_.begin()->first; }
+  int back () const { assert(! empty()); return map_.rbegin()->second; }
+
+  // true if value in set
+  bool contains(int i) const {
+    auto it = map_.upper_bound(i);
+
+    if (it == map_.begin())
+      return false;
+
+    --it;
+
+    return (i <= it->second);
+  }
+
+  // true if all values in [start, end] in set
+  bool containsAll(int start, int end) const {
+    if (start > end)
+      return true;
+
+    auto it = map_.upper_bound(start);
+
+    if (it == map_.begin())
+      return false;
+
+    --it;
+
+    return (end <= it->second);
+  }
+
+  // true if any value in [start, end] in set
+  bool intersects(int start, int end) const {
+    if (start > end)
+      return false;
+
+    // last interval starting at or before end
+    auto it = map_.upper_bound(end);
+
+    if (it == map_.begin())
+      return false;
+
+    --it;
+
+    return (it->second >= start);
+  }
+
+  // add values [start, end]
+  void add(int start, int end) {
+    if (start > end)
+      return;
+
+    auto it = map_.upper_bound(start);
+
+    // merge with interval overlapping or touching on the left
+    if (it != map_.begin()) {
+      auto pit = std::prev(it);
+
+      if (pit->second >= start - 1) {
+        if (pit->second >= end)
+          return;
+
+        start = pit->first;
+
+        count_ -= pit->second - pit->first + 1;
+
+        map_.erase(pit);
+      }
+    }
+
+    // absorb intervals overlapping or touching on the right
+    while (it != map_.end() && it->first <= end + 1) {
+      end = std::max(end, it->second);
+
+      count_ -= it->second - it->first + 1;
+
+      it = map_.erase(it);
+    }
+
+    map_.emplace_hint(it, start, end);
+
+    count_ += end - start + 1;
+  }
+
+  // remove values [start, end]
+  void remove(int start, int end) {
+    if (start > end)
+      return;
+
+    auto it = map_.upper_bound(start);
+
+    // trim (or split) interval starting at or before start
+    if (it != map_.begin()) {
+      auto pit = std::prev(it);
+
+      if (pit->second >= start) {
+        int s = pit->first;
+        int e = pit->second;
+
+        count_ -= e - s + 1;
+
+        if (s < start) {
+          pit->second = start - 1;
+
+          count_ += pit->second - s + 1;
+        }
+        else
+          map_.erase(pit);
+
+        if (e > end) {
+          map_.emplace_hint(it, end + 1, e);
+
+          count_ += e - end;
+
+          return;
+        }
+      }
+    }
+
+    // remove intervals starting inside range, trimming the last
+    while (it != map_.end() && it->first <= end) {
+      int e = it->second;
+
+      count_ -= e - it->first + 1;
+
+      it = map_.erase(it);
+
+      if (e > end) {
+        map_.emplace_hint(it, end + 1, e);
+
+        count_ += e - end;
+
+        break;
+      }
+    }
+  }
+
+  // flip membership of values [start, end]
+  void toggle(int start, int end) {
+    auto gaps = complement(start, end);
+
+    remove(start, end);
+
+    for (const auto &gap : gaps)
+      add(gap.start, gap.end);
+  }
+
+  // insert n values (not in set) at pos, values at or after pos move up by n
+  // (O(k log n) for k intervals at or after pos)
+  void insert(int pos, int n) {
+    if (n <= 0)
+      return;
+
+    Intervals moved;
+
+    auto it = map_.lower_bound(pos);
+
+    // split interval containing pos
+    if (it != map_.begin()) {
+      auto pit = std::prev(it);
+
+      if (pit->second >= pos) {
+        moved.emplace_back(pos, pit->second);
+
+        pit->second = pos - 1;
+      }
+    }
+
+    for ( ; it != map_.end(); it = map_.erase(it))
+      moved.emplace_back(it->first, it->second);
+
+    for (const auto &interval : moved)
+      map_.emplace_hint(map_.end(), interval.start + n, interval.end + n);
+  }
+
+  // erase n values at pos, values after them move down by n (intervals either side
+  // of pos are merged if they touch)
+  void erase(int pos, int n) {
+    if (n <= 0)
+      return;
+
+    remove(pos, pos + n - 1);
+
+    Intervals moved;
+
+    for (auto it = map_.lower_bound(pos + n); it != map_.end(); it = map_.erase(it)) {
+      moved.emplace_back(it->first, it->second);
+
+      count_ -= it->second - it->first + 1;
+    }
+
+    for (const auto &interval : moved)
+      add(interval.start - n, interval.end - n);
+  }
+
+  // intervals of set clipped to [start, end]
+  Intervals intersection(int start, int end) const {
+    Intervals intervals;
+
+    if (start > end)
+      return intervals;
+
+    auto it = map_.upper_bound(start);
+
+    if (it != map_.begin())
+      --it;
+
+    for ( ; it != map_.end() && it->first <= end; ++it) {
+      if (it->second < start)
+        continue;
+
+      intervals.emplace_back(std::max(it->first, start), std::min(it->second, end));
+    }
+
+    return intervals;
+  }
+
+  // intervals of [start, end] not in set
+  Intervals complement(int start, int end) const {
+    Intervals intervals;
+
+    int pos = start;
+
+    for (const auto &interval : intersection(start, end)) {
+      if (interval.start > pos)
+        intervals.emplace_back(pos, interval.start - 1);
+
+      pos = interval.end + 1;
+    }
+
+    if (pos <= end)
+      intervals.emplace_back(pos, end);
+
+    return intervals;
+  }
+
+  Intervals intervals() const {
+    Intervals intervals;
+
+    for (const auto &p : map_)
+      intervals.emplace_back(p.first, p.second);
+
+    return intervals;
+  }
+
+  friend bool operator==(const CIntervalSet &lhs, const CIntervalSet &rhs) {
+    return (lhs.map_ == rhs.map_);
+  }
+
+  friend bool operator!=(const CIntervalSet &lhs, const CIntervalSet &rhs) {
+    return ! (lhs == rhs);
+  }
+
+ private:
+  IntervalMap map_;
+  long        count_ { 0 };
+};
+
+#endif
@@ -8,7 +8,10 @@
 #include <CQPerfMonitor.h>
 #endif
 
-#include <CLargestRect.h>
+#include <CBitGrid.h>
+#include <CFenwickTree.h>
+#include <CRankBitset.h>
+#include <CIntervalSet.h>
 
 #include <svg/filter_svg.h>
 #include <svg/fit_all_columns_svg.h>
@@ -26,5306 +29,10927 @@
 #include <QContextMenuEvent>
 #include <QMenu>
 #include <QTextLayout>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QThread>
+#include <QSemaphore>
+#include <QCollator>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include <set>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <iterator>
 #include <iostream>
 #include <cmath>
+#include <limits>
 #include <cassert>
 
-CQModelView::
-CQModelView(QWidget *parent) :
- QAbstractItemView(parent), paintData_(this)
-{
-  setObjectName("modelView");
+// typed sort keys of rows for a sort column (number for numeric columns, collator key
+// for others), invalid (non-numeric) values of numeric columns sort last for both orders
+struct CQModelView::SortColumnKeys {
+  using Reals  = std::vector<double>;
+  using Strs   = std::vector<QCollatorSortKey>;
+  using Values = std::vector<QString>;
 
-  //---
+  int    column  { -1 };    // sort column
+  bool   numeric { false }; // is numeric column
+  Reals  reals;             // per row number (NaN if invalid)
+  Strs   strs;              // per row collator key
+  Values values;            // per row string (read in gui thread, converted to strs)
 
-  // headers
-  hh_ = new CQModelViewHeader(Qt::Horizontal, this);
-  vh_ = new CQModelViewHeader(Qt::Vertical  , this);
+  int size() const { return int(numeric ? reals.size() : strs.size()); }
 
-  hsm_ = new QItemSelectionModel;
-  vsm_ = new QItemSelectionModel;
+  bool isValid(int r) const { return (! numeric || ! std::isnan(reals[uint(r)])); }
 
-  hh_->setVisible(true);
-  vh_->setVisible(true);
+  // replace keys of rows from r with keys of other rows
+  void setRows(int r, const SortColumnKeys &keys) {
+    if (numeric)
+      std::copy(keys.reals.begin(), keys.reals.end(), reals.begin() + r);
+    else
+      std::copy(keys.strs.begin(), keys.strs.end(), strs.begin() + r);
+  }
 
-  //---
+  // insert keys of other rows at row r
+  void insertRows(int r, const SortColumnKeys &keys) {
+    if (numeric)
+      reals.insert(reals.begin() + r, keys.reals.begin(), keys.reals.end());
+    else
+      strs.insert(strs.begin() + r, keys.strs.begin(), keys.strs.end());
+  }
 
-  // scrollbars
-  hs_ = horizontalScrollBar();
-  vs_ = verticalScrollBar  ();
+  // append read values (reals if numeric) of other rows
+  void appendValues(const SortColumnKeys &keys) {
+    if (numeric)
+      reals.insert(reals.end(), keys.reals.begin(), keys.reals.end());
+    else
+      values.insert(values.end(), keys.values.begin(), keys.values.end());
+  }
 
-  connect(hs_, SIGNAL(valueChanged(int)), this, SLOT(hscrollSlot(int)));
-  connect(vs_, SIGNAL(valueChanged(int)), this, SLOT(vscrollSlot(int)));
+  // remove keys of n rows at row r
+  void removeRows(int r, int n) {
+    if (numeric)
+      reals.erase(reals.begin() + r, reals.begin() + r + n);
+    else
+      strs.erase(strs.begin() + r, strs.begin() + r + n);
+  }
 
-  //---
+  bool less(int r1, int r2, bool ascending) const {
+    if (numeric) {
+      double k1 = reals[uint(r1)];
+      double k2 = reals[uint(r2)];
 
-  setMouseTracking(true);
+      if (std::isnan(k1)) return false;
+      if (std::isnan(k2)) return true;
 
-  setTabKeyNavigation(true);
+      return (ascending ? k1 < k2 : k2 < k1);
+    }
 
-  setContextMenuPolicy(Qt::DefaultContextMenu);
+    if (ascending)
+      return strs[uint(r1)].compare(strs[uint(r2)]) < 0;
+    else
+      return strs[uint(r2)].compare(strs[uint(r1)]) < 0;
+  }
+};
 
-  // space for headers
-  setViewportMargins(globalColumnData_.headerWidth, globalRowData_.headerHeight, 0, 0);
+// expanded node (root or expanded row), number of flat rows (zero if hidden, one plus
+// descendant flat rows if expanded) of each row are stored in a fenwick tree for
+// O(log n) flat row <-> (parent, row) mapping. When the view is sorted the counts
+// are stored in sorted (position) order and order/pos map position <-> model row.
+// Expanded child nodes are created unbuilt with only their total flat/model row counts
+// and are built (counts, order and child nodes) on first access. Sorted nodes cache the
+// typed sort keys of their rows for resorting changed and inserted rows
+struct CQModelView::ExpandNode {
+  using Children = std::map<int, ExpandNode *>;
+  using Rows     = std::vector<int>;
 
-  //---
+  QPersistentModelIndex parent;                // parent index of rows
+  ExpandNode*           parentNode { nullptr }; // parent node (nullptr for root)
+  int                   row        { -1 };      // row in parent node
+  int                   depth      { 0 };       // depth of rows
+  CFenwickTree<int>     counts;                // number of flat rows per row position
+  Rows                  order;                 // model row at position (empty if unsorted)
+  Rows                  pos;                   // position of model row (empty if unsorted)
+  Children              children;              // expanded rows
+  SortColumnKeysArray   keys;                  // cached sort keys (if sorted)
+  bool                  built      { true };    // counts, order and children created
+  int                   flatRows   { 0 };       // total flat rows (if not built)
+  int                   modelRows  { 0 };       // total model rows (if not built)
 
-  auto *selectionModel = new CQModelViewSelectionModel(this);
+  ExpandNode() { }
 
-  CQModelView::setSelectionModel(selectionModel);
+ ~ExpandNode() {
+    for (auto &pc : children)
+      delete pc.second;
+  }
 
-  //---
+  ExpandNode(const ExpandNode &) = delete;
+  ExpandNode &operator=(const ExpandNode &) = delete;
 
-  cornerWidget_ = new CQModelViewCornerButton(this);
-}
+  int numRows() const { return counts.size(); }
 
-CQModelView::
-~CQModelView()
-{
-  delete hsm_;
-  delete vsm_;
+  int numFlatRows() const { return (built ? counts.total() : flatRows); }
 
-  delete sm_;
-}
+  bool isSorted() const { return ! order.empty(); }
 
-QSize
-CQModelView::
-viewportSizeHint() const
-{
-  QSize result((vh_->isHidden() ? 0 : vh_->width ()) + hh_->length(),
-               (hh_->isHidden() ? 0 : hh_->height()) + vh_->length());
+  // map model row <-> sorted position
+  int rowPos(int r) const { return (isSorted() ? pos  [uint(r)] : r); }
+  int posRow(int p) const { return (isSorted() ? order[uint(p)] : p); }
 
-  result += QSize(verticalScrollBar  ()->isVisible() ? verticalScrollBar  ()->width () : 0,
-                  horizontalScrollBar()->isVisible() ? horizontalScrollBar()->height() : 0);
+  // number of flat rows of row and number of flat rows before row
+  int rowFlatRows  (int r) const { return counts.value    (rowPos(r)); }
+  int rowFlatOffset(int r) const { return counts.prefixSum(rowPos(r)); }
 
-  return result;
-}
+  // get model rows in display order
+  Rows rowOrder() const {
+    if (isSorted())
+      return order;
 
-QAbstractItemModel *
-CQModelView::
-model() const
-{
-  return model_.data();
-}
+    Rows rows;
 
-void
-CQModelView::
-setModel(QAbstractItemModel *model)
-{
-  if (model == model_)
-    return;
+    rows.resize(uint(numRows()));
 
-  // disconnect from old model
-  if (model_) {
-    disconnect(model_, SIGNAL(rowsInserted(QModelIndex, int, int)),
-               this, SLOT(modelChangedSlot()));
-    disconnect(model_, SIGNAL(columnsInserted(QModelIndex, int, int)),
-               this, SLOT(modelChangedSlot()));
-    disconnect(model_, SIGNAL(rowsRemoved(QModelIndex, int, int)),
-               this, SLOT(modelChangedSlot()));
-    disconnect(model_, SIGNAL(columnsRemoved(QModelIndex, int, int)),
-               this, SLOT(modelChangedSlot()));
+    std::iota(rows.begin(), rows.end(), 0);
+
+    return rows;
   }
 
-  if (sm_ && model_)
-    disconnect(sm_, SIGNAL(currentRowChanged(QModelIndex, QModelIndex)), model_, SLOT(submit()));
+  // get flat row count per model row
+  Rows rowCounts() const {
+    int nr = numRows();
 
-  model_ = model;
+    Rows rowCounts;
 
-  // connect to new model
-  if (model_) {
-    connect(model_, SIGNAL(rowsInserted(QModelIndex, int, int)),
-            this, SLOT(modelChangedSlot()));
-    connect(model_, SIGNAL(columnsInserted(QModelIndex, int, int)),
-            this, SLOT(modelChangedSlot()));
-    connect(model_, SIGNAL(rowsRemoved(QModelIndex, int, int)),
-            this, SLOT(modelChangedSlot()));
-    connect(model_, SIGNAL(columnsRemoved(QModelIndex, int, int)),
-            this, SLOT(modelChangedSlot()));
+    rowCounts.resize(uint(nr));
+
+    for (int r = 0; r < nr; ++r)
+      rowCounts[uint(r)] = rowFlatRows(r);
+
+    return rowCounts;
   }
 
-  //---
+  // set sorted row order and flat row counts (per model row)
+  void setOrder(const Rows &order1, const Rows &rowCounts) {
+    int nr = int(order1.size());
 
-  QAbstractItemView::setModel(model_);
+    order = order1;
 
-  if (sm_ && model_) {
-    sm_->setModel(model_);
+    pos.resize(uint(nr));
 
-    QAbstractItemView::setSelectionModel(sm_);
-  }
+    Rows posCounts;
 
-  //---
+    posCounts.resize(uint(nr));
 
-  hh_->setModel(model_);
-  vh_->setModel(model_);
+    for (int p = 0; p < nr; ++p) {
+      int r = order[uint(p)];
 
-  if (model_) {
-    hsm_->setModel(model_);
-    vsm_->setModel(model_);
+      pos[uint(r)] = p;
 
-    hh_->setSelectionModel(hsm_);
-    vh_->setSelectionModel(vsm_);
+      posCounts[uint(p)] = rowCounts[uint(r)];
+    }
+
+    counts.build(posCounts);
   }
 
-  //---
+  // update sorted order of same rows (only changed range of positions [pos1, pos2]
+  // is updated), returns false if no position changed
+  bool updateOrder(const Rows &order1, int &pos1, int &pos2) {
+    int nr = int(order1.size());
 
-  // connect model
-  // update cache
-  state_.updateAll();
+    pos1 = 0;
+    pos2 = nr - 1;
 
-  autoFitted_ = false;
+    while (pos1 < nr && order1[uint(pos1)] == order[uint(pos1)])
+      ++pos1;
 
-  redraw();
+    if (pos1 >= nr)
+      return false;
 
-  emit stateChanged();
-}
+    while (pos2 > pos1 && order1[uint(pos2)] == order[uint(pos2)])
+      --pos2;
 
-void
-CQModelView::
-setRootIndex(const QModelIndex &index)
-{
-  if (index == this->rootIndex()) {
-    viewport()->update();
-    return;
-  }
+    // get moved counts (using old positions) before update
+    Rows posCounts;
 
-  vh_->setRootIndex(index);
-  hh_->setRootIndex(index);
+    for (int p = pos1; p <= pos2; ++p)
+      posCounts.push_back(counts.value(pos[uint(order1[uint(p)])]));
 
-  QAbstractItemView::setRootIndex(index);
-}
+    for (int p = pos1; p <= pos2; ++p) {
+      int r = order1[uint(p)];
 
-void
-CQModelView::
-doItemsLayout()
-{
-  state_.updateAll();
+      order[uint(p)] = r;
+      pos  [uint(r)] = p;
 
-  autoFitted_ = false;
+      counts.setValue(p, posCounts[uint(p - pos1)]);
+    }
 
-  redraw();
+    return true;
+  }
 
-  emit stateChanged();
-}
+  int numModelRows() const {
+    if (! built)
+      return modelRows;
 
-QItemSelectionModel *
-CQModelView::
-selectionModel() const
-{
-  return sm_.data();
-}
+    int n = numRows();
 
-void
-CQModelView::
-setSelectionModel(QItemSelectionModel *sm)
-{
-  // ignore auto model
-  if (! qobject_cast<CQModelViewSelectionModel *>(sm)) {
-    delete sm;
-    return;
+    for (const auto &pc : children)
+      n += pc.second->numModelRows();
+
+    return n;
   }
 
-  if (sm_ && model_)
-    disconnect(sm_, SIGNAL(currentRowChanged(QModelIndex, QModelIndex)), model_, SLOT(submit()));
+  // move expanded rows at or after row by n (rows inserted/removed)
+  void shiftChildren(int row1, int n) {
+    Children children1;
 
-  if (sm_)
-    delete sm_;
+    for (auto &pc : children) {
+      int r = pc.first;
 
-  sm_ = sm;
+      if (r >= row1) {
+        r += n;
 
-  if (model_) {
-    sm_->setModel(model_);
+        pc.second->row = r;
+      }
 
-    QAbstractItemView::setSelectionModel(sm_);
+      children1[r] = pc.second;
+    }
+
+    std::swap(children, children1);
   }
+};
 
-  if (sm_ && model_)
-    connect(sm_, SIGNAL(currentRowChanged(QModelIndex, QModelIndex)), model_, SLOT(submit()));
+// hidden child rows (set bits) per parent, only parents with hidden rows are stored.
+// Parents are keyed by current index and re-keyed from the persistent parent index
+// after model structure changes. Rows are saved as persistent indices while the model
+// layout changes (rows moved/sorted) and the bitsets rebuilt after
+struct CQModelView::HiddenRows {
+  struct ParentRows {
+    QPersistentModelIndex parent;         // persistent parent index
+    bool                  root { false }; // is invalid (root) parent
+    CRankBitset           rows;           // hidden rows
+  };
 
-  redraw();
-}
+  using Parents = std::unordered_map<QModelIndex, ParentRows, IndexHash>;
 
-QAbstractItemDelegate *
-CQModelView::
-itemDelegate() const
-{
-  return delegate_.data();
-}
+  struct LayoutRows {
+    QPersistentModelIndex              parent;            // persistent parent index
+    bool                               root    { false }; // is invalid (root) parent
+    bool                               visible { false }; // inds are visible rows
+    std::vector<QPersistentModelIndex> inds;              // hidden (or visible) rows
+  };
 
-void
-CQModelView::
-setItemDelegate(QAbstractItemDelegate *delegate)
-{
-  delegate_ = delegate;
+  using LayoutParents = std::vector<LayoutRows>;
 
-  QAbstractItemView::setItemDelegate(delegate_);
+  Parents       parents;
+  LayoutParents layoutParents;
 
-  // TODO: connect signals
+  bool empty() const { return parents.empty(); }
 
-  redraw();
-}
+  void clear() { parents.clear(); }
 
-QHeaderView *
-CQModelView::
-horizontalHeader() const
-{
-  return hh_;
-}
+  // get hidden rows of parent (nullptr if none)
+  const CRankBitset *rows(const QModelIndex &parent) const {
+    if (parents.empty()) return nullptr;
 
-QHeaderView *
-CQModelView::
-verticalHeader() const
-{
-  return vh_;
-}
+    auto p = parents.find(parent);
+    if (p == parents.end()) return nullptr;
 
-void
-CQModelView::
-reset()
-{
-  //std::cerr << "CQModelView::reset\n";
+    return &(*p).second.rows;
+  }
 
-  state_.updateAll();
+  bool isHidden(const QModelIndex &parent, int row) const {
+    const auto *rows = this->rows(parent);
 
-  autoFitted_ = false;
+    return (rows && row >= 0 && row < rows->size() && rows->test(row));
+  }
 
-  QAbstractItemView::reset();
-}
+  void setHidden(const QModelIndex &parent, int nr, int row, bool hide) {
+    auto p = parents.find(parent);
 
-void
-CQModelView::
-dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
-{
-  //std::cerr << "CQModelView::dataChanged\n";
+    if (p == parents.end()) {
+      if (! hide) return;
 
-  QAbstractItemView::dataChanged(topLeft, bottomRight, roles);
-}
+      p = addParent(parent);
 
-void
-CQModelView::
-selectColumn(int section, Qt::KeyboardModifiers modifiers)
-{
-  auto parent = rootIndex();
+      (*p).second.rows.resize(nr);
+    }
 
-  auto ind = model_->index(0, section, parent);
+    auto &rows = (*p).second.rows;
 
-  QItemSelection selection;
+    if (row >= rows.size()) {
+      if (! hide) return;
 
-  selection.select(ind, ind);
+      rows.resize(row + 1);
+    }
 
-  if (! (modifiers & Qt::ControlModifier))
-    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Columns);
-  else
-    sm_->select(selection, QItemSelectionModel::Select | QItemSelectionModel::Columns);
+    rows.set(row, hide);
 
-  sm_->setCurrentIndex(ind, QItemSelectionModel::NoUpdate);
-}
+    if (rows.none())
+      parents.erase(p);
+  }
 
-void
-CQModelView::
-selectColumnRange(int section1, int section2, Qt::KeyboardModifiers modifiers)
-{
-  auto parent = rootIndex();
+  void setRows(const QModelIndex &parent, const CRankBitset &rows) {
+    if (rows.none()) {
+      parents.erase(parent);
+      return;
+    }
 
-  auto ind1 = model_->index(0, section1, parent);
-  auto ind2 = model_->index(0, section2, parent);
+    auto p = parents.find(parent);
 
-  QItemSelection selection;
+    if (p == parents.end())
+      p = addParent(parent);
 
-  if (section1 > section2)
-    selection.select(ind1, ind2);
-  else
-    selection.select(ind2, ind1);
+    (*p).second.rows = rows;
+  }
 
-  if (! (modifiers & Qt::ControlModifier))
-    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Columns);
-  else
-    sm_->select(selection, QItemSelectionModel::Select | QItemSelectionModel::Columns);
+  // rows inserted into parent
+  void insertRows(const QModelIndex &parent, int row, int n) {
+    auto p = parents.find(parent);
+    if (p == parents.end()) return;
 
-  sm_->setCurrentIndex(ind2, QItemSelectionModel::NoUpdate);
-}
+    auto &rows = (*p).second.rows;
 
-void
-CQModelView::
-selectRow(int section, Qt::KeyboardModifiers modifiers)
-{
-  auto parent = rootIndex();
+    if (row < rows.size())
+      rows.insert(row, n, false);
+  }
 
-  auto ind = model_->index(section, 0, parent);
+  // rows removed from parent
+  void removeRows(const QModelIndex &parent, int row, int n) {
+    auto p = parents.find(parent);
+    if (p == parents.end()) return;
 
-  QItemSelection selection;
+    auto &rows = (*p).second.rows;
 
-  selection.select(ind, ind);
+    if (row < rows.size())
+      rows.erase(row, std::min(n, rows.size() - row));
 
-  if (! (modifiers & Qt::ControlModifier))
-    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
-  else
-    sm_->select(selection, QItemSelectionModel::Select | QItemSelectionModel::Rows);
+    if (rows.none())
+      parents.erase(p);
+  }
 
-  sm_->setCurrentIndex(ind, QItemSelectionModel::NoUpdate);
-}
+  // re-key parents from persistent parent indices (removed parents are dropped)
+  void rehash() {
+    if (parents.empty())
+      return;
 
-void
-CQModelView::
-selectRowRange(int section1, int section2, Qt::KeyboardModifiers modifiers)
-{
-  auto parent = rootIndex();
+    Parents parents1;
 
-  auto ind1 = model_->index(section1, 0, parent);
-  auto ind2 = model_->index(section2, 0, parent);
+    for (auto &pp : parents) {
+      auto &parentRows = pp.second;
 
-  QItemSelection selection;
+      if (! parentRows.root && ! parentRows.parent.isValid())
+        continue;
 
-  if (section1 < section2)
-    selection.select(ind1, ind2);
-  else
-    selection.select(ind2, ind1);
+      QModelIndex parent;
 
-  if (! (modifiers & Qt::ControlModifier))
-    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
-  else
-    sm_->select(selection, QItemSelectionModel::Select | QItemSelectionModel::Rows);
+      if (! parentRows.root)
+        parent = parentRows.parent;
 
-  sm_->setCurrentIndex(ind2, QItemSelectionModel::NoUpdate);
-}
+      parents1[parent] = std::move(parentRows);
+    }
 
-void
-CQModelView::
-selectCell(const QModelIndex &ind, Qt::KeyboardModifiers modifiers)
-{
-  QItemSelection selection;
+    std::swap(parents, parents1);
+  }
 
-  selection.select(ind, ind);
+  // add hidden rows of other
+  void unite(const HiddenRows &hiddenRows) {
+    for (const auto &pp : hiddenRows.parents) {
+      auto p = parents.find(pp.first);
 
-  if (! (modifiers & Qt::ControlModifier))
-    sm_->select(selection, QItemSelectionModel::ClearAndSelect);
-  else
-    sm_->select(selection, QItemSelectionModel::Select);
+      if (p == parents.end())
+        parents[pp.first] = pp.second;
+      else
+        (*p).second.rows |= pp.second.rows;
+    }
+  }
 
-  sm_->setCurrentIndex(ind, QItemSelectionModel::NoUpdate);
-}
+  // save rows as persistent indices before model layout change (fewest of hidden or
+  // visible rows are saved)
+  void saveLayout(const QAbstractItemModel *model) {
+    layoutParents.clear();
 
-void
-CQModelView::
-selectCellRange(const QModelIndex &ind1, const QModelIndex &ind2, Qt::KeyboardModifiers modifiers)
-{
-  int row1 = ind1.row();
-  int row2 = ind2.row();
+    for (const auto &pp : parents) {
+      const auto &parentRows = pp.second;
 
-  int column1 = ind1.column();
-  int column2 = ind2.column();
+      if (! parentRows.root && ! parentRows.parent.isValid())
+        continue;
 
-  int r1 = std::min(row1, row2);
-  int r2 = std::max(row1, row2);
+      QModelIndex parent;
 
-  int c1 = std::min(column1, column2);
-  int c2 = std::max(column1, column2);
+      if (! parentRows.root)
+        parent = parentRows.parent;
 
-  auto parent = rootIndex();
+      const auto &rows = parentRows.rows;
 
-  auto oind1 = model_->index(r1, c1, parent);
-  auto oind2 = model_->index(r2, c2, parent);
+      int nr = model->rowCount(parent);
 
-  QItemSelection selection;
+      LayoutRows layoutRows;
 
-  selection.select(oind1, oind2);
+      layoutRows.parent  = parentRows.parent;
+      layoutRows.root    = parentRows.root;
+      layoutRows.visible = (2*rows.rank(std::min(nr, rows.size())) > nr);
 
-  if (! (modifiers & Qt::ControlModifier))
-    sm_->select(selection, QItemSelectionModel::ClearAndSelect);
-  else
-    sm_->select(selection, QItemSelectionModel::Select);
+      for (int r = 0; r < nr; ++r) {
+        bool hidden = (r < rows.size() && rows.test(r));
 
-  sm_->setCurrentIndex(ind2, QItemSelectionModel::NoUpdate);
-}
+        if (hidden != layoutRows.visible)
+          layoutRows.inds.push_back(model->index(r, 0, parent));
+      }
 
-void
-CQModelView::
-selectAllSlot()
-{
-  selectAll();
-}
+      layoutParents.push_back(std::move(layoutRows));
+    }
+  }
 
-void
-CQModelView::
-selectAll()
-{
-  if (isHierarchical()) {
-    QItemSelection selection;
+  // rebuild rows from saved persistent indices after model layout change
+  void restoreLayout(const QAbstractItemModel *model) {
+    parents.clear();
 
-    int  row1   = -1;
-    int  row2   = -1;
-    auto parent = rootIndex();
+    for (const auto &layoutRows : layoutParents) {
+      if (! layoutRows.root && ! layoutRows.parent.isValid())
+        continue;
 
-    for (const auto &pr : rowDatas_) {
-      const auto &rowData = pr.second;
+      QModelIndex parent;
 
-      if (row1 >= 0 && rowData.row == row2 + 1 && rowData.parent == parent) {
-        row2 = rowData.row;
-        continue;
-      }
+      if (! layoutRows.root)
+        parent = layoutRows.parent;
 
-      if (row1 >= 0) {
-        auto index1 = model_->index(row1, 0, parent);
-        auto index2 = (row2 != row1 ? model_->index(row2, 0, parent) : index1);
+      int nr = model->rowCount(parent);
 
-        selection.select(index1, index2);
+      CRankBitset rows;
+
+      rows.resize(nr, layoutRows.visible);
+
+      for (const auto &ind : layoutRows.inds) {
+        if (ind.isValid() && ind.parent() == parent && ind.row() < nr)
+          rows.set(ind.row(), ! layoutRows.visible);
       }
 
-      row1   = rowData.row;
-      row2   = rowData.row;
-      parent = rowData.parent;
+      setRows(parent, rows);
     }
 
-    if (row1 >= 0) {
-      auto index1 = model_->index(row1, 0, parent);
-      auto index2 = (row2 != row1 ? model_->index(row2, 0, parent) : index1);
+    layoutParents.clear();
+  }
+
+ private:
+  Parents::iterator addParent(const QModelIndex &parent) {
+    auto &parentRows = parents[parent];
+
+    parentRows.parent = parent;
+    parentRows.root   = ! parent.isValid();
+
+    return parents.find(parent);
+  }
+};
+
+// filter of all rows of parent by conjunction of compiled column filters.
+// Filter column values are read from the model in the gui thread, the values are
+// matched in chunks by FilterTask in the filter thread pool (separate from the sort
+// chunk pool so cancel only waits for filter tasks) and the result is applied
+// (filterFinishedSlot) as a single hidden rows update
+struct CQModelView::FilterRun {
+  // compiled column filter:
+  //  /regexp/          : regular expression (contains)
+  //  <v, <=v, >v, >=v,
+  //  =v, !=v, v        : numeric compare (numeric column)
+  //  v1..v2, v1.., ..v2: numeric inclusive range (numeric column)
+  //  pattern           : wildcard (exact match, literal prefix prefilter)
+  struct Filter {
+    enum class Type { WILDCARD, REGEXP, COMPARE, RANGE };
+    enum class Op   { EQ, NE, LT, LE, GT, GE };
+
+    int     column  { -1 };
+    Type    type    { Type::WILDCARD };
+    QString str;
+    QString prefix;
+    bool    literal { false };
+    QRegExp regexp;
+    Op      op      { Op::EQ };
+    double  value1  { 0.0 };
+    double  value2  { 0.0 };
+
+    void init(int column, const QString &str, bool numeric) {
+      this->column = column;
+      this->str    = str;
+
+      if (str.length() >= 2 && str.startsWith("/") && str.endsWith("/")) {
+        type   = Type::REGEXP;
+        regexp = QRegExp(str.mid(1, str.length() - 2), Qt::CaseSensitive, QRegExp::RegExp2);
+        return;
+      }
 
-      selection.select(index1, index2);
-    }
+      if (numeric && initNumeric(str))
+        return;
 
-    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
-  }
-  else {
-    QAbstractItemView::selectAll();
-  }
-}
+      type = Type::WILDCARD;
 
-void
-CQModelView::
-scrollContentsBy(int dx, int dy)
-{
-  QAbstractItemView::scrollContentsBy(dx, dy);
+      // get literal prefix of wildcard pattern (matching strings must start with it)
+      int prefixLen = 0;
 
-  int dy1 = dy*paintData_.rowHeight;
+      for ( ; prefixLen < str.length(); ++prefixLen) {
+        auto c = str[prefixLen];
 
-  viewport()->scroll(dx, dy1);
-}
+        if (c == '*' || c == '?' || c == '[' || c == '\\')
+          break;
+      }
 
-void
-CQModelView::
-rowsInserted(const QModelIndex &parent, int start, int end)
-{
-  //std::cerr << "CQModelView::rowsInserted\n";
+      prefix  = str.left(prefixLen);
+      literal = (prefixLen == str.length());
+      regexp  = QRegExp(str, Qt::CaseSensitive, QRegExp::Wildcard);
+    }
 
-  QAbstractItemView::rowsInserted(parent, start, end);
-}
+    bool initNumeric(const QString &str) {
+      auto toReal = [](const QString &str, double &r) {
+        bool ok;
 
-void
-CQModelView::
-rowsAboutToBeRemoved(const QModelIndex &parent, int start, int end)
-{
-  //std::cerr << "CQModelView::rowsAboutToBeRemoved\n";
+        r = str.trimmed().toDouble(&ok);
 
-  QAbstractItemView::rowsAboutToBeRemoved(parent, start, end);
-}
+        return ok;
+      };
 
-QModelIndexList
-CQModelView::
-selectedIndexes() const
-{
-  //std::cerr << "CQModelView::selectedIndexes\n";
+      int pos = str.indexOf("..");
 
-  return QAbstractItemView::selectedIndexes();
-}
+      if (pos >= 0) {
+        auto lstr = str.left(pos);
+        auto rstr = str.mid (pos + 2);
 
-void
-CQModelView::
-updateGeometries()
-{
-  //std::cerr << "CQModelView::updateGeometries\n";
+        value1 = -std::numeric_limits<double>::max();
+        value2 =  std::numeric_limits<double>::max();
 
-  QAbstractItemView::updateGeometries();
-}
+        if (lstr.trimmed().length() && ! toReal(lstr, value1)) return false;
+        if (rstr.trimmed().length() && ! toReal(rstr, value2)) return false;
 
-void
-CQModelView::
-selectionChanged(const QItemSelection &selected, const QItemSelection &deselected)
-{
-  state_.updateSelection = true;
+        type = Type::RANGE;
 
-  QAbstractItemView::selectionChanged(selected, deselected);
-}
+        return true;
+      }
 
-void
-CQModelView::
-keyboardSearch(const QString &search)
-{
-  if (! isHierarchical())
-    return QAbstractItemView::keyboardSearch(search);
+      static const std::vector<std::pair<QString, Op>> ops = {
+        {"<=", Op::LE}, {">=", Op::GE}, {"!=", Op::NE},
+        {"<" , Op::LT}, {">" , Op::GT}, {"=" , Op::EQ} };
 
-  auto start = sm_->currentIndex();
+      op = Op::EQ;
 
-  bool again = true;
+      auto vstr = str;
 
-  auto pr = rowDatas_.begin();
+      for (const auto &po : ops) {
+        if (str.startsWith(po.first)) {
+          op   = po.second;
+          vstr = str.mid(po.first.length());
+          break;
+        }
+      }
 
-  while (pr != rowDatas_.end()) {
-    const auto &rowData = (*pr).second;
+      if (! toReal(vstr, value1))
+        return false;
 
-    auto index = model_->index(rowData.row, 0, rowData.parent);
+      type = Type::COMPARE;
 
-    if (index == start)
-      break;
+      return true;
+    }
 
-    ++pr;
-  }
+    // is filter a refinement of (only matches subset of values of) other filter
+    bool isSubset(const Filter &filter) const {
+      if (column != filter.column)
+        return false;
 
-  ++pr;
+      if (str == filter.str)
+        return true;
 
-  if (pr == rowDatas_.end()) {
-    pr = rowDatas_.begin();
+      if (type == Type::WILDCARD && filter.type == Type::WILDCARD) {
+        // text inserted at trailing or leading '*' of other pattern
+        const auto &fstr = filter.str;
 
-    again = false;
-  }
+        int len = fstr.length() - 1;
 
-  while (pr != rowDatas_.end()) {
-    const auto &rowData = (*pr).second;
+        if (len >= 0 && fstr.endsWith("*") && str.startsWith(fstr.left(len)))
+          return true;
 
-    auto index = model_->index(rowData.row, 0, rowData.parent);
+        if (len >= 0 && fstr.startsWith("*") && str.endsWith(fstr.mid(1)))
+          return true;
 
-    auto str = model_->data(index, Qt::DisplayRole).toString();
+        return false;
+      }
 
-    if (str.startsWith(search)) {
-      sm_->setCurrentIndex(index, QItemSelectionModel::NoUpdate);
-      return;
-    }
+      // numeric interval inside other filter interval
+      if (type == Type::RANGE || type == Type::COMPARE) {
+        if (filter.type == Type::RANGE)
+          return (type == Type::RANGE ? (value1 >= filter.value1 && value2 <= filter.value2) :
+                  (op == Op::EQ && filter.matchReal(value1)));
 
-    ++pr;
-  }
+        if (filter.type != Type::COMPARE)
+          return false;
 
-  if (again) {
-    pr = rowDatas_.begin();
+        if (type == Type::RANGE)
+          return (filter.op != Op::NE && filter.matchReal(value1) && filter.matchReal(value2));
 
-    while (pr != rowDatas_.end()) {
-      const auto &rowData = (*pr).second;
+        if (op == Op::EQ)
+          return filter.matchReal(value1);
 
-      auto index = model_->index(rowData.row, 0, rowData.parent);
+        bool less  = (op        == Op::LT || op        == Op::LE);
+        bool fless = (filter.op == Op::LT || filter.op == Op::LE);
 
-      auto str = model_->data(index, Qt::DisplayRole).toString();
+        if (op == Op::NE || filter.op == Op::NE || filter.op == Op::EQ || less != fless)
+          return false;
 
-      if (str.startsWith(search)) {
-        sm_->setCurrentIndex(index, QItemSelectionModel::NoUpdate);
-        return;
+        if (value1 == filter.value1)
+          return (op == filter.op || op == Op::LT || op == Op::GT);
+
+        return (less ? value1 < filter.value1 : value1 > filter.value1);
       }
 
-      if (index == start)
-        break;
+      return false;
+    }
 
-      ++pr;
+    bool matchReal(double r) const {
+      if (type == Type::RANGE)
+        return (r >= value1 && r <= value2);
+
+      switch (op) {
+        case Op::EQ: return (r == value1);
+        case Op::NE: return (r != value1);
+        case Op::LT: return (r <  value1);
+        case Op::LE: return (r <= value1);
+        case Op::GT: return (r >  value1);
+        case Op::GE: return (r >= value1);
+        default:     return false;
+      }
     }
-  }
-}
 
-int
-CQModelView::
-rowHeight(int) const
-{
-  // all rows the same height
-  return globalRowData_.height;
-}
+    bool isNumeric() const { return (type == Type::COMPARE || type == Type::RANGE); }
 
-int
-CQModelView::
-columnWidth(int column) const
-{
-  const_cast<CQModelView *>(this)->updateVisColumns();
+    // match value (regexp must be thread local)
+    bool match(const QVariant &var) {
+      if      (type == Type::WILDCARD) {
+        auto str1 = var.toString();
 
-  //---
+        if (str1 == str)
+          return true;
 
-  auto p = visColumnDatas_.find(column);
-  if (p == visColumnDatas_.end()) return 0;
+        return (! literal && str1.startsWith(prefix) && regexp.exactMatch(str1));
+      }
+      else if (type == Type::REGEXP) {
+        return (regexp.indexIn(var.toString()) >= 0);
+      }
 
-  const auto &visColumnData = (*p).second;
+      bool ok;
 
-  return columnWidth(column, visColumnData);
-}
+      double r = var.toDouble(&ok);
+      if (! ok) return false;
 
-int
-CQModelView::
-columnWidth(int column, const VisColumnData &visColumnData) const
-{
-  if (visColumnData.last && isStretchLastColumn()) {
-    return visColumnData.rect.width();
-  }
-  else {
-    assert(column >= 0);
+      return matchReal(r);
+    }
+  };
 
-    const ColumnData &columnData = columnDatas_[uint(column)];
+  // column values of checked rows for filter (read in gui thread), strings for
+  // wildcard/regexp filter and reals (nan if not real) for numeric filter
+  struct FilterValues {
+    using Strs  = std::vector<QString>;
+    using Reals = std::vector<double>;
 
-    int cw = (columnData.width > 0 ? columnData.width : 100);
+    Strs  strs;
+    Reals reals;
 
-    return cw;
-  }
-}
+    void add(const Filter &filter, const QVariant &var) {
+      if (filter.isNumeric()) {
+        bool ok;
 
-void
-CQModelView::
-setColumnWidth(int column, int width)
-{
-  assert(column >= 0);
+        double r = var.toDouble(&ok);
 
-  ColumnData &columnData = columnDatas_[uint(column)];
+        reals.push_back(ok ? r : std::numeric_limits<double>::quiet_NaN());
+      }
+      else
+        strs.push_back(var.toString());
+    }
 
-  if (columnData.width != width) {
-    columnData.width = width;
+    // match value i (regexp must be thread local)
+    bool match(Filter &filter, int i) const {
+      if      (filter.type == Filter::Type::WILDCARD) {
+        const auto &str1 = strs[uint(i)];
 
-    int cw = (columnData.width > 0 ? columnData.width : 100);
+        if (str1 == filter.str)
+          return true;
 
-    hh_->resizeSection(column, cw);
+        return (! filter.literal && str1.startsWith(filter.prefix) &&
+                filter.regexp.exactMatch(str1));
+      }
+      else if (filter.type == Filter::Type::REGEXP) {
+        return (filter.regexp.indexIn(strs[uint(i)]) >= 0);
+      }
 
-    state_.updateAll();
+      double r = reals[uint(i)];
+      if (std::isnan(r)) return false;
 
-    redraw();
+      return filter.matchReal(r);
+    }
+  };
 
-    emit stateChanged();
-  }
-}
+  // tree filter row (rows stored in pre-order so children follow parent)
+  struct TreeNode {
+    QModelIndex ind;                  // row index
+    int         parentNode  { -1 };   // parent node (-1 for root rows)
+    int         numChildren { 0 };    // number of (fetched) child rows
+  };
 
-bool
-CQModelView::
-columnHeatmap(int column) const
-{
-  assert(column >= 0);
+  using Filters   = std::vector<Filter>;
+  using Values    = std::vector<FilterValues>;
+  using Visible   = std::vector<uchar>;
+  using Rows      = std::vector<int>;
+  using TreeNodes = std::vector<TreeNode>;
+
+  int                 id      { 0 };
+  QAbstractItemModel* model   { nullptr };
+  QModelIndex         parent;                // parent of filtered rows
+  int                 nr      { 0 };         // number of rows
+  Filters             filters;               // column filters (all must match)
+  Values              values;                // column values per filter of check rows
+  Rows                rows;                  // rows to check (all if empty)
+  Visible             visible;               // result per row (per node if tree)
+  bool                tree    { false };     // filter descendants (keep ancestors)
+  bool                expand  { false };     // expand ancestors of tree matches
+  TreeNodes           nodes;                 // rows and descendant rows (tree)
+  Visible             anyVisible;            // node has visible descendant (tree)
+  std::vector<Rows>   outerNodes;            // per chunk parents outside chunk (tree)
+  std::atomic<bool>   cancelled { false };   // cancel request
+  std::atomic<int>    pending   { 0 };       // number of running tasks
+
+  // number of rows to check
+  int numCheckRows() const {
+    if (tree)
+      return int(nodes.size());
+
+    return (rows.empty() ? nr : int(rows.size()));
+  }
+
+  // is filter a refinement of other filter (each other column filter is implied)
+  bool isSubset(const FilterRun &run) const {
+    for (const auto &filter1 : run.filters) {
+      bool implied = false;
+
+      for (const auto &filter : filters) {
+        if (filter.isSubset(filter1)) {
+          implied = true;
+          break;
+        }
+      }
 
-  const ColumnData &columnData = columnDatas_[uint(column)];
+      if (! implied)
+        return false;
+    }
 
-  return columnData.heatmap;
-}
+    return true;
+  }
 
-void
-CQModelView::
-setColumnHeatmap(int column, bool heatmap)
-{
-  assert(column >= 0);
+  // can change of cells [topLeft, bottomRight] change filter result (a filter column
+  // changed for rows of filtered parent, or descendant rows if tree)
+  bool isDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight) const {
+    bool columnChanged = false;
 
-  ColumnData &columnData = columnDatas_[uint(column)];
+    for (const auto &filter : filters) {
+      if (topLeft.column() <= filter.column && bottomRight.column() >= filter.column) {
+        columnChanged = true;
+        break;
+      }
+    }
 
-  if (columnData.heatmap != heatmap) {
-    columnData.heatmap = heatmap;
+    if (! columnChanged)
+      return false;
 
-    redraw();
+    auto changedParent = topLeft.parent();
+
+    if (! tree)
+      return (changedParent == parent);
+
+    for (auto ind = changedParent; ; ind = ind.parent()) {
+      if (ind == parent)
+        return true;
+
+      if (! ind.isValid())
+        return false;
+    }
   }
-}
 
-//---
+  // read filter column values of check rows (gui thread), tree rows are added to nodes
+  void readValues() {
+    values.resize(filters.size());
 
-void
-CQModelView::
-setFreezeFirstColumn(bool b)
-{
-  if (freezeFirstColumn_ != b) {
-    freezeFirstColumn_ = b;
+    if (tree) {
+      for (int r = 0; r < nr; ++r)
+        addTreeNode(parent, r, -1);
 
-    state_.updateAll();
+      return;
+    }
 
-    redraw();
+    int n = numCheckRows();
 
-    emit stateChanged();
-  }
-}
+    for (size_t k = 0; k < filters.size(); ++k) {
+      const auto &filter = filters[k];
 
-//---
+      auto &values1 = values[k];
 
-void
-CQModelView::
-setStretchLastColumn(bool b)
-{
-  if (stretchLastColumn_ != b) {
-    stretchLastColumn_ = b;
+      if (filter.isNumeric())
+        values1.reals.reserve(uint(n));
+      else
+        values1.strs.reserve(uint(n));
 
-    state_.updateAll();
+      for (int i = 0; i < n; ++i) {
+        int r = (rows.empty() ? i : rows[uint(i)]);
 
-    redraw();
+        auto ind = model->index(r, filter.column, parent);
 
-    emit stateChanged();
+        values1.add(filter, model->data(ind, Qt::DisplayRole));
+      }
+    }
   }
-}
 
-//---
+  // add tree node and values for row and its descendants (unfetched children are
+  // skipped as fetchMore would change model during filter)
+  void addTreeNode(const QModelIndex &parent, int r, int parentNode) {
+    int i = int(nodes.size());
 
-void
-CQModelView::
-setMultiHeaderLines(bool b)
-{
-  if (multiHeaderLines_ != b) {
-    multiHeaderLines_ = b;
+    TreeNode node;
 
-    state_.updateAll();
+    node.ind        = model->index(r, 0, parent);
+    node.parentNode = parentNode;
 
-    redraw();
+    nodes.push_back(node);
 
-    emit stateChanged();
-  }
-}
+    for (size_t k = 0; k < filters.size(); ++k) {
+      auto ind = model->index(r, filters[k].column, parent);
 
-//---
+      values[k].add(filters[k], model->data(ind, Qt::DisplayRole));
+    }
 
-void
-CQModelView::
-setShowVerticalHeader(bool b)
-{
-  if (showVerticalHeader_ != b) {
-    showVerticalHeader_ = b;
+    int nr1 = (model->hasChildren(node.ind) ? model->rowCount(node.ind) : 0);
 
-    state_.updateAll();
+    if (nr1 <= 0)
+      return;
 
-    redraw();
+    nodes[uint(i)].numChildren = nr1;
 
-    emit stateChanged();
+    for (int r1 = 0; r1 < nr1; ++r1)
+      addTreeNode(node.ind, r1, i);
   }
-}
 
-void
-CQModelView::
-setVerticalType(VerticalType type)
-{
-  if (verticalType_ != type) {
-    verticalType_ = type;
+  // evaluate check rows [i1, i2) of chunk (check cancel every 1024 rows)
+  void filterRows(int chunk, int i1, int i2) {
+    // copy filters for thread local regexp match state
+    auto filters1 = filters;
 
-    state_.updateAll();
+    for (int i = i1; i < i2; ++i) {
+      if (((i - i1) & 1023) == 0 && cancelled)
+        return;
 
-    redraw();
+      int r = (rows.empty() ? i : rows[uint(i)]);
 
-    emit stateChanged();
+      visible[uint(r)] = matchValues(i, filters1);
+    }
+
+    if (tree)
+      propagateRows(chunk, i1, i2);
   }
-}
 
-//---
+  // tree node visible if node or any descendant matches. Children follow parent in
+  // nodes so propagate to parents in chunk in reverse order, parents in earlier chunks
+  // are saved and merged when all chunks are done
+  void propagateRows(int chunk, int i1, int i2) {
+    auto &outer = outerNodes[uint(chunk)];
 
-void
-CQModelView::
-setHeaderOnBottom(bool b)
-{
-  headerOnBottom_ = b;
+    for (int i = i2 - 1; i >= i1; --i) {
+      if (anyVisible[uint(i)])
+        visible[uint(i)] = 1;
 
-  state_.updateAll();
+      if (! visible[uint(i)])
+        continue;
 
-  redraw();
-}
+      int p = nodes[uint(i)].parentNode;
 
-void
-CQModelView::
-setHeaderOnRight(bool b)
-{
-  headerOnRight_ = b;
+      if      (p >= i1)
+        anyVisible[uint(p)] = 1;
+      else if (p >= 0)
+        outer.push_back(p);
+    }
+  }
 
-  state_.updateAll();
+  // make ancestors of saved chunk parents visible (stop at ancestor already visible
+  // from descendant as its ancestors are already done)
+  void mergeOuterNodes() {
+    for (const auto &outer : outerNodes) {
+      for (int p : outer) {
+        while (p >= 0 && ! anyVisible[uint(p)]) {
+          anyVisible[uint(p)] = 1;
+          visible   [uint(p)] = 1;
 
-  redraw();
-}
+          p = nodes[uint(p)].parentNode;
+        }
+      }
+    }
+  }
 
-//---
+  // match values of check row i
+  bool matchValues(int i, Filters &filters) const {
+    for (size_t k = 0; k < filters.size(); ++k) {
+      if (! values[k].match(filters[k], i))
+        return false;
+    }
 
-void
-CQModelView::
-setShowFilter(bool b)
-{
-  if (showFilter_ != b) {
-    showFilter_ = b;
+    return true;
+  }
+};
 
-    state_.updateAll();
+struct CQModelView::FilterTask : public QRunnable {
+  CQModelView* view      { nullptr };
+  FilterRun*   filterRun { nullptr };
+  int          chunk     { 0 };
+  int          i1        { 0 };
+  int          i2        { 0 };
 
-    redraw();
+  FilterTask(CQModelView *view, FilterRun *filterRun, int chunk, int i1, int i2) :
+   view(view), filterRun(filterRun), chunk(chunk), i1(i1), i2(i2) {
+  }
 
-    if (showFilter_) {
-      int nfe = int(filterEdits_.size());
+  void run() override {
+    filterRun->filterRows(chunk, i1, i2);
 
-      if (nfe > 0)
-        filterEdits_[0]->setFocus();
-    }
+    if (--filterRun->pending == 0 && ! filterRun->cancelled) {
+      int id = filterRun->id;
 
-    emit stateChanged();
+      QMetaObject::invokeMethod(view, "filterFinishedSlot", Qt::QueuedConnection, Q_ARG(int, id));
+    }
   }
-}
-
-//---
+};
 
-void
-CQModelView::
-setSortingEnabled(bool b)
-{
-  if (sortingEnabled_ != b) {
-    sortingEnabled_ = b;
+// background view sort of root rows. Sort values are read in gui thread time slices, keys
+// are extracted and sorted in a worker thread, the first screen of rows is sorted first
+// (partial order) and shown while the full sort runs. The previous order is shown until
+// the partial order is ready
+struct CQModelView::SortRun {
+  using Rows   = std::vector<int>;
+  using RowSet = std::set<int>;
 
-    hh_->setSortIndicatorShown(sortingEnabled_);
+  CQModelView*          view          { nullptr };
+  int                   id            { 0 };
+  QPersistentModelIndex parent;                  // parent of sorted rows
+  int                   nr            { 0 };     // number of sorted rows
+  int                   readRows      { 0 };     // number of rows with read values
+  int                   numPartial    { 0 };     // number of rows in partial sort
+  SortKeys              sortKeys;                // sort columns
+  SortColumnKeysArray   keys;                    // typed sort keys per sort column
+  Rows                  partialOrder;            // first rows sorted (shown while sorting)
+  Rows                  order;                   // full sort order
+  bool                  partialReady  { false }; // partial order shown
+  RowSet                changedRows;             // rows with changed values since start
+  long                  progressTotal { 1 };     // total work (rows processed)
+  std::atomic<long>     progress      { 0 };     // processed work
+  std::atomic<int>      percent       { 0 };     // last reported percent
+  std::atomic<bool>     cancelled     { false }; // cancelled
 
-    auto *proxyModel = qobject_cast<QSortFilterProxyModel *>(model());
+  bool isCancelled() const { return cancelled; }
 
-    if (sortingEnabled_) {
-      if (proxyModel) {
-        if (sortRole_ >= 0)
-          proxyModel->setSortRole(sortRole_);
-      }
+  // add processed work and report changed percent to view
+  void addProgress(long n) {
+    long p = (progress += n);
 
-      sortByColumn(hh_->sortIndicatorSection(), hh_->sortIndicatorOrder());
-    }
-    else {
-      if (proxyModel) {
-        sortRole_ = proxyModel->sortRole();
+    int percent1 = int((100*std::min(p, progressTotal))/progressTotal);
 
-        proxyModel->setSortRole(Qt::InitialSortOrderRole);
+    if (percent1 > percent.exchange(percent1))
+      QMetaObject::invokeMethod(view, "sortProgressSlot", Qt::QueuedConnection,
+                                Q_ARG(int, id), Q_ARG(int, percent1));
+  }
+};
 
-        proxyModel->invalidate();
-      }
-    }
+// task to extract keys and sort rows of sort run in worker thread (stops if cancelled)
+struct CQModelView::SortTask : public QRunnable {
+  CQModelView* view    { nullptr };
+  SortRun*     sortRun { nullptr };
 
-    redraw();
+  SortTask(CQModelView *view, SortRun *sortRun) :
+   view(view), sortRun(sortRun) {
   }
-}
 
-void
-CQModelView::
-setShowGrid(bool b)
-{
-  showGrid_ = b;
+  void run() override {
+    int id = sortRun->id;
 
-  redraw();
-}
+    view->calcSortKeys(sortRun->nr, sortRun->keys, sortRun);
+    if (sortRun->isCancelled()) return;
 
-void
-CQModelView::
-setShowHHeaderLines(bool b)
-{
-  showHHeaderLines_ = b;
+    view->partialSortKeyRows(sortRun->sortKeys, sortRun->keys, sortRun->nr,
+                             sortRun->numPartial, sortRun->partialOrder, sortRun);
 
-  redraw();
-}
+    sortRun->addProgress(sortRun->nr);
+    if (sortRun->isCancelled()) return;
 
-void
-CQModelView::
-setShowVHeaderLines(bool b)
-{
-  showVHeaderLines_ = b;
+    QMetaObject::invokeMethod(view, "sortPartialSlot", Qt::QueuedConnection, Q_ARG(int, id));
 
-  redraw();
-}
+    view->sortKeyRows(sortRun->sortKeys, sortRun->keys, sortRun->nr, sortRun->order, sortRun);
+    if (sortRun->isCancelled()) return;
 
-//---
+    QMetaObject::invokeMethod(view, "sortFinishedSlot", Qt::QueuedConnection, Q_ARG(int, id));
+  }
+};
 
-bool
-CQModelView::
-isCornerButtonEnabled() const
-{
-  return cornerWidget_->isEnabled();
-}
+// task to run one chunk of a parallel loop (see parallelFor)
+struct CQModelView::ParallelTask : public QRunnable {
+  const std::function<void(int)> &func;
+  QSemaphore                     &done;
+  int                             chunk { 0 };
 
-void
-CQModelView::
-setCornerButtonEnabled(bool enabled)
-{
-  if (enabled != cornerWidget_->isEnabled()) {
-    cornerWidget_->setEnabled(enabled);
+  ParallelTask(const std::function<void(int)> &func, QSemaphore &done, int chunk) :
+   func(func), done(done), chunk(chunk) {
+  }
 
-    redraw();
+  void run() override {
+    func(chunk);
+
+    done.release();
   }
-}
+};
 
-//---
+// cached text width of root row vertical header labels. Each row width is stored with
+// a count of rows per width so the max width is kept up to date from only the rows
+// affected by header data changes and row inserts/removes. Models with more than
+// maxRows rows are sampled (first/last and evenly spaced rows) so width is approximate
+struct CQModelView::VHeaderWidths {
+  using Widths      = std::vector<int>;
+  using WidthCounts = std::map<int, int>;
 
-void
-CQModelView::
-setIndentation(int i)
-{
-  if (indentation_ != i) {
-    indentation_ = i;
+  bool        valid       { false }; // widths measured for current rows and font
+  bool        sampled     { false }; // width measured from sample of rows
+  QFont       font;                  // font widths measured with
+  Widths      widths;                // text width per row (-1 if no text), empty if sampled
+  WidthCounts counts;                // number of rows per text width
+  int         sampleWidth { -1 };    // max sampled text width
 
-    state_.updateAll();
+  void invalidate() {
+    valid       = false;
+    sampled     = false;
+    sampleWidth = -1;
 
-    redraw();
+    widths.clear();
+    counts.clear();
+  }
 
-    emit stateChanged();
+  // max text width (-1 if no text)
+  int maxWidth() const {
+    if (sampled)
+      return sampleWidth;
+
+    return (! counts.empty() ? counts.rbegin()->first : -1);
   }
-}
 
-//---
+  // measure all (or sample of) rows using measure(row)
+  template<typename MEASURE>
+  void build(int nr, int maxRows, const MEASURE &measure) {
+    invalidate();
 
-void
-CQModelView::
-setRootIsDecorated(bool b)
-{
-  if (rootIsDecorated_ != b) {
-    rootIsDecorated_ = b;
+    valid = true;
 
-    state_.updateAll();
+    if (nr > maxRows && maxRows > 1) {
+      sampled = true;
 
-    redraw();
+      for (int i = 0; i < maxRows; ++i) {
+        int r = int((long(nr - 1)*i)/(maxRows - 1));
 
-    emit stateChanged();
+        sampleWidth = std::max(sampleWidth, measure(r));
+      }
+    }
+    else {
+      widths.resize(uint(nr));
+
+      for (int r = 0; r < nr; ++r) {
+        widths[uint(r)] = measure(r);
+
+        addCount(widths[uint(r)]);
+      }
+    }
   }
-}
 
-//---
+  // header data of rows [row1, row2] changed
+  template<typename MEASURE>
+  void updateRows(int row1, int row2, int maxRows, const MEASURE &measure) {
+    if (! valid) return;
 
-void
-CQModelView::
-sortByColumn(int column, Qt::SortOrder order)
-{
-  hh_->setSortIndicator(column, order);
+    if (sampled) {
+      // changed rows can only widen sample (re-sample if too many)
+      if (row2 - row1 + 1 > maxRows) { invalidate(); return; }
 
-  sortByColumn(column);
-}
+      for (int r = row1; r <= row2; ++r)
+        sampleWidth = std::max(sampleWidth, measure(r));
 
-void
-CQModelView::
-sortByColumn(int column)
-{
-  if (column < 0 || column >= nc_)
-    return;
+      return;
+    }
 
-  model()->sort(column, hh_->sortIndicatorOrder());
+    row2 = std::min(row2, int(widths.size()) - 1);
 
-  redraw();
-}
+    for (int r = std::max(row1, 0); r <= row2; ++r) {
+      int w = measure(r);
 
-//---
+      removeCount(widths[uint(r)]);
 
-void
-CQModelView::
-resizeEvent(QResizeEvent *)
-{
-  visualRect_ = viewport()->rect();
+      widths[uint(r)] = w;
 
-  state_.updateAll();
+      addCount(w);
+    }
+  }
 
-  emit stateChanged();
-}
+  // n rows inserted at row
+  template<typename MEASURE>
+  void insertRows(int row, int n, int maxRows, const MEASURE &measure) {
+    if (! valid) return;
 
-void
-CQModelView::
-modelChangedSlot()
-{
-  state_.updateAll();
-
-  autoFitted_ = false;
-
-  redraw();
-
-  emit stateChanged();
-}
+    if (sampled || int(widths.size()) + n > maxRows) {
+      if (n > maxRows) { invalidate(); return; }
 
-// update geometry
-// depends
-//   font, margins, header sizes, filter, viewport size, scrollbars, visible columns
-void
-CQModelView::
-updateWidgetGeometries()
-{
-  if (! state_.updateGeometries)
-    return;
+      if (! sampled) {
+        sampleWidth = maxWidth();
+        sampled     = true;
 
-  state_.updateGeometries = false;
+        widths.clear();
+        counts.clear();
+      }
 
-  //---
+      for (int r = row; r < row + n; ++r)
+        sampleWidth = std::max(sampleWidth, measure(r));
 
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::updateWidgetGeometries");
-#endif
+      return;
+    }
 
-  updateVisColumns();
+    if (row < 0 || row > int(widths.size())) { invalidate(); return; }
 
-  //---
+    Widths rowWidths;
 
-  int fh = paintData_.fm.height();
+    rowWidths.resize(uint(n));
 
-  globalRowData_.headerHeight = 0;
+    for (int i = 0; i < n; ++i) {
+      rowWidths[uint(i)] = measure(row + i);
 
-  using ColumnStrs = std::map<int, QStringList>;
+      addCount(rowWidths[uint(i)]);
+    }
 
-  ColumnStrs columnStrs;
-  int        ncr = 0;
+    widths.insert(widths.begin() + row, rowWidths.begin(), rowWidths.end());
+  }
 
-  for (int c = 0; c < nc_; ++c) {
-    if (isColumnHidden(c))
-      continue;
+  // n rows removed at row (sampled width is kept)
+  void removeRows(int row, int n) {
+    if (! valid || sampled) return;
 
-    auto data = model_->headerData(c, Qt::Horizontal, Qt::DisplayRole);
+    if (row < 0 || row + n > int(widths.size())) { invalidate(); return; }
 
-    auto str = data.toString();
+    for (int r = row; r < row + n; ++r)
+      removeCount(widths[uint(r)]);
 
-    if (isMultiHeaderLines()) {
-      auto strs = str.split(QRegExp("\n|\r\n|\r"));
+    widths.erase(widths.begin() + row, widths.begin() + row + n);
+  }
 
-      int ns = strs.size();
+  void addCount(int w) {
+    if (w >= 0)
+      ++counts[w];
+  }
 
-      ncr = std::max(ncr, ns);
+  void removeCount(int w) {
+    if (w < 0) return;
 
-      for (int i = 0; i < ns; ++i)
-        columnStrs[c].push_back(strs[i]);
-    }
-    else  {
-      columnStrs[c].push_back(str);
+    auto p = counts.find(w);
+    if (p == counts.end()) return;
 
-      ncr = 1;
-    }
+    if (--(*p).second <= 0)
+      counts.erase(p);
   }
+};
 
-  //---
+// open addressing (linear probe) hash of visible cell model index to cell slot.
+// The table only grows and entries are stamped with a generation so rebuilding it on
+// each visible cell update neither allocates nor clears the table
+struct CQModelView::VisCellSlots {
+  struct Entry {
+    QModelIndex ind;
+    int         slot { -1 };
+    uint        gen  { 0 }; // generation entry was added in (empty if not current)
+  };
 
-  rowColumnSpans_.clear();
+  using Entries = std::vector<Entry>;
 
-  //---
+  Entries entries;   // table (size is power of two)
+  size_t  mask { 0 };
+  uint    gen  { 0 }; // current generation
 
-  using RowStrs = std::map<int, QStringList>;
+  // clear for n indices (load factor at most 1/2)
+  void reset(int n) {
+    size_t size = 16;
 
-  if (isMultiHeaderLines()) {
-    // pad from front (lines are bottom to top)
-    for (auto &pcs : columnStrs) {
-      auto &strs = pcs.second;
+    while (size < 2*size_t(n))
+      size *= 2;
 
-      while (strs.size() < ncr)
-        strs.push_front("");
-    }
+    if (entries.size() < size)
+      entries.resize(size);
 
-    //---
+    mask = entries.size() - 1;
 
-    RowStrs rowStrs;
+    // invalidate all entries by moving to next generation (only clear on wrap)
+    if (++gen == 0) {
+      for (auto &entry : entries)
+        entry.gen = 0;
 
-    for (int r = 0; r < ncr; ++r) {
-      for (int c = 0; c < nc_; ++c) {
-        rowStrs[r].push_back(columnStrs[c][r]);
-      }
+      gen = 1;
     }
+  }
 
-    //---
+  bool isUsed(const Entry &entry) const { return entry.gen == gen; }
 
-    for (auto &prs : rowStrs) {
-      int   r    = prs.first;
-      auto &strs = prs.second;
+  void add(const QModelIndex &ind, int slot) {
+    size_t i = IndexHash()(ind) & mask;
 
-      int nc = strs.size();
+    while (isUsed(entries[i]))
+      i = (i + 1) & mask;
 
-      int c1 = 0;
+    entries[i].ind  = ind;
+    entries[i].slot = slot;
+    entries[i].gen  = gen;
+  }
 
-      while (c1 + 1 < nc) {
-        int c2 = c1;
+  // slot of index (-1 if not visible)
+  int find(const QModelIndex &ind) const {
+    if (entries.empty()) return -1;
 
-        while (c2 + 1 < nc && strs[c2 + 1] == strs[c1])
-          ++c2;
+    size_t i = IndexHash()(ind) & mask;
 
-        if (c2 > c1)
-          rowColumnSpans_[r].push_back(ColumnSpan(c1, c2));
+    while (isUsed(entries[i])) {
+      if (entries[i].ind == ind)
+        return entries[i].slot;
 
-        c1 = c2 + 1;
-      }
+      i = (i + 1) & mask;
     }
+
+    return -1;
   }
+};
 
-  //---
+CQModelView::
+CQModelView(QWidget *parent) :
+ QAbstractItemView(parent), paintData_(this)
+{
+  setObjectName("modelView");
 
-  globalRowData_   .headerHeight = ncr*(fh + 1) + 2*globalRowData_.margin;
-  globalColumnData_.headerWidth  = paintData_.fm.horizontalAdvance("X") + 2*globalRowData_.margin;
-  globalRowData_   .height       = fh + globalRowData_.margin;
+  hiddenRows_       = new HiddenRows;
+  userHiddenRows_   = new HiddenRows;
+  filterHiddenRows_ = new HiddenRows;
+  vheaderWidths_    = new VHeaderWidths;
+  visCellSlots_     = new VisCellSlots;
 
-  // space for headers
-  int filterHeight = (isShowFilter() ? fh + 8 : 0);
+  //---
 
-  int lm = 0;
+  // filter while typing (after pause)
+  filterTimer_ = new QTimer(this);
 
-  if (isShowVerticalHeader())
-    lm = std::max(globalColumnData_.headerWidth, globalRowData_.vheaderWidth);
+  filterTimer_->setSingleShot(true);
+  filterTimer_->setInterval(250);
 
-  int mx1 = lm                                        , mx2 = 0;
-  int my1 = globalRowData_.headerHeight + filterHeight, my2 = 0;
+  connect(filterTimer_, SIGNAL(timeout()), this, SLOT(editFilterSlot()));
 
-  if (isHeaderOnRight())
-    std::swap(mx1, mx2);
+  // read background sort values in time slices (between events)
+  sortReadTimer_ = new QTimer(this);
 
-  if (isHeaderOnBottom())
-    std::swap(my1, my2);
+  sortReadTimer_->setSingleShot(true);
+  sortReadTimer_->setInterval(0);
 
-  setViewportMargins(mx1, my1, mx2, my2);
+  connect(sortReadTimer_, SIGNAL(timeout()), this, SLOT(sortReadSlot()));
 
   //---
 
-  // inner viewport
-  auto vrect = viewport()->geometry();
-
-  //---
+  // headers
+  hh_ = new CQModelViewHeader(Qt::Horizontal, this);
+  vh_ = new CQModelViewHeader(Qt::Vertical  , this);
 
-  cornerWidget_->setVisible(isShowVerticalHeader());
+  hsm_ = new QItemSelectionModel;
+  vsm_ = new QItemSelectionModel;
 
-  int cx = 0;
-  int cy = 0;
+  hh_->setVisible(true);
+  vh_->setVisible(true);
 
-  if (isHeaderOnRight())
-    cx = vrect.right();
+  //---
 
-  if (isHeaderOnBottom())
-    cy = vrect.bottom();
+  // scrollbars
+  hs_ = horizontalScrollBar();
+  vs_ = verticalScrollBar  ();
 
-  cornerWidget_->setGeometry(cx, cy, lm, globalRowData_.headerHeight);
+  connect(hs_, SIGNAL(valueChanged(int)), this, SLOT(hscrollSlot(int)));
+  connect(vs_, SIGNAL(valueChanged(int)), this, SLOT(vscrollSlot(int)));
 
   //---
 
-  int hhx = vrect.left();
-  int hhy = vrect.top() - globalRowData_.headerHeight;
+  setMouseTracking(true);
 
-  if (isHeaderOnBottom())
-    hhy = vrect.bottom();
+  setTabKeyNavigation(true);
 
-  hh_->setGeometry(hhx, hhy, vrect.width(), globalRowData_.headerHeight);
+  setContextMenuPolicy(Qt::DefaultContextMenu);
 
-  //---
+  // space for headers
+  setViewportMargins(globalColumnData_.headerWidth, globalRowData_.headerHeight, 0, 0);
 
-  int vhx = vrect.left() - lm;
-  int vhy = vrect.top();
+  //---
 
-  if (isHeaderOnRight())
-    vhx = vrect.right();
+  auto *selectionModel = new CQModelViewSelectionModel(this);
 
-  vh_->setGeometry(vhx, vhy, lm, vrect.height());
+  CQModelView::setSelectionModel(selectionModel);
 
   //---
 
-  const_cast<CQModelView *>(this)->updateScrollBars();
-  const_cast<CQModelView *>(this)->updateVisColumns();
+  cornerWidget_ = new CQModelViewCornerButton(this);
+}
 
-  //---
+CQModelView::
+~CQModelView()
+{
+  cancelFilter();
+  resetFilterResult();
 
-  int nfe = int(filterEdits_.size());
+  cancelSort();
 
-  while (nfe > nvc_) {
-    delete filterEdits_.back();
+  if (sortPool_)
+    sortPool_->waitForDone();
 
-    filterEdits_.pop_back();
+  delete sortPool_;
+  delete filterPool_;
+  delete threadPool_;
 
-    --nfe;
-  }
+  delete rootNode_;
+  delete hiddenRows_;
+  delete userHiddenRows_;
+  delete filterHiddenRows_;
+  delete vheaderWidths_;
+  delete visCellSlots_;
 
-  while (nfe < nvc_) {
-    auto *le = new CQModelViewFilterEdit(this);
-    le->setObjectName(QString("filterEdit%1").arg(nfe));
+  delete hsm_;
+  delete vsm_;
 
-    connect(le, SIGNAL(editingFinished()), this, SLOT(editFilterSlot()));
+  delete sm_;
+}
 
-    filterEdits_.push_back(le);
+QSize
+CQModelView::
+viewportSizeHint() const
+{
+  QSize result((vh_->isHidden() ? 0 : vh_->width ()) + hh_->length(),
+               (hh_->isHidden() ? 0 : hh_->height()) + vh_->length());
 
-    ++nfe;
-  }
+  result += QSize(verticalScrollBar  ()->isVisible() ? verticalScrollBar  ()->width () : 0,
+                  horizontalScrollBar()->isVisible() ? horizontalScrollBar()->height() : 0);
 
-  if (isShowFilter()) {
-    int x = vrect.left();
+  return result;
+}
 
-    int ic = 0;
+QAbstractItemModel *
+CQModelView::
+model() const
+{
+  return model_.data();
+}
 
-    for (const auto &vp : visColumnDatas_) {
-      int c = vp.first;
+void
+CQModelView::
+setModel(QAbstractItemModel *model)
+{
+  if (model == model_)
+    return;
 
-      auto *le = filterEdits_[uint(ic)];
+  // disconnect from old model
+  if (model_) {
+    disconnect(model_, SIGNAL(columnsInserted(QModelIndex, int, int)),
+               this, SLOT(modelChangedSlot()));
+    disconnect(model_, SIGNAL(rowsAboutToBeInserted(QModelIndex, int, int)),
+               this, SLOT(rowsAboutToBeInsertedSlot(QModelIndex, int, int)));
+    disconnect(model_, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+               this, SLOT(rowsRemovedSlot(QModelIndex, int, int)));
+    disconnect(model_, SIGNAL(layoutAboutToBeChanged()),
+               this, SLOT(layoutAboutToBeChangedSlot()));
+    disconnect(model_, SIGNAL(layoutChanged()),
+               this, SLOT(layoutChangedSlot()));
+    disconnect(model_, SIGNAL(columnsRemoved(QModelIndex, int, int)),
+               this, SLOT(modelChangedSlot()));
+    disconnect(model_, SIGNAL(headerDataChanged(Qt::Orientation, int, int)),
+               this, SLOT(headerDataChangedSlot(Qt::Orientation, int, int)));
+
+    disconnect(model_, SIGNAL(rowsAboutToBeInserted(QModelIndex, int, int)),
+               this, SLOT(cancelFilterSlot()));
+    disconnect(model_, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)),
+               this, SLOT(cancelFilterSlot()));
+    disconnect(model_, SIGNAL(columnsAboutToBeInserted(QModelIndex, int, int)),
+               this, SLOT(cancelFilterSlot()));
+    disconnect(model_, SIGNAL(columnsAboutToBeRemoved(QModelIndex, int, int)),
+               this, SLOT(cancelFilterSlot()));
+    disconnect(model_, SIGNAL(layoutAboutToBeChanged()),
+               this, SLOT(cancelFilterSlot()));
+    disconnect(model_, SIGNAL(modelAboutToBeReset()),
+               this, SLOT(cancelFilterSlot()));
+
+    disconnect(model_, SIGNAL(rowsAboutToBeInserted(QModelIndex, int, int)),
+               this, SLOT(cancelSortSlot()));
+    disconnect(model_, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)),
+               this, SLOT(cancelSortSlot()));
+    disconnect(model_, SIGNAL(columnsAboutToBeInserted(QModelIndex, int, int)),
+               this, SLOT(cancelSortSlot()));
+    disconnect(model_, SIGNAL(columnsAboutToBeRemoved(QModelIndex, int, int)),
+               this, SLOT(cancelSortSlot()));
+    disconnect(model_, SIGNAL(layoutAboutToBeChanged()),
+               this, SLOT(cancelSortSlot()));
+    disconnect(model_, SIGNAL(modelAboutToBeReset()),
+               this, SLOT(cancelSortSlot()));
+  }
+
+  cancelFilter();
+  resetFilterResult();
+
+  cancelSort();
+
+  state_.updateSortOrder = true;
 
-      le->setColumn(c);
+  if (sm_ && model_)
+    disconnect(sm_, SIGNAL(currentRowChanged(QModelIndex, QModelIndex)), model_, SLOT(submit()));
 
-      int cw = columnWidth(c);
+  model_ = model;
 
-      le->setGeometry(x, 0, cw, filterHeight);
+  for (auto *hiddenRows : {hiddenRows_, userHiddenRows_, filterHiddenRows_})
+    hiddenRows->clear();
 
-      le->setVisible(true);
+  vheaderWidths_->invalidate();
 
-      auto data = model_->headerData(ic, Qt::Horizontal, Qt::DisplayRole);
+  // connect to new model
+  if (model_) {
+    // rows inserted/removed are spliced into flat rows (rowsInserted, rowsAboutToBeRemoved)
+    connect(model_, SIGNAL(columnsInserted(QModelIndex, int, int)),
+            this, SLOT(modelChangedSlot()));
+    connect(model_, SIGNAL(rowsAboutToBeInserted(QModelIndex, int, int)),
+            this, SLOT(rowsAboutToBeInsertedSlot(QModelIndex, int, int)));
+    connect(model_, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+            this, SLOT(rowsRemovedSlot(QModelIndex, int, int)));
+    connect(model_, SIGNAL(layoutAboutToBeChanged()),
+            this, SLOT(layoutAboutToBeChangedSlot()));
+    connect(model_, SIGNAL(layoutChanged()),
+            this, SLOT(layoutChangedSlot()));
+    connect(model_, SIGNAL(columnsRemoved(QModelIndex, int, int)),
+            this, SLOT(modelChangedSlot()));
+    connect(model_, SIGNAL(headerDataChanged(Qt::Orientation, int, int)),
+            this, SLOT(headerDataChangedSlot(Qt::Orientation, int, int)));
+
+    // filter results are for old rows so stop filter before model structure changes
+    connect(model_, SIGNAL(rowsAboutToBeInserted(QModelIndex, int, int)),
+            this, SLOT(cancelFilterSlot()));
+    connect(model_, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)),
+            this, SLOT(cancelFilterSlot()));
+    connect(model_, SIGNAL(columnsAboutToBeInserted(QModelIndex, int, int)),
+            this, SLOT(cancelFilterSlot()));
+    connect(model_, SIGNAL(columnsAboutToBeRemoved(QModelIndex, int, int)),
+            this, SLOT(cancelFilterSlot()));
+    connect(model_, SIGNAL(layoutAboutToBeChanged()),
+            this, SLOT(cancelFilterSlot()));
+    connect(model_, SIGNAL(modelAboutToBeReset()),
+            this, SLOT(cancelFilterSlot()));
+
+    // background sort rows (snapshot values) change with model structure so stop it
+    // before model structure changes (restarted after change)
+    connect(model_, SIGNAL(rowsAboutToBeInserted(QModelIndex, int, int)),
+            this, SLOT(cancelSortSlot()));
+    connect(model_, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)),
+            this, SLOT(cancelSortSlot()));
+    connect(model_, SIGNAL(columnsAboutToBeInserted(QModelIndex, int, int)),
+            this, SLOT(cancelSortSlot()));
+    connect(model_, SIGNAL(columnsAboutToBeRemoved(QModelIndex, int, int)),
+            this, SLOT(cancelSortSlot()));
+    connect(model_, SIGNAL(layoutAboutToBeChanged()),
+            this, SLOT(cancelSortSlot()));
+    connect(model_, SIGNAL(modelAboutToBeReset()),
+            this, SLOT(cancelSortSlot()));
+  }
 
-      le->setPlaceholderText(data.toString());
+  //---
 
-      x += cw;
+  QAbstractItemView::setModel(model_);
 
-      ++ic;
-    }
-  }
-  else {
-    for (int c = 0; c < nvc_; ++c) {
-      auto *le = filterEdits_[uint(c)];
+  if (sm_ && model_) {
+    sm_->setModel(model_);
 
-      le->setVisible(false);
-    }
+    QAbstractItemView::setSelectionModel(sm_);
   }
-}
-
-// depends:
-//  number of rows, row height, column width, row hidden, column hidden, viewport height
-void
-CQModelView::
-updateScrollBars()
-{
-  if (! state_.updateScrollBars)
-    return;
-
-  state_.updateScrollBars = false;
 
   //---
 
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::updateScrollBars");
-#endif
+  hh_->setModel(model_);
+  vh_->setModel(model_);
 
-  updateVisColumns();
-  updateRowDatas  ();
+  if (model_) {
+    hsm_->setModel(model_);
+    vsm_->setModel(model_);
+
+    hh_->setSelectionModel(hsm_);
+    vh_->setSelectionModel(vsm_);
+  }
 
   //---
 
-  int rowHeight = this->rowHeight(0);
+  // connect model
+  // update cache
+  state_.updateAll();
 
-  int w = 0;
-  int h = nvr_*rowHeight;
+  hierChecked_ = false;
 
-  nvc_ = 0;
+  autoFitted_ = false;
 
-  for (int c = 0; c < nc_; ++c) {
-    if (isColumnHidden(c))
-      continue;
+  redraw();
 
-    ++nvc_;
+  emit stateChanged();
+}
 
-    const ColumnData &columnData = columnDatas_[uint(c)];
+void
+CQModelView::
+setRootIndex(const QModelIndex &index)
+{
+  if (index == this->rootIndex()) {
+    viewport()->update();
+    return;
+  }
 
-    int cw = (columnData.width > 0 ? columnData.width : 100);
+  cancelSort();
 
-    w += cw;
-  }
+  state_.updateSortOrder = true;
 
-  //---
+  vheaderWidths_->invalidate();
 
-  bool vchanged = false;
-  bool hchanged = false;
+  vh_->setRootIndex(index);
+  hh_->setRootIndex(index);
 
-  int ah = viewport()->height();
+  hierChecked_ = false;
 
-  if (h > ah) {
-    scrollData_.nv = (ah + rowHeight - 1)/rowHeight;
+  QAbstractItemView::setRootIndex(index);
+}
 
-    int maxv = nvr_ - scrollData_.nv;
+void
+CQModelView::
+doItemsLayout()
+{
+  state_.updateAll();
 
-    if (! vs_->isVisible() || scrollData_.nv != vs_->pageStep() || maxv != vs_->maximum()) {
-      vs_->setPageStep(scrollData_.nv);
-      vs_->setRange(0, nvr_ - scrollData_.nv);
+  // rows may be moved by layout change
+  vheaderWidths_->invalidate();
 
-      vs_->setVisible(true);
+  rehashExpanded();
 
-      vchanged = true;
-    }
-  }
-  else {
-    scrollData_.nv = -1;
+  hierChecked_ = false;
 
-    if (vs_->isVisible()) {
-      vs_->setVisible(false);
+  state_.updateSortOrder = true;
 
-      vchanged = true;
-    }
+  autoFitted_ = false;
+
+  if (! restartViewSort()) {
+    redraw();
+
+    emit stateChanged();
   }
+}
 
-  //---
+CQModelViewSelectionModel *
+CQModelView::
+selectionModel() const
+{
+  return viewSelectionModel();
+}
 
-  int aw = viewport()->width();
+void
+CQModelView::
+setSelectionModel(QItemSelectionModel *sm)
+{
+  // ignore auto model
+  if (! qobject_cast<CQModelViewSelectionModel *>(sm)) {
+    delete sm;
+    return;
+  }
 
-  if (w > aw) {
-    int maxh = w - aw;
+  if (sm_ && model_)
+    disconnect(sm_, SIGNAL(currentRowChanged(QModelIndex, QModelIndex)), model_, SLOT(submit()));
 
-    if (! hs_->isVisible() || aw != hs_->pageStep() || maxh != hs_->maximum()) {
-      hs_->setPageStep(aw);
-      hs_->setRange(0, w - aw);
+  if (sm_)
+    delete sm_;
 
-      hs_->setVisible(true);
+  sm_ = sm;
 
-      hchanged = true;
-    }
-  }
-  else {
-    if (hs_->isVisible()) {
-      hs_->setVisible(false);
+  if (model_) {
+    sm_->setModel(model_);
 
-      hchanged = true;
-    }
+    QAbstractItemView::setSelectionModel(sm_);
   }
 
-  if (hchanged || vchanged)
-    scrollTo(currentIndex());
+  if (sm_ && model_)
+    connect(sm_, SIGNAL(currentRowChanged(QModelIndex, QModelIndex)), model_, SLOT(submit()));
+
+  redraw();
+}
+
+QAbstractItemDelegate *
+CQModelView::
+itemDelegate() const
+{
+  return delegate_.data();
 }
 
 void
 CQModelView::
-updateCurrentIndices()
+setItemDelegate(QAbstractItemDelegate *delegate)
 {
-  auto ind = sm_->currentIndex();
+  delegate_ = delegate;
 
-  if (ind.isValid()) {
-    auto hind = model_->index(0, ind.column(), QModelIndex());
-    auto vind = model_->index(ind.row   (), 0, ind.parent());
+  QAbstractItemView::setItemDelegate(delegate_);
 
-    hsm_->setCurrentIndex(hind, QItemSelectionModel::NoUpdate);
-    vsm_->setCurrentIndex(vind, QItemSelectionModel::NoUpdate);
+  // TODO: connect signals
 
-    auto p = (vsm_->currentIndex().isValid() ? indRow_.find(vsm_->currentIndex()) : indRow_.end());
+  redraw();
+}
 
-    currentFlatRow_ = (p != indRow_.end() ? (*p).second : -1);
-  }
-  else {
-    hsm_->clearCurrentIndex();
-    vsm_->clearCurrentIndex();
-  }
+QHeaderView *
+CQModelView::
+horizontalHeader() const
+{
+  return hh_;
+}
 
-  redraw();
+QHeaderView *
+CQModelView::
+verticalHeader() const
+{
+  return vh_;
 }
 
 void
 CQModelView::
-updateSelection()
+reset()
 {
-  if (! model_)
-    return;
+  //std::cerr << "CQModelView::reset\n";
 
-  //---
+  for (auto *hiddenRows : {hiddenRows_, userHiddenRows_, filterHiddenRows_})
+    hiddenRows->clear();
 
-  // get selected columns and rows
-  const auto selection = sm_->selection();
+  vheaderWidths_->invalidate();
 
-  std::set<int>         columns;
-  std::set<QModelIndex> rows;
+  resetFilterResult();
 
-  for (auto it = selection.constBegin(); it != selection.constEnd(); ++it) {
-    const auto &range = *it;
+  state_.updateAll();
 
-    for (int c = range.left(); c <= range.right(); ++c)
-      columns.insert(c);
+  rehashExpanded();
 
-    for (int r = range.top(); r <= range.bottom(); ++r) {
-      auto ind = model_->index(r, 0, range.parent());
+  hierChecked_ = false;
 
-      rows.insert(ind);
-    }
-  }
+  autoFitted_ = false;
 
-  //---
+  QAbstractItemView::reset();
 
-  // select horizontal header columns
-  QItemSelection hselection;
+  state_.updateSortOrder = true;
 
-  for (auto &c : columns) {
-    auto hind = model_->index(0, c, QModelIndex());
+  restartViewSort();
+}
 
-    hselection.select(hind, hind);
-  }
+void
+CQModelView::
+dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+  //std::cerr << "CQModelView::dataChanged\n";
 
-  if (hsm_->model())
-    hsm_->select(hselection, QItemSelectionModel::ClearAndSelect);
+  QAbstractItemView::dataChanged(topLeft, bottomRight, roles);
 
-  //---
+  // changed filter column values may no longer match last filter (can't be refined),
+  // restart running filter (values read before change)
+  if (filterResult_ && filterResult_->isDataChanged(topLeft, bottomRight))
+    resetFilterResult();
 
-  // select vertical header rows
-  QItemSelection vselection;
+  if (filterRun_ && filterRun_->isDataChanged(topLeft, bottomRight)) {
+    cancelFilter();
 
-  for (auto &r : rows)
-    vselection.select(r, r);
+    filterTimer_->start();
+  }
 
-  if (vsm_->model())
-    vsm_->select(vselection, QItemSelectionModel::ClearAndSelect);
+  // changed sort column values need resort of changed rows (rows of background
+  // sort are resorted when it finishes)
+  for (const auto &sortKey : viewSortKeys_) {
+    if (topLeft.column() <= sortKey.column && bottomRight.column() >= sortKey.column) {
+      if (state_.updateRowDatas)
+        state_.updateSortOrder = true;
 
-  //---
+      if (sortRun_ && topLeft.parent() == sortRun_->parent) {
+        for (int r = topLeft.row(); r <= bottomRight.row(); ++r)
+          sortRun_->changedRows.insert(r);
+      }
+      else
+        updateSortedRows(topLeft.parent(), topLeft.row(), bottomRight.row());
 
-  redraw();
+      break;
+    }
+  }
 }
 
 void
 CQModelView::
-paintEvent(QPaintEvent *e)
+selectColumn(int section, Qt::KeyboardModifiers modifiers)
 {
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfMonitorInst->resetStartsWith("CQModelView::");
-
-  CQPerfTrace trace("CQModelView::paintEvent");
-#endif
+  auto parent = rootIndex();
 
-  //---
+  auto ind = model_->index(0, section, parent);
 
-  QPainter painter(this->viewport());
+  QItemSelection selection;
 
-//painter.setClipRegion(e->region());
+  selection.select(ind, ind);
 
-  paintRect_ = e->rect();
+  if (! (modifiers & Qt::ControlModifier))
+    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Columns);
+  else
+    sm_->select(selection, QItemSelectionModel::Select | QItemSelectionModel::Columns);
 
-  //---
+  sm_->setCurrentIndex(ind, QItemSelectionModel::NoUpdate);
+}
 
-  auto c = palette().color(QPalette::Base);
+void
+CQModelView::
+selectColumnRange(int section1, int section2, Qt::KeyboardModifiers modifiers)
+{
+  auto parent = rootIndex();
 
-  painter.fillRect(viewport()->rect(), c);
+  auto ind1 = model_->index(0, section1, parent);
+  auto ind2 = model_->index(0, section2, parent);
 
-  auto isDarkColor = [](const QColor &c) {
-    int gray = qGray(c.red(), c.green(), c.blue());
-    return (gray <= 127);
-  };
+  QItemSelection selection;
 
-  isDark_ = isDarkColor(c);
+  if (section1 > section2)
+    selection.select(ind1, ind2);
+  else
+    selection.select(ind2, ind1);
 
-  //---
+  if (! (modifiers & Qt::ControlModifier))
+    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Columns);
+  else
+    sm_->select(selection, QItemSelectionModel::Select | QItemSelectionModel::Columns);
 
-  paintData_.fm = QFontMetrics(font());
+  sm_->setCurrentIndex(ind2, QItemSelectionModel::NoUpdate);
+}
 
-  //---
+void
+CQModelView::
+selectRow(int section, Qt::KeyboardModifiers modifiers)
+{
+  auto ind = flatRowIndex(section);
+  if (! ind.isValid()) return;
 
-#if 0
-  int nr = nr_;
-  int nc = nc_;
-#endif
+  QItemSelection selection;
 
-  if (model_) {
-    auto parent = rootIndex();
+  selection.select(ind, ind);
 
-    nr_ = model_->rowCount   (parent);
-    nc_ = model_->columnCount(parent);
-  }
-  else {
-    nr_ = 0;
-    nc_ = 0;
-  }
+  if (! (modifiers & Qt::ControlModifier))
+    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+  else
+    sm_->select(selection, QItemSelectionModel::Select | QItemSelectionModel::Rows);
 
-  if (nc_ != int(columnDatas_.size())) {
-    columnDatas_.resize(uint(nc_));
-  }
-
-  //---
-
-#if 0
-  // TODO: needed, model signals should handle this
-  if (! state_.updateScrollBars)
-    state_.updateScrollBars = (nc_ != nc || nr_ !=  nr);
-#endif
-
-  //---
-
-  if (autoFitOnShow_) {
-    if (! autoFitted_) {
-      autoFitted_ = true;
-
-      fitAllColumnsSlot();
-    }
-  }
+  sm_->setCurrentIndex(ind, QItemSelectionModel::NoUpdate);
+}
 
-  //---
+void
+CQModelView::
+selectRowRange(int section1, int section2, Qt::KeyboardModifiers modifiers)
+{
+  auto ind2 = flatRowIndex(section2);
+  if (! ind2.isValid()) return;
 
-  if (isShowGrid())
-    initDrawGrid();
+  auto selection = flatRowsSelection(section1, section2, 0, 0);
 
-  //---
+  if (! (modifiers & Qt::ControlModifier))
+    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+  else
+    sm_->select(selection, QItemSelectionModel::Select | QItemSelectionModel::Rows);
 
-  drawCells(&painter);
+  sm_->setCurrentIndex(ind2, QItemSelectionModel::NoUpdate);
+}
 
-  //---
+void
+CQModelView::
+selectCell(const QModelIndex &ind, Qt::KeyboardModifiers modifiers)
+{
+  QItemSelection selection;
 
-  drawAlternateEmpty(&painter);
+  selection.select(ind, ind);
 
-  //---
+  if (! (modifiers & Qt::ControlModifier))
+    sm_->select(selection, QItemSelectionModel::ClearAndSelect);
+  else
+    sm_->select(selection, QItemSelectionModel::Select);
 
-  if (isShowGrid())
-    drawGrid(&painter);
+  sm_->setCurrentIndex(ind, QItemSelectionModel::NoUpdate);
 }
 
 void
 CQModelView::
-drawAlternateEmpty(QPainter *painter)
+selectCellRange(const QModelIndex &ind1, const QModelIndex &ind2, Qt::KeyboardModifiers modifiers)
 {
-  QStyleOptionViewItem opt;
-
-  bool alternateEmpty =
-    style()->styleHint(QStyle::SH_ItemView_PaintAlternatingRowColorsForEmptyArea, &opt, this);
-
-  if (alternateEmpty) {
-    int alternate = 0;
+  int row1 = ind1.row();
+  int row2 = ind2.row();
 
-    if (nvr_ > 0) {
-      int flatRow = visFlatRows_.back();
+  int column1 = ind1.column();
+  int column2 = ind2.column();
 
-      auto pr = rowDatas_.find(flatRow);
-      assert(pr != rowDatas_.end());
+  int r1 = std::min(row1, row2);
+  int r2 = std::max(row1, row2);
 
-      const auto &rowData = (*pr).second;
+  int c1 = std::min(column1, column2);
+  int c2 = std::max(column1, column2);
 
-      //---
+  QItemSelection selection;
 
-      auto pp = visRowDatas_.find(rowData.parent);
-      assert(pp != visRowDatas_.end());
+  if (isFlatRowOrder()) {
+    auto parent = rootIndex();
 
-      const auto &rowVisRowDatas = (*pp).second;
+    auto oind1 = model_->index(r1, c1, parent);
+    auto oind2 = model_->index(r2, c2, parent);
 
-      auto ppr = rowVisRowDatas.find(rowData.row);
-      assert(ppr != rowVisRowDatas.end());
+    selection.select(oind1, oind2);
+  }
+  else {
+    // select displayed (flat) rows between indices
+    int flatRow1 = indexFlatRow(ind1);
+    int flatRow2 = indexFlatRow(ind2);
+    if (flatRow1 < 0 || flatRow2 < 0) return;
 
-      const auto &visRowData = (*ppr).second;
+    selection = flatRowsSelection(flatRow1, flatRow2, c1, c2);
+  }
 
-      alternate = (visRowData.flatRow & 1);
-    }
+  if (! (modifiers & Qt::ControlModifier))
+    sm_->select(selection, QItemSelectionModel::ClearAndSelect);
+  else
+    sm_->select(selection, QItemSelectionModel::Select);
 
-    int y = nvr_*paintData_.rowHeight;
+  sm_->setCurrentIndex(ind2, QItemSelectionModel::NoUpdate);
+}
 
-    while (y < paintData_.vh) {
-      alternate = 1 - alternate;
+// get selection of cells in flat row and column range
+QItemSelection
+CQModelView::
+flatRectSelection(const DragRect &rect) const
+{
+  if (isFlatRowOrder()) {
+    QItemSelection selection;
 
-      if (alternate)
-        setRoleBrush(painter, ColorRole::AlternateBg);
-      else
-        setRoleBrush(painter, ColorRole::Base);
+    auto parent = rootIndex();
 
-      opt.rect = QRect(0, y, paintData_.vw, paintData_.rowHeight);
+    auto ind1 = model_->index(rect.flatRow1, rect.column1, parent);
+    auto ind2 = model_->index(rect.flatRow2, rect.column2, parent);
 
-      painter->fillRect(opt.rect, painter->brush());
+    selection.select(ind1, ind2);
 
-      y += paintData_.rowHeight;
-    }
+    return selection;
   }
+
+  return flatRowsSelection(rect.flatRow1, rect.flatRow2, rect.column1, rect.column2);
 }
 
-void
+// are flat rows the same as model rows of root (not hierarchical, sorted or with hidden rows)
+bool
 CQModelView::
-initDrawGrid() const
+isFlatRowOrder() const
 {
-  QStyleOptionViewItem option;
-
-  int gridHint = style()->styleHint(QStyle::SH_Table_GridLineColor, &option, this);
-
-  auto gridColor = QColor(static_cast<QRgb>(gridHint));
-
-  paintData_.gridPen = QPen(gridColor, 0, gridStyle());
+  return (! isHierarchical() && ! isViewSorted() && hiddenRows_->empty());
 }
 
-void
+// get selection of columns for displayed (flat) rows, contiguous model rows of
+// the same parent are combined into a single range
+QItemSelection
 CQModelView::
-drawGrid(QPainter *painter)
+flatRowsSelection(int flatRow1, int flatRow2, int column1, int column2) const
 {
-  setRolePen(painter, ColorRole::GridFg);
+  QItemSelection selection;
 
-  for (const auto &pp : visRowDatas_) {
-    const auto &rowVisRowDatas = pp.second;
+  if (flatRow1 > flatRow2)
+    std::swap(flatRow1, flatRow2);
 
-    for (const auto &pr : rowVisRowDatas) {
-      const auto &visRowData = pr.second;
+  if (isFlatRowOrder()) {
+    auto parent = rootIndex();
 
-      int x1 = visRowData.rect.left();
-//    int y1 = visRowData.rect.top();
-      int y2 = visRowData.rect.bottom() - 1;
+    selection.select(model_->index(flatRow1, column1, parent),
+                     model_->index(flatRow2, column2, parent));
 
-      painter->drawLine(x1, y2, paintData_.vw - x1, y2);
-    }
+    return selection;
   }
 
-  int y1 = 0;
+  QModelIndex parent;
+  int         row1 = -1, row2 = -1;
 
-  for (const auto &pv : visColumnDatas_) {
-    const auto &visColumnData = pv.second;
+  auto addRange = [&]() {
+    if (row1 >= 0)
+      selection.select(model_->index(row1, column1, parent),
+                       model_->index(row2, column2, parent));
+  };
 
-    if (! visColumnData.visible)
+  for (int flatRow = flatRow1; flatRow <= flatRow2; ++flatRow) {
+    auto rowData = flatRowData(flatRow);
+
+    if (rowData.row < 0 || rowData.row >= rowData.numRows)
+      break;
+
+    if (row1 >= 0 && rowData.parent == parent && rowData.row == row2 + 1) {
+      row2 = rowData.row;
       continue;
+    }
 
-//  int x1 = visColumnData.rect.left ();
-    int x2 = visColumnData.rect.right();
+    addRange();
 
-    painter->drawLine(x2, y1, x2, paintData_.vh - y1);
+    parent = rowData.parent;
+    row1   = rowData.row;
+    row2   = row1;
   }
+
+  addRange();
+
+  return selection;
 }
 
 void
 CQModelView::
-drawCells(QPainter *painter) const
+selectAllSlot()
 {
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::drawCells");
-#endif
-
-  const_cast<CQModelView *>(this)->updateScrollBars      ();
-  const_cast<CQModelView *>(this)->updateVisCells        ();
-  const_cast<CQModelView *>(this)->updateWidgetGeometries();
-
-  //---
-
-  paintData_.reset();
+  selectAll();
+}
 
-  paintData_.vrect     = viewport()->rect();
-  paintData_.vw        = paintData_.vrect.width ();
-  paintData_.vh        = paintData_.vrect.height();
-  paintData_.margin    = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
-  paintData_.rowHeight = this->rowHeight(0);
+void
+CQModelView::
+selectAll()
+{
+  if (isHierarchical()) {
+    auto selection = visibleRowsSelection();
 
-  if (iconSize().isValid()) {
-    paintData_.decorationSize = iconSize();
+    sm_->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
   }
   else {
-    int pm = style()->pixelMetric(QStyle::PM_SmallIconSize, nullptr, this);
-
-    paintData_.decorationSize = QSize(pm, pm);
+    QAbstractItemView::selectAll();
   }
+}
 
-  paintData_.showDecorationSelected =
-    style()->styleHint(QStyle::SH_ItemView_ShowDecorationSelected, nullptr, this);
-
-  //---
-
-  drawCellsRows(painter);
-
-  drawCellsSelection(painter);
+void
+CQModelView::
+invertSelectionSlot()
+{
+  invertSelection();
 }
 
 void
 CQModelView::
-drawCellsRows(QPainter *painter) const
+invertSelection()
 {
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::drawCellsRows");
-#endif
+  if (! model_ || ! sm_)
+    return;
 
-  // draw rows
-  for (const auto &flatRow : visFlatRows_) {
-    auto pr = rowDatas_.find(flatRow);
-    assert(pr != rowDatas_.end());
+  // toggle all visible cells (interval backend makes this O(ranges))
+  QItemSelection selection;
 
-    const auto &rowData = (*pr).second;
+  if (isHierarchical())
+    selection = visibleRowsSelection();
+  else {
+    int nr = model_->rowCount   (rootIndex());
+    int nc = model_->columnCount(rootIndex());
 
-    //---
+    if (nr <= 0 || nc <= 0)
+      return;
 
-    auto pp = visRowDatas_.find(rowData.parent);
-    if (pp == visRowDatas_.end()) continue;
+    auto index1 = model_->index(0     , 0     , rootIndex());
+    auto index2 = model_->index(nr - 1, nc - 1, rootIndex());
 
-    const auto &rowVisRowDatas = (*pp).second;
+    selection.select(index1, index2);
+  }
 
-    auto ppr = rowVisRowDatas.find(rowData.row);
-    if (ppr == rowVisRowDatas.end()) continue;
+  if (selection.empty())
+    return;
 
-    const auto &visRowData = (*ppr).second;
+  auto flags = QItemSelectionModel::SelectionFlags(QItemSelectionModel::Toggle);
 
-    //---
+  if (isHierarchical() || selectionBehavior() == SelectRows)
+    flags |= QItemSelectionModel::Rows;
 
-    drawRow(painter, rowData.row, rowData.parent, visRowData);
-  }
+  sm_->select(selection, flags);
 }
 
-void
+// selection of visible row ranges of each expanded node
+QItemSelection
 CQModelView::
-drawCellsSelection(QPainter *painter) const
+visibleRowsSelection() const
 {
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::drawCellsSelection");
-#endif
+  const_cast<CQModelView *>(this)->updateRowDatas();
 
-  const_cast<CQModelView *>(this)->updateVisCells();
+  QItemSelection selection;
 
-  // draw selection
-  auto drawSelection = [&](const QRect &r) {
-    setRolePen  (painter, ColorRole::SelectionFg, 0.7);
-    setRoleBrush(painter, ColorRole::SelectionBg, 0.3);
+  std::vector<ExpandNode *> nodes;
 
-    painter->fillRect(r, painter->brush());
+  if (rootNode_)
+    nodes.push_back(rootNode_);
 
-    setRoleBrush(painter, ColorRole::None);
+  while (! nodes.empty()) {
+    auto *node = nodes.back();
 
-    painter->drawRect(r.adjusted(0, 0, -1, -1));
-  };
+    nodes.pop_back();
 
-  const auto selection = sm_->selection();
+    const_cast<CQModelView *>(this)->buildExpandNode(node);
 
-  if (selection.empty())
-    return;
+    QModelIndex parent = node->parent;
 
-  if (isHierarchical()) {
-    const_cast<CQModelView *>(this)->updateHierSelection(selection);
+    int nr   = node->numRows();
+    int row1 = -1;
+
+    for (int r = 0; r <= nr; ++r) {
+      bool visible = (r < nr && node->rowFlatRows(r) > 0);
 
-    struct CLargestRectData {
-      CLargestRectData(const CellAreas &cellAreas, int nc) :
-       cellAreas(cellAreas), nc(nc) {
+      if      (visible) {
+        if (row1 < 0)
+          row1 = r;
       }
+      else if (row1 >= 0) {
+        auto index1 = model_->index(row1 , 0, parent);
+        auto index2 = model_->index(r - 1, 0, parent);
 
-      int getValue(int x, int y) const {
-        const auto *vc = cellAreas[uint(y*nc + x)];
+        selection.select(index1, index2);
 
-        return (vc && vc->selected ? 1 : 0);
+        row1 = -1;
       }
+    }
 
-      const CellAreas& cellAreas;
-      int              nc { 0 };
-    };
+    for (const auto &pc : node->children)
+      nodes.push_back(pc.second);
+  }
 
-    using LargestRect = CLargestRect<CLargestRectData, int>;
+  return selection;
+}
 
-    for (auto &p : selDepthHierCellAreas_) {
-      const auto &hierCellAreas = p.second;
+void
+CQModelView::
+scrollContentsBy(int, int)
+{
+  // viewport and headers are scrolled by pixel shift of rows/columns in
+  // hscrollSlot/vscrollSlot (scroll bar units are rows not pixels)
+}
 
-      for (auto &p1 : hierCellAreas) {
-        // selection in flat hierarchical area
-        const auto &cellAreas = p1.second;
+void
+CQModelView::
+rowsInserted(const QModelIndex &parent, int start, int end)
+{
+  //std::cerr << "CQModelView::rowsInserted\n";
 
-        // vis grid
-        auto na = cellAreas.size();
-        if (! na) continue;
+  QAbstractItemView::rowsInserted(parent, start, end);
 
-        //---
+  // shift hidden rows of parent (new rows are not hidden)
+  for (auto *hiddenRows : {hiddenRows_, userHiddenRows_, filterHiddenRows_}) {
+    hiddenRows->insertRows(parent, start, end - start + 1);
+    hiddenRows->rehash();
+  }
 
-        // reset selected cells
-        for (auto &vc : cellAreas) {
-          if (vc)
-            vc->selected = true;
-        }
+  // expanded indices after inserted rows have new rows (and hash)
+  rehashExpanded();
 
-        //---
+  // model is hierarchical if child rows added or new root rows have children
+  if      (parent.isValid() && parent != rootIndex())
+    hierarchical_ = true;
+  else if (model_ && hierChecked_) {
+    for (int r = start; ! hierarchical_ && r <= end; ++r)
+      hierarchical_ = model_->hasChildren(model_->index(r, 0, parent));
+  }
 
-        // draw largest rectangle and remove from set until all cells processed
-        int nr = int(na/size_t(nc_));
+  // measure vertical header widths of new root rows
+  if (parent == rootIndex() && vheaderWidths_->valid) {
+    QFontMetrics fm(vheaderWidths_->font);
 
-        CLargestRectData largestRectData(cellAreas, nc_);
+    vheaderWidths_->insertRows(start, end - start + 1, maxVHeaderMeasureRows(), [&](int r) {
+      return vheaderTextWidth(fm, r);
+    });
+  }
 
-        LargestRect largestRect(largestRectData, nc_, nr);
+  // kept root sort order no longer valid if rows not added to nodes
+  if (state_.updateRowDatas)
+    state_.updateSortOrder = true;
 
-        while (true) {
-          LargestRect::Rect lrect = largestRect.largestRect(1);
+  // add rows to parent node (if expanded) and update ancestor flat row counts
+  // (no update needed if nodes rebuilt on next update)
+  if (model_ && rootNode_ && ! state_.updateRowDatas) {
+    auto *node = findExpandNode(parent);
 
-          if (lrect.width <= 0 || lrect.height <= 0)
-            break;
+    if (node) {
+      int n        = end - start + 1;
+      int oldTotal = node->numFlatRows();
 
-          //---
+      if (isViewSorted()) {
+        auto sortKeys = validSortKeys();
 
-          int r1 = lrect.top;
-          int r2 = lrect.top + lrect.height - 1;
-          int c1 = lrect.left;
-          int c2 = lrect.left + lrect.width - 1;
+        // add keys of new rows to cached keys (all keys read if not cached)
+        if (isSortKeysValid(node->keys, sortKeys, node->numRows())) {
+          SortColumnKeysArray rowKeys;
 
-          const auto *vc1 = cellAreas[uint(r1*nc_ + c1)];
-          const auto *vc2 = cellAreas[uint(r2*nc_ + c2)];
-          assert(vc1 && vc2);
+          readSortKeys(parent, start, n, sortKeys, rowKeys);
 
-          int x1 = vc1->rect.left  ();
-          int y1 = vc1->rect.top   ();
-          int x2 = vc2->rect.right ();
-          int y2 = vc2->rect.bottom();
+          for (size_t k = 0; k < sortKeys.size(); ++k)
+            node->keys[k].insertRows(start, rowKeys[k]);
+        }
+        else
+          (void) nodeSortKeys(node, sortKeys, node->numRows() + n);
 
-          QRect rect(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
-
-          drawSelection(rect);
-
-          //---
-
-          for (int r = 0; r < lrect.height; ++r) {
-            int r1 = lrect.top + r;
-
-            for (int c = 0; c < lrect.width; ++c) {
-              int c1 = lrect.left + c;
-
-              auto *vc = cellAreas[uint(r1*nc_ + c1)];
+        // renumber rows after inserted rows and add new rows at sorted positions
+        auto rowCounts = node->rowCounts();
+        auto order     = node->rowOrder();
 
-              if (vc)
-                vc->selected = false;
-            }
-          }
+        for (auto &r : order) {
+          if (r >= start)
+            r += n;
         }
-      }
-    }
 
-    for (auto &cp : visCellDatas_) {
-      const auto &visCellData = cp.second;
-
-      if (visCellData.selected)
-        drawSelection(visCellData.rect);
-    }
-  }
-  else {
-    for (auto it = selection.constBegin(); it != selection.constEnd(); ++it) {
-      const auto &range = *it;
+        rowCounts.insert(rowCounts.begin() + start, uint(n), 0);
 
-      auto pc1 = visColumnDatas_.find(range.left ());
-      auto pc2 = visColumnDatas_.find(range.right());
+        node->shiftChildren(start, n);
 
-      int x1 = paintData_.vrect.left ();
-      int x2 = paintData_.vrect.right();
+        std::vector<int> rows;
 
-      if (pc1 != visColumnDatas_.end()) {
-        const auto &visColumnData1 = (*pc1).second;
+        rows.resize(uint(n));
 
-        x1 = visColumnData1.rect.left ();
-      }
+        std::iota(rows.begin(), rows.end(), start);
 
-      if (pc2 != visColumnDatas_.end()) {
-        const auto &visColumnData2 = (*pc2).second;
+        insertSortedRows(sortKeys, node->keys, order, rows);
 
-        x2 = visColumnData2.rect.right();
+        node->setOrder(order, rowCounts);
       }
+      else {
+        node->shiftChildren(start, n);
 
-      //---
-
-      auto p = visRowDatas_.find(range.parent());
-      if (p == visRowDatas_.end()) return;
-
-      const auto &rowVisRowDatas = (*p).second;
-
-      auto pt = rowVisRowDatas.find(range.top());
-      auto pb = rowVisRowDatas.find(range.bottom());
-
-      int y1 = paintData_.vrect.top();
-      int y2 = paintData_.vrect.bottom();
+        node->counts.insert(start, n, 0);
+      }
 
-      if (pt != rowVisRowDatas.end()) {
-        const auto &visRowData1 = (*pt).second;
+      // restore expanded state of new rows (e.g. moved rows)
+      const auto &expandedRows = this->expandedRows();
 
-        y1 = visRowData1.rect.top();
-      }
+      for (int r = start; r <= end; ++r)
+        setExpandNodeRowVisible(node, r, ! isRowHidden(r, parent), expandedRows);
 
-      if (pb != rowVisRowDatas.end()) {
-        const auto &visRowData2 = (*pb).second;
+      addExpandNodeFlatRows(node->parentNode, node->row, node->numFlatRows() - oldTotal);
+    }
 
-        y2 = visRowData2.rect.bottom();
-      }
+    rowDatasChanged();
+  }
 
-      QRect r(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
+  // restart background sort stopped for row changes (redraws if rows rebuilt)
+  if (! restartViewSort()) {
+    redraw();
 
-      drawSelection(r);
-    }
+    emit stateChanged();
   }
 }
 
 void
 CQModelView::
-updateHierSelection(const QItemSelection &selection)
+rowsAboutToBeRemoved(const QModelIndex &parent, int start, int end)
 {
-  // update grid of cells selected per depth and parent flat row
-  if (state_.updateSelection) {
-    state_.updateSelection = false;
-
-    selDepthHierCellAreas_.clear();
+  //std::cerr << "CQModelView::rowsAboutToBeRemoved\n";
 
-    for (auto &cp : visCellDatas_) {
-      auto &visCellData = cp.second;
+  QAbstractItemView::rowsAboutToBeRemoved(parent, start, end);
 
-      visCellData.selected = false;
-    }
+  // build parent node for old rows (rows removed from node in rowsRemovedSlot)
+  if (model_ && ! state_.updateRowDatas)
+    (void) findExpandNode(parent);
+}
 
-    for (auto it = selection.constBegin(); it != selection.constEnd(); ++it) {
-      const auto &range = *it;
+QModelIndexList
+CQModelView::
+selectedIndexes() const
+{
+  //std::cerr << "CQModelView::selectedIndexes\n";
 
-      for (int c = range.left(); c <= range.right(); ++c) {
-        for (int r = range.top(); r <= range.bottom(); ++r) {
-          auto ind = model_->index(r, c, range.parent());
+  // base class selection model queries do not see interval selection
+  auto *sm = viewSelectionModel();
 
-          auto pc = visCellDatas_.find(ind);
-          if (pc == visCellDatas_.end()) continue;
+  return (sm ? sm->selectedIndexes() : QModelIndexList());
+}
 
-          auto &visCellData = (*pc).second;
+void
+CQModelView::
+clearSelection()
+{
+  auto *sm = viewSelectionModel();
 
-          visCellData.selected = true;
-        }
-      }
-    }
+  if (sm)
+    sm->clearSelection();
+}
 
-    for (auto &cp : visCellDatas_) {
-      auto &vc = cp.second;
+void
+CQModelView::
+updateGeometries()
+{
+  //std::cerr << "CQModelView::updateGeometries\n";
 
-      if (vc.selected) {
-        CellAreas &cellAreas = selDepthHierCellAreas_[-vc.depth][vc.parentFlatRow];
+  QAbstractItemView::updateGeometries();
+}
 
-        if (cellAreas.empty())
-          cellAreas.resize(uint(vc.nr*nc_));
+void
+CQModelView::
+selectionChanged(const QItemSelection &selected, const QItemSelection &deselected)
+{
+  state_.updateSelection = true;
 
-        cellAreas[uint(vc.r*nc_ + vc.c)] = &vc;
-      }
-    }
-  }
+  QAbstractItemView::selectionChanged(selected, deselected);
 }
 
 void
 CQModelView::
-drawHHeader(QPainter *painter) const
+keyboardSearch(const QString &search)
 {
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::drawHHeader");
-#endif
+  if (! isHierarchical())
+    return QAbstractItemView::keyboardSearch(search);
 
-  const_cast<CQModelView *>(this)->updateScrollBars      ();
-  const_cast<CQModelView *>(this)->updateVisColumns      ();
-  const_cast<CQModelView *>(this)->updateWidgetGeometries();
+  auto start = sm_->currentIndex();
 
-  //---
+  bool again = true;
 
-  paintData_.reset();
+  updateRowDatas();
 
-  paintData_.vrect     = hh_->viewport()->rect();
-  paintData_.vw        = paintData_.vrect.width ();
-  paintData_.vh        = paintData_.vrect.height();
-  paintData_.margin    = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
-  paintData_.rowHeight = this->rowHeight(0);
+  int nfr = nvr_;
 
-  if (showHHeaderLines())
-    initDrawGrid();
+  int startFlatRow = (start.isValid() ? indexFlatRow(start) : -1);
 
-  //---
+  int flatRow = (startFlatRow >= 0 ? startFlatRow + 1 : nfr);
 
-  painter->fillRect(paintData_.vrect, roleColor(ColorRole::HeaderBg));
+  if (flatRow >= nfr) {
+    flatRow = 0;
 
-  //---
+    again = false;
+  }
 
-  painter->save();
+  while (flatRow < nfr) {
+    auto index = flatRowIndex(flatRow);
 
-  for (const auto &pv : visColumnDatas_) {
-    int         c             = pv.first;
-    const auto &visColumnData = pv.second;
+    auto str = model_->data(index, Qt::DisplayRole).toString();
 
-    if (! visColumnData.visible)
-      continue;
+    if (str.startsWith(search)) {
+      sm_->setCurrentIndex(index, QItemSelectionModel::NoUpdate);
+      return;
+    }
 
-    bool valid = (c != freezeColumn_);
+    ++flatRow;
+  }
 
-    if (valid) {
-      if (freezeColumn_ >= 0) {
-        int x  = visColumnData.rect.left () +   paintData_.margin;
-        int cw = visColumnData.rect.width() + 2*paintData_.margin;
+  if (again) {
+    flatRow = 0;
 
-        int x1 = std::max(x, freezeWidth_);
-        int x2 = (! visColumnData.last ? std::max(x + cw, freezeWidth_) : paintData_.vw - 1);
+    while (flatRow < nfr) {
+      auto index = flatRowIndex(flatRow);
 
-        if (x1 < x2) {
-          painter->setClipRect(QRect(x1, 0, x2 - x1 + 1, globalRowData_.headerHeight));
+      auto str = model_->data(index, Qt::DisplayRole).toString();
 
-          drawHHeaderSection(painter, c, visColumnData);
-        }
-      }
-      else {
-        drawHHeaderSection(painter, c, visColumnData);
+      if (str.startsWith(search)) {
+        sm_->setCurrentIndex(index, QItemSelectionModel::NoUpdate);
+        return;
       }
+
+      if (index == start)
+        break;
+
+      ++flatRow;
     }
   }
+}
 
-  //---
+int
+CQModelView::
+rowHeight(int) const
+{
+  // all rows the same height
+  return globalRowData_.height;
+}
 
-  if (freezeColumn_ >= 0) {
-    auto p = visColumnDatas_.find(freezeColumn_);
-    assert(p != visColumnDatas_.end());
+int
+CQModelView::
+columnWidth(int column) const
+{
+  const_cast<CQModelView *>(this)->updateVisColumns();
 
-    const auto &visColumnData = (*p).second;
+  //---
 
-    painter->setClipRect(QRect(0, 0, freezeWidth_, globalRowData_.headerHeight));
+  auto p = visColumnDatas_.find(column);
 
-    drawHHeaderSection(painter, freezeColumn_, visColumnData);
-  }
+  // column outside visible window
+  if (p == visColumnDatas_.end()) {
+    if (column < 0 || column >= int(columnDatas_.size()) || isColumnHidden(column))
+      return 0;
 
-  //---
+    const ColumnData &columnData = columnDatas_[uint(column)];
 
-  // draw span text
-  if (isMultiHeaderLines()) {
-    int fh = paintData_.fm.height();
+    return (columnData.width > 0 ? columnData.width : 100);
+  }
 
-    for (const auto &pr : rowColumnSpans_) {
-      int         r           = pr.first;
-      const auto &columnSpans = pr.second;
+  const auto &visColumnData = (*p).second;
 
-      int y1 = r*(fh + 1) + globalRowData_.margin;
-      int y2 = y1 + fh;
+  return columnWidth(column, visColumnData);
+}
 
-      for (const auto &span : columnSpans) {
-        int c1 = span.first;
-        int c2 = span.second;
+int
+CQModelView::
+columnWidth(int column, const VisColumnData &visColumnData) const
+{
+  if (visColumnData.last && isStretchLastColumn()) {
+    return visColumnData.rect.width();
+  }
+  else {
+    assert(column >= 0);
 
-        auto ps1 = visColumnDatas_.find(c1);
-        auto ps2 = visColumnDatas_.find(c2);
-        if (ps1 == visColumnDatas_.end() || ps2 == visColumnDatas_.end()) continue;
+    const ColumnData &columnData = columnDatas_[uint(column)];
 
-        const auto &visColumnData1 = (*ps1).second;
-        const auto &visColumnData2 = (*ps2).second;
+    int cw = (columnData.width > 0 ? columnData.width : 100);
 
-        QRect rect(visColumnData1.rect.left(), y1,
-                   visColumnData2.rect.right() - visColumnData1.rect.left() + 1, y2 - y1 + 1);
+    return cw;
+  }
+}
 
-        auto data = model_->headerData(c1, Qt::Horizontal, Qt::DisplayRole);
+void
+CQModelView::
+setColumnWidth(int column, int width)
+{
+  assert(column >= 0);
 
-        auto str = data.toString();
+  ColumnData &columnData = columnDatas_[uint(column)];
 
-        auto strs = str.split(QRegExp("\n|\r\n|\r"));
+  if (columnData.width != width) {
+    columnData.width = width;
 
-        setRolePen(painter, ColorRole::HeaderFg);
+    int cw = (columnData.width > 0 ? columnData.width : 100);
 
-        painter->drawText(rect, Qt::AlignHCenter | Qt::AlignVCenter, strs[r]);
+    hh_->resizeSection(column, cw);
 
-        //---
+    state_.updateLayout();
 
-        setRolePen(painter, ColorRole::HeaderLineFg);
+    redraw();
 
-        painter->drawLine(visColumnData2.rect.topRight  (), visColumnData2.rect.bottomRight());
-        painter->drawLine(               rect.bottomLeft(),                rect.bottomRight());
-      }
-    }
+    emit stateChanged();
   }
+}
 
-  //---
+bool
+CQModelView::
+columnHeatmap(int column) const
+{
+  assert(column >= 0);
 
-  painter->restore();
+  const ColumnData &columnData = columnDatas_[uint(column)];
+
+  return columnData.heatmap;
 }
 
 void
 CQModelView::
-drawHHeaderSection(QPainter *painter, int c, const VisColumnData &visColumnData) const
+setColumnHeatmap(int column, bool heatmap)
 {
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::drawHHeaderSection");
-#endif
+  assert(column >= 0);
 
-  auto ind = model_->index(0, c, QModelIndex());
+  ColumnData &columnData = columnDatas_[uint(column)];
 
-  //---
+  if (columnData.heatmap != heatmap) {
+    columnData.heatmap = heatmap;
 
-  auto data = model_->headerData(c, Qt::Horizontal, Qt::DisplayRole);
+    redraw();
+  }
+}
 
-  auto str = data.toString();
+//---
 
-  //---
+void
+CQModelView::
+setFreezeFirstColumn(bool b)
+{
+  if (freezeFirstColumn_ != b) {
+    freezeFirstColumn_ = b;
 
-  bool isNumeric = isNumericColumn(c);
+    state_.updateLayout();
 
-  //---
+    redraw();
 
-  // init style data
-  QStyleOptionHeader option;
+    emit stateChanged();
+  }
+}
 
-  option.state = QStyle::State_Horizontal;
+//---
 
-  if (c == mouseData_.moveData.hsection)
-    option.state |= QStyle::State_MouseOver;
+void
+CQModelView::
+setStretchLastColumn(bool b)
+{
+  if (stretchLastColumn_ != b) {
+    stretchLastColumn_ = b;
 
-  if (c == mouseData_.pressData.hsection)
-    option.state |= QStyle::State_Sunken;
+    state_.updateLayout();
 
-  if (hsm_->isSelected(ind))
-    option.state |= QStyle::State_Selected;
+    redraw();
 
-  if (c == hsm_->currentIndex().column() && hsm_->currentIndex().isValid())
-    option.state |= QStyle::State_HasFocus;
+    emit stateChanged();
+  }
+}
 
-  if (hh_->isSortIndicatorShown() && hh_->sortIndicatorSection() == c)
-    option.sortIndicator = (hh_->sortIndicatorOrder() == Qt::AscendingOrder ?
-      QStyleOptionHeader::SortDown : QStyleOptionHeader::SortUp);
+//---
 
-  option.rect          = visColumnData.rect;
-  option.iconAlignment = Qt::AlignCenter;
-  option.section       = c;
-  option.textAlignment = (isNumeric ? Qt::AlignRight : Qt::AlignLeft) | Qt::AlignVCenter;
-  option.orientation   = Qt::Horizontal;
+void
+CQModelView::
+setMultiHeaderLines(bool b)
+{
+  if (multiHeaderLines_ != b) {
+    multiHeaderLines_ = b;
 
-  //---
+    state_.updateLayout();
 
-  // get decoration icon
-  auto ivar = model_->headerData(c, Qt::Horizontal, Qt::DecorationRole);
+    redraw();
 
-  option.icon = qvariant_cast<QIcon>(ivar);
+    emit stateChanged();
+  }
+}
 
-  if (option.icon.isNull())
-    option.icon = qvariant_cast<QPixmap>(ivar);
+//---
 
-  //---
+void
+CQModelView::
+setShowVerticalHeader(bool b)
+{
+  if (showVerticalHeader_ != b) {
+    showVerticalHeader_ = b;
 
-  option.position         = QStyleOptionHeader::Middle; // TODO
-  option.selectedPosition = QStyleOptionHeader::NotAdjacent; // TODO
+    state_.updateLayout();
 
-  //---
+    redraw();
 
-  auto initBrush = [&]() {
-    if (option.state & QStyle::State_MouseOver)
-      setRoleBrush(painter, ColorRole::MouseOverBg);
-    else
-      setRoleBrush(painter, ColorRole::HeaderBg);
-  };
+    emit stateChanged();
+  }
+}
 
-  auto initPen = [&]() {
-    if (option.state & QStyle::State_MouseOver)
-      setRolePen(painter, ColorRole::MouseOverFg);
-    else
-      setRolePen(painter, ColorRole::HeaderFg);
-  };
+void
+CQModelView::
+setVerticalType(VerticalType type)
+{
+  if (verticalType_ != type) {
+    verticalType_ = type;
 
-  auto fillBackground = [&](const QRect &r) {
-    initBrush();
+    state_.updateLayout();
 
-    painter->fillRect(r, painter->brush());
-  };
+    redraw();
 
-  auto drawFocus = [&]() {
-    setRolePen  (painter, ColorRole::HighlightBg);
-    setRoleBrush(painter, ColorRole::None);
+    emit stateChanged();
+  }
+}
 
-    int x1 = option.rect.left  ();
-    int x2 = option.rect.right ();
-    int y  = option.rect.bottom();
+//---
 
-    for (int i = 0; i < 3; ++i)
-      painter->drawLine(x1, y - i, x2, y - i);
-  };
+void
+CQModelView::
+setHeaderOnBottom(bool b)
+{
+  headerOnBottom_ = b;
 
-  //---
+  state_.updateLayout();
 
-  struct RectSpan {
-    QRect rect;
-    bool  inSpan { false };
+  redraw();
+}
 
-    RectSpan(const QRect &rect, bool inSpan) :
-     rect(rect), inSpan(inSpan) {
-    }
-  };
+void
+CQModelView::
+setHeaderOnRight(bool b)
+{
+  headerOnRight_ = b;
 
-  using RowRects = std::vector<RectSpan>;
+  state_.updateLayout();
 
-  RowRects rowRects;
+  redraw();
+}
 
-  int y = option.rect.top() + globalRowData_.margin;
+//---
 
-  //---
+void
+CQModelView::
+setShowFilter(bool b)
+{
+  if (showFilter_ != b) {
+    showFilter_ = b;
 
-  QStringList strs;
+    state_.updateLayout();
 
-  if (isMultiHeaderLines())
-    strs = str.split(QRegExp("\n|\r\n|\r"));
-  else
-    strs.push_back(str);
+    redraw();
 
-  int ns = strs.length();
+    if (showFilter_) {
+      int nfe = int(filterEdits_.size());
 
-  //---
+      if (nfe > 0)
+        filterEdits_[0]->setFocus();
+    }
 
-  if (ns > 1) {
-    int fh = paintData_.fm.height();
+    emit stateChanged();
+  }
+}
 
-    for (int r = 0; r < ns; ++r) {
-      bool inSpan = false;
+void
+CQModelView::
+setFilterTree(bool b)
+{
+  if (filterTree_ != b) {
+    filterTree_ = b;
 
-      auto ps = rowColumnSpans_.find(r);
+    cancelFilter();
+    resetFilterResult();
 
-      if (ps != rowColumnSpans_.end()) {
-        const auto &columnSpans = (*ps).second;
+    // remove filter hidden rows of previous mode and reapply filter
+    if (! filterHiddenRows_->empty()) {
+      filterHiddenRows_->clear();
 
-        for (const auto &span : columnSpans) {
-          if (c >= span.first && c <= span.second) {
-            inSpan = true;
-            break;
-          }
-        }
-      }
+      unionHiddenRows();
 
-      //---
+      rebuildRowDatas();
+    }
 
-      QRect rect;
+    applyFilters();
+  }
+}
 
-      if      (r == 0)
-        rect = QRect(option.rect.left(), y - globalRowData_.margin, option.rect.width(), fh);
-      else if (r == ns - 1)
-        rect = QRect(option.rect.left(), y, option.rect.width(), fh + globalRowData_.margin);
-      else
-        rect = QRect(option.rect.left(), y, option.rect.width(), fh);
+void
+CQModelView::
+setFilterExpand(bool b)
+{
+  if (filterExpand_ != b) {
+    filterExpand_ = b;
 
-      rowRects.push_back(RectSpan(rect, inSpan));
+    if (isFilterTree()) {
+      resetFilterResult();
 
-      y += fh + 1;
+      applyFilters();
     }
   }
-  else {
-    rowRects.push_back(RectSpan(option.rect, false));
-  }
-
-  //---
+}
 
-  for (const auto &rowRect : rowRects) {
-    if (! rowRect.inSpan)
-      fillBackground(rowRect.rect.adjusted(-paintData_.margin, 0, paintData_.margin, 0));
-  }
+//---
 
-  //---
+void
+CQModelView::
+setSortingEnabled(bool b)
+{
+  if (sortingEnabled_ != b) {
+    sortingEnabled_ = b;
 
-  initPen();
+    hh_->setSortIndicatorShown(sortingEnabled_);
 
-  for (int r = 0; r < ns; ++r) {
-    const RectSpan &rectSpan = rowRects[uint(r)];
+    auto *proxyModel = qobject_cast<QSortFilterProxyModel *>(model());
 
-    //---
+    if (sortingEnabled_) {
+      if (proxyModel) {
+        if (sortRole_ >= 0)
+          proxyModel->setSortRole(sortRole_);
+      }
 
-    auto subopt = option;
+      sortByColumn(hh_->sortIndicatorSection(), hh_->sortIndicatorOrder());
+    }
+    else {
+      if (proxyModel) {
+        sortRole_ = proxyModel->sortRole();
 
-    subopt.text = strs[r];
+        proxyModel->setSortRole(Qt::InitialSortOrderRole);
 
-    if (! rectSpan.inSpan) {
-      subopt.rect = style()->subElementRect(QStyle::SE_HeaderLabel, &subopt, hh_);
+        proxyModel->invalidate();
+      }
 
-      QRect rect(subopt.rect.left(), rectSpan.rect.top(),
-                 subopt.rect.width(), rectSpan.rect.height());
+      // restore model row order
+      if (isViewSorted()) {
+        viewSortKeys_.clear();
 
-      painter->drawText(rect, Qt::AlignHCenter | Qt::AlignVCenter, strs[r]);
+        rebuildRowDatas();
+      }
     }
-  }
 
-  //---
+    redraw();
+  }
+}
 
-  if (option.sortIndicator != QStyleOptionHeader::None) {
-    auto subopt = option;
+void
+CQModelView::
+setViewSort(bool b)
+{
+  if (viewSort_ != b) {
+    viewSort_ = b;
 
-    subopt.rect = style()->subElementRect(QStyle::SE_HeaderArrow, &option, hh_);
+    viewSortKeys_.clear();
 
-    style()->drawPrimitive(QStyle::PE_IndicatorHeaderArrow, &subopt, painter, hh_);
+    if (viewSort_ && isSortingEnabled())
+      sortByColumn(hh_->sortIndicatorSection());
+    else
+      rebuildRowDatas();
   }
+}
 
-  //---
-
-  auto fullRect = visColumnData.rect.adjusted(-paintData_.margin, 0, paintData_.margin, 0);
-
-  setRolePen(painter, ColorRole::HeaderLineFg);
+void
+CQModelView::
+setShowGrid(bool b)
+{
+  showGrid_ = b;
 
-  painter->drawLine(fullRect.topLeft   (), fullRect.topRight   ());
-  painter->drawLine(fullRect.bottomLeft(), fullRect.bottomRight());
+  redraw();
+}
 
-  for (const auto &rowRect : rowRects) {
-    if (! rowRect.inSpan) {
-      int x  = rowRect.rect.right() + paintData_.margin;
-      int y1 = rowRect.rect.top();
-      int y2 = rowRect.rect.bottom();
+void
+CQModelView::
+setShowHHeaderLines(bool b)
+{
+  showHHeaderLines_ = b;
 
-      painter->drawLine(x, y1, x, y2);
-    }
-  }
+  redraw();
+}
 
-  //---
+void
+CQModelView::
+setShowVHeaderLines(bool b)
+{
+  showVHeaderLines_ = b;
 
-  if (showHHeaderLines()) {
-    setRolePen(painter, ColorRole::GridFg);
+  redraw();
+}
 
-    painter->drawLine(option.rect.topRight(), option.rect.bottomRight());
-  }
+//---
 
-  //---
+bool
+CQModelView::
+isCornerButtonEnabled() const
+{
+  return cornerWidget_->isEnabled();
+}
 
-  if (option.state & QStyle::State_HasFocus)
-    drawFocus();
+void
+CQModelView::
+setCornerButtonEnabled(bool enabled)
+{
+  if (enabled != cornerWidget_->isEnabled()) {
+    cornerWidget_->setEnabled(enabled);
 
-  //---
+    redraw();
+  }
+}
 
-  if (c == mouseData_.pressData.hsectionh || c == mouseData_.moveData.hsectionh) {
-    setRolePen(painter, ColorRole::MouseOverFg);
+//---
 
-    for (const auto &rowRect : rowRects) {
-      if (! rowRect.inSpan) {
-        int x  = rowRect.rect.right() + paintData_.margin;
-        int y1 = rowRect.rect.top();
-        int y2 = rowRect.rect.bottom();
+void
+CQModelView::
+setIndentation(int i)
+{
+  if (indentation_ != i) {
+    indentation_ = i;
 
-        for (int i = 0; i < 3; ++i)
-          painter->drawLine(x - i, y1, x - i, y2);
-      }
-    }
+    state_.updateLayout();
+
+    redraw();
+
+    emit stateChanged();
   }
+}
 
-  //---
+//---
 
-  auto drawSelection = [&](const QRect &rect) {
-    setRolePen  (painter, ColorRole::SelectionFg, 0.3);
-    setRoleBrush(painter, ColorRole::SelectionBg, 0.3);
+void
+CQModelView::
+setRootIsDecorated(bool b)
+{
+  if (rootIsDecorated_ != b) {
+    rootIsDecorated_ = b;
 
-    painter->fillRect(rect, painter->brush());
-  };
+    state_.updateLayout();
 
-  if (option.state & QStyle::State_Selected) {
-    for (const auto &rowRect : rowRects) {
-      if (! rowRect.inSpan)
-        drawSelection(rowRect.rect.adjusted(-paintData_.margin, 0, paintData_.margin, 0));
-    }
+    redraw();
+
+    emit stateChanged();
   }
 }
 
+//---
+
 void
 CQModelView::
-drawVHeader(QPainter *painter) const
+sortByColumn(int column, Qt::SortOrder order)
 {
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::drawVHeader");
-#endif
+  hh_->setSortIndicator(column, order);
 
-  const_cast<CQModelView *>(this)->updateScrollBars      ();
-  const_cast<CQModelView *>(this)->updateVisColumns      ();
-  const_cast<CQModelView *>(this)->updateVisRows         ();
-  const_cast<CQModelView *>(this)->updateWidgetGeometries();
+  sortByColumn(column);
+}
 
-  //---
+void
+CQModelView::
+sortByColumn(int column)
+{
+  if (column < 0 || column >= nc_)
+    return;
 
-  paintData_.reset();
+  // sort row order in view (model unchanged)
+  if (isViewSort()) {
+    viewSortKeys_.clear();
 
-  paintData_.vrect     = vh_->viewport()->rect();
-  paintData_.vw        = paintData_.vrect.width ();
-  paintData_.vh        = paintData_.vrect.height();
-  paintData_.margin    = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
-  paintData_.rowHeight = this->rowHeight(0);
+    viewSortKeys_.push_back(SortKey(column, hh_->sortIndicatorOrder()));
 
-  if (showVHeaderLines())
-    initDrawGrid();
+    startViewSort();
 
-  //---
+    return;
+  }
 
-  painter->fillRect(paintData_.vrect, roleColor(ColorRole::HeaderBg));
+  model()->sort(column, hh_->sortIndicatorOrder());
 
-  //---
+  redraw();
+}
 
-  auto p = (vsm_->currentIndex().isValid() ? indRow_.find(vsm_->currentIndex()) : indRow_.end());
+// add column as next view sort key (toggle order if already a sort key)
+void
+CQModelView::
+addSortByColumn(int column)
+{
+  if (column < 0 || column >= nc_)
+    return;
 
-  int currentRow = (p != indRow_.end() ? (*p).second : -1);
+  if (! isSortingEnabled())
+    setSortingEnabled(true);
 
-  // draw header area for each visible flat row
-  for (const auto &flatRow : visFlatRows_) {
-    auto pr = rowDatas_.find(flatRow);
-    assert(pr != rowDatas_.end());
+  if (! isViewSort() || ! isViewSorted()) {
+    sortByColumn(column, Qt::AscendingOrder);
+    return;
+  }
 
-    const auto &rowData = (*pr).second;
+  auto p = std::find_if(viewSortKeys_.begin(), viewSortKeys_.end(),
+                        [&](const SortKey &sortKey) { return sortKey.column == column; });
 
-    //---
+  if (p != viewSortKeys_.end()) {
+    (*p).order = ((*p).order == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder);
 
-    auto pp = visRowDatas_.find(rowData.parent);
-    if (pp == visRowDatas_.end()) continue;
+    // primary key order shown by header sort indicator
+    if (p == viewSortKeys_.begin())
+      hh_->setSortIndicator(column, (*p).order);
+  }
+  else
+    viewSortKeys_.push_back(SortKey(column, Qt::AscendingOrder));
 
-    const auto &rowVisRowDatas = (*pp).second;
+  startViewSort();
+}
 
-    auto ppr = rowVisRowDatas.find(rowData.row);
-    if (ppr == rowVisRowDatas.end()) continue;
+//---
 
-    const auto &visRowData = (*ppr).second;
+void
+CQModelView::
+resizeEvent(QResizeEvent *)
+{
+  visualRect_ = viewport()->rect();
 
-    //---
+  state_.updateLayout();
 
-    auto ind = model_->index(rowData.row, 0, rowData.parent);
+  emit stateChanged();
+}
 
-    //---
+void
+CQModelView::
+modelChangedSlot()
+{
+  state_.updateAll();
 
-    // init style data
-    QStyleOptionHeader option;
+  state_.updateSortOrder = true;
 
-    if (visRowData.flatRow == mouseData_.moveData.vsection)
-      option.state |= QStyle::State_MouseOver;
+  vheaderWidths_->invalidate();
 
-    if (vsm_->isSelected(ind))
-      option.state |= QStyle::State_Selected;
+  // inserted/removed columns change expanded index columns (and hash)
+  rehashExpanded();
 
-    if (flatRow == currentRow)
-      option.state |= QStyle::State_HasFocus;
+  hierChecked_ = false;
 
-    option.rect             = visRowData.rect;
-    option.icon             = QIcon();
-    option.iconAlignment    = Qt::AlignCenter;
-    option.position         = QStyleOptionHeader::Middle; // TODO
-    option.section          = visRowData.flatRow;
-    option.selectedPosition = QStyleOptionHeader::NotAdjacent; // TODO
-    option.text             = "";
-    option.textAlignment    = Qt::AlignLeft | Qt::AlignVCenter;
+  autoFitted_ = false;
 
-    //---
+  if (! restartViewSort()) {
+    redraw();
 
-    auto fillBackground = [&]() {
-      if (option.state & QStyle::State_MouseOver) {
-        setRolePen  (painter, ColorRole::MouseOverFg);
-        setRoleBrush(painter, ColorRole::MouseOverBg);
-      }
-      else {
-        setRolePen  (painter, ColorRole::HeaderFg);
-        setRoleBrush(painter, ColorRole::HeaderBg);
-      }
+    emit stateChanged();
+  }
+}
 
-      painter->fillRect(option.rect, painter->brush());
+void
+CQModelView::
+rowsAboutToBeInsertedSlot(const QModelIndex &parent, int, int)
+{
+  // build parent node for old rows (rows added to node in rowsInserted)
+  if (model_ && ! state_.updateRowDatas)
+    (void) findExpandNode(parent);
+}
 
-      setRoleBrush(painter, ColorRole::Base);
-    };
+void
+CQModelView::
+rowsRemovedSlot(const QModelIndex &parent, int start, int end)
+{
+  // remove hidden rows of parent
+  for (auto *hiddenRows : {hiddenRows_, userHiddenRows_, filterHiddenRows_}) {
+    hiddenRows->removeRows(parent, start, end - start + 1);
+    hiddenRows->rehash();
+  }
 
-    auto drawFocus = [&]() {
-      setRolePen  (painter, ColorRole::HighlightBg);
-      setRoleBrush(painter, ColorRole::None);
+  // remove cached vertical header widths of root rows
+  if (parent == rootIndex())
+    vheaderWidths_->removeRows(start, end - start + 1);
 
-      int x  = option.rect.right ();
-      int y1 = option.rect.top   ();
-      int y2 = option.rect.bottom();
+  // kept root sort order no longer valid if rows not removed from nodes
+  if (state_.updateRowDatas)
+    state_.updateSortOrder = true;
 
-      for (int i = 0; i < 3; ++i)
-        painter->drawLine(x - i, y1, x - i, y2);
-    };
+  // remove rows (and expanded descendants) from parent node (if expanded) and
+  // update ancestor flat row counts (no update needed if nodes rebuilt on next update)
+  if (model_ && rootNode_ && ! state_.updateRowDatas) {
+    auto *node = findExpandNode(parent);
 
-    //---
+    if (node && start < node->numRows()) {
+      end = std::min(end, node->numRows() - 1);
 
-    fillBackground();
+      int n        = end - start + 1;
+      int oldTotal = node->numFlatRows();
 
-    //---
+      auto pc1 = node->children.lower_bound(start);
+      auto pc2 = node->children.upper_bound(end);
 
-    setRolePen(painter, ColorRole::HeaderLineFg);
+      for (auto pc = pc1; pc != pc2; ++pc)
+        delete (*pc).second;
 
-    painter->drawLine(option.rect.topRight(), option.rect.bottomRight());
+      node->children.erase(pc1, pc2);
 
-    //---
+      if (node->isSorted()) {
+        // remove rows from sorted order (remaining rows stay sorted) and renumber
+        auto rowCounts = node->rowCounts();
 
-    if (option.state & QStyle::State_HasFocus)
-      drawFocus();
+        rowCounts.erase(rowCounts.begin() + start, rowCounts.begin() + end + 1);
 
-    //---
+        std::vector<int> order;
 
-    auto drawSelection = [&]() {
-      setRolePen  (painter, ColorRole::SelectionFg, 0.3);
-      setRoleBrush(painter, ColorRole::SelectionBg, 0.3);
+        order.reserve(rowCounts.size());
 
-      painter->fillRect(option.rect, painter->brush());
-    };
+        for (const auto &r : node->order) {
+          if      (r < start)
+            order.push_back(r);
+          else if (r > end)
+            order.push_back(r - n);
+        }
 
-    if (option.state & QStyle::State_Selected)
-      drawSelection();
+        node->shiftChildren(end + 1, -n);
 
-    //---
+        node->setOrder(order, rowCounts);
 
-    if (showVHeaderLines()) {
-      setRolePen(painter, ColorRole::GridFg);
+        // remove keys of rows from cached keys (read again on next use if not cached)
+        if (isSortKeysValid(node->keys, validSortKeys(), int(node->pos.size()) + n)) {
+          for (auto &keys1 : node->keys)
+            keys1.removeRows(start, n);
+        }
+        else
+          node->keys.clear();
+      }
+      else {
+        node->counts.erase(start, n);
 
-      int x1 = option.rect.left  ();
-      int x2 = option.rect.right ();
-      int y2 = option.rect.bottom();
+        node->shiftChildren(end + 1, -n);
+      }
 
-      painter->drawLine(x1, y2 - 1, x2, y2 - 1);
+      addExpandNodeFlatRows(node->parentNode, node->row, node->numFlatRows() - oldTotal);
     }
 
-    //---
+    rowDatasChanged();
+  }
 
-    if (! isHierarchical() && globalRowData_.vheaderWidth > 0) {
-      int m = globalRowData_.margin;
+  // remove expanded state of removed rows and rehash moved rows
+  rehashExpanded();
 
-      int dy = (option.rect.height() - paintData_.fm.height() + 1)/2;
+  // removed rows may have been only root rows with children
+  if (hierarchical_)
+    hierChecked_ = false;
 
-      dy += paintData_.fm.ascent();
+  // restart background sort stopped for row changes (redraws if rows rebuilt)
+  if (! restartViewSort()) {
+    redraw();
 
-      if      (verticalType() == VerticalType::TEXT) {
-        auto data = model_->headerData(rowData.row, Qt::Vertical, Qt::DisplayRole);
+    emit stateChanged();
+  }
+}
 
-        if (data.isValid()) {
-          auto text = data.toString();
+// rows may move (e.g. sorted proxy model) so save hidden rows as persistent indices
+void
+CQModelView::
+layoutAboutToBeChangedSlot()
+{
+  if (! model_)
+    return;
 
-          if (text.length()) {
-            setRolePen(painter, ColorRole::HeaderFg);
+  for (auto *hiddenRows : {hiddenRows_, userHiddenRows_, filterHiddenRows_})
+    hiddenRows->saveLayout(model_);
+}
 
-            painter->drawText(option.rect.topLeft() + QPoint(m, dy), text);
-          }
-        }
-      }
-      else if (verticalType() == VerticalType::NUMBER) {
-        setRolePen(painter, ColorRole::HeaderFg);
+// rebuild hidden rows at new row positions (nodes are rebuilt by doItemsLayout)
+void
+CQModelView::
+layoutChangedSlot()
+{
+  if (! model_)
+    return;
 
-        auto text = QString::number(rowData.row + 1);
+  for (auto *hiddenRows : {hiddenRows_, userHiddenRows_, filterHiddenRows_})
+    hiddenRows->restoreLayout(model_);
+}
 
-        int dx = globalRowData_.vheaderWidth - 2*m - paintData_.fm.horizontalAdvance(text);
+void
+CQModelView::
+headerDataChangedSlot(Qt::Orientation orient, int first, int last)
+{
+  if (orient != Qt::Vertical)
+    return;
 
-        painter->drawText(option.rect.topLeft() + QPoint(m + dx, dy), text);
-      }
-    }
+  // remeasure changed vertical header rows (if cached)
+  if (vheaderWidths_->valid) {
+    QFontMetrics fm(vheaderWidths_->font);
+
+    vheaderWidths_->updateRows(first, last, maxVHeaderMeasureRows(), [&](int r) {
+      return vheaderTextWidth(fm, r);
+    });
   }
+
+  state_.updateGeometries = true;
+  state_.updateVisRows    = true;
+
+  redraw();
 }
 
+// update geometry
+// depends
+//   font, margins, header sizes, filter, viewport size, scrollbars, visible columns
 void
 CQModelView::
-drawRow(QPainter *painter, int r, const QModelIndex &parent, const VisRowData &visRowData) const
+updateWidgetGeometries()
 {
+  if (! state_.updateGeometries)
+    return;
+
+  state_.updateGeometries = false;
+
+  //---
+
 #ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::drawRow");
+  CQPerfTrace trace("CQModelView::updateWidgetGeometries");
 #endif
 
+  updateVisColumns();
+
   //---
 
-  painter->save();
+  int fh = paintData_.fm.height();
 
-  for (const auto &pv : visColumnDatas_) {
-    int         c             = pv.first;
-    const auto &visColumnData = pv.second;
+  globalRowData_.headerHeight = 0;
 
-    if (! visColumnData.visible)
+  using ColumnStrs = std::map<int, QStringList>;
+
+  ColumnStrs columnStrs;
+  int        ncr = 0;
+
+  for (int c = 0; c < nc_; ++c) {
+    if (isColumnHidden(c))
       continue;
 
-    bool valid = (c != freezeColumn_);
+    auto data = model_->headerData(c, Qt::Horizontal, Qt::DisplayRole);
 
-    if (valid) {
-      if (freezeColumn_ >= 0) {
-        int x = visColumnData.rect.left() - paintData_.margin;
+    auto str = data.toString();
 
-        int cw = visColumnData.rect.width() + 2*paintData_.margin;
+    if (isMultiHeaderLines()) {
+      auto strs = str.split(QRegExp("\n|\r\n|\r"));
 
-        int x1 = std::max(x, freezeWidth_);
-        int x2 = (! visColumnData.last ? std::max(x + cw, freezeWidth_) : paintData_.vw - 1);
+      int ns = strs.size();
 
-        if (x1 < x2) {
-          int y = visRowData.rect.top();
+      ncr = std::max(ncr, ns);
 
-          painter->setClipRect(QRect(x1, y, x2 - x1 + 1, paintData_.rowHeight));
+      for (int i = 0; i < ns; ++i)
+        columnStrs[c].push_back(strs[i]);
+    }
+    else  {
+      columnStrs[c].push_back(str);
 
-          drawCell(painter, r, c, parent, visRowData, visColumnData);
-        }
-      }
-      else {
-        drawCell(painter, r, c, parent, visRowData, visColumnData);
-      }
+      ncr = 1;
     }
   }
 
   //---
 
-  if (freezeWidth_ > 0) {
-    auto pv = visColumnDatas_.find(freezeColumn_);
-    assert(pv != visColumnDatas_.end());
-
-    const auto &visColumnData = (*pv).second;
-
-    int y = visRowData.rect.top();
-
-    painter->setClipRect(QRect(0, y, freezeWidth_, paintData_.rowHeight));
+  rowColumnSpans_.clear();
 
-    drawCell(painter, r, freezeColumn_, parent, visRowData, visColumnData);
-  }
+  //---
 
-  painter->restore();
-}
+  using RowStrs = std::map<int, QStringList>;
 
-void
-CQModelView::
-drawCell(QPainter *painter, int r, int c, const QModelIndex &parent,
-         const VisRowData &visRowData, const VisColumnData &) const
-{
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::drawCell");
-#endif
+  if (isMultiHeaderLines()) {
+    // pad from front (lines are bottom to top)
+    for (auto &pcs : columnStrs) {
+      auto &strs = pcs.second;
 
-  auto ind = model_->index(r, c, parent);
+      while (strs.size() < ncr)
+        strs.push_front("");
+    }
 
-  //--
+    //---
 
-  if (isHierarchical() && c == 0) {
-    auto pc = ivisCellDatas_.find(ind);
-    if (pc == ivisCellDatas_.end()) return;
+    RowStrs rowStrs;
 
-    const auto &ivisCellData = (*pc).second;
+    for (int r = 0; r < ncr; ++r) {
+      for (int c = 0; c < nc_; ++c) {
+        rowStrs[r].push_back(columnStrs[c][r]);
+      }
+    }
 
     //---
 
-    bool children     = visRowData.children;
-    bool expanded     = visRowData.expanded;
-    bool moreSiblings = false;
-
-    QStyleOptionViewItem opt;
+    for (auto &prs : rowStrs) {
+      int   r    = prs.first;
+      auto &strs = prs.second;
 
-    opt.rect = ivisCellData.rect;
+      int nc = strs.size();
 
-    opt.state = (moreSiblings ? QStyle::State_Sibling  : QStyle::State_None) |
-                (children     ? QStyle::State_Children : QStyle::State_None) |
-                (expanded     ? QStyle::State_Open     : QStyle::State_None);
+      int c1 = 0;
 
-    if (ind == mouseData_.moveData.iind)
-      opt.state |= QStyle::State_MouseOver;
+      while (c1 + 1 < nc) {
+        int c2 = c1;
 
-    if (alternatingRowColors() && visRowData.alternate)
-      opt.features |= QStyleOptionViewItem::Alternate;
-    else
-      opt.features &= ~QStyleOptionViewItem::Alternate;
+        while (c2 + 1 < nc && strs[c2 + 1] == strs[c1])
+          ++c2;
 
-    //---
+        if (c2 > c1)
+          rowColumnSpans_[r].push_back(ColumnSpan(c1, c2));
 
-    auto fillIndicatorBackground = [&]() {
-      if (opt.state & QStyle::State_MouseOver) {
-        setRolePen  (painter, ColorRole::MouseOverFg);
-        setRoleBrush(painter, ColorRole::MouseOverBg);
+        c1 = c2 + 1;
       }
-      else {
-        setRolePen(painter, ColorRole::Text);
+    }
+  }
 
-        if (opt.features & QStyleOptionViewItem::Alternate)
-          setRoleBrush(painter, ColorRole::AlternateBg);
-        else
-          setRoleBrush(painter, ColorRole::Base);
-      }
+  //---
 
-      painter->fillRect(opt.rect, painter->brush());
+  globalRowData_   .headerHeight = ncr*(fh + 1) + 2*globalRowData_.margin;
+  globalColumnData_.headerWidth  = paintData_.fm.horizontalAdvance("X") + 2*globalRowData_.margin;
+  globalRowData_   .height       = fh + globalRowData_.margin;
 
-      if (opt.features & QStyleOptionViewItem::Alternate)
-        setRoleBrush(painter, ColorRole::AlternateBg);
-      else
-        setRoleBrush(painter, ColorRole::Base);
-    };
+  // space for headers
+  int filterHeight = (isShowFilter() ? fh + 8 : 0);
 
-    //---
+  int lm = 0;
 
-    fillIndicatorBackground();
+  if (isShowVerticalHeader())
+    lm = std::max(globalColumnData_.headerWidth, globalRowData_.vheaderWidth);
 
-    style()->drawPrimitive(QStyle::PE_IndicatorBranch, &opt, painter, this);
-  }
+  int mx1 = lm                                        , mx2 = 0;
+  int my1 = globalRowData_.headerHeight + filterHeight, my2 = 0;
 
-  //--
+  if (isHeaderOnRight())
+    std::swap(mx1, mx2);
 
-  auto pc = visCellDatas_.find(ind);
-  if (pc == visCellDatas_.end()) return;
+  if (isHeaderOnBottom())
+    std::swap(my1, my2);
 
-  const auto &visCellData = (*pc).second;
+  setViewportMargins(mx1, my1, mx2, my2);
 
   //---
 
-  bool isNumeric = isNumericColumn(c);
-
-  //--
-
-  // init style data
-  QStyleOptionViewItem option;
+  // inner viewport
+  auto vrect = viewport()->geometry();
 
-  option.init(this);
+  //---
 
-  option.state &= ~QStyle::State_MouseOver;
+  cornerWidget_->setVisible(isShowVerticalHeader());
 
-  if      (selectionBehavior() == SelectRows) {
-    if (ind.row() == mouseData_.moveData.ind.row())
-      option.state |= QStyle::State_MouseOver;
-  }
-  else if (selectionBehavior() == SelectColumns) {
-    if (ind.column() == mouseData_.moveData.ind.column())
-      option.state |= QStyle::State_MouseOver;
-  }
-  else {
-    if (ind == mouseData_.moveData.ind)
-      option.state |= QStyle::State_MouseOver;
-  }
+  int cx = 0;
+  int cy = 0;
 
-  if (ind == currentIndex() && currentIndex().isValid())
-    option.state |= QStyle::State_HasFocus;
-  else
-    option.state &= ~QStyle::State_HasFocus;
+  if (isHeaderOnRight())
+    cx = vrect.right();
 
-  if (alternatingRowColors() && visRowData.alternate)
-    option.features |= QStyleOptionViewItem::Alternate;
-  else
-    option.features &= ~QStyleOptionViewItem::Alternate;
+  if (isHeaderOnBottom())
+    cy = vrect.bottom();
 
-  option.widget                 = this;
-  option.rect                   = visCellData.rect;
-  option.font                   = font();
-  option.fontMetrics            = QFontMetrics(option.font);
-  option.decorationSize         = paintData_.decorationSize;
-  option.decorationPosition     = QStyleOptionViewItem::Left;
-  option.decorationAlignment    = Qt::AlignCenter;
-  option.displayAlignment       = (isNumeric ? Qt::AlignRight : Qt::AlignLeft) | Qt::AlignVCenter;
-  option.textElideMode          = textElideMode();
-  option.showDecorationSelected = paintData_.showDecorationSelected;
+  cornerWidget_->setGeometry(cx, cy, lm, globalRowData_.headerHeight);
 
   //---
 
-#if 0
-  auto fillBackground = [&]() {
-    auto bgVar = model_->data(ind, Qt::BackgroundRole);
+  int hhx = vrect.left();
+  int hhy = vrect.top() - globalRowData_.headerHeight;
 
-    if (bgVar.canConvert<QBrush>())
-      painter->setBrush(qvariant_cast<QBrush>(bgVar).color());
+  if (isHeaderOnBottom())
+    hhy = vrect.bottom();
 
-    //---
+  hh_->setGeometry(hhx, hhy, vrect.width(), globalRowData_.headerHeight);
 
-    if (option.state & QStyle::State_MouseOver) {
-      setRolePen  (painter, ColorRole::MouseOverFg);
-      setRoleBrush(painter, ColorRole::MouseOverBg);
-    }
-    else {
-      setRolePen(painter, ColorRole::Text);
+  //---
 
-      if (option.features & QStyleOptionViewItem::Alternate)
-        setRoleBrush(painter, ColorRole::AlternateBg);
-      else
-        setRoleBrush(painter, ColorRole::Base);
-    }
+  int vhx = vrect.left() - lm;
+  int vhy = vrect.top();
 
-    painter->fillRect(option.rect, painter->brush());
+  if (isHeaderOnRight())
+    vhx = vrect.right();
 
-    if (option.features & QStyleOptionViewItem::Alternate)
-      setRoleBrush(painter, ColorRole::AlternateBg);
-    else
-      setRoleBrush(painter, ColorRole::Base);
-  };
-#endif
+  vh_->setGeometry(vhx, vhy, lm, vrect.height());
 
   //---
 
-  // set font
-  auto fontVar = ind.data(Qt::FontRole);
+  const_cast<CQModelView *>(this)->updateScrollBars();
+  const_cast<CQModelView *>(this)->updateVisColumns();
 
-  if (fontVar.isValid()){
-    option.font        = qvariant_cast<QFont>(fontVar).resolve(option.font);
-    option.fontMetrics = QFontMetrics(option.font);
+  //---
+
+  int nfe = int(filterEdits_.size());
+
+  while (nfe > nvc_) {
+    delete filterEdits_.back();
+
+    filterEdits_.pop_back();
+
+    --nfe;
   }
 
-  // set text alignment
-  auto alignVar = ind.data(Qt::TextAlignmentRole);
+  while (nfe < nvc_) {
+    auto *le = new CQModelViewFilterEdit(this);
+    le->setObjectName(QString("filterEdit%1").arg(nfe));
 
-  if (alignVar.isValid())
-    option.displayAlignment = Qt::Alignment(alignVar.toInt());
+    connect(le, SIGNAL(editingFinished()), this, SLOT(editFilterSlot()));
+    connect(le, SIGNAL(textEdited(const QString &)), this, SLOT(filterTextChangedSlot()));
 
-  // set foreground brush
-  auto fgVar = ind.data(Qt::ForegroundRole);
+    filterEdits_.push_back(le);
 
-  if (fgVar.canConvert<QBrush>())
-    option.palette.setBrush(QPalette::Text, qvariant_cast<QBrush>(fgVar));
+    ++nfe;
+  }
 
-  // disable style animations for checkboxes etc. within itemview
-  option.styleObject = nullptr;
+  if (isShowFilter()) {
+    int x = vrect.left();
 
-  //---
+    int ic = 0;
 
-  auto *delegate = itemDelegate();
+    for (int c = 0; c < nc_ && ic < nfe; ++c) {
+      if (isColumnHidden(c))
+        continue;
 
-  if (! delegate) {
-    drawCellBackground(painter, option, ind);
+      auto *le = filterEdits_[uint(ic)];
 
-    // draw cell value
-    setRolePen(painter, ColorRole::HeaderFg);
+      le->setColumn(c);
 
-    auto data = model_->data(ind, Qt::DisplayRole);
+      int cw = columnWidth(c);
 
-    auto str = data.toString();
+      le->setGeometry(x, 0, cw, filterHeight);
 
-    auto textRect = option.rect.adjusted(4, 0, -4, 0);
+      le->setVisible(true);
 
-    painter->save();
+      auto data = model_->headerData(ic, Qt::Horizontal, Qt::DisplayRole);
 
-    painter->setPen(option.palette.brush(QPalette::Text).color());
+      le->setPlaceholderText(data.toString());
 
-    painter->setClipRect(textRect);
+      x += cw;
 
-#if 1
-    QTextOption textOption;
+      ++ic;
+    }
+  }
+  else {
+    for (int c = 0; c < nvc_; ++c) {
+      auto *le = filterEdits_[uint(c)];
 
-    textOption.setAlignment(option.displayAlignment);
+      le->setVisible(false);
+    }
+  }
+}
 
-    QTextLayout textLayout(str, option.font);
+// depends:
+//  number of rows, row height, column width, row hidden, column hidden, viewport height
+void
+CQModelView::
+updateScrollBars()
+{
+  if (! state_.updateScrollBars)
+    return;
 
-    textLayout.setTextOption(textOption);
+  state_.updateScrollBars = false;
 
-    (void) viewItemTextLayout(textLayout, textRect.width());
+  //---
 
-    int nl = textLayout.lineCount();
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::updateScrollBars");
+#endif
 
-    int dy = (option.rect.height() - paintData_.fm.height() + 1)/2;
+  updateVisColumns   ();
+  updateColumnOffsets();
+  updateRowDatas     ();
 
-    dy += paintData_.fm.ascent();
+  //---
 
-    for (int i = 0; i < nl; ++i) {
-      auto line = textLayout.lineAt(i);
+  int rowHeight = this->rowHeight(0);
 
-      int start  = line.textStart();
-      int length = line.textLength();
+  int w = columnOffsets_.back();
+  int h = nvr_*rowHeight;
 
-      auto text = textLayout.text().mid(start, length);
+  //---
 
-      painter->drawText(textRect.topLeft() + QPoint(0, dy), text);
+  bool vchanged = false;
+  bool hchanged = false;
 
-      //line.draw(painter, textRect.topLeft());
+  int ah = viewport()->height();
 
-      break;
-    }
-#else
-    painter->drawText(textRect, option.displayAlignment, str);
-#endif
+  if (h > ah) {
+    scrollData_.nv = (ah + rowHeight - 1)/rowHeight;
 
-    painter->restore();
+    int maxv = nvr_ - scrollData_.nv;
+
+    if (! vs_->isVisible() || scrollData_.nv != vs_->pageStep() || maxv != vs_->maximum()) {
+      vs_->setPageStep(scrollData_.nv);
+      vs_->setRange(0, nvr_ - scrollData_.nv);
+
+      vs_->setVisible(true);
+
+      vchanged = true;
+    }
   }
   else {
-    //style()->drawPrimitive(QStyle::PE_PanelItemViewRow, &option, painter, this);
+    scrollData_.nv = -1;
 
-    //drawCellBackground(painter, option, ind);
+    if (vs_->isVisible()) {
+      vs_->setVisible(false);
 
-    auto *delegate  = itemDelegate();
-    auto *idelegate = qobject_cast<CQItemDelegate *>(delegate);
+      vchanged = true;
+    }
+  }
 
-    if (idelegate) {
-      const ColumnData &columnData = columnDatas_[uint(c)];
+  //---
 
-      idelegate->setHeatmap(columnData.heatmap);
-    }
+  int aw = viewport()->width();
 
-    if (option.state & QStyle::State_MouseOver) {
-      if (selectionBehavior() != SelectRows && selectionBehavior() != SelectColumns)
-        option.state |= QStyle::State_HasEditFocus;
+  if (w > aw) {
+    int maxh = w - aw;
+
+    if (! hs_->isVisible() || aw != hs_->pageStep() || maxh != hs_->maximum()) {
+      hs_->setPageStep(aw);
+      hs_->setRange(0, w - aw);
+
+      hs_->setVisible(true);
+
+      hchanged = true;
     }
+  }
+  else {
+    if (hs_->isVisible()) {
+      hs_->setVisible(false);
 
-    delegate->paint(painter, option, ind);
+      hchanged = true;
+    }
   }
+
+  if (hchanged || vchanged)
+    scrollTo(currentIndex());
 }
 
 void
 CQModelView::
-drawCellBackground(QPainter *painter, const QStyleOptionViewItem &option,
-                   const QModelIndex &ind) const
+updateCurrentIndices()
 {
-  auto bgVar = model_->data(ind, Qt::BackgroundRole);
-
- if (bgVar.canConvert<QBrush>())
-   painter->setBrush(qvariant_cast<QBrush>(bgVar).color());
-
- //---
+  auto ind = sm_->currentIndex();
 
- if (option.state & QStyle::State_MouseOver) {
-   setRolePen  (painter, ColorRole::MouseOverFg);
-   setRoleBrush(painter, ColorRole::MouseOverBg);
- }
- else {
-   setRolePen(painter, ColorRole::Text);
+  if (ind.isValid()) {
+    auto hind = model_->index(0, ind.column(), QModelIndex());
+    auto vind = model_->index(ind.row   (), 0, ind.parent());
 
-   if (option.features & QStyleOptionViewItem::Alternate)
-     setRoleBrush(painter, ColorRole::AlternateBg);
-   else
-     setRoleBrush(painter, ColorRole::Base);
- }
+    hsm_->setCurrentIndex(hind, QItemSelectionModel::NoUpdate);
+    vsm_->setCurrentIndex(vind, QItemSelectionModel::NoUpdate);
 
- painter->fillRect(option.rect, painter->brush());
+    currentFlatRow_ = (vsm_->currentIndex().isValid() ?
+                         indexFlatRow(vsm_->currentIndex()) : -1);
+  }
+  else {
+    hsm_->clearCurrentIndex();
+    vsm_->clearCurrentIndex();
+  }
 
- if (option.features & QStyleOptionViewItem::Alternate)
-   setRoleBrush(painter, ColorRole::AlternateBg);
- else
-   setRoleBrush(painter, ColorRole::Base);
+  redraw();
 }
 
-//------
-
 void
 CQModelView::
-updateVisColumns()
+updateSelection()
 {
-  if (! state_.updateVisColumns)
+  if (! model_)
     return;
 
-  state_.updateVisColumns = false;
+  // drag selection redraws changed rows itself
+  if (mouseData_.dragUpdate)
+    return;
 
-  //---
+  // header section selection is not copied to hsm_/vsm_. It is queried from the
+  // selection model's row/column intervals for the visible sections when drawn
+  redraw();
+}
 
+CQModelViewSelectionModel *
+CQModelView::
+viewSelectionModel() const
+{
+  return qobject_cast<CQModelViewSelectionModel *>(sm_.data());
+}
+
+void
+CQModelView::
+paintEvent(QPaintEvent *e)
+{
 #ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::updateVisColumns");
+  CQPerfMonitorInst->resetStartsWith("CQModelView::");
+
+  CQPerfTrace trace("CQModelView::paintEvent");
 #endif
 
-  nvc_ = 0;
+  //---
 
-  int lastC = -1;
+  QPainter painter(this->viewport());
 
-  visColumnDatas_.clear();
+//painter.setClipRegion(e->region());
 
-  int x1 = -horizontalOffset();
+  paintRect_ = e->rect();
 
-  int margin = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
+  //---
 
-  freezeWidth_  = 0;
-  freezeColumn_ = -1;
+  auto c = palette().color(QPalette::Base);
 
-  for (int c = 0; c < nc_; ++c) {
-    if (isColumnHidden(c))
-      continue;
-
-    //---
+  painter.fillRect(viewport()->rect(), c);
 
-    const ColumnData &columnData = columnDatas_[uint(c)];
+  auto isDarkColor = [](const QColor &c) {
+    int gray = qGray(c.red(), c.green(), c.blue());
+    return (gray <= 127);
+  };
 
-    int cw = (columnData.width > 0 ? columnData.width : 100);
-    int x2 = x1 + cw;
+  isDark_ = isDarkColor(c);
 
-    VisColumnData &visColumnData = visColumnDatas_[c];
+  //---
 
-    //---
+  paintData_.fm = QFontMetrics(font());
 
-    if (isFreezeFirstColumn() && freezeColumn_ < 0) {
-      freezeColumn_ = c;
-      freezeWidth_  = columnWidth(c, visColumnData);
-    }
+  //---
 
-    //---
+#if 0
+  int nr = nr_;
+  int nc = nc_;
+#endif
 
-    int xl, xr;
+  if (model_) {
+    auto parent = rootIndex();
 
-    if (c == freezeColumn_) {
-      xl = margin;
-      xr = cw - margin;
-    }
-    else {
-      xl = x1 + margin;
-      xr = x2 - margin;
-    }
+    nr_ = model_->rowCount   (parent);
+    nc_ = model_->columnCount(parent);
+  }
+  else {
+    nr_ = 0;
+    nc_ = 0;
+  }
 
-    visColumnData.rect  = QRect(xl, 0, xr - xl + 1, globalRowData_.headerHeight);
-    visColumnData.hrect = QRect(xr, 0, 2*margin   , globalRowData_.headerHeight);
+  if (nc_ != int(columnDatas_.size())) {
+    columnDatas_.resize(uint(nc_));
+  }
 
-    visColumnData.first = (nvc_ == 0);
+  //---
 
-    visColumnData.visible = ! (x1 > visualRect_.right() || x2 < visualRect_.left());
+#if 0
+  // TODO: needed, model signals should handle this
+  if (! state_.updateScrollBars)
+    state_.updateScrollBars = (nc_ != nc || nr_ !=  nr);
+#endif
 
-    ++nvc_;
+  //---
 
-    lastC = c;
+  if (autoFitOnShow_) {
+    if (! autoFitted_) {
+      autoFitted_ = true;
 
-    x1 = x2;
+      fitAllColumnsSlot();
+    }
   }
 
-  int vw = viewport()->rect().width();
+  //---
+
+  if (isShowGrid())
+    initDrawGrid();
 
-  if (lastC > 0) {
-    VisColumnData &visColumnData = visColumnDatas_[lastC];
+  //---
 
-    visColumnData.last = true;
+  drawCells(&painter);
 
-    if (isStretchLastColumn()) {
-      int xr = visColumnData.rect.right();
+  //---
 
-      if (xr + margin < vw) {
-        int xl = visColumnData.rect.left();
+  drawAlternateEmpty(&painter);
 
-        xr = vw - margin - 1;
+  //---
 
-        visColumnData.rect  = QRect(xl, 0, xr - xl + 1, globalRowData_.headerHeight);
-        visColumnData.hrect = QRect(xr, 0, 2*margin, globalRowData_.headerHeight);
-      }
-    }
-  }
+  if (isShowGrid())
+    drawGrid(&painter);
 }
 
-//------
-
 void
 CQModelView::
-updateRowDatas()
+drawAlternateEmpty(QPainter *painter)
 {
-  if (! state_.updateRowDatas)
-    return;
+  QStyleOptionViewItem opt;
 
-  state_.updateRowDatas = false;
+  bool alternateEmpty =
+    style()->styleHint(QStyle::SH_ItemView_PaintAlternatingRowColorsForEmptyArea, &opt, this);
 
-  //---
+  if (alternateEmpty) {
+    int alternate = 0;
 
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::updateRowDatas");
-#endif
+    if (nvr_ > 0 && ! visFlatRows_.empty()) {
+      int flatRow = visFlatRows_.back();
 
-  // update visible rows
-  nmr_          = 0;
-  nvr_          = 0;
-  hierarchical_ = false;
+      const auto *visRowData = visFlatRowData(flatRow);
+      assert(visRowData);
 
-  rowDatas_.clear();
+      alternate = (visRowData->flatRow & 1);
+    }
 
-  auto parent = rootIndex();
+    int y = nvr_*paintData_.rowHeight;
+
+    while (y < paintData_.vh) {
+      alternate = 1 - alternate;
+
+      if (alternate)
+        setRoleBrush(painter, ColorRole::AlternateBg);
+      else
+        setRoleBrush(painter, ColorRole::Base);
+
+      opt.rect = QRect(0, y, paintData_.vw, paintData_.rowHeight);
+
+      painter->fillRect(opt.rect, painter->brush());
 
-  initRowDatas(parent, nvr_, 0, -1);
+      y += paintData_.rowHeight;
+    }
+  }
 }
 
 void
 CQModelView::
-initRowDatas(const QModelIndex &parent, int &nvr, int depth, int parentFlatRow)
+initDrawGrid() const
 {
-  int nr = (model_ ? model_->rowCount(parent) : 0);
+  QStyleOptionViewItem option;
 
-  for (int r = 0; r < nr; ++r) {
-    ++nmr_;
+  int gridHint = style()->styleHint(QStyle::SH_Table_GridLineColor, &option, this);
 
-    if (isRowHidden(r, parent))
-      continue;
+  auto gridColor = QColor(static_cast<QRgb>(gridHint));
 
-    auto ind1 = model_->index(r, 0, parent);
+  paintData_.gridPen = QPen(gridColor, 0, gridStyle());
+}
 
-    bool children = model_->hasChildren(ind1);
-    bool expanded = (! ignoreExpanded_ ? isExpanded(ind1) : true);
+void
+CQModelView::
+drawGrid(QPainter *painter)
+{
+  setRolePen(painter, ColorRole::GridFg);
 
-    if (children)
-      hierarchical_ = true;
+  for (const auto &visRowData : visRowDatas_) {
+    int x1 = visRowData.rect.left();
+//  int y1 = visRowData.rect.top();
+    int y2 = visRowData.rect.bottom() - 1;
 
-    int parentFlatRow1 = nvr;
+    painter->drawLine(x1, y2, paintData_.vw - x1, y2);
+  }
 
-    rowDatas_[nvr]  = RowData(parent, r, nr, nvr, children, expanded, depth, parentFlatRow);
-    indRow_  [ind1] = nvr;
+  int y1 = 0;
 
-    ++nvr;
+  for (const auto &pv : visColumnDatas_) {
+    const auto &visColumnData = pv.second;
 
-    if (children && expanded) {
-      if (model_ && model_->canFetchMore(parent))
-        model_->fetchMore(parent);
+    if (! visColumnData.visible)
+      continue;
 
-      initRowDatas(ind1, nvr, depth + 1, parentFlatRow1);
-    }
+//  int x1 = visColumnData.rect.left ();
+    int x2 = visColumnData.rect.right();
+
+    painter->drawLine(x2, y1, x2, paintData_.vh - y1);
   }
 }
 
-//------
-
 void
 CQModelView::
-updateVisRows()
+drawCells(QPainter *painter) const
 {
-  if (! state_.updateVisRows)
-    return;
-
-  state_.updateVisRows = false;
-
-  //---
-
 #ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::updateVisRows");
+  CQPerfTrace trace("CQModelView::drawCells");
 #endif
 
-  updateRowDatas();
+  const_cast<CQModelView *>(this)->updateScrollBars      ();
+  const_cast<CQModelView *>(this)->updateVisCells        ();
+  const_cast<CQModelView *>(this)->updateWidgetGeometries();
 
   //---
 
-  visRowDatas_.clear();
-  visFlatRows_.clear();
+  paintData_.reset();
 
-  //---
+  paintData_.vrect     = viewport()->rect();
+  paintData_.vw        = paintData_.vrect.width ();
+  paintData_.vh        = paintData_.vrect.height();
+  paintData_.margin    = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
+  paintData_.rowHeight = this->rowHeight(0);
 
-  int rowHeight = this->rowHeight(0);
+  if (iconSize().isValid()) {
+    paintData_.decorationSize = iconSize();
+  }
+  else {
+    int pm = style()->pixelMetric(QStyle::PM_SmallIconSize, nullptr, this);
 
-  int borderHeight = visualBorderRows_*rowHeight;
+    paintData_.decorationSize = QSize(pm, pm);
+  }
 
-  int vy1 = visualRect_.top   () - borderHeight;
-  int vy2 = visualRect_.bottom() + borderHeight;
+  paintData_.showDecorationSelected =
+    style()->styleHint(QStyle::SH_ItemView_ShowDecorationSelected, nullptr, this);
 
   //---
 
-  int y1 = 0;
+  drawCellsRows(painter);
 
-  if (vs_->isVisible() && vs_->value() == vs_->maximum())
-    y1 = -(nvr_*rowHeight - paintData_.vh);
-  else
-    y1 = -verticalOffset()*rowHeight;
+  drawCellsSelection(painter);
+}
 
-  int hw = std::max(globalColumnData_.headerWidth, globalRowData_.vheaderWidth);
+void
+CQModelView::
+drawCellsRows(QPainter *painter) const
+{
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::drawCellsRows");
+#endif
 
-  for (const auto &pr : rowDatas_) {
-    const auto &rowData = pr.second;
+  // draw rows
+  for (const auto &flatRow : visFlatRows_) {
+    auto rowData = rowDatas_.rowData(flatRow);
 
     //---
 
-    int y2 = y1 + rowHeight;
-
-    VisRowData &visRowData = visRowDatas_[rowData.parent][rowData.row];
-
-    visRowData.rect = QRect(0, y1, hw, y2 - y1 + 1);
-
-    visRowData.depth         = rowData.depth;
-    visRowData.parentFlatRow = rowData.parentFlatRow;
-    visRowData.flatRow       = rowData.flatRow;
-    visRowData.r             = rowData.row;
-    visRowData.nr            = rowData.numRows;
-    visRowData.alternate     = (visRowData.flatRow & 1);
-    visRowData.children      = rowData.children;
-    visRowData.expanded      = rowData.expanded;
-    visRowData.visible       = ! (y1 > visualRect_.bottom() || y2 < visualRect_.top());
-    visRowData.evisible      = ! (y1 > vy2 || y2 < vy1);
-    visRowData.depth         = rowData.depth;
+    const auto *pvisRowData = visFlatRowData(flatRow);
+    if (! pvisRowData) continue;
 
-    //---
+    const auto &visRowData = *pvisRowData;
 
-    if (visRowData.evisible)
-      visFlatRows_.push_back(visRowData.flatRow);
+    // skip rows outside update rect (e.g. partial redraw of drag selection change)
+    if (visRowData.rect.bottom() < paintRect_.top   () ||
+        visRowData.rect.top   () > paintRect_.bottom())
+      continue;
 
     //---
 
-    y1 = y2;
+    drawRow(painter, rowData.row, rowData.parent, visRowData);
   }
+}
 
-  //---
+void
+CQModelView::
+drawCellsSelection(QPainter *painter) const
+{
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::drawCellsSelection");
+#endif
 
-  globalRowData_.vheaderWidth = -1;
+  const_cast<CQModelView *>(this)->updateVisCells();
 
-  if      (verticalType() == VerticalType::TEXT) {
-    for (int r = 0; r < nr_; ++r) {
-      auto data = (model_ ? model_->headerData(r, Qt::Vertical, Qt::DisplayRole) : QVariant());
-      if (! data.isValid()) continue;
+  // draw selection
+  auto drawSelection = [&](const QRect &r) {
+    setRolePen  (painter, ColorRole::SelectionFg, 0.7);
+    setRoleBrush(painter, ColorRole::SelectionBg, 0.3);
 
-      auto str = data.toString();
-      if (! str.length()) continue;
+    painter->fillRect(r, painter->brush());
 
-      globalRowData_.vheaderWidth =
-        std::max(globalRowData_.vheaderWidth, paintData_.fm.horizontalAdvance(str));
-    }
+    setRoleBrush(painter, ColorRole::None);
 
-    globalRowData_.vheaderWidth += 2*globalRowData_.margin;
-  }
-  else if (verticalType() == VerticalType::NUMBER) {
-    int n = (nr_ > 0 ? int(std::log10(nr_) + 1) : 1);
+    painter->drawRect(r.adjusted(0, 0, -1, -1));
+  };
 
-    globalRowData_.vheaderWidth = n*paintData_.fm.horizontalAdvance("8") + 2*globalRowData_.margin;
-  }
-}
+  auto *sm = viewSelectionModel();
 
-//------
+  if (! sm)
+    return;
 
-void
-CQModelView::
-updateVisCells()
-{
-  if (! state_.updateVisCells)
+  const auto selection = sm->selection();
+
+  if (selection.empty())
     return;
 
-  state_.updateVisCells = false;
+  if (isHierarchical() || isViewSorted()) {
+    const_cast<CQModelView *>(this)->updateHierSelection();
 
-  //---
+    CBitGrid grid;
 
-#ifdef CQ_MODEL_VIEW_TRACE
-  CQPerfTrace trace("CQModelView::updateVisCells");
-#endif
+    for (auto &p : selDepthHierCellAreas_) {
+      const auto &hierCellAreas = p.second;
 
-  updateVisColumns();
-  updateVisRows   ();
+      for (auto &p1 : hierCellAreas) {
+        // selection in flat hierarchical area
+        const auto &cellAreas = p1.second;
 
-  //---
+        // vis grid
+        auto na = cellAreas.size();
+        if (! na) continue;
 
-  visCellDatas_ .clear();
-  ivisCellDatas_.clear();
+        //---
 
-  for (const auto &pc : visColumnDatas_) {
-    int         c             = pc.first;
-    const auto &visColumnData = pc.second;
+        // reset selected cells
+        for (auto &vc : cellAreas) {
+          if (vc)
+            vc->selected = true;
+        }
 
-    int x1 = visColumnData.rect.left () - paintData_.margin;
-    int x2 = visColumnData.rect.right() + paintData_.margin;
+        //---
 
-    for (const auto &flatRow : visFlatRows_) {
-      auto pr = rowDatas_.find(flatRow);
-      assert(pr != rowDatas_.end());
+        // grid is visible column slots wide (not model columns)
+        int nr = int(na/size_t(visCellNc_));
 
-      const auto &rowData = (*pr).second;
+        grid.resize(visCellNc_, nr);
 
-      //---
+        for (int r = 0; r < nr; ++r) {
+          for (int cs = 0; cs < visCellNc_; ++cs) {
+            const auto *vc = cellAreas[uint(r*visCellNc_ + cs)];
 
-      const VisRowData &visRowData = visRowDatas_[rowData.parent][rowData.row];
+            if (vc && vc->selected)
+              grid.set(cs, r);
+          }
+        }
 
-      int y1 = visRowData.rect.top   ();
-      int y2 = visRowData.rect.bottom();
+        //---
 
-      //---
+        // draw disjoint rectangles of selected cells (row runs merged vertically)
+        for (const auto &grect : grid.rects()) {
+          const auto *vc1 = cellAreas[uint(grect.top     *visCellNc_ + grect.left   )];
+          const auto *vc2 = cellAreas[uint(grect.bottom()*visCellNc_ + grect.right())];
+          assert(vc1 && vc2);
 
-      int indent = 0;
+          int x1 = vc1->rect.left  ();
+          int y1 = vc1->rect.top   ();
+          int x2 = vc2->rect.right ();
+          int y2 = vc2->rect.bottom();
 
-      if (isHierarchical() && c == 0) {
-        auto ind = model_->index(rowData.row, c, rowData.parent);
+          QRect rect(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
 
-        VisCellData &ivisCellData = ivisCellDatas_[ind];
+          drawSelection(rect);
 
-        indent = (visRowData.depth + rootIsDecorated())*indentation();
+          //---
 
-        ivisCellData.depth         = rowData.depth;
-        ivisCellData.parentFlatRow = rowData.parentFlatRow;
-        ivisCellData.flatRow       = flatRow;
-        ivisCellData.r             = rowData.row;
-        ivisCellData.nr            = rowData.numRows;
-        ivisCellData.c             = 0;
-        ivisCellData.rect          = QRect(x1, y1, indent, y2 - y1 + 1);
-        ivisCellData.selected      = false;
+          for (int r = grect.top; r <= grect.bottom(); ++r) {
+            for (int cs = grect.left; cs <= grect.right(); ++cs) {
+              auto *vc = cellAreas[uint(r*visCellNc_ + cs)];
+
+              if (vc)
+                vc->selected = false;
+            }
+          }
+        }
       }
+    }
 
-      //---
+    // draw selected cells not covered by a rectangle
+    for (auto &visCellData : visCellDatas_) {
+      if (visCellData.selected)
+        drawSelection(visCellData.rect);
+    }
+  }
+  else {
+    for (auto it = selection.constBegin(); it != selection.constEnd(); ++it) {
+      const auto &range = *it;
 
-      auto ind = model_->index(rowData.row, c, rowData.parent);
+      int x1 = paintData_.vrect.left ();
+      int x2 = paintData_.vrect.right();
 
-      VisCellData &visCellData = visCellDatas_[ind];
+      int xl, xr;
 
-      if (visColumnData.last && isStretchLastColumn() && x2 < paintData_.vw)
-        x2 = paintData_.vw - 1;
+      if (columnXRange(range.left (), xl, xr))
+        x1 = xl;
 
-      int xi1 = x1 + indent;
+      if (columnXRange(range.right(), xl, xr))
+        x2 = xr;
 
-      visCellData.depth         = rowData.depth;
-      visCellData.parentFlatRow = rowData.parentFlatRow;
-      visCellData.flatRow       = flatRow;
-      visCellData.r             = rowData.row;
-      visCellData.nr            = rowData.numRows;
-      visCellData.c             = c;
-      visCellData.rect          = QRect(xi1, y1, x2 - xi1 + 1, y2 - y1 + 1);
-      visCellData.selected      = false;
-    }
-  }
-}
+      //---
 
-//------
+      int flatRow1 = flatRowPos(range.parent(), range.top());
+      int flatRow2 = flatRowPos(range.parent(), range.bottom() + 1);
+      if (flatRow1 < 0 || flatRow2 <= flatRow1) continue;
 
-bool
-CQModelView::
-isNumericColumn(int c) const
-{
-  auto type = CQBaseModelType::STRING;
+      int rowHeight = this->rowHeight(0);
 
-  auto tvar = model_->headerData(c, Qt::Horizontal, static_cast<int>(CQBaseModelRole::Type));
-  if (! tvar.isValid()) return false;
+      // clip to a row outside view so clipped border is not scrolled into view
+      int y1 = std::max(visRowsY_ + flatRow1*rowHeight, paintData_.vrect.top   () - rowHeight);
+      int y2 = std::min(visRowsY_ + flatRow2*rowHeight, paintData_.vrect.bottom() + rowHeight);
 
-  bool ok;
-  type = static_cast<CQBaseModelType>(tvar.toInt(&ok));
-  if (! ok) return false;
+      if (y1 > y2) continue;
 
-  //---
+      QRect r(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
 
-  return (type == CQBaseModelType::REAL || type == CQBaseModelType::INTEGER);
+      drawSelection(r);
+    }
+  }
 }
 
 void
 CQModelView::
-editFilterSlot()
+updateHierSelection()
 {
-  auto *le = qobject_cast<CQModelViewFilterEdit *>(sender());
-  assert(le);
+  // update grid of cells selected per depth and parent flat row
+  if (state_.updateSelection) {
+    state_.updateSelection = false;
 
-  filterColumn(le->column());
-}
+    selDepthHierCellAreas_.clear();
 
-void
-CQModelView::
-filterColumn(int column)
-{
-  assert(column >= 0);
+    for (auto &visCellData : visCellDatas_)
+      visCellData.selected = false;
 
-  auto *le = filterEdits_[uint(column)];
+    auto *sm = viewSelectionModel();
+    if (! sm) return;
 
-  auto parent = rootIndex();
+    // selected visible cells and their position range per depth and parent flat row
+    using DepthParent = std::pair<int, int>;
+    using PosRange    = std::pair<int, int>;
 
-  auto filterStr = le->text().trimmed();
+    std::vector<VisCellData *>      selCells;
+    std::map<DepthParent, PosRange> posRanges;
 
-  if (filterStr.length()) {
-    QRegExp regexp(filterStr, Qt::CaseSensitive, QRegExp::Wildcard);
+    // only query selection of visible cells (offscreen ranges cost nothing)
+    int nr = int(visFlatRows_.size());
 
-    for (int r = 0; r < nr_; ++r) {
-      auto ind = model_->index(r, column, parent);
+    for (int rs = 0; rs < nr; ++rs) {
+      auto rowData = rowDatas_.rowData(visFlatRows_[uint(rs)]);
 
-      auto str = model_->data(ind, Qt::DisplayRole).toString();
+      if (! sm->isAnyRowCellSelected(rowData.row, rowData.parent))
+        continue;
 
-      bool visible = (str == filterStr || regexp.exactMatch(str));
+      int cs = 0;
 
-      setRowHidden(r, parent, ! visible);
-    }
-  }
-  else {
-    for (int r = 0; r < nr_; ++r) {
-      setRowHidden(r, parent, false);
-    }
-  }
+      for (const auto &pc : visColumnDatas_) {
+        int c    = pc.first;
+        int slot = rs*visCellNc_ + cs++;
 
-  state_.updateAll();
+        if (! sm->isCellSelected(rowData.row, c, rowData.parent))
+          continue;
 
-  redraw();
+        auto &vc = visCellDatas_[uint(slot)];
 
-  emit stateChanged();
-}
+        vc.selected = true;
 
-void
-CQModelView::
-hscrollSlot(int v)
-{
-  if (scrollData_.hpos != v) {
-    scrollData_.hpos = v;
+        selCells.push_back(&vc);
 
-    state_.updateVisColumns = true;
-    state_.updateVisCells   = true;
+        DepthParent depthParent(-vc.depth, vc.parentFlatRow);
 
-    redraw();
-  }
-}
+        auto pr = posRanges.find(depthParent);
 
-void
-CQModelView::
-vscrollSlot(int v)
-{
-  if (scrollData_.vpos != v) {
-    scrollData_.vpos = v;
+        if (pr == posRanges.end())
+          posRanges[depthParent] = PosRange(vc.pos, vc.pos);
+        else {
+          (*pr).second.first  = std::min((*pr).second.first , vc.pos);
+          (*pr).second.second = std::max((*pr).second.second, vc.pos);
+        }
+      }
+    }
 
-    state_.updateVisRows   = true;
-    state_.updateVisCells  = true;
-    state_.updateSelection = true;
+    // grid of selected cells clipped to the visible positions of each parent and
+    // the visible column slots (visCellNc_ wide)
+    for (auto *vc : selCells) {
+      const auto &posRange = posRanges[DepthParent(-vc->depth, vc->parentFlatRow)];
 
-    redraw();
+      CellAreas &cellAreas = selDepthHierCellAreas_[-vc->depth][vc->parentFlatRow];
+
+      if (cellAreas.empty())
+        cellAreas.resize(uint((posRange.second - posRange.first + 1)*visCellNc_));
+
+      int cs = visCellColumns_[uint(vc->c)];
+
+      cellAreas[uint((vc->pos - posRange.first)*visCellNc_ + cs)] = vc;
+    }
   }
 }
 
 void
 CQModelView::
-mousePressEvent(QMouseEvent *e)
+drawHHeader(QPainter *painter) const
 {
-  mouseData_.pressed   = true;
-  mouseData_.modifiers = e->modifiers();
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::drawHHeader");
+#endif
 
-  if (e->button() != Qt::LeftButton)
-    return;
+  const_cast<CQModelView *>(this)->updateScrollBars      ();
+  const_cast<CQModelView *>(this)->updateVisColumns      ();
+  const_cast<CQModelView *>(this)->updateWidgetGeometries();
 
-  mouseData_.pressData.pos = e->pos();
+  //---
 
-  cellPositionToIndex(mouseData_.pressData);
+  paintData_.reset();
 
-  handleMousePress();
-}
+  paintData_.vrect     = hh_->viewport()->rect();
+  paintData_.vw        = paintData_.vrect.width ();
+  paintData_.vh        = paintData_.vrect.height();
+  paintData_.margin    = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
+  paintData_.rowHeight = this->rowHeight(0);
 
-void
-CQModelView::
-handleMousePress()
-{
-  // mouse type for expand/collapse of tree
-  if (isHierarchical()) {
-    if (style()->styleHint(QStyle::SH_ListViewExpand_SelectMouseType, nullptr, this) ==
-          QEvent::MouseButtonPress) {
-      if (mouseData_.pressData.iind.isValid()) {
-        setExpanded(mouseData_.pressData.iind, ! isExpanded(mouseData_.pressData.iind));
-        return;
-      }
-    }
-  }
+  if (showHHeaderLines())
+    initDrawGrid();
 
   //---
 
-  mouseData_.pressData.currentInd = sm_->currentIndex();
+  painter->fillRect(paintData_.vrect, roleColor(ColorRole::HeaderBg));
 
-  // horizontal header section pressed
-  if      (mouseData_.pressData.hsection >= 0) {
-    if (! (mouseData_.modifiers & Qt::ShiftModifier)) {
-      selectColumn(mouseData_.pressData.hsection, mouseData_.modifiers);
+  //---
 
-      redraw();
-    }
-  }
-  // horizontal header section handle pressed
-  else if (mouseData_.pressData.hsectionh >= 0) {
-    const ColumnData &columnData = columnDatas_[uint(mouseData_.pressData.hsectionh)];
+  painter->save();
 
-    int cw = (columnData.width > 0 ? columnData.width : 100);
+  for (const auto &pv : visColumnDatas_) {
+    int         c             = pv.first;
+    const auto &visColumnData = pv.second;
 
-    mouseData_.headerWidth = cw;
-  }
-  // vertical header section pressed
-  else if (mouseData_.pressData.vsection >= 0) {
-    if (! (mouseData_.modifiers & Qt::ShiftModifier)) {
-      selectRow(mouseData_.pressData.vsection, mouseData_.modifiers);
+    if (! visColumnData.visible)
+      continue;
 
-      redraw();
-    }
-  }
-  // table row/column selected
-  else if (mouseData_.pressData.ind.isValid()) {
-    if      (selectionBehavior() == SelectRows)
-      selectRow(mouseData_.pressData.ind.row(), mouseData_.modifiers);
-    else if (selectionBehavior() == SelectColumns)
-      selectColumn(mouseData_.pressData.ind.column(), mouseData_.modifiers);
-    else
-      selectCell(mouseData_.pressData.ind, mouseData_.modifiers);
+    bool valid = (c != freezeColumn_);
 
-    redraw();
-  }
-}
+    if (valid) {
+      if (freezeColumn_ >= 0) {
+        int x  = visColumnData.rect.left () +   paintData_.margin;
+        int cw = visColumnData.rect.width() + 2*paintData_.margin;
 
-void
-CQModelView::
-mouseMoveEvent(QMouseEvent *e)
-{
-  PositionData moveData;
+        int x1 = std::max(x, freezeWidth_);
+        int x2 = (! visColumnData.last ? std::max(x + cw, freezeWidth_) : paintData_.vw - 1);
 
-  moveData.pos = e->pos();
+        if (x1 < x2) {
+          painter->setClipRect(QRect(x1, 0, x2 - x1 + 1, globalRowData_.headerHeight));
 
-  cellPositionToIndex(moveData);
+          drawHHeaderSection(painter, c, visColumnData);
+        }
+      }
+      else {
+        drawHHeaderSection(painter, c, visColumnData);
+      }
+    }
+  }
 
-  if (! mouseData_.pressed) {
-    if (moveData != mouseData_.moveData) {
-      //auto rrect = mouseData_.moveData.rect.united(moveData.rect);
+  //---
 
-      mouseData_.moveData = moveData;
+  if (freezeColumn_ >= 0) {
+    auto p = visColumnDatas_.find(freezeColumn_);
+    assert(p != visColumnDatas_.end());
 
-      //redraw(rrect);
-      redraw();
-    }
-  }
-  else {
-    if (moveData != mouseData_.moveData) {
-      mouseData_.moveData = moveData;
+    const auto &visColumnData = (*p).second;
 
-      handleMouseMove();
-    }
+    painter->setClipRect(QRect(0, 0, freezeWidth_, globalRowData_.headerHeight));
+
+    drawHHeaderSection(painter, freezeColumn_, visColumnData);
   }
-}
 
-void
-CQModelView::
-handleMouseMove()
-{
-  // horizontal header section pressed
-  if      (mouseData_.pressData.hsection >= 0) {
-    if (mouseData_.moveData.hsection < 0)
-      return;
+  //---
 
-    selectColumnRange(mouseData_.pressData.hsection, mouseData_.moveData.hsection,
-                      mouseData_.modifiers);
+  // draw span text
+  if (isMultiHeaderLines()) {
+    int fh = paintData_.fm.height();
 
-    redraw();
-  }
-  // horizontal header section handle pressed
-  else if (mouseData_.pressData.hsectionh >= 0) {
-    int dx = mouseData_.moveData.pos.x() - mouseData_.pressData.pos.x();
+    for (const auto &pr : rowColumnSpans_) {
+      int         r           = pr.first;
+      const auto &columnSpans = pr.second;
 
-    ColumnData &columnData = columnDatas_[uint(mouseData_.pressData.hsectionh)];
+      int y1 = r*(fh + 1) + globalRowData_.margin;
+      int y2 = y1 + fh;
 
-    columnData.width = std::min(std::max(mouseData_.headerWidth + dx, 4), 9999);
+      for (const auto &span : columnSpans) {
+        int c1 = span.first;
+        int c2 = span.second;
 
-    hh_->resizeSection(mouseData_.pressData.hsectionh, columnData.width);
+        int xl1, xr1, xl2, xr2;
 
-    state_.updateAll();
+        if (! columnXRange(c1, xl1, xr1) || ! columnXRange(c2, xl2, xr2)) continue;
 
-    redraw();
+        if (xr2 < 0 || xl1 >= paintData_.vw) continue;
 
-    emit stateChanged();
-  }
-  // vertical header section pressed
-  else if (mouseData_.pressData.vsection >= 0) {
-    if (mouseData_.moveData.vsection < 0)
-      return;
+        QRect rect(xl1, y1, xr2 - xl1 + 1, y2 - y1 + 1);
 
-    selectRowRange(mouseData_.pressData.vsection, mouseData_.moveData.vsection,
-                   mouseData_.modifiers);
+        auto data = model_->headerData(c1, Qt::Horizontal, Qt::DisplayRole);
 
-    redraw();
-  }
-  // table row/column selected
-  else if (mouseData_.pressData.ind.isValid() && mouseData_.moveData.ind.isValid()) {
-    mouseData_.moveData.currentInd = sm_->currentIndex();
+        auto str = data.toString();
 
-    // TODO: hierarchical will need more work
-    if (isHierarchical()) {
-      QRect rect(mouseData_.pressData.pos, mouseData_.moveData.pos);
+        auto strs = str.split(QRegExp("\n|\r\n|\r"));
 
-      if (! (mouseData_.modifiers & Qt::ControlModifier))
-        setSelection(rect, QItemSelectionModel::ClearAndSelect);
-      else
-        setSelection(rect, QItemSelectionModel::Select);
+        setRolePen(painter, ColorRole::HeaderFg);
 
-      sm_->setCurrentIndex(mouseData_.moveData.ind, QItemSelectionModel::NoUpdate);
-    }
-    else {
-      selectCellRange(mouseData_.pressData.ind, mouseData_.moveData.ind,
-                      mouseData_.modifiers);
-    }
+        painter->drawText(rect, Qt::AlignHCenter | Qt::AlignVCenter, strs[r]);
 
-    scrollTo(mouseData_.moveData.ind);
+        //---
 
-    redraw();
+        setRolePen(painter, ColorRole::HeaderLineFg);
+
+        painter->drawLine(xr2, 0, xr2, globalRowData_.headerHeight - 1);
+        painter->drawLine(rect.bottomLeft(), rect.bottomRight());
+      }
+    }
   }
+
+  //---
+
+  painter->restore();
 }
 
 void
 CQModelView::
-mouseReleaseEvent(QMouseEvent *e)
+drawHHeaderSection(QPainter *painter, int c, const VisColumnData &visColumnData) const
 {
-  if (e->button() != Qt::LeftButton)
-    return;
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::drawHHeaderSection");
+#endif
 
-  mouseData_.releaseData.pos = e->pos();
+  auto data = model_->headerData(c, Qt::Horizontal, Qt::DisplayRole);
 
-  mouseData_.pressed = false;
+  auto str = data.toString();
 
-  cellPositionToIndex(mouseData_.releaseData);
+  //---
 
-  handleMouseRelease();
+  bool isNumeric = isNumericColumn(c);
 
-  mouseData_.pressData.reset();
-  mouseData_.moveData .reset();
-}
+  //---
 
-void
-CQModelView::
-handleMouseRelease()
-{
-  bool click = false;
+  // init style data
+  QStyleOptionHeader option;
 
-  if      (mouseData_.pressData.iind.isValid())
-    click = (mouseData_.pressData.iind == mouseData_.releaseData.iind);
-  else if (mouseData_.pressData.ind.isValid())
-    click = (mouseData_.pressData.ind == mouseData_.releaseData.ind);
-  else if (mouseData_.pressData.hsection >= 0)
-    click = (mouseData_.pressData.hsection == mouseData_.releaseData.hsection);
-  else if (mouseData_.pressData.vsection >= 0)
-    click = (mouseData_.pressData.vsection == mouseData_.releaseData.vsection);
+  option.state = QStyle::State_Horizontal;
 
-  //---
+  if (c == mouseData_.moveData.hsection)
+    option.state |= QStyle::State_MouseOver;
 
-  // vertical header section pressed
-  if      (mouseData_.pressData.hsection >= 0) {
-    if (mouseData_.modifiers & Qt::ShiftModifier) {
-      int currentSection = -1;
+  if (c == mouseData_.pressData.hsection)
+    option.state |= QStyle::State_Sunken;
 
-      if (click) {
-        auto start = mouseData_.pressData.currentInd;
-        if (! start.isValid()) return;
+  auto *sm = viewSelectionModel();
 
-        currentSection = start.column();
-      }
-      else {
-        if (mouseData_.moveData.hsection < 0)
-          return;
+  if (sm && sm->isColumnInSelection(c))
+    option.state |= QStyle::State_Selected;
 
-        currentSection = mouseData_.moveData.hsection;
-      }
+  if (c == hsm_->currentIndex().column() && hsm_->currentIndex().isValid())
+    option.state |= QStyle::State_HasFocus;
 
-      selectColumnRange(mouseData_.pressData.hsection, currentSection, mouseData_.modifiers);
+  // sort priority (1 based) of multi column view sort
+  int sortPriority = 0;
 
-      redraw();
+  if (hh_->isSortIndicatorShown() && viewSortKeys_.size() > 1) {
+    for (size_t i = 0; i < viewSortKeys_.size(); ++i) {
+      if (viewSortKeys_[i].column != c) continue;
+
+      option.sortIndicator = (viewSortKeys_[i].order == Qt::AscendingOrder ?
+        QStyleOptionHeader::SortDown : QStyleOptionHeader::SortUp);
+
+      sortPriority = int(i + 1);
     }
   }
-  // horizontal header section pressed
-  else if (mouseData_.pressData.vsection >= 0) {
-    if (mouseData_.modifiers & Qt::ShiftModifier) {
-      int currentSection = -1;
+  else if (hh_->isSortIndicatorShown() && hh_->sortIndicatorSection() == c)
+    option.sortIndicator = (hh_->sortIndicatorOrder() == Qt::AscendingOrder ?
+      QStyleOptionHeader::SortDown : QStyleOptionHeader::SortUp);
 
-      if (click) {
-        auto start = mouseData_.pressData.currentInd;
-        if (! start.isValid()) return;
+  option.rect          = visColumnData.rect;
+  option.iconAlignment = Qt::AlignCenter;
+  option.section       = c;
+  option.textAlignment = (isNumeric ? Qt::AlignRight : Qt::AlignLeft) | Qt::AlignVCenter;
+  option.orientation   = Qt::Horizontal;
 
-        currentSection = start.row();
-      }
-      else {
-        if (mouseData_.moveData.vsection < 0)
-          return;
+  //---
 
-        currentSection = mouseData_.moveData.vsection;
-      }
+  // get decoration icon
+  auto ivar = model_->headerData(c, Qt::Horizontal, Qt::DecorationRole);
 
-      selectRowRange(mouseData_.pressData.vsection, currentSection, mouseData_.modifiers);
+  option.icon = qvariant_cast<QIcon>(ivar);
 
-      redraw();
-    }
-  }
-  // table row/column selected
-  else if (mouseData_.pressData.ind.isValid() && mouseData_.moveData.ind.isValid()) {
-  }
+  if (option.icon.isNull())
+    option.icon = qvariant_cast<QPixmap>(ivar);
 
   //---
 
-  if (click) {
-    if      (mouseData_.pressData.iind.isValid())
-      emit clicked(mouseData_.pressData.iind);
-    else if (mouseData_.pressData.ind.isValid())
-      emit clicked(mouseData_.pressData.ind);
-    else if (mouseData_.pressData.hsection >= 0) {
-      hh_->emitSectionClicked(mouseData_.pressData.hsection);
-    }
-    else if (mouseData_.pressData.vsection >= 0) {
-      vh_->emitSectionClicked(mouseData_.pressData.vsection);
-    }
-  }
+  option.position         = QStyleOptionHeader::Middle; // TODO
+  option.selectedPosition = QStyleOptionHeader::NotAdjacent; // TODO
 
   //---
 
-  // mouse type for expand/collapse of tree
-  if (isHierarchical()) {
-    if (style()->styleHint(QStyle::SH_ListViewExpand_SelectMouseType, nullptr, this) ==
-          QEvent::MouseButtonRelease) {
-      if (mouseData_.pressData.iind.isValid()) {
-        setExpanded(mouseData_.pressData.iind, ! isExpanded(mouseData_.pressData.iind));
-        return;
-      }
-    }
-  }
-}
+  auto initBrush = [&]() {
+    if (option.state & QStyle::State_MouseOver)
+      setRoleBrush(painter, ColorRole::MouseOverBg);
+    else
+      setRoleBrush(painter, ColorRole::HeaderBg);
+  };
 
-void
-CQModelView::
-mouseDoubleClickEvent(QMouseEvent *e)
-{
-  if (e->button() != Qt::LeftButton)
-    return;
+  auto initPen = [&]() {
+    if (option.state & QStyle::State_MouseOver)
+      setRolePen(painter, ColorRole::MouseOverFg);
+    else
+      setRolePen(painter, ColorRole::HeaderFg);
+  };
 
-  mouseData_.pressData.pos = e->pos();
+  auto fillBackground = [&](const QRect &r) {
+    initBrush();
 
-  cellPositionToIndex(mouseData_.pressData);
+    painter->fillRect(r, painter->brush());
+  };
 
-  handleMouseRelease();
+  auto drawFocus = [&]() {
+    setRolePen  (painter, ColorRole::HighlightBg);
+    setRoleBrush(painter, ColorRole::None);
 
-  if      (mouseData_.pressData.ind.isValid()) {
-    auto persistent = QPersistentModelIndex(mouseData_.pressData.ind);
+    int x1 = option.rect.left  ();
+    int x2 = option.rect.right ();
+    int y  = option.rect.bottom();
 
-    if (edit(persistent, DoubleClicked, e))
-      return;
+    for (int i = 0; i < 3; ++i)
+      painter->drawLine(x1, y - i, x2, y - i);
+  };
 
-    if (expandsOnDoubleClick())
-      setExpanded(mouseData_.pressData.ind, ! isExpanded(mouseData_.pressData.ind));
+  //---
 
-    QStyleOptionViewItem option;
+  struct RectSpan {
+    QRect rect;
+    bool  inSpan { false };
 
-    if (style()->styleHint(QStyle::SH_ItemView_ActivateItemOnSingleClick, &option, this))
-      emit activated(mouseData_.pressData.ind);
-  }
-  else if (mouseData_.pressData.iind.isValid()) {
-    if (expandsOnDoubleClick())
-      setExpanded(mouseData_.pressData.iind, ! isExpanded(mouseData_.pressData.iind));
-  }
-}
+    RectSpan(const QRect &rect, bool inSpan) :
+     rect(rect), inSpan(inSpan) {
+    }
+  };
 
-void
-CQModelView::
-handleMouseDoubleClick()
-{
-  if      (mouseData_.pressData.hsection >= 0) {
-    if (headerEditor_) {
-      headerEditor_->deleteLater();
+  using RowRects = std::vector<RectSpan>;
 
-      headerEditor_ = nullptr;
-    }
+  RowRects rowRects;
 
-    headerEditor_ = new CQModelViewHeaderEdit(this, mouseData_.pressData.hsection);
+  int y = option.rect.top() + globalRowData_.margin;
 
-    headerEditor_->setGeometry(mouseData_.pressData.rect);
+  //---
 
-    auto text = model_->headerData(mouseData_.pressData.hsection, Qt::Horizontal, Qt::DisplayRole);
+  QStringList strs;
 
-    headerEditor_->setText(text.toString());
-    headerEditor_->setFocus();
+  if (isMultiHeaderLines())
+    strs = str.split(QRegExp("\n|\r\n|\r"));
+  else
+    strs.push_back(str);
 
-    headerEditor_->show();
-  }
-  else if (mouseData_.pressData.hsectionh >= 0) {
-    resizeColumnToContents(mouseData_.pressData.hsectionh);
+  int ns = strs.length();
 
-    redraw();
-  }
-  else if (mouseData_.pressData.vsection >= 0) {
+  //---
+
+  if (ns > 1) {
+    int fh = paintData_.fm.height();
+
+    for (int r = 0; r < ns; ++r) {
+      bool inSpan = false;
+
+      auto ps = rowColumnSpans_.find(r);
+
+      if (ps != rowColumnSpans_.end()) {
+        const auto &columnSpans = (*ps).second;
+
+        for (const auto &span : columnSpans) {
+          if (c >= span.first && c <= span.second) {
+            inSpan = true;
+            break;
+          }
+        }
+      }
+
+      //---
+
+      QRect rect;
+
+      if      (r == 0)
+        rect = QRect(option.rect.left(), y - globalRowData_.margin, option.rect.width(), fh);
+      else if (r == ns - 1)
+        rect = QRect(option.rect.left(), y, option.rect.width(), fh + globalRowData_.margin);
+      else
+        rect = QRect(option.rect.left(), y, option.rect.width(), fh);
+
+      rowRects.push_back(RectSpan(rect, inSpan));
+
+      y += fh + 1;
+    }
   }
-  else if (mouseData_.pressData.ind.isValid()) {
+  else {
+    rowRects.push_back(RectSpan(option.rect, false));
   }
-}
 
-void
-CQModelView::
-keyPressEvent(QKeyEvent *e)
-{
-  auto current = currentIndex();
+  //---
 
-  // search
-  if      (e->key() == Qt::Key_Slash) {
-    setShowFilter(! isShowFilter());
+  for (const auto &rowRect : rowRects) {
+    if (! rowRect.inSpan)
+      fillBackground(rowRect.rect.adjusted(-paintData_.margin, 0, paintData_.margin, 0));
   }
-  else if (e->key() == Qt::Key_Asterisk) {
-    if (isHierarchical()) {
-      std::vector<QModelIndex> parents;
 
-      parents.push_back(current);
+  //---
 
-      while (! parents.empty()) {
-        auto parent = parents.back();
+  initPen();
 
-        parents.pop_back();
+  for (int r = 0; r < ns; ++r) {
+    const RectSpan &rectSpan = rowRects[uint(r)];
 
-        int nr = model()->rowCount(parent);
+    //---
 
-        for (int r = 0; r < nr; ++r) {
-          auto child = model()->index(r, 0, parent);
+    auto subopt = option;
 
-          if (! child.isValid())
-            break;
+    subopt.text = strs[r];
 
-          parents.push_back(child);
+    if (! rectSpan.inSpan) {
+      subopt.rect = style()->subElementRect(QStyle::SE_HeaderLabel, &subopt, hh_);
 
-          expand(child);
-        }
-      }
+      QRect rect(subopt.rect.left(), rectSpan.rect.top(),
+                 subopt.rect.width(), rectSpan.rect.height());
 
-      expand(current);
+      painter->drawText(rect, Qt::AlignHCenter | Qt::AlignVCenter, strs[r]);
     }
   }
-  else if (e->key() == Qt::Key_Plus) {
-    if (isHierarchical()) {
-      expand(current);
+
+  //---
+
+  if (option.sortIndicator != QStyleOptionHeader::None) {
+    auto subopt = option;
+
+    subopt.rect = style()->subElementRect(QStyle::SE_HeaderArrow, &option, hh_);
+
+    style()->drawPrimitive(QStyle::PE_IndicatorHeaderArrow, &subopt, painter, hh_);
+
+    // draw sort priority left of arrow
+    if (sortPriority > 0) {
+      auto pstr = QString::number(sortPriority);
+
+      int pw = paintData_.fm.horizontalAdvance(pstr);
+
+      QRect prect(subopt.rect.left() - pw - 2, subopt.rect.top(), pw, subopt.rect.height());
+
+      setRolePen(painter, ColorRole::HeaderFg);
+
+      painter->drawText(prect, Qt::AlignRight | Qt::AlignVCenter, pstr);
     }
   }
-  else if (e->key() == Qt::Key_Minus) {
-    if (isHierarchical()) {
-      collapse(current);
+
+  //---
+
+  // draw background sort progress along bottom of sort column sections
+  if (sortRun_ && sortPercent_ >= 0) {
+    for (const auto &sortKey : sortRun_->sortKeys) {
+      if (sortKey.column != c) continue;
+
+      int pw = (option.rect.width()*sortPercent_)/100;
+
+      QRect prect(option.rect.left(), option.rect.bottom() - 2, pw, 3);
+
+      painter->fillRect(prect, roleColor(ColorRole::HighlightBg));
+
+      break;
     }
   }
 
-  QAbstractItemView::keyPressEvent(e);
-}
+  //---
 
-void
-CQModelView::
-leaveEvent(QEvent *)
-{
-  mouseData_.reset();
+  auto fullRect = visColumnData.rect.adjusted(-paintData_.margin, 0, paintData_.margin, 0);
 
-  redraw();
-}
+  setRolePen(painter, ColorRole::HeaderLineFg);
 
-void
-CQModelView::
-contextMenuEvent(QContextMenuEvent *e)
-{
-  mouseData_.menuData.pos = e->pos();
+  painter->drawLine(fullRect.topLeft   (), fullRect.topRight   ());
+  painter->drawLine(fullRect.bottomLeft(), fullRect.bottomRight());
 
-  cellPositionToIndex(mouseData_.menuData);
+  for (const auto &rowRect : rowRects) {
+    if (! rowRect.inSpan) {
+      int x  = rowRect.rect.right() + paintData_.margin;
+      int y1 = rowRect.rect.top();
+      int y2 = rowRect.rect.bottom();
 
-  showMenu(e->globalPos());
-}
+      painter->drawLine(x, y1, x, y2);
+    }
+  }
 
-void
-CQModelView::
-showMenu(const QPoint &pos)
-{
-  updateVisColumns();
+  //---
+
+  if (showHHeaderLines()) {
+    setRolePen(painter, ColorRole::GridFg);
+
+    painter->drawLine(option.rect.topRight(), option.rect.bottomRight());
+  }
 
   //---
 
-  auto *menu = new QMenu;
+  if (option.state & QStyle::State_HasFocus)
+    drawFocus();
 
   //---
 
-  addMenuActions(menu);
+  if (c == mouseData_.pressData.hsectionh || c == mouseData_.moveData.hsectionh) {
+    setRolePen(painter, ColorRole::MouseOverFg);
+
+    for (const auto &rowRect : rowRects) {
+      if (! rowRect.inSpan) {
+        int x  = rowRect.rect.right() + paintData_.margin;
+        int y1 = rowRect.rect.top();
+        int y2 = rowRect.rect.bottom();
+
+        for (int i = 0; i < 3; ++i)
+          painter->drawLine(x - i, y1, x - i, y2);
+      }
+    }
+  }
 
   //---
 
-  (void) menu->exec(pos);
+  auto drawSelection = [&](const QRect &rect) {
+    setRolePen  (painter, ColorRole::SelectionFg, 0.3);
+    setRoleBrush(painter, ColorRole::SelectionBg, 0.3);
 
-  delete menu;
+    painter->fillRect(rect, painter->brush());
+  };
+
+  if (option.state & QStyle::State_Selected) {
+    for (const auto &rowRect : rowRects) {
+      if (! rowRect.inSpan)
+        drawSelection(rowRect.rect.adjusted(-paintData_.margin, 0, paintData_.margin, 0));
+    }
+  }
 }
 
 void
 CQModelView::
-addMenuActions(QMenu *menu)
+drawVHeader(QPainter *painter) const
 {
-  int is = QFontMetrics(font()).height() + 6;
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::drawVHeader");
+#endif
+
+  const_cast<CQModelView *>(this)->updateScrollBars      ();
+  const_cast<CQModelView *>(this)->updateVisColumns      ();
+  const_cast<CQModelView *>(this)->updateVisRows         ();
+  const_cast<CQModelView *>(this)->updateWidgetGeometries();
 
   //---
 
-  int column = mouseData_.menuData.column();
+  paintData_.reset();
 
-  //---
+  paintData_.vrect     = vh_->viewport()->rect();
+  paintData_.vw        = paintData_.vrect.width ();
+  paintData_.vh        = paintData_.vrect.height();
+  paintData_.margin    = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
+  paintData_.rowHeight = this->rowHeight(0);
 
-  auto addMenu = [&](const QString &name) {
-    auto *subMenu = new QMenu(name);
+  if (showVHeaderLines())
+    initDrawGrid();
 
-    menu->addMenu(subMenu);
+  //---
 
-    return subMenu;
-  };
+  painter->fillRect(paintData_.vrect, roleColor(ColorRole::HeaderBg));
 
-  auto addAction = [&](QMenu *menu, const QString &name, const char *slotName=nullptr) {
-    auto *action = menu->addAction(name);
+  //---
 
-    if (slotName)
-      connect(action, SIGNAL(triggered()), this, slotName);
+  int currentRow = (vsm_->currentIndex().isValid() ?
+                      indexFlatRow(vsm_->currentIndex()) : -1);
+
+  auto *sm = viewSelectionModel();
+
+  // draw header area for each visible flat row
+  for (const auto &flatRow : visFlatRows_) {
+    auto rowData = rowDatas_.rowData(flatRow);
+
+    //---
+
+    const auto *pvisRowData = visFlatRowData(flatRow);
+    if (! pvisRowData) continue;
+
+    const auto &visRowData = *pvisRowData;
+
+    //---
+
+    // init style data
+    QStyleOptionHeader option;
+
+    if (visRowData.flatRow == mouseData_.moveData.vsection)
+      option.state |= QStyle::State_MouseOver;
+
+    if (sm && sm->isAnyRowCellSelected(rowData.row, rowData.parent))
+      option.state |= QStyle::State_Selected;
+
+    if (flatRow == currentRow)
+      option.state |= QStyle::State_HasFocus;
+
+    option.rect             = visRowData.rect;
+    option.icon             = QIcon();
+    option.iconAlignment    = Qt::AlignCenter;
+    option.position         = QStyleOptionHeader::Middle; // TODO
+    option.section          = visRowData.flatRow;
+    option.selectedPosition = QStyleOptionHeader::NotAdjacent; // TODO
+    option.text             = "";
+    option.textAlignment    = Qt::AlignLeft | Qt::AlignVCenter;
+
+    //---
+
+    auto fillBackground = [&]() {
+      if (option.state & QStyle::State_MouseOver) {
+        setRolePen  (painter, ColorRole::MouseOverFg);
+        setRoleBrush(painter, ColorRole::MouseOverBg);
+      }
+      else {
+        setRolePen  (painter, ColorRole::HeaderFg);
+        setRoleBrush(painter, ColorRole::HeaderBg);
+      }
+
+      painter->fillRect(option.rect, painter->brush());
+
+      setRoleBrush(painter, ColorRole::Base);
+    };
+
+    auto drawFocus = [&]() {
+      setRolePen  (painter, ColorRole::HighlightBg);
+      setRoleBrush(painter, ColorRole::None);
+
+      int x  = option.rect.right ();
+      int y1 = option.rect.top   ();
+      int y2 = option.rect.bottom();
+
+      for (int i = 0; i < 3; ++i)
+        painter->drawLine(x - i, y1, x - i, y2);
+    };
+
+    //---
+
+    fillBackground();
+
+    //---
+
+    setRolePen(painter, ColorRole::HeaderLineFg);
+
+    painter->drawLine(option.rect.topRight(), option.rect.bottomRight());
+
+    //---
+
+    if (option.state & QStyle::State_HasFocus)
+      drawFocus();
+
+    //---
+
+    auto drawSelection = [&]() {
+      setRolePen  (painter, ColorRole::SelectionFg, 0.3);
+      setRoleBrush(painter, ColorRole::SelectionBg, 0.3);
+
+      painter->fillRect(option.rect, painter->brush());
+    };
+
+    if (option.state & QStyle::State_Selected)
+      drawSelection();
+
+    //---
+
+    if (showVHeaderLines()) {
+      setRolePen(painter, ColorRole::GridFg);
+
+      int x1 = option.rect.left  ();
+      int x2 = option.rect.right ();
+      int y2 = option.rect.bottom();
+
+      painter->drawLine(x1, y2 - 1, x2, y2 - 1);
+    }
+
+    //---
+
+    if (! isHierarchical() && globalRowData_.vheaderWidth > 0) {
+      int m = globalRowData_.margin;
+
+      int dy = (option.rect.height() - paintData_.fm.height() + 1)/2;
+
+      dy += paintData_.fm.ascent();
+
+      if      (verticalType() == VerticalType::TEXT) {
+        auto data = model_->headerData(rowData.row, Qt::Vertical, Qt::DisplayRole);
+
+        if (data.isValid()) {
+          auto text = data.toString();
+
+          if (text.length()) {
+            setRolePen(painter, ColorRole::HeaderFg);
+
+            painter->drawText(option.rect.topLeft() + QPoint(m, dy), text);
+          }
+        }
+      }
+      else if (verticalType() == VerticalType::NUMBER) {
+        setRolePen(painter, ColorRole::HeaderFg);
+
+        auto text = QString::number(rowData.row + 1);
+
+        int dx = globalRowData_.vheaderWidth - 2*m - paintData_.fm.horizontalAdvance(text);
+
+        painter->drawText(option.rect.topLeft() + QPoint(m + dx, dy), text);
+      }
+    }
+  }
+}
+
+void
+CQModelView::
+drawRow(QPainter *painter, int r, const QModelIndex &parent, const VisRowData &visRowData) const
+{
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::drawRow");
+#endif
+
+  //---
+
+  painter->save();
+
+  for (const auto &pv : visColumnDatas_) {
+    int         c             = pv.first;
+    const auto &visColumnData = pv.second;
+
+    if (! visColumnData.visible)
+      continue;
+
+    bool valid = (c != freezeColumn_);
+
+    // skip columns outside paint rect (exposed strip when scrolled)
+    if (visColumnData.rect.right() + paintData_.margin < paintRect_.left () ||
+        visColumnData.rect.left () - paintData_.margin > paintRect_.right())
+      valid = false;
+
+    if (valid) {
+      if (freezeColumn_ >= 0) {
+        int x = visColumnData.rect.left() - paintData_.margin;
+
+        int cw = visColumnData.rect.width() + 2*paintData_.margin;
+
+        int x1 = std::max(x, freezeWidth_);
+        int x2 = (! visColumnData.last ? std::max(x + cw, freezeWidth_) : paintData_.vw - 1);
+
+        if (x1 < x2) {
+          int y = visRowData.rect.top();
+
+          painter->setClipRect(QRect(x1, y, x2 - x1 + 1, paintData_.rowHeight));
+
+          drawCell(painter, r, c, parent, visRowData, visColumnData);
+        }
+      }
+      else {
+        drawCell(painter, r, c, parent, visRowData, visColumnData);
+      }
+    }
+  }
+
+  //---
+
+  if (freezeWidth_ > 0) {
+    auto pv = visColumnDatas_.find(freezeColumn_);
+    assert(pv != visColumnDatas_.end());
+
+    const auto &visColumnData = (*pv).second;
+
+    int y = visRowData.rect.top();
+
+    painter->setClipRect(QRect(0, y, freezeWidth_, paintData_.rowHeight));
+
+    drawCell(painter, r, freezeColumn_, parent, visRowData, visColumnData);
+  }
+
+  painter->restore();
+}
+
+void
+CQModelView::
+drawCell(QPainter *painter, int r, int c, const QModelIndex &parent,
+         const VisRowData &visRowData, const VisColumnData &) const
+{
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::drawCell");
+#endif
+
+  auto ind = model_->index(r, c, parent);
+
+  //--
+
+  int slot = visCellSlot(visRowData.flatRow, c);
+  if (slot < 0) return;
+
+  if (isHierarchical() && c == 0) {
+    const auto &ivisCellData = ivisCellDatas_[uint(slot/visCellNc_)];
+
+    //---
+
+    bool children     = visRowData.children;
+    bool expanded     = visRowData.expanded;
+    bool moreSiblings = false;
+
+    QStyleOptionViewItem opt;
+
+    opt.rect = ivisCellData.rect;
+
+    opt.state = (moreSiblings ? QStyle::State_Sibling  : QStyle::State_None) |
+                (children     ? QStyle::State_Children : QStyle::State_None) |
+                (expanded     ? QStyle::State_Open     : QStyle::State_None);
+
+    if (ind == mouseData_.moveData.iind)
+      opt.state |= QStyle::State_MouseOver;
+
+    if (alternatingRowColors() && visRowData.alternate)
+      opt.features |= QStyleOptionViewItem::Alternate;
+    else
+      opt.features &= ~QStyleOptionViewItem::Alternate;
+
+    //---
+
+    auto fillIndicatorBackground = [&]() {
+      if (opt.state & QStyle::State_MouseOver) {
+        setRolePen  (painter, ColorRole::MouseOverFg);
+        setRoleBrush(painter, ColorRole::MouseOverBg);
+      }
+      else {
+        setRolePen(painter, ColorRole::Text);
+
+        if (opt.features & QStyleOptionViewItem::Alternate)
+          setRoleBrush(painter, ColorRole::AlternateBg);
+        else
+          setRoleBrush(painter, ColorRole::Base);
+      }
+
+      painter->fillRect(opt.rect, painter->brush());
+
+      if (opt.features & QStyleOptionViewItem::Alternate)
+        setRoleBrush(painter, ColorRole::AlternateBg);
+      else
+        setRoleBrush(painter, ColorRole::Base);
+    };
+
+    //---
+
+    fillIndicatorBackground();
+
+    style()->drawPrimitive(QStyle::PE_IndicatorBranch, &opt, painter, this);
+  }
+
+  //--
+
+  const auto &visCellData = visCellDatas_[uint(slot)];
+
+  //---
+
+  bool isNumeric = isNumericColumn(c);
+
+  //--
+
+  // init style data
+  QStyleOptionViewItem option;
+
+  option.init(this);
+
+  option.state &= ~QStyle::State_MouseOver;
+
+  if      (selectionBehavior() == SelectRows) {
+    if (ind.row() == mouseData_.moveData.ind.row())
+      option.state |= QStyle::State_MouseOver;
+  }
+  else if (selectionBehavior() == SelectColumns) {
+    if (ind.column() == mouseData_.moveData.ind.column())
+      option.state |= QStyle::State_MouseOver;
+  }
+  else {
+    if (ind == mouseData_.moveData.ind)
+      option.state |= QStyle::State_MouseOver;
+  }
+
+  if (ind == currentIndex() && currentIndex().isValid())
+    option.state |= QStyle::State_HasFocus;
+  else
+    option.state &= ~QStyle::State_HasFocus;
+
+  if (alternatingRowColors() && visRowData.alternate)
+    option.features |= QStyleOptionViewItem::Alternate;
+  else
+    option.features &= ~QStyleOptionViewItem::Alternate;
+
+  option.widget                 = this;
+  option.rect                   = visCellData.rect;
+  option.font                   = font();
+  option.fontMetrics            = QFontMetrics(option.font);
+  option.decorationSize         = paintData_.decorationSize;
+  option.decorationPosition     = QStyleOptionViewItem::Left;
+  option.decorationAlignment    = Qt::AlignCenter;
+  option.displayAlignment       = (isNumeric ? Qt::AlignRight : Qt::AlignLeft) | Qt::AlignVCenter;
+  option.textElideMode          = textElideMode();
+  option.showDecorationSelected = paintData_.showDecorationSelected;
+
+  //---
+
+#if 0
+  auto fillBackground = [&]() {
+    auto bgVar = model_->data(ind, Qt::BackgroundRole);
+
+    if (bgVar.canConvert<QBrush>())
+      painter->setBrush(qvariant_cast<QBrush>(bgVar).color());
+
+    //---
+
+    if (option.state & QStyle::State_MouseOver) {
+      setRolePen  (painter, ColorRole::MouseOverFg);
+      setRoleBrush(painter, ColorRole::MouseOverBg);
+    }
+    else {
+      setRolePen(painter, ColorRole::Text);
+
+      if (option.features & QStyleOptionViewItem::Alternate)
+        setRoleBrush(painter, ColorRole::AlternateBg);
+      else
+        setRoleBrush(painter, ColorRole::Base);
+    }
+
+    painter->fillRect(option.rect, painter->brush());
+
+    if (option.features & QStyleOptionViewItem::Alternate)
+      setRoleBrush(painter, ColorRole::AlternateBg);
+    else
+      setRoleBrush(painter, ColorRole::Base);
+  };
+#endif
+
+  //---
+
+  // set font
+  auto fontVar = ind.data(Qt::FontRole);
+
+  if (fontVar.isValid()){
+    option.font        = qvariant_cast<QFont>(fontVar).resolve(option.font);
+    option.fontMetrics = QFontMetrics(option.font);
+  }
+
+  // set text alignment
+  auto alignVar = ind.data(Qt::TextAlignmentRole);
+
+  if (alignVar.isValid())
+    option.displayAlignment = Qt::Alignment(alignVar.toInt());
+
+  // set foreground brush
+  auto fgVar = ind.data(Qt::ForegroundRole);
+
+  if (fgVar.canConvert<QBrush>())
+    option.palette.setBrush(QPalette::Text, qvariant_cast<QBrush>(fgVar));
+
+  // disable style animations for checkboxes etc. within itemview
+  option.styleObject = nullptr;
+
+  //---
+
+  auto *delegate = itemDelegate();
+
+  if (! delegate) {
+    drawCellBackground(painter, option, ind);
+
+    // draw cell value
+    setRolePen(painter, ColorRole::HeaderFg);
+
+    auto data = model_->data(ind, Qt::DisplayRole);
+
+    auto str = data.toString();
+
+    auto textRect = option.rect.adjusted(4, 0, -4, 0);
+
+    painter->save();
+
+    painter->setPen(option.palette.brush(QPalette::Text).color());
+
+    painter->setClipRect(textRect);
+
+#if 1
+    QTextOption textOption;
+
+    textOption.setAlignment(option.displayAlignment);
+
+    QTextLayout textLayout(str, option.font);
+
+    textLayout.setTextOption(textOption);
+
+    (void) viewItemTextLayout(textLayout, textRect.width());
+
+    int nl = textLayout.lineCount();
+
+    int dy = (option.rect.height() - paintData_.fm.height() + 1)/2;
+
+    dy += paintData_.fm.ascent();
+
+    for (int i = 0; i < nl; ++i) {
+      auto line = textLayout.lineAt(i);
+
+      int start  = line.textStart();
+      int length = line.textLength();
+
+      auto text = textLayout.text().mid(start, length);
+
+      painter->drawText(textRect.topLeft() + QPoint(0, dy), text);
+
+      //line.draw(painter, textRect.topLeft());
+
+      break;
+    }
+#else
+    painter->drawText(textRect, option.displayAlignment, str);
+#endif
+
+    painter->restore();
+  }
+  else {
+    //style()->drawPrimitive(QStyle::PE_PanelItemViewRow, &option, painter, this);
+
+    //drawCellBackground(painter, option, ind);
+
+    auto *delegate  = itemDelegate();
+    auto *idelegate = qobject_cast<CQItemDelegate *>(delegate);
+
+    if (idelegate) {
+      const ColumnData &columnData = columnDatas_[uint(c)];
+
+      idelegate->setHeatmap(columnData.heatmap);
+    }
+
+    if (option.state & QStyle::State_MouseOver) {
+      if (selectionBehavior() != SelectRows && selectionBehavior() != SelectColumns)
+        option.state |= QStyle::State_HasEditFocus;
+    }
+
+    delegate->paint(painter, option, ind);
+  }
+}
+
+void
+CQModelView::
+drawCellBackground(QPainter *painter, const QStyleOptionViewItem &option,
+                   const QModelIndex &ind) const
+{
+  auto bgVar = model_->data(ind, Qt::BackgroundRole);
+
+ if (bgVar.canConvert<QBrush>())
+   painter->setBrush(qvariant_cast<QBrush>(bgVar).color());
+
+ //---
+
+ if (option.state & QStyle::State_MouseOver) {
+   setRolePen  (painter, ColorRole::MouseOverFg);
+   setRoleBrush(painter, ColorRole::MouseOverBg);
+ }
+ else {
+   setRolePen(painter, ColorRole::Text);
+
+   if (option.features & QStyleOptionViewItem::Alternate)
+     setRoleBrush(painter, ColorRole::AlternateBg);
+   else
+     setRoleBrush(painter, ColorRole::Base);
+ }
+
+ painter->fillRect(option.rect, painter->brush());
+
+ if (option.features & QStyleOptionViewItem::Alternate)
+   setRoleBrush(painter, ColorRole::AlternateBg);
+ else
+   setRoleBrush(painter, ColorRole::Base);
+}
+
+//------
+
+// x offset of each column from left of first column (prefix sum of shown column
+// widths, size nc_ + 1), only updated when column widths or visibility change
+void
+CQModelView::
+updateColumnOffsets()
+{
+  if (! state_.updateColumnOffs && int(columnOffsets_.size()) == nc_ + 1)
+    return;
+
+  state_.updateColumnOffs = false;
+
+  //---
+
+  nvc_ = 0;
+
+  firstColumn_ = -1;
+  lastColumn_  = -1;
+
+  columnOffsets_.resize(uint(nc_ + 1));
+
+  int x = 0;
+
+  for (int c = 0; c < nc_; ++c) {
+    columnOffsets_[uint(c)] = x;
+
+    if (isColumnHidden(c))
+      continue;
+
+    const ColumnData &columnData = columnDatas_[uint(c)];
+
+    int cw = (columnData.width > 0 ? columnData.width : 100);
+
+    x += cw;
+
+    if (firstColumn_ < 0)
+      firstColumn_ = c;
+
+    lastColumn_ = c;
+
+    ++nvc_;
+  }
+
+  columnOffsets_[uint(nc_)] = x;
+}
+
+// x range of column cell rect for any (shown) column including those outside the
+// visible column window
+bool
+CQModelView::
+columnXRange(int column, int &xl, int &xr) const
+{
+  auto pc = visColumnDatas_.find(column);
+
+  if (pc != visColumnDatas_.end()) {
+    xl = (*pc).second.rect.left ();
+    xr = (*pc).second.rect.right();
+    return true;
+  }
+
+  if (column < 0 || column >= nc_ || int(columnOffsets_.size()) != nc_ + 1 ||
+      isColumnHidden(column))
+    return false;
+
+  int margin = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
+
+  xl = columnOffsets_[uint(column    )] - horizontalOffset() + margin;
+  xr = columnOffsets_[uint(column + 1)] - horizontalOffset() - margin;
+
+  return true;
+}
+
+void
+CQModelView::
+updateVisColumns()
+{
+  if (! state_.updateVisColumns)
+    return;
+
+  state_.updateVisColumns = false;
+
+  //---
+
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::updateVisColumns");
+#endif
+
+  updateColumnOffsets();
+
+  //---
+
+  visColumnDatas_.clear();
+
+  int hoffset = horizontalOffset();
+
+  int margin = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
+
+  freezeColumn_ = (isFreezeFirstColumn() ? firstColumn_ : -1);
+  freezeWidth_  = 0;
+
+  auto addColumn = [&](int c) {
+    const ColumnData &columnData = columnDatas_[uint(c)];
+
+    int cw = (columnData.width > 0 ? columnData.width : 100);
+    int x1 = columnOffsets_[uint(c)] - hoffset;
+    int x2 = x1 + cw;
+
+    VisColumnData &visColumnData = visColumnDatas_[c];
+
+    //---
+
+    int xl, xr;
+
+    if (c == freezeColumn_) {
+      freezeWidth_ = cw;
+
+      xl = margin;
+      xr = cw - margin;
+    }
+    else {
+      xl = x1 + margin;
+      xr = x2 - margin;
+    }
+
+    visColumnData.rect  = QRect(xl, 0, xr - xl + 1, globalRowData_.headerHeight);
+    visColumnData.hrect = QRect(xr, 0, 2*margin   , globalRowData_.headerHeight);
+
+    visColumnData.first = (c == firstColumn_);
+    visColumnData.last  = (c == lastColumn_ && lastColumn_ > 0);
+
+    visColumnData.visible = ! (x1 > visualRect_.right() || x2 < visualRect_.left());
+  };
+
+  // only columns overlapping viewport (and frozen column) are added. Visible column
+  // range is found by binary search of column offsets (hidden columns have zero width)
+  if (nc_ > 0) {
+    auto pc1 = std::lower_bound(columnOffsets_.begin() + 1, columnOffsets_.end(),
+                                visualRect_.left() + hoffset);
+    auto pc2 = std::upper_bound(columnOffsets_.begin(), columnOffsets_.end() - 1,
+                                visualRect_.right() + hoffset);
+
+    int c1 = int(pc1 - columnOffsets_.begin()) - 1;
+    int c2 = int(pc2 - columnOffsets_.begin()) - 1;
+
+    if (freezeColumn_ >= 0 && (freezeColumn_ < c1 || freezeColumn_ > c2))
+      addColumn(freezeColumn_);
+
+    for (int c = std::max(c1, 0); c <= c2; ++c) {
+      if (! isColumnHidden(c))
+        addColumn(c);
+    }
+  }
+
+  int vw = viewport()->rect().width();
+
+  auto pl = visColumnDatas_.find(lastColumn_);
+
+  if (pl != visColumnDatas_.end() && (*pl).second.last) {
+    VisColumnData &visColumnData = (*pl).second;
+
+    if (isStretchLastColumn()) {
+      int xr = visColumnData.rect.right();
+
+      if (xr + margin < vw) {
+        int xl = visColumnData.rect.left();
+
+        xr = vw - margin - 1;
+
+        visColumnData.rect  = QRect(xl, 0, xr - xl + 1, globalRowData_.headerHeight);
+        visColumnData.hrect = QRect(xr, 0, 2*margin, globalRowData_.headerHeight);
+      }
+    }
+  }
+
+  //---
+
+  // right x of cell and header areas of scrolled columns for binary search hit test
+  // (frozen column overlaps scrolled columns so is checked separately)
+  visColumnOrder_ .clear();
+  visColumnCellX2_.clear();
+  visColumnHeadX2_.clear();
+
+  for (const auto &pc : visColumnDatas_) {
+    if (pc.first == freezeColumn_)
+      continue;
+
+    const auto &visColumnData = pc.second;
+
+    visColumnOrder_ .push_back(pc.first);
+    visColumnCellX2_.push_back(visColumnData.rect .right() + margin);
+    visColumnHeadX2_.push_back(visColumnData.hrect.right());
+  }
+}
+
+//------
+
+void
+CQModelView::
+updateRowDatas()
+{
+  if (! state_.updateRowDatas)
+    return;
+
+  state_.updateRowDatas = false;
+
+  //---
+
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::updateRowDatas");
+#endif
+
+  // update hidden row parents for any moved parents
+  for (auto *hiddenRows : {hiddenRows_, userHiddenRows_, filterHiddenRows_})
+    hiddenRows->rehash();
+
+  // keep sorted order of root rows if still valid (only hidden or expanded rows changed)
+  if (rootNode_ && rootNode_->isSorted() && ! state_.updateSortOrder)
+    std::swap(prevRootOrder_, rootNode_->order);
+
+  state_.updateSortOrder = false;
+
+  // rebuild expanded nodes (flat rows are created for visible window in updateVisRows)
+  delete rootNode_;
+
+  rootNode_ = nullptr;
+
+  rowDatas_.clear();
+
+  nmr_ = 0;
+  nvr_ = 0;
+
+  if (! model_) {
+    hierarchical_ = false;
+    hierChecked_  = false;
+    return;
+  }
+
+  auto parent = rootIndex();
+
+  rootNode_ = createExpandNode(parent, nullptr, -1, 0, expandedRows());
+
+  prevRootOrder_.clear();
+
+  nmr_ = rootNode_->numModelRows();
+  nvr_ = rootNode_->numFlatRows();
+
+  // model is hierarchical if any node expanded or any top level row has children (all
+  // rows checked until first with children, rechecked after model structure changes),
+  // also set when window rows have children
+  if (! hierChecked_) {
+    hierarchical_ = false;
+
+    int nr = rootNode_->numRows();
+
+    for (int r = 0; ! hierarchical_ && r < nr; ++r)
+      hierarchical_ = model_->hasChildren(model_->index(r, 0, parent));
+
+    hierChecked_ = true;
+  }
+
+  if (! rootNode_->children.empty())
+    hierarchical_ = true;
+
+  // start background sort requested by root node build (not started while building
+  // as it may rebuild nodes)
+  if (sortStartPending_) {
+    sortStartPending_ = false;
+
+    startViewSort();
+  }
+}
+
+// get expanded rows per parent
+CQModelView::ExpandedRows
+CQModelView::
+calcExpandedRows() const
+{
+  ExpandedRows expandedRows;
+
+  for (const auto &ind : expanded_) {
+    if (! ind.isValid()) continue;
+
+    expandedRows[ind.parent()].push_back(ind.row());
+  }
+
+  return expandedRows;
+}
+
+// get cached expanded rows per parent (updated when expanded set changes)
+const CQModelView::ExpandedRows &
+CQModelView::
+expandedRows() const
+{
+  if (! expandedRowsValid_) {
+    expandedRows_ = calcExpandedRows();
+
+    expandedRowsValid_ = true;
+  }
+
+  return expandedRows_;
+}
+
+// expanded set changed (index added, removed or rehashed)
+void
+CQModelView::
+expandedChanged()
+{
+  expandedRowsValid_ = false;
+
+  expandedRows_.clear();
+}
+
+// expanded set is hashed on index row/column/parent which change when rows or columns
+// are inserted, removed or moved so rebuild set (removing invalid and duplicate indices)
+void
+CQModelView::
+rehashExpanded()
+{
+  if (expanded_.empty())
+    return;
+
+  ExpandedSet expanded;
+
+  expanded.reserve(expanded_.size());
+
+  for (const auto &ind : expanded_) {
+    if (ind.isValid())
+      expanded.insert(ind);
+  }
+
+  std::swap(expanded_, expanded);
+
+  expandedChanged();
+}
+
+// create node for rows of parent (row in parent node). The root node is built, expanded
+// child nodes are only counted (total flat and model rows) and built on first access
+CQModelView::ExpandNode *
+CQModelView::
+createExpandNode(const QModelIndex &parent, ExpandNode *parentNode, int row, int depth,
+                 const ExpandedRows &expandedRows)
+{
+  if (parentNode && model_->canFetchMore(parent))
+    model_->fetchMore(parent);
+
+  auto *node = new ExpandNode;
+
+  node->parent     = parent;
+  node->parentNode = parentNode;
+  node->row        = row;
+  node->depth      = depth;
+
+  if (parentNode) {
+    node->built    = false;
+    node->flatRows = countExpandRows(parent, expandedRows, node->modelRows);
+  }
+  else
+    fillExpandNode(node, expandedRows);
+
+  return node;
+}
+
+// set per row flat row counts of node, expanded child rows (with model rows) are added
+// as (unbuilt) child nodes
+void
+CQModelView::
+fillExpandNode(ExpandNode *node, const ExpandedRows &expandedRows)
+{
+  const auto &parent = node->parent;
+
+  int nr = model_->rowCount(parent);
+
+  std::vector<int> counts;
+
+  counts.resize(uint(nr));
+
+  const auto *hidden = hiddenRows_->rows(parent);
+
+  for (int r = 0; r < nr; ++r)
+    counts[uint(r)] = (hidden && r < hidden->size() && hidden->test(r) ? 0 : 1);
+
+  // add expanded child rows
+  auto pe = expandedRows.find(parent);
+
+  if (pe != expandedRows.end()) {
+    for (const auto &r : (*pe).second) {
+      if (r < 0 || r >= nr || ! counts[uint(r)]) continue;
+
+      auto ind = model_->index(r, 0, parent);
+
+      if (node->children.find(r) != node->children.end() || ! model_->hasChildren(ind))
+        continue;
+
+      auto *child = createExpandNode(ind, node, r, node->depth + 1, expandedRows);
+
+      node->children[r] = child;
+
+      counts[uint(r)] += child->numFlatRows();
+    }
+  }
+
+  // store counts in sorted row order
+  std::vector<int> order;
+
+  if (isViewSorted()) {
+    // large number of root rows are sorted in background, previous order (if still
+    // valid) or partial order is used until ready. Background sort is started after
+    // nodes are built (updateRowDatas) and model order is used until then
+    if (! node->parentNode) {
+      if (! sortRun_ && prevRootOrder_.empty() && nr >= minBackgroundSortRows() &&
+          ! validSortKeys().empty())
+        sortStartPending_ = true;
+
+      if      (sortRun_ && sortRun_->partialReady &&
+               sortRun_->parent == parent && sortRun_->nr == nr)
+        order = sortRun_->partialOrder;
+      else if (int(prevRootOrder_.size()) == nr)
+        order = prevRootOrder_;
+      else if (! sortRun_ && ! sortStartPending_)
+        sortRows(parent, nr, order, node->keys);
+    }
+    else
+      sortRows(parent, nr, order, node->keys);
+  }
+
+  if (! order.empty())
+    node->setOrder(order, counts);
+  else
+    node->counts.build(counts);
+}
+
+// build unbuilt node (on first access), any change in node's flat rows since it was
+// counted is added to ancestor counts
+void
+CQModelView::
+buildExpandNode(ExpandNode *node)
+{
+  if (node->built)
+    return;
+
+  int oldFlatRows = node->flatRows;
+
+  node->built     = true;
+  node->flatRows  = 0;
+  node->modelRows = 0;
+
+  fillExpandNode(node, expandedRows());
+
+  int n = node->numFlatRows() - oldFlatRows;
+
+  if (n != 0 && node->parentNode)
+    addExpandNodeFlatRows(node->parentNode, node->row, n);
+}
+
+// count flat rows (visible rows and descendant rows of expanded rows) and model rows of
+// parent without creating nodes (only expanded rows are visited, view state unchanged)
+int
+CQModelView::
+countExpandRows(const QModelIndex &parent, const ExpandedRows &expandedRows,
+                int &modelRows) const
+{
+  int nr = model_->rowCount(parent);
+
+  const auto *hidden = hiddenRows_->rows(parent);
+
+  int n = nr - (hidden ? hidden->rank(std::min(nr, hidden->size())) : 0);
+
+  modelRows += nr;
+
+  auto pe = expandedRows.find(parent);
+
+  if (pe != expandedRows.end()) {
+    for (const auto &r : (*pe).second) {
+      if (r < 0 || r >= nr || (hidden && r < hidden->size() && hidden->test(r)))
+        continue;
+
+      auto ind = model_->index(r, 0, parent);
+
+      if (! model_->hasChildren(ind))
+        continue;
+
+      if (model_->canFetchMore(ind))
+        model_->fetchMore(ind);
+
+      n += countExpandRows(ind, expandedRows, modelRows);
+    }
+  }
+
+  return n;
+}
+
+// add all (not hidden) rows of parent with children and their descendant rows with
+// children to expanded set (expandAll)
+void
+CQModelView::
+addExpandedRows(const QModelIndex &parent)
+{
+  int nr = model_->rowCount(parent);
+
+  const auto *hidden = hiddenRows_->rows(parent);
+
+  for (int r = 0; r < nr; ++r) {
+    if (hidden && r < hidden->size() && hidden->test(r))
+      continue;
+
+    auto ind = model_->index(r, 0, parent);
+
+    if (! model_->hasChildren(ind))
+      continue;
+
+    if (model_->canFetchMore(ind))
+      model_->fetchMore(ind);
+
+    expanded_.insert(ind);
+
+    addExpandedRows(ind);
+  }
+}
+
+// start view sort of rows. Large numbers of root rows are sorted in a worker thread,
+// the rows up to the end of the visible rows are selected and sorted first and shown
+// while the full sort runs. The current order is shown until the partial order is ready
+// (other rows are sorted when their nodes are created). Returns true if small number of rows
+// sorted (and rebuilt) immediately
+bool
+CQModelView::
+startViewSort()
+{
+  cancelSort();
+
+  auto sortKeys = validSortKeys();
+
+  auto parent = rootIndex();
+
+  int nr = (model_ && ! sortKeys.empty() ? model_->rowCount(parent) : 0);
+
+  if (nr < minBackgroundSortRows()) {
+    state_.updateSortOrder = true;
+
+    rebuildRowDatas();
+
+    return true;
+  }
+
+  //---
+
+  if (! threadPool_)
+    threadPool_ = new QThreadPool;
+
+  if (! sortPool_) {
+    sortPool_ = new QThreadPool;
+
+    sortPool_->setMaxThreadCount(1);
+  }
+
+  auto *run = new SortRun;
+
+  run->view     = this;
+  run->id       = ++sortRunId_;
+  run->parent   = parent;
+  run->nr       = nr;
+  run->sortKeys = sortKeys;
+
+  // sort values are read in gui thread time slices (worker only uses snapshot)
+  readSortValues(parent, 0, sortKeys, run->keys);
+
+  // sort rows up to end of visible rows (and border rows) first
+  int rh = std::max(rowHeight(0), 1);
+  int nv = (scrollData_.nv > 0 ? scrollData_.nv : viewport()->height()/rh + 1);
+
+  run->numPartial = scrollData_.vpos + nv + visualBorderRows_;
+
+  // work is string key conversion, partial sort and sort pass (chunk sort and merges)
+  std::vector<int> bounds;
+
+  calcChunkBounds(nr, bounds, minBackgroundSortChunks());
+
+  int nchunks = int(bounds.size()) - 1;
+  int nmerge  = 0;
+  int nstr    = 0;
+
+  for (int w = 1; w < nchunks; w *= 2)
+    ++nmerge;
+
+  for (const auto &keys : run->keys) {
+    if (! keys.numeric)
+      ++nstr;
+  }
+
+  run->progressTotal = long(nr)*(1 + nstr + 1 + (1 + nmerge));
+
+  sortRun_     = run;
+  sortPercent_ = 0;
+
+  emit sortProgress(0);
+
+  hh_->redraw();
+
+  sortReadSlot();
+
+  return false;
+}
+
+// read next rows of background sort values for a time slice (keeps gui responsive)
+// and start worker when all rows are read
+void
+CQModelView::
+sortReadSlot()
+{
+  auto *run = sortRun_;
+
+  if (! run || ! model_ || run->readRows >= run->nr)
+    return;
+
+  static int blockRows = 4096;
+
+  QElapsedTimer timer;
+
+  timer.start();
+
+  while (run->readRows < run->nr && timer.elapsed() < sortReadTime()) {
+    int n = std::min(blockRows, run->nr - run->readRows);
+
+    SortColumnKeysArray keys;
+
+    readSortValues(run->parent, n, run->sortKeys, keys, run->readRows);
+
+    for (size_t k = 0; k < keys.size(); ++k)
+      run->keys[k].appendValues(keys[k]);
+
+    run->readRows += n;
+
+    run->addProgress(n);
+  }
+
+  if (run->readRows < run->nr) {
+    sortReadTimer_->start();
+    return;
+  }
+
+  sortPool_->start(new SortTask(this, run));
+}
+
+// restart running background sort (rows or columns changed), returns true if rows
+// rebuilt (and redrawn)
+bool
+CQModelView::
+restartViewSort()
+{
+  if (! sortRun_ && ! sortRestart_)
+    return false;
+
+  sortRestart_ = false;
+
+  return startViewSort();
+}
+
+// cancel running background sort (waits for worker to notice)
+void
+CQModelView::
+cancelSort()
+{
+  if (! sortRun_)
+    return;
+
+  sortRun_->cancelled = true;
+
+  sortReadTimer_->stop();
+
+  if (sortPool_)
+    sortPool_->waitForDone();
+
+  delete sortRun_;
+
+  sortRun_ = nullptr;
+
+  sortPercent_ = -1;
+
+  hh_->redraw();
+}
+
+// model structure about to change so stop background sort of old rows (restarted
+// after change)
+void
+CQModelView::
+cancelSortSlot()
+{
+  if (! sortRun_)
+    return;
+
+  cancelSort();
+
+  sortRestart_ = true;
+}
+
+void
+CQModelView::
+sortProgressSlot(int id, int percent)
+{
+  if (! sortRun_ || sortRun_->id != id)
+    return;
+
+  sortPercent_ = percent;
+
+  emit sortProgress(percent);
+
+  hh_->redraw();
+}
+
+// partial sort ready, show sorted first rows
+void
+CQModelView::
+sortPartialSlot(int id)
+{
+  if (! sortRun_ || sortRun_->id != id)
+    return;
+
+  sortRun_->partialReady = true;
+
+  state_.updateSortOrder = true;
+
+  rebuildRowDatas();
+}
+
+// background sort finished, swap in full sort order for root rows
+void
+CQModelView::
+sortFinishedSlot(int id)
+{
+  if (! sortRun_ || sortRun_->id != id)
+    return;
+
+  // apply pending rebuild (uses partial order)
+  updateRowDatas();
+
+  auto *run = sortRun_;
+
+  sortRun_     = nullptr;
+  sortPercent_ = -1;
+
+  if (rootNode_ && rootNode_->parent == run->parent && rootNode_->numRows() == run->nr &&
+      isViewSorted()) {
+    rootNode_->setOrder(run->order, rootNode_->rowCounts());
+
+    std::swap(rootNode_->keys, run->keys);
+
+    rowDatasChanged();
+
+    // resort rows changed since keys were extracted
+    for (const auto &r : run->changedRows)
+      updateSortedRows(run->parent, r, r);
+  }
+
+  delete run;
+
+  emit sortProgress(100);
+
+  hh_->redraw();
+
+  redraw();
+}
+
+// get valid view sort keys (columns in model)
+CQModelView::SortKeys
+CQModelView::
+validSortKeys() const
+{
+  SortKeys sortKeys;
+
+  for (const auto &sortKey : viewSortKeys_) {
+    if (sortKey.column >= 0 && sortKey.column < nc_)
+      sortKeys.push_back(sortKey);
+  }
+
+  return sortKeys;
+}
+
+// get model rows of parent in view sort order (view sort columns and orders) and
+// typed sort keys of rows
+void
+CQModelView::
+sortRows(const QModelIndex &parent, int nr, std::vector<int> &order,
+         SortColumnKeysArray &keys)
+{
+  order.clear();
+
+  keys.clear();
+
+  auto sortKeys = validSortKeys();
+
+  if (sortKeys.empty() || nr <= 1)
+    return;
+
+  readSortValues(parent, nr, sortKeys, keys);
+
+  calcSortKeys(nr, keys);
+
+  sortKeyRows(sortKeys, keys, nr, order);
+}
+
+// get bounds of chunks of rows for parallel processing (number of chunks is a power
+// of two for pairwise merge)
+void
+CQModelView::
+calcChunkBounds(int nr, std::vector<int> &bounds, int minChunks) const
+{
+  static int minChunkRows = 16384;
+
+  int nt      = std::max(QThread::idealThreadCount(), minChunks);
+  int nchunks = 1;
+
+  while (nchunks < nt && nr/(2*nchunks) >= minChunkRows)
+    nchunks *= 2;
+
+  bounds.resize(uint(nchunks + 1));
+
+  for (int i = 0; i <= nchunks; ++i)
+    bounds[uint(i)] = int((long(nr)*i)/nchunks);
+}
+
+// read sort column values of rows [row1, row1 + nr) of parent (gui thread), numeric column
+// values are stored as keys and string column values are converted to keys by calcSortKeys
+void
+CQModelView::
+readSortValues(const QModelIndex &parent, int nr, const SortKeys &sortKeys,
+               SortColumnKeysArray &keys, int row1) const
+{
+  keys.clear();
+
+  keys.resize(sortKeys.size());
+
+  for (size_t k = 0; k < sortKeys.size(); ++k) {
+    auto &keys1 = keys[k];
+
+    int column = sortKeys[k].column;
+
+    keys1.column  = column;
+    keys1.numeric = isNumericColumn(column);
+
+    if (keys1.numeric)
+      keys1.reals.resize(uint(nr));
+    else
+      keys1.values.resize(uint(nr));
+
+    for (int r = 0; r < nr; ++r) {
+      auto var = model_->data(model_->index(row1 + r, column, parent), Qt::DisplayRole);
+
+      if (keys1.numeric) {
+        bool ok;
+
+        double value = var.toDouble(&ok);
+
+        keys1.reals[uint(r)] = (ok ? value : std::numeric_limits<double>::quiet_NaN());
+      }
+      else
+        keys1.values[uint(r)] = var.toString();
+    }
+  }
+}
+
+// convert read string values to collator sort keys for each sort column (no model
+// access so can be run in a worker thread)
+void
+CQModelView::
+calcSortKeys(int nr, SortColumnKeysArray &keys, SortRun *run)
+{
+  std::vector<int> bounds;
+
+  calcChunkBounds(nr, bounds, run ? minBackgroundSortChunks() : 1);
+
+  for (auto &keys1 : keys) {
+    if (keys1.numeric)
+      continue;
+
+    calcSortColumnKeys(bounds, keys1, run);
+
+    if (run && run->isCancelled())
+      return;
+  }
+}
+
+// sort rows using typed sort keys. Rows are sorted in chunks which are then merged
+// (chunks are processed in parallel for large row counts). Multiple sort columns are
+// compared lexicographically in a single sort (later column keys only compared for
+// equal earlier keys). Rows with equal keys keep model order. Only uses keys (no model
+// access) so can be run in a worker thread
+void
+CQModelView::
+sortKeyRows(const SortKeys &sortKeys, const SortColumnKeysArray &keys, int nr,
+            std::vector<int> &order, SortRun *run)
+{
+  std::vector<int> bounds;
+
+  calcChunkBounds(nr, bounds, run ? minBackgroundSortChunks() : 1);
+
+  int nchunks = int(bounds.size()) - 1;
+
+  auto isCancelled = [&]() { return (run && run->isCancelled()); };
+
+  auto addProgress = [&](int n) { if (run) run->addProgress(n); };
+
+  // sort chunks of rows then merge pairs of adjacent sorted ranges until one range
+  // (background sort checks for cancel before each chunk sort and merge)
+  auto sortChunks = [&](std::vector<int> &rows, const auto &cmp) {
+    rows.resize(uint(nr));
+
+    std::iota(rows.begin(), rows.end(), 0);
+
+    parallelFor(nchunks, [&](int i) {
+      if (isCancelled()) return;
+
+      std::stable_sort(rows.begin() + bounds[uint(i)], rows.begin() + bounds[uint(i + 1)], cmp);
+
+      addProgress(bounds[uint(i + 1)] - bounds[uint(i)]);
+    });
+
+    for (int w = 1; w < nchunks; w *= 2) {
+      parallelFor(nchunks/(2*w), [&](int j) {
+        if (isCancelled()) return;
+
+        int i1 = bounds[uint(2*j*w)];
+        int i2 = bounds[uint((2*j + 1)*w)];
+        int i3 = bounds[uint((2*j + 2)*w)];
+
+        std::inplace_merge(rows.begin() + i1, rows.begin() + i2, rows.begin() + i3, cmp);
+
+        addProgress(i3 - i1);
+      });
+    }
+  };
+
+  //---
+
+  // single column compares typed keys directly
+  if (sortKeys.size() == 1) {
+    const auto &keys1 = keys[0];
+
+    bool ascending = (sortKeys[0].order == Qt::AscendingOrder);
+
+    sortChunks(order, [&](int r1, int r2) { return keys1.less(r1, r2, ascending); });
+
+    return;
+  }
+
+  //---
+
+  // compare keys of each sort column in priority order (invalid values are last for
+  // both orders)
+  int nk = int(sortKeys.size());
+
+  std::vector<uchar> ascending;
+
+  ascending.resize(uint(nk));
+
+  for (int k = 0; k < nk; ++k)
+    ascending[uint(k)] = (sortKeys[uint(k)].order == Qt::AscendingOrder);
+
+  sortChunks(order, [&](int r1, int r2) {
+    for (int k = 0; k < nk; ++k) {
+      const auto &keys1 = keys[uint(k)];
+
+      if (keys1.less(r1, r2, ascending[uint(k)])) return true;
+      if (keys1.less(r2, r1, ascending[uint(k)])) return false;
+    }
+
+    return false;
+  });
+}
+
+// get first n rows in sort order using typed sort keys, the first n rows of each chunk are
+// selected in parallel (O(rows)) and the first n of these are selected and sorted, remaining
+// rows follow in model order
+void
+CQModelView::
+partialSortKeyRows(const SortKeys &sortKeys, const SortColumnKeysArray &keys, int nr, int n,
+                   std::vector<int> &order, SortRun *run)
+{
+  auto cmp = sortRowCompare(sortKeys, keys);
+
+  n = std::min(std::max(n, 0), nr);
+
+  std::vector<int> bounds;
+
+  calcChunkBounds(nr, bounds, run ? minBackgroundSortChunks() : 1);
+
+  int nchunks = int(bounds.size()) - 1;
+
+  std::vector<std::vector<int>> chunkRows;
+
+  chunkRows.resize(uint(nchunks));
+
+  parallelFor(nchunks, [&](int i) {
+    if (run && run->isCancelled()) return;
+
+    auto &rows = chunkRows[uint(i)];
+
+    rows.resize(uint(bounds[uint(i + 1)] - bounds[uint(i)]));
+
+    std::iota(rows.begin(), rows.end(), bounds[uint(i)]);
+
+    if (int(rows.size()) > n) {
+      std::nth_element(rows.begin(), rows.begin() + n, rows.end(), cmp);
+
+      rows.resize(uint(n));
+    }
+  });
+
+  order.clear();
+
+  order.reserve(uint(nr));
+
+  for (const auto &rows : chunkRows)
+    order.insert(order.end(), rows.begin(), rows.end());
+
+  if (int(order.size()) > n) {
+    std::nth_element(order.begin(), order.begin() + n, order.end(), cmp);
+
+    order.resize(uint(n));
+  }
+
+  std::sort(order.begin(), order.end(), cmp);
+
+  // remaining rows in model order
+  std::vector<uchar> partial;
+
+  partial.resize(uint(nr));
+
+  for (const auto &r : order)
+    partial[uint(r)] = 1;
+
+  for (int r = 0; r < nr; ++r) {
+    if (! partial[uint(r)])
+      order.push_back(r);
+  }
+}
+
+// convert string values of column to collator sort keys (in parallel chunks), values
+// are freed when done
+void
+CQModelView::
+calcSortColumnKeys(const std::vector<int> &bounds, SortColumnKeys &keys, SortRun *run)
+{
+  int nchunks = int(bounds.size()) - 1;
+  int nr      = bounds.back();
+
+  // check cancel and report progress every block of rows
+  static int blockRows = 4096;
+
+  auto checkBlock = [&](int r, int r1) {
+    if (! run || (r - r1 + 1) % blockRows != 0)
+      return true;
+
+    run->addProgress(blockRows);
+
+    return ! run->isCancelled();
+  };
+
+  QCollator collator;
+
+  collator.setNumericMode(true);
+
+  // collator is not thread safe so each chunk uses a copy
+  std::vector<std::vector<QCollatorSortKey>> chunkKeys;
+
+  chunkKeys.resize(uint(nchunks));
+
+  parallelFor(nchunks, [&](int i) {
+    auto collator1 = collator;
+
+    auto &keys1 = chunkKeys[uint(i)];
+
+    int r1 = bounds[uint(i)];
+
+    keys1.reserve(uint(bounds[uint(i + 1)] - r1));
+
+    for (int r = r1; r < bounds[uint(i + 1)]; ++r) {
+      keys1.push_back(collator1.sortKey(keys.values[uint(r)]));
+
+      if (! checkBlock(r, r1))
+        break;
+    }
+  });
+
+  keys.strs.reserve(uint(nr));
+
+  for (auto &keys1 : chunkKeys) {
+    keys.strs.insert(keys.strs.end(), keys1.begin(), keys1.end());
+
+    keys1.clear();
+  }
+
+  SortColumnKeys::Values().swap(keys.values);
+}
+
+// are cached sort keys of nr rows valid for sort keys (same columns and column types)
+bool
+CQModelView::
+isSortKeysValid(const SortColumnKeysArray &keys, const SortKeys &sortKeys, int nr) const
+{
+  if (keys.size() != sortKeys.size())
+    return false;
+
+  for (size_t k = 0; k < keys.size(); ++k) {
+    const auto &keys1 = keys[k];
+
+    if (keys1.column != sortKeys[k].column || keys1.numeric != isNumericColumn(keys1.column) ||
+        keys1.size() != nr)
+      return false;
+  }
+
+  return true;
+}
+
+// read sort keys of rows [row1, row1 + nr) of parent (values read and converted to keys)
+void
+CQModelView::
+readSortKeys(const QModelIndex &parent, int row1, int nr, const SortKeys &sortKeys,
+             SortColumnKeysArray &keys)
+{
+  readSortValues(parent, nr, sortKeys, keys, row1);
+
+  calcSortKeys(nr, keys);
+}
+
+// get cached sort keys of nr rows of node (all rows read if not cached or sort columns
+// changed)
+const CQModelView::SortColumnKeysArray &
+CQModelView::
+nodeSortKeys(ExpandNode *node, const SortKeys &sortKeys, int nr)
+{
+  if (! isSortKeysValid(node->keys, sortKeys, nr))
+    readSortKeys(node->parent, 0, nr, sortKeys, node->keys);
+
+  return node->keys;
+}
+
+// get compare function for view sort order of rows using typed sort keys (same order as
+// sortRows: sort keys in priority order then model row)
+std::function<bool(int, int)>
+CQModelView::
+sortRowCompare(const SortKeys &sortKeys, const SortColumnKeysArray &keys) const
+{
+  std::vector<uchar> ascending;
+
+  for (const auto &sortKey : sortKeys)
+    ascending.push_back(sortKey.order == Qt::AscendingOrder);
+
+  return [&keys, ascending](int r1, int r2) {
+    for (size_t k = 0; k < keys.size(); ++k) {
+      if (keys[k].less(r1, r2, ascending[k])) return true;
+      if (keys[k].less(r2, r1, ascending[k])) return false;
+    }
+
+    return r1 < r2;
+  };
+}
+
+// add rows into sorted rows (order) using sort keys of all rows. Rows are sorted and then
+// inserted at binary searched positions for a few rows or merged for many rows
+void
+CQModelView::
+insertSortedRows(const SortKeys &sortKeys, const SortColumnKeysArray &keys,
+                 std::vector<int> &order, std::vector<int> &rows)
+{
+  if (rows.empty())
+    return;
+
+  auto cmp = sortRowCompare(sortKeys, keys);
+
+  std::sort(rows.begin(), rows.end(), cmp);
+
+  std::vector<int> order1;
+
+  order1.reserve(order.size() + rows.size());
+
+  double n = double(order.size());
+
+  if (double(rows.size())*std::log2(n + 1) < n) {
+    auto p = order.begin();
+
+    for (const auto &r : rows) {
+      auto p1 = std::lower_bound(p, order.end(), r, cmp);
+
+      order1.insert(order1.end(), p, p1);
+
+      order1.push_back(r);
+
+      p = p1;
+    }
+
+    order1.insert(order1.end(), p, order.end());
+  }
+  else
+    std::merge(order.begin(), order.end(), rows.begin(), rows.end(),
+               std::back_inserter(order1), cmp);
+
+  std::swap(order, order1);
+}
+
+// resort changed rows [row1, row2] of parent (sort column values changed) using cached
+// keys (only changed rows are read), only rows between old and new position of each
+// moved row change so only those visible rows are redrawn
+void
+CQModelView::
+updateSortedRows(const QModelIndex &parent, int row1, int row2)
+{
+  if (! model_ || ! rootNode_ || state_.updateRowDatas)
+    return;
+
+  auto *node = findExpandNode(parent);
+  if (! node || ! node->isSorted()) return;
+
+  row1 = std::max(row1, 0);
+  row2 = std::min(row2, node->numRows() - 1);
+  if (row1 > row2) return;
+
+  auto sortKeys = validSortKeys();
+  if (sortKeys.empty()) return;
+
+  // update cached keys of changed rows (all keys read if not cached)
+  int nr = node->numRows();
+  int n  = row2 - row1 + 1;
+
+  if (isSortKeysValid(node->keys, sortKeys, nr)) {
+    SortColumnKeysArray rowKeys;
+
+    readSortKeys(parent, row1, n, sortKeys, rowKeys);
+
+    for (size_t k = 0; k < sortKeys.size(); ++k)
+      node->keys[k].setRows(row1, rowKeys[k]);
+  }
+  else
+    (void) nodeSortKeys(node, sortKeys, nr);
+
+  // remove changed rows from sorted order and reinsert
+  std::vector<int> order;
+
+  order.reserve(node->order.size());
+
+  for (const auto &r : node->order) {
+    if (r < row1 || r > row2)
+      order.push_back(r);
+  }
+
+  std::vector<int> rows, oldPos;
+
+  rows.resize(uint(n));
+
+  std::iota(rows.begin(), rows.end(), row1);
+
+  for (const auto &r : rows)
+    oldPos.push_back(node->pos[uint(r)]);
+
+  insertSortedRows(sortKeys, node->keys, order, rows);
+
+  int pos1, pos2;
+
+  if (! node->updateOrder(order, pos1, pos2))
+    return;
+
+  // merged position ranges between old and new position of moved rows (rows outside
+  // these ranges keep their position)
+  std::vector<std::pair<int, int>> ranges;
+
+  for (int i = 0; i < n; ++i) {
+    int p1 = oldPos[uint(i)];
+    int p2 = node->pos[uint(row1 + i)];
+
+    if (p1 != p2)
+      ranges.emplace_back(std::min(p1, p2), std::max(p1, p2));
+  }
+
+  std::sort(ranges.begin(), ranges.end());
+
+  std::vector<std::pair<int, int>> flatRanges;
+
+  int nodeFlatRow = expandNodeFlatRow(node);
+
+  for (size_t i = 0; i < ranges.size(); ) {
+    int p1 = ranges[i].first;
+    int p2 = ranges[i].second;
+
+    for (++i; i < ranges.size() && ranges[i].first <= p2 + 1; ++i)
+      p2 = std::max(p2, ranges[i].second);
+
+    // flat rows of range positions (includes expanded descendants)
+    int flatRow1 = nodeFlatRow + node->counts.prefixSum(p1);
+    int flatRow2 = nodeFlatRow + node->counts.prefixSum(p2 + 1);
+
+    if (flatRow2 > rowDatas_.start && flatRow1 < rowDatas_.end())
+      flatRanges.emplace_back(flatRow1, flatRow2);
+  }
+
+  if (flatRanges.empty())
+    return;
+
+  rowDatasChanged();
+
+  ++numRedraws_;
+
+  vh_->redraw();
+
+  for (const auto &fr : flatRanges)
+    redrawFlatRowRange(fr.first, fr.second);
+}
+
+// run func for chunks [0, n) on thread pool and wait for all to finish
+// (run in calling thread for single chunk)
+void
+CQModelView::
+parallelFor(int n, const std::function<void(int)> &func)
+{
+  if (n <= 1) {
+    if (n == 1)
+      func(0);
+
+    return;
+  }
+
+  if (! threadPool_)
+    threadPool_ = new QThreadPool;
+
+  QSemaphore done;
+
+  for (int i = 0; i < n; ++i)
+    threadPool_->start(new ParallelTask(func, done, i));
+
+  done.acquire(n);
+}
+
+// get node for children of parent (nullptr if parent not visible or expanded), node
+// (and ancestors) are built if needed
+CQModelView::ExpandNode *
+CQModelView::
+findExpandNode(const QModelIndex &parent) const
+{
+  if (! rootNode_)
+    return nullptr;
+
+  if (parent == rootNode_->parent)
+    return rootNode_;
+
+  if (! parent.isValid())
+    return nullptr;
+
+  auto *parentNode = findExpandNode(parent.parent());
+  if (! parentNode) return nullptr;
+
+  auto p = parentNode->children.find(parent.row());
+  if (p == parentNode->children.end()) return nullptr;
+
+  auto *node = (*p).second;
+
+  const_cast<CQModelView *>(this)->buildExpandNode(node);
+
+  return node;
+}
+
+// get flat row of first child row of node
+int
+CQModelView::
+expandNodeFlatRow(const ExpandNode *node) const
+{
+  if (! node->parentNode)
+    return 0;
+
+  return expandNodeFlatRow(node->parentNode) + node->parentNode->rowFlatOffset(node->row) + 1;
+}
+
+// get flat row of first visible row at or after row of parent (-1 if parent not laid out)
+int
+CQModelView::
+flatRowPos(const QModelIndex &parent, int row) const
+{
+  const_cast<CQModelView *>(this)->updateRowDatas();
+
+  auto *node = findExpandNode(parent);
+  if (! node) return -1;
+
+  row = std::min(std::max(row, 0), node->numRows());
+
+  int offset = (row < node->numRows() ? node->rowFlatOffset(row) : node->numFlatRows());
+
+  return expandNodeFlatRow(node) + offset;
+}
+
+// get flat row for index (-1 if not laid out)
+int
+CQModelView::
+indexFlatRow(const QModelIndex &ind) const
+{
+  if (! model_ || ! ind.isValid() || ind == rootIndex())
+    return -1;
+
+  const_cast<CQModelView *>(this)->updateRowDatas();
+
+  auto parent = ind.parent();
+
+  // check window first
+  int flatRow = rowDatas_.flatRow(model_->index(ind.row(), 0, parent));
+
+  if (flatRow >= 0)
+    return flatRow;
+
+  auto *node = findExpandNode(parent);
+  if (! node) return -1;
+
+  int r = ind.row();
+
+  if (r >= node->numRows() || ! node->rowFlatRows(r))
+    return -1;
+
+  return expandNodeFlatRow(node) + node->rowFlatOffset(r);
+}
+
+// get node, row and parent flat row for flat row
+bool
+CQModelView::
+flatRowNode(int flatRow, ExpandNode* &node, int &row, int &parentFlatRow) const
+{
+  node          = rootNode_;
+  row           = -1;
+  parentFlatRow = -1;
+
+  if (! node || flatRow < 0 || flatRow >= node->numFlatRows())
+    return false;
+
+  int nodeFlatRow = 0; // flat row of first row of node
+
+  while (node) {
+    int offset = flatRow - nodeFlatRow;
+
+    int pos = node->counts.lowerBound(offset);
+    if (pos >= node->numRows()) return false;
+
+    row = node->posRow(pos);
+
+    int rowFlatRow = nodeFlatRow + node->counts.prefixSum(pos);
+
+    if (rowFlatRow == flatRow)
+      return true;
+
+    // flat row is descendant of row
+    auto p = node->children.find(row);
+    if (p == node->children.end()) return false;
+
+    node = (*p).second;
+
+    const_cast<CQModelView *>(this)->buildExpandNode(node);
+
+    parentFlatRow = rowFlatRow;
+    nodeFlatRow   = rowFlatRow + 1;
+  }
+
+  return false;
+}
+
+// get row data for flat row (from window or expanded nodes)
+CQModelView::RowData
+CQModelView::
+flatRowData(int flatRow) const
+{
+  if (rowDatas_.contains(flatRow))
+    return rowDatas_.rowData(flatRow);
+
+  ExpandNode *node;
+  int         row, parentFlatRow;
+
+  if (! flatRowNode(flatRow, node, row, parentFlatRow))
+    return RowData();
+
+  auto ind = model_->index(row, 0, node->parent);
+
+  bool expanded = (node->children.find(row) != node->children.end());
+  bool children = (expanded || model_->hasChildren(ind));
+
+  RowData rowData(node->parent, row, node->numRows(), flatRow, children, expanded,
+                  node->depth, parentFlatRow);
+
+  rowData.pos = node->rowPos(row);
+
+  return rowData;
+}
+
+QModelIndex
+CQModelView::
+flatRowIndex(int flatRow, int column) const
+{
+  if (rowDatas_.contains(flatRow))
+    return model_->index(rowDatas_.row(flatRow), column, rowDatas_.parent(flatRow));
+
+  auto rowData = flatRowData(flatRow);
+
+  if (rowData.row < 0 || rowData.row >= rowData.numRows)
+    return QModelIndex();
+
+  return model_->index(rowData.row, column, rowData.parent);
+}
+
+// vis row data of visible flat row (nullptr if not in visible range)
+const CQModelView::VisRowData *
+CQModelView::
+visFlatRowData(int flatRow) const
+{
+  int i = flatRow - visRowsStart_;
+
+  if (i < 0 || i >= int(visRowDatas_.size()))
+    return nullptr;
+
+  return &visRowDatas_[uint(i)];
+}
+
+// create row datas for window of flat rows
+void
+CQModelView::
+updateRowWindow(int flatRow1, int flatRow2)
+{
+  updateRowDatas();
+
+  flatRow1 = std::max(flatRow1, 0);
+  flatRow2 = std::min(flatRow2, nvr_);
+
+  rowDatas_.clear(flatRow1);
+
+  if (flatRow1 >= flatRow2)
+    return;
+
+  rowDatas_.reserve(flatRow2 - flatRow1);
+
+  std::map<const ExpandNode *, int> nodeParentIds;
+
+  for (int flatRow = flatRow1; flatRow < flatRow2; ++flatRow) {
+    ExpandNode *node;
+    int         row, parentFlatRow;
+
+    if (! flatRowNode(flatRow, node, row, parentFlatRow))
+      break;
+
+    auto pn = nodeParentIds.find(node);
+
+    if (pn == nodeParentIds.end())
+      pn = nodeParentIds.insert(pn,
+             std::make_pair(node, rowDatas_.addParent(node->parent, node->numRows())));
+
+    auto ind = model_->index(row, 0, node->parent);
+
+    bool expanded = (node->children.find(row) != node->children.end());
+    bool children = (expanded || model_->hasChildren(ind));
+
+    if (children)
+      hierarchical_ = true;
+
+    rowDatas_.add(ind, (*pn).second, row, node->rowPos(row), node->depth, parentFlatRow,
+                  children, expanded);
+  }
+}
+
+// add number of flat rows for row of node (and node's ancestors)
+void
+CQModelView::
+addExpandNodeFlatRows(ExpandNode *node, int row, int n)
+{
+  while (node) {
+    node->counts.addValue(node->rowPos(row), n);
+
+    row  = node->row;
+    node = node->parentNode;
+  }
+}
+
+// update flat row count of node row for hidden state (create/delete expanded child node)
+// (ancestor counts are not updated)
+void
+CQModelView::
+setExpandNodeRowVisible(ExpandNode *node, int row, bool visible, const ExpandedRows &expandedRows)
+{
+  int pos = node->rowPos(row);
+
+  bool oldVisible = (node->counts.value(pos) > 0);
+
+  if (visible == oldVisible)
+    return;
+
+  auto pc = node->children.find(row);
+
+  if (pc != node->children.end()) {
+    delete (*pc).second;
+
+    node->children.erase(pc);
+  }
+
+  if (! visible) {
+    node->counts.setValue(pos, 0);
+    return;
+  }
+
+  int n = 1;
+
+  auto ind = model_->index(row, 0, node->parent);
+
+  if (isIndexExpanded(ind) && model_->hasChildren(ind)) {
+    auto *child = createExpandNode(ind, node, row, node->depth + 1, expandedRows);
+
+    node->children[row] = child;
+
+    n += child->numFlatRows();
+  }
+
+  node->counts.setValue(pos, n);
+}
+
+// hidden state of parent rows changed, update parent node and ancestor flat row counts
+void
+CQModelView::
+updateHiddenRows(const QModelIndex &parent, int row1, int row2)
+{
+  if (! model_ || ! rootNode_ || state_.updateRowDatas)
+    return;
+
+  auto *node = findExpandNode(parent);
+
+  if (node) {
+    int oldTotal = node->numFlatRows();
+
+    const auto &expandedRows = this->expandedRows();
+
+    const auto *hidden = hiddenRows_->rows(parent);
+
+    row2 = std::min(row2, node->numRows() - 1);
+
+    for (int r = row1; r <= row2; ++r) {
+      bool visible = ! (hidden && r < hidden->size() && hidden->test(r));
+
+      setExpandNodeRowVisible(node, r, visible, expandedRows);
+    }
+
+    addExpandNodeFlatRows(node->parentNode, node->row, node->numFlatRows() - oldTotal);
+  }
+
+  rowDatasChanged();
+}
+
+// hidden rows of many parents or view sort changed, rebuild expanded nodes
+void
+CQModelView::
+rebuildRowDatas()
+{
+  state_.updateScrollBars = true;
+  state_.updateRowDatas   = true;
+  state_.updateVisRows    = true;
+  state_.updateVisCells   = true;
+  state_.updateSelection  = true;
+
+  redraw();
+
+  emit stateChanged();
+}
+
+// flat rows changed (rows inserted/removed, expand/collapse), update visible data
+// but keep column widths, scroll position and expand state
+void
+CQModelView::
+rowDatasChanged()
+{
+  if (rootNode_) {
+    nmr_ = rootNode_->numModelRows();
+    nvr_ = rootNode_->numFlatRows();
+  }
+
+  rowDatas_.clear();
+
+  if (vsm_ && vsm_->currentIndex().isValid())
+    currentFlatRow_ = indexFlatRow(vsm_->currentIndex());
+  else
+    currentFlatRow_ = -1;
+
+  state_.updateScrollBars = true;
+  state_.updateVisRows    = true;
+  state_.updateVisCells   = true;
+  state_.updateSelection  = true;
+}
+
+//------
+
+void
+CQModelView::
+updateVisRows()
+{
+  if (! state_.updateVisRows)
+    return;
+
+  state_.updateVisRows = false;
+
+  //---
+
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::updateVisRows");
+#endif
+
+  updateRowDatas();
+
+  //---
+
+  visRowDatas_.clear();
+  visFlatRows_.clear();
+
+  visRowsStart_ = 0;
+
+  //---
+
+  int rowHeight = this->rowHeight(0);
+
+  int borderHeight = visualBorderRows_*rowHeight;
+
+  int vy1 = visualRect_.top   () - borderHeight;
+  int vy2 = visualRect_.bottom() + borderHeight;
+
+  //---
+
+  int y1 = 0;
+
+  if (vs_->isVisible() && vs_->value() == vs_->maximum())
+    y1 = -(nvr_*rowHeight - viewport()->height());
+  else
+    y1 = -verticalOffset()*rowHeight;
+
+  visRowsY_ = y1;
+
+  int hw = std::max(globalColumnData_.headerWidth, globalRowData_.vheaderWidth);
+
+  // create row datas for flat rows in extended visible range
+  auto floorDiv = [](int a, int b) { return (a >= 0 ? a/b : -((b - a - 1)/b)); };
+
+  int rh1 = std::max(rowHeight, 1);
+
+  int flatRow1 = std::max(floorDiv(vy1 - y1, rh1) - 1, 0);
+  int flatRow2 = std::min(floorDiv(vy2 - y1, rh1) + 2, nvr_);
+
+  updateRowWindow(flatRow1, flatRow2);
+
+  // only rows overlapping extended visible range are materialized (contiguous
+  // so stored in flat row order from visRowsStart_)
+  int evisRow1 = std::max(floorDiv(vy1 - visRowsY_ - 1, rh1), rowDatas_.start);
+  int evisRow2 = std::min(floorDiv(vy2 - visRowsY_, rh1) + 1, rowDatas_.end());
+
+  visRowsStart_ = evisRow1;
+
+  visRowDatas_.reserve(uint(std::max(evisRow2 - evisRow1, 0)));
+
+  y1 += evisRow1*rowHeight;
+
+  for (int flatRow = evisRow1; flatRow < evisRow2; ++flatRow) {
+    int y2 = y1 + rowHeight;
+
+    visRowDatas_.emplace_back();
+
+    VisRowData &visRowData = visRowDatas_.back();
+
+    visRowData.rect = QRect(0, y1, hw, y2 - y1 + 1);
+
+    visRowData.depth         = rowDatas_.depth(flatRow);
+    visRowData.parentFlatRow = rowDatas_.parentFlatRow(flatRow);
+    visRowData.flatRow       = flatRow;
+    visRowData.r             = rowDatas_.row(flatRow);
+    visRowData.nr            = rowDatas_.numRows(flatRow);
+    visRowData.alternate     = (visRowData.flatRow & 1);
+    visRowData.children      = rowDatas_.hasChildren(flatRow);
+    visRowData.expanded      = rowDatas_.isExpanded(flatRow);
+    visRowData.visible       = ! (y1 > visualRect_.bottom() || y2 < visualRect_.top());
+    visRowData.evisible      = ! (y1 > vy2 || y2 < vy1);
+
+    //---
+
+    if (visRowData.evisible)
+      visFlatRows_.push_back(visRowData.flatRow);
+
+    //---
+
+    y1 = y2;
+  }
+
+  //---
+
+  updateVHeaderWidth();
+}
+
+void
+CQModelView::
+updateVHeaderWidth()
+{
+  globalRowData_.vheaderWidth = -1;
+
+  if      (verticalType() == VerticalType::TEXT) {
+    // text widths are cached and only remeasured for changed rows (headerDataChangedSlot,
+    // rowsInserted, rowsRemovedSlot) or when font or model changes
+    if (vheaderWidths_->valid && vheaderWidths_->font != font())
+      vheaderWidths_->invalidate();
+
+    if (vheaderWidths_->valid && ! vheaderWidths_->sampled &&
+        int(vheaderWidths_->widths.size()) != nr_)
+      vheaderWidths_->invalidate();
+
+    if (! vheaderWidths_->valid) {
+      vheaderWidths_->font = font();
+
+      QFontMetrics fm(vheaderWidths_->font);
+
+      vheaderWidths_->build(nr_, maxVHeaderMeasureRows(), [&](int r) {
+        return vheaderTextWidth(fm, r);
+      });
+    }
+
+    globalRowData_.vheaderWidth = vheaderWidths_->maxWidth() + 2*globalRowData_.margin;
+  }
+  else if (verticalType() == VerticalType::NUMBER) {
+    int n = (nr_ > 0 ? int(std::log10(nr_) + 1) : 1);
+
+    globalRowData_.vheaderWidth = n*paintData_.fm.horizontalAdvance("8") + 2*globalRowData_.margin;
+  }
+}
+
+// text width of vertical header label of root row (-1 if no text)
+int
+CQModelView::
+vheaderTextWidth(const QFontMetrics &fm, int row) const
+{
+  auto data = (model_ ? model_->headerData(row, Qt::Vertical, Qt::DisplayRole) : QVariant());
+  if (! data.isValid()) return -1;
+
+  auto str = data.toString();
+  if (! str.length()) return -1;
+
+  return fm.horizontalAdvance(str);
+}
+
+//------
+
+void
+CQModelView::
+updateVisCells()
+{
+  if (! state_.updateVisCells)
+    return;
+
+  state_.updateVisCells = false;
+
+  //---
+
+#ifdef CQ_MODEL_VIEW_TRACE
+  CQPerfTrace trace("CQModelView::updateVisCells");
+#endif
+
+  updateVisColumns();
+  updateVisRows   ();
+
+  //---
+
+  // dense grid of visible rows (visFlatRows_ order) x visible columns (visColumnDatas_
+  // order), storage capacity is kept between updates
+  int nr = int(visFlatRows_.size());
+
+  visCellNc_ = int(visColumnDatas_.size());
+
+  // only reset slots of previous window columns
+  for (const auto &c : visCellColumnIds_) {
+    if (c < int(visCellColumns_.size()))
+      visCellColumns_[uint(c)] = -1;
+  }
+
+  visCellColumns_.resize(uint(nc_), -1);
+
+  visCellColumnIds_.clear();
+
+  int cs = 0;
+
+  for (const auto &pc : visColumnDatas_) {
+    if (pc.first >= 0 && pc.first < nc_)
+      visCellColumns_[uint(pc.first)] = cs;
+
+    visCellColumnIds_.push_back(pc.first);
+
+    ++cs;
+  }
+
+  visCellDatas_ .resize(uint(nr*visCellNc_));
+  ivisCellDatas_.resize(isHierarchical() ? uint(nr) : 0);
+
+  visCellSlots_->reset(nr*visCellNc_);
+
+  cs = 0;
+
+  for (const auto &pc : visColumnDatas_) {
+    int         c             = pc.first;
+    const auto &visColumnData = pc.second;
+
+    int x1 = visColumnData.rect.left () - paintData_.margin;
+    int x2 = visColumnData.rect.right() + paintData_.margin;
+
+    for (int rs = 0; rs < nr; ++rs) {
+      int flatRow = visFlatRows_[uint(rs)];
+
+      auto rowData = rowDatas_.rowData(flatRow);
+
+      //---
+
+      const auto *pvisRowData = visFlatRowData(flatRow);
+      assert(pvisRowData);
+
+      const VisRowData &visRowData = *pvisRowData;
+
+      int y1 = visRowData.rect.top   ();
+      int y2 = visRowData.rect.bottom();
+
+      //---
+
+      auto ind = model_->index(rowData.row, c, rowData.parent);
+
+      int indent = 0;
+
+      if (isHierarchical() && c == 0) {
+        VisCellData &ivisCellData = ivisCellDatas_[uint(rs)];
+
+        indent = (visRowData.depth + rootIsDecorated())*indentation();
+
+        ivisCellData.ind           = ind;
+        ivisCellData.depth         = rowData.depth;
+        ivisCellData.parentFlatRow = rowData.parentFlatRow;
+        ivisCellData.flatRow       = flatRow;
+        ivisCellData.r             = rowData.row;
+        ivisCellData.pos           = rowData.pos;
+        ivisCellData.nr            = rowData.numRows;
+        ivisCellData.c             = 0;
+        ivisCellData.rect          = QRect(x1, y1, indent, y2 - y1 + 1);
+        ivisCellData.selected      = false;
+      }
+
+      //---
+
+      int slot = rs*visCellNc_ + cs;
+
+      VisCellData &visCellData = visCellDatas_[uint(slot)];
+
+      if (visColumnData.last && isStretchLastColumn() && x2 < paintData_.vw)
+        x2 = paintData_.vw - 1;
+
+      int xi1 = x1 + indent;
+
+      visCellData.ind           = ind;
+      visCellData.depth         = rowData.depth;
+      visCellData.parentFlatRow = rowData.parentFlatRow;
+      visCellData.flatRow       = flatRow;
+      visCellData.r             = rowData.row;
+      visCellData.pos           = rowData.pos;
+      visCellData.nr            = rowData.numRows;
+      visCellData.c             = c;
+      visCellData.rect          = QRect(xi1, y1, x2 - xi1 + 1, y2 - y1 + 1);
+      visCellData.selected      = false;
+
+      visCellSlots_->add(ind, slot);
+    }
+
+    ++cs;
+  }
+
+  // selected flags reset and hier selection cell areas point into cells
+  state_.updateSelection = true;
+}
+
+// slot of visible flat row in visFlatRows_ (-1 if not visible)
+int
+CQModelView::
+visCellRowSlot(int flatRow) const
+{
+  // visible flat rows are consecutive
+  if (visFlatRows_.empty())
+    return -1;
+
+  int rs = flatRow - visFlatRows_.front();
+
+  if (rs < 0 || rs >= int(visFlatRows_.size()) || visFlatRows_[uint(rs)] != flatRow)
+    return -1;
+
+  return rs;
+}
+
+// slot of visible cell in visCellDatas_ (-1 if not visible)
+int
+CQModelView::
+visCellSlot(int flatRow, int c) const
+{
+  if (c < 0 || c >= int(visCellColumns_.size()))
+    return -1;
+
+  int cs = visCellColumns_[uint(c)];
+  if (cs < 0) return -1;
+
+  int rs = visCellRowSlot(flatRow);
+  if (rs < 0) return -1;
+
+  return rs*visCellNc_ + cs;
+}
+
+//------
+
+bool
+CQModelView::
+isNumericColumn(int c) const
+{
+  auto type = CQBaseModelType::STRING;
+
+  auto tvar = model_->headerData(c, Qt::Horizontal, static_cast<int>(CQBaseModelRole::Type));
+  if (! tvar.isValid()) return false;
+
+  bool ok;
+  type = static_cast<CQBaseModelType>(tvar.toInt(&ok));
+  if (! ok) return false;
+
+  //---
+
+  return (type == CQBaseModelType::REAL || type == CQBaseModelType::INTEGER);
+}
+
+void
+CQModelView::
+editFilterSlot()
+{
+  filterTimer_->stop();
+
+  applyFilters();
+}
+
+// filter text edited, restart debounce timer to filter while typing
+void
+CQModelView::
+filterTextChangedSlot()
+{
+  filterTimer_->start();
+}
+
+// filter root rows by conjunction of all non-empty filter edits
+void
+CQModelView::
+applyFilters()
+{
+  cancelFilter();
+
+  if (! model_)
+    return;
+
+  auto parent = rootIndex();
+
+  int nr = model_->rowCount(parent);
+
+  auto *run = new FilterRun;
+
+  run->id     = ++filterRunId_;
+  run->model  = model_;
+  run->parent = parent;
+  run->nr     = nr;
+  run->tree   = isFilterTree();
+  run->expand = isFilterExpand();
+
+  for (auto *le : filterEdits_) {
+    int c = le->column();
+
+    auto filterStr = le->text().trimmed();
+
+    if (c < 0 || c >= nc_ || ! filterStr.length())
+      continue;
+
+    FilterRun::Filter filter;
+
+    filter.init(c, filterStr, isNumericColumn(c));
+
+    run->filters.push_back(filter);
+  }
+
+  if (run->filters.empty() || nr == 0) {
+    delete run;
+
+    resetFilterResult();
+
+    if (! filterHiddenRows_->empty()) {
+      filterHiddenRows_->clear();
+
+      if (isFilterTree()) {
+        unionHiddenRows();
+
+        rebuildRowDatas();
+      }
+      else
+        unionHiddenRows(parent);
+    }
+
+    return;
+  }
+
+  // if refinement of last applied filter (e.g. text typed at end of wildcard) then
+  // only rows matching last filter need to be checked
+  auto *result = filterResult_;
+
+  if (result && ! run->tree && ! result->tree && result->parent == parent &&
+      result->nr == nr && run->isSubset(*result)) {
+    // no change if same filter
+    if (result->isSubset(*run)) {
+      delete run;
+      return;
+    }
+
+    for (int r = 0; r < nr; ++r) {
+      if (result->visible[uint(r)])
+        run->rows.push_back(r);
+    }
+  }
+
+  // model is only read in gui thread (tree rows are read into nodes)
+  run->readValues();
+
+  run->visible.resize(uint(run->tree ? run->numCheckRows() : nr));
+
+  if (run->tree)
+    run->anyVisible.resize(run->visible.size());
+
+  filterRun_ = run;
+
+  //---
+
+  int n = run->numCheckRows();
+
+  // evaluate small number of rows in gui thread
+  int minChunkRows = 4096;
+
+  int nt = QThread::idealThreadCount();
+
+  if (nt <= 1 || n <= minChunkRows) {
+    run->outerNodes.resize(1);
+
+    run->filterRows(0, 0, n);
+
+    filterFinishedSlot(run->id);
+
+    return;
+  }
+
+  // evaluate rows (tree nodes) in chunks (several per thread for load balancing)
+  if (! filterPool_)
+    filterPool_ = new QThreadPool;
+
+  int chunkRows = std::max((n + 4*nt - 1)/(4*nt), minChunkRows);
+  int nchunks   = (n + chunkRows - 1)/chunkRows;
+
+  run->outerNodes.resize(uint(nchunks));
+
+  run->pending = nchunks;
+
+  for (int i = 0; i < nchunks; ++i) {
+    int i1 = i*chunkRows;
+    int i2 = std::min(i1 + chunkRows, n);
+
+    filterPool_->start(new FilterTask(this, run, i, i1, i2));
+  }
+}
+
+// cancel running filter (waits for running filter tasks to notice, background sort
+// chunks in the shared thread pool are not waited for)
+void
+CQModelView::
+cancelFilter()
+{
+  if (! filterRun_)
+    return;
+
+  filterRun_->cancelled = true;
+
+  if (filterPool_)
+    filterPool_->waitForDone();
+
+  delete filterRun_;
+
+  filterRun_ = nullptr;
+}
+
+// forget last applied filter (model data changed so can't be refined)
+void
+CQModelView::
+resetFilterResult()
+{
+  delete filterResult_;
+
+  filterResult_ = nullptr;
+}
+
+void
+CQModelView::
+filterFinishedSlot(int id)
+{
+  if (! filterRun_ || filterRun_->id != id)
+    return;
+
+  auto *run = filterRun_;
+
+  filterRun_ = nullptr;
+
+  // model structure changes cancel filter so rows should match
+  if (! model_ || run->parent != rootIndex() || model_->rowCount(run->parent) != run->nr) {
+    delete run;
+    return;
+  }
+
+  CRankBitset rows;
+
+  if (run->tree) {
+    // chunks propagated visible descendants to parents in chunk, merge remaining
+    // parents in earlier chunks
+    run->mergeOuterNodes();
+
+    const auto &nodes      = run->nodes;
+    const auto &anyVisible = run->anyVisible;
+
+    int n = int(nodes.size());
+
+    // replace filter hidden rows of all parents
+    std::vector<bool> rootHidden;
+
+    rootHidden.resize(uint(run->nr));
+
+    std::map<int, std::vector<bool>> nodeHidden;
+
+    for (int i = 0; i < n; ++i) {
+      if (run->visible[uint(i)])
+        continue;
+
+      const auto &node = nodes[uint(i)];
+
+      int r = node.ind.row();
+      int p = node.parentNode;
+
+      if (p < 0) {
+        rootHidden[uint(r)] = true;
+        continue;
+      }
+
+      auto &hidden = nodeHidden[p];
+
+      if (hidden.empty())
+        hidden.resize(uint(nodes[uint(p)].numChildren));
+
+      hidden[uint(r)] = true;
+    }
+
+    filterHiddenRows_->clear();
+
+    rows.assign(rootHidden);
+
+    filterHiddenRows_->setRows(run->parent, rows);
+
+    for (const auto &ph : nodeHidden) {
+      rows.assign(ph.second);
+
+      filterHiddenRows_->setRows(nodes[uint(ph.first)].ind, rows);
+    }
+
+    // expand ancestors of matches (single expand state update and state changed
+    // signal from rebuild)
+    if (run->expand) {
+      bool changed = false;
+
+      for (int i = 0; i < n; ++i) {
+        if (! anyVisible[uint(i)])
+          continue;
+
+        if (expanded_.insert(nodes[uint(i)].ind).second)
+          changed = true;
+      }
+
+      if (changed)
+        expandedChanged();
+    }
+
+    FilterRun::TreeNodes().swap(run->nodes);
+    FilterRun::Visible  ().swap(run->anyVisible);
+
+    run->outerNodes.clear();
+
+    unionHiddenRows();
+
+    rebuildRowDatas();
+  }
+  else {
+    std::vector<bool> hidden;
+
+    hidden.resize(uint(run->nr));
+
+    for (int r = 0; r < run->nr; ++r)
+      hidden[uint(r)] = ! run->visible[uint(r)];
+
+    rows.assign(hidden);
+
+    filterHiddenRows_->setRows(run->parent, rows);
+
+    unionHiddenRows(run->parent);
+  }
+
+  // keep as base for refinement
+  FilterRun::Rows  ().swap(run->rows);
+  FilterRun::Values().swap(run->values);
+
+  resetFilterResult();
+
+  filterResult_ = run;
+}
+
+// model about to change, stop running filter (values and rows read from old model) and
+// restart
+void
+CQModelView::
+cancelFilterSlot()
+{
+  resetFilterResult();
+
+  if (! filterRun_)
+    return;
+
+  cancelFilter();
+
+  QTimer::singleShot(0, this, SLOT(editFilterSlot()));
+}
+
+void
+CQModelView::
+hscrollSlot(int v)
+{
+  if (scrollData_.hpos != v) {
+    bool blit = canScrollBlit();
+
+    int dx = scrollData_.hpos - v;
+
+    scrollData_.hpos = v;
+
+    state_.updateVisColumns = true;
+    state_.updateVisCells   = true;
+
+    if (blit)
+      scrollBlit(dx, 0);
+    else
+      redraw();
+  }
+}
+
+void
+CQModelView::
+vscrollSlot(int v)
+{
+  if (scrollData_.vpos != v) {
+    bool blit = canScrollBlit();
+
+    int y1 = visRowsY_;
+
+    scrollData_.vpos = v;
+
+    state_.updateVisRows   = true;
+    state_.updateVisCells  = true;
+    state_.updateSelection = true;
+
+    if (blit) {
+      // rows are positioned from bottom at end so shift is change in row y
+      updateVisRows();
+
+      scrollBlit(0, visRowsY_ - y1);
+    }
+    else
+      redraw();
+  }
+}
+
+void
+CQModelView::
+mousePressEvent(QMouseEvent *e)
+{
+  mouseData_.pressed   = true;
+  mouseData_.modifiers = e->modifiers();
+
+  if (e->button() != Qt::LeftButton)
+    return;
+
+  mouseData_.pressData.pos = e->pos();
+
+  cellPositionToIndex(mouseData_.pressData);
+
+  handleMousePress();
+}
+
+void
+CQModelView::
+handleMousePress()
+{
+  // mouse type for expand/collapse of tree
+  if (isHierarchical()) {
+    if (style()->styleHint(QStyle::SH_ListViewExpand_SelectMouseType, nullptr, this) ==
+          QEvent::MouseButtonPress) {
+      if (mouseData_.pressData.iind.isValid()) {
+        setExpanded(mouseData_.pressData.iind, ! isExpanded(mouseData_.pressData.iind));
+        return;
+      }
+    }
+  }
+
+  //---
+
+  mouseData_.pressData.currentInd = sm_->currentIndex();
+
+  mouseData_.dragRect.reset();
+
+  // horizontal header section pressed
+  if      (mouseData_.pressData.hsection >= 0) {
+    if (! (mouseData_.modifiers & Qt::ShiftModifier)) {
+      selectColumn(mouseData_.pressData.hsection, mouseData_.modifiers);
+
+      redraw();
+    }
+  }
+  // horizontal header section handle pressed
+  else if (mouseData_.pressData.hsectionh >= 0) {
+    const ColumnData &columnData = columnDatas_[uint(mouseData_.pressData.hsectionh)];
+
+    int cw = (columnData.width > 0 ? columnData.width : 100);
+
+    mouseData_.headerWidth = cw;
+  }
+  // vertical header section pressed
+  else if (mouseData_.pressData.vsection >= 0) {
+    if (! (mouseData_.modifiers & Qt::ShiftModifier)) {
+      selectRow(mouseData_.pressData.vsection, mouseData_.modifiers);
+
+      redraw();
+    }
+  }
+  // table row/column selected
+  else if (mouseData_.pressData.ind.isValid()) {
+    if      (selectionBehavior() == SelectRows)
+      selectRow(indexFlatRow(mouseData_.pressData.ind), mouseData_.modifiers);
+    else if (selectionBehavior() == SelectColumns)
+      selectColumn(mouseData_.pressData.ind.column(), mouseData_.modifiers);
+    else
+      selectCell(mouseData_.pressData.ind, mouseData_.modifiers);
+
+    redraw();
+  }
+}
+
+void
+CQModelView::
+mouseMoveEvent(QMouseEvent *e)
+{
+  PositionData moveData;
+
+  moveData.pos = e->pos();
+
+  cellPositionToIndex(moveData);
+
+  if (! mouseData_.pressed) {
+    if (moveData != mouseData_.moveData) {
+      //auto rrect = mouseData_.moveData.rect.united(moveData.rect);
+
+      mouseData_.moveData = moveData;
+
+      //redraw(rrect);
+      redraw();
+    }
+  }
+  else {
+    if (moveData != mouseData_.moveData) {
+      mouseData_.moveData = moveData;
+
+      handleMouseMove();
+    }
+  }
+}
+
+void
+CQModelView::
+handleMouseMove()
+{
+  // horizontal header section pressed
+  if      (mouseData_.pressData.hsection >= 0) {
+    if (mouseData_.moveData.hsection < 0)
+      return;
+
+    selectColumnRange(mouseData_.pressData.hsection, mouseData_.moveData.hsection,
+                      mouseData_.modifiers);
+
+    redraw();
+  }
+  // horizontal header section handle pressed
+  else if (mouseData_.pressData.hsectionh >= 0) {
+    int dx = mouseData_.moveData.pos.x() - mouseData_.pressData.pos.x();
+
+    ColumnData &columnData = columnDatas_[uint(mouseData_.pressData.hsectionh)];
+
+    columnData.width = std::min(std::max(mouseData_.headerWidth + dx, 4), 9999);
+
+    hh_->resizeSection(mouseData_.pressData.hsectionh, columnData.width);
+
+    state_.updateLayout();
+
+    redraw();
+
+    emit stateChanged();
+  }
+  // vertical header section pressed
+  else if (mouseData_.pressData.vsection >= 0) {
+    if (mouseData_.moveData.vsection < 0)
+      return;
+
+    selectRowRange(mouseData_.pressData.vsection, mouseData_.moveData.vsection,
+                   mouseData_.modifiers);
+
+    redraw();
+  }
+  // table row/column selected
+  else if (mouseData_.pressData.ind.isValid() && mouseData_.moveData.ind.isValid()) {
+    mouseData_.moveData.currentInd = sm_->currentIndex();
+
+    // drag rect from anchor (press) cell to current cell in flat rows
+    int flatRow1 = indexFlatRow(mouseData_.pressData.ind);
+    int flatRow2 = indexFlatRow(mouseData_.moveData.ind);
+
+    int column1 = mouseData_.pressData.ind.column();
+    int column2 = mouseData_.moveData.ind.column();
+
+    DragRect dragRect(std::min(flatRow1, flatRow2), std::max(flatRow1, flatRow2),
+                      std::min(column1 , column2 ), std::max(column1 , column2 ));
+
+    if (flatRow1 >= 0 && flatRow2 >= 0 && mouseData_.dragRect.isValid()) {
+      // only apply and redraw change from previous drag rect
+      updateDragSelection(dragRect);
+    }
+    else {
+      selectCellRange(mouseData_.pressData.ind, mouseData_.moveData.ind,
+                      mouseData_.modifiers);
+
+      redraw();
+    }
+
+    mouseData_.dragRect = (flatRow1 >= 0 && flatRow2 >= 0 ? dragRect : DragRect());
+
+    scrollTo(mouseData_.moveData.ind);
+  }
+}
+
+// update selection for drag rect change by selecting cells which entered the
+// rect and (unless adding to selection) deselecting cells which left it
+void
+CQModelView::
+updateDragSelection(const DragRect &dragRect)
+{
+  const auto &prevRect = mouseData_.dragRect;
+
+  if (dragRect == prevRect)
+    return;
+
+  // parts of rect r1 not in rect r2 (at most four)
+  auto subtractRect = [](const DragRect &r1, const DragRect &r2, DragRects &rects) {
+    if (! r1.intersects(r2)) {
+      rects.push_back(r1);
+      return;
+    }
+
+    if (r1.flatRow1 < r2.flatRow1)
+      rects.push_back(DragRect(r1.flatRow1, r2.flatRow1 - 1, r1.column1, r1.column2));
+
+    if (r1.flatRow2 > r2.flatRow2)
+      rects.push_back(DragRect(r2.flatRow2 + 1, r1.flatRow2, r1.column1, r1.column2));
+
+    int flatRow1 = std::max(r1.flatRow1, r2.flatRow1);
+    int flatRow2 = std::min(r1.flatRow2, r2.flatRow2);
+
+    if (r1.column1 < r2.column1)
+      rects.push_back(DragRect(flatRow1, flatRow2, r1.column1, r2.column1 - 1));
+
+    if (r1.column2 > r2.column2)
+      rects.push_back(DragRect(flatRow1, flatRow2, r2.column2 + 1, r1.column2));
+  };
+
+  DragRects addRects, removeRects;
+
+  subtractRect(dragRect, prevRect, addRects);
+
+  bool isAdd = (mouseData_.modifiers & Qt::ControlModifier);
+
+  if (! isAdd)
+    subtractRect(prevRect, dragRect, removeRects);
+
+  //---
+
+  QItemSelection addSelection, removeSelection;
+
+  int redrawRow1 = -1, redrawRow2 = -1;
+
+  auto addRedrawRows = [&](const DragRect &rect) {
+    redrawRow1 = (redrawRow1 >= 0 ? std::min(redrawRow1, rect.flatRow1) : rect.flatRow1);
+    redrawRow2 = std::max(redrawRow2, rect.flatRow2);
+  };
+
+  for (const auto &rect : addRects) {
+    addSelection.append(flatRectSelection(rect));
+
+    addRedrawRows(rect);
+  }
+
+  for (const auto &rect : removeRects) {
+    removeSelection.append(flatRectSelection(rect));
+
+    addRedrawRows(rect);
+  }
+
+  //---
+
+  // apply delta without full redraw from selection model updates
+  mouseData_.dragUpdate = true;
+
+  if (! removeSelection.empty())
+    sm_->select(removeSelection, QItemSelectionModel::Deselect);
+
+  if (! addSelection.empty())
+    sm_->select(addSelection, QItemSelectionModel::Select);
+
+  sm_->setCurrentIndex(mouseData_.moveData.ind, QItemSelectionModel::NoUpdate);
+
+  mouseData_.dragUpdate = false;
+
+  //---
+
+  // redraw rows which changed and rows of previous and new current cell
+  int currentRow1 = indexFlatRow(mouseData_.moveData.currentInd);
+  int currentRow2 = indexFlatRow(mouseData_.moveData.ind);
+
+  if (currentRow1 >= 0)
+    addRedrawRows(DragRect(currentRow1, currentRow1, 0, 0));
+
+  if (currentRow2 >= 0)
+    addRedrawRows(DragRect(currentRow2, currentRow2, 0, 0));
+
+  if (redrawRow1 < 0)
+    return;
+
+  int rowHeight = this->rowHeight(0);
+
+  auto vrect = viewport()->rect();
+
+  int y1 = std::max(visRowsY_ + redrawRow1*rowHeight      , vrect.top   ());
+  int y2 = std::min(visRowsY_ + (redrawRow2 + 1)*rowHeight, vrect.bottom());
+
+  if (y1 > y2)
+    return;
+
+  redraw(QRect(vrect.left(), y1, vrect.width(), y2 - y1 + 1));
+}
+
+void
+CQModelView::
+mouseReleaseEvent(QMouseEvent *e)
+{
+  if (e->button() != Qt::LeftButton)
+    return;
+
+  mouseData_.releaseData.pos = e->pos();
+
+  mouseData_.pressed = false;
+
+  cellPositionToIndex(mouseData_.releaseData);
+
+  handleMouseRelease();
+
+  mouseData_.pressData.reset();
+  mouseData_.moveData .reset();
+}
+
+void
+CQModelView::
+handleMouseRelease()
+{
+  bool click = false;
+
+  if      (mouseData_.pressData.iind.isValid())
+    click = (mouseData_.pressData.iind == mouseData_.releaseData.iind);
+  else if (mouseData_.pressData.ind.isValid())
+    click = (mouseData_.pressData.ind == mouseData_.releaseData.ind);
+  else if (mouseData_.pressData.hsection >= 0)
+    click = (mouseData_.pressData.hsection == mouseData_.releaseData.hsection);
+  else if (mouseData_.pressData.vsection >= 0)
+    click = (mouseData_.pressData.vsection == mouseData_.releaseData.vsection);
+
+  //---
+
+  // vertical header section pressed
+  if      (mouseData_.pressData.hsection >= 0) {
+    // shift click adds secondary view sort column
+    if      (click && (mouseData_.modifiers & Qt::ShiftModifier) && isViewSort()) {
+      addSortByColumn(mouseData_.pressData.hsection);
+
+      redraw();
+    }
+    else if (mouseData_.modifiers & Qt::ShiftModifier) {
+      int currentSection = -1;
+
+      if (click) {
+        auto start = mouseData_.pressData.currentInd;
+        if (! start.isValid()) return;
+
+        currentSection = start.column();
+      }
+      else {
+        if (mouseData_.moveData.hsection < 0)
+          return;
+
+        currentSection = mouseData_.moveData.hsection;
+      }
+
+      selectColumnRange(mouseData_.pressData.hsection, currentSection, mouseData_.modifiers);
+
+      redraw();
+    }
+  }
+  // horizontal header section pressed
+  else if (mouseData_.pressData.vsection >= 0) {
+    if (mouseData_.modifiers & Qt::ShiftModifier) {
+      int currentSection = -1;
+
+      if (click) {
+        auto start = mouseData_.pressData.currentInd;
+        if (! start.isValid()) return;
+
+        currentSection = start.row();
+      }
+      else {
+        if (mouseData_.moveData.vsection < 0)
+          return;
+
+        currentSection = mouseData_.moveData.vsection;
+      }
+
+      selectRowRange(mouseData_.pressData.vsection, currentSection, mouseData_.modifiers);
+
+      redraw();
+    }
+  }
+  // table row/column selected
+  else if (mouseData_.pressData.ind.isValid() && mouseData_.moveData.ind.isValid()) {
+  }
+
+  //---
+
+  if (click) {
+    if      (mouseData_.pressData.iind.isValid())
+      emit clicked(mouseData_.pressData.iind);
+    else if (mouseData_.pressData.ind.isValid())
+      emit clicked(mouseData_.pressData.ind);
+    else if (mouseData_.pressData.hsection >= 0) {
+      hh_->emitSectionClicked(mouseData_.pressData.hsection);
+    }
+    else if (mouseData_.pressData.vsection >= 0) {
+      vh_->emitSectionClicked(mouseData_.pressData.vsection);
+    }
+  }
+
+  //---
+
+  // mouse type for expand/collapse of tree
+  if (isHierarchical()) {
+    if (style()->styleHint(QStyle::SH_ListViewExpand_SelectMouseType, nullptr, this) ==
+          QEvent::MouseButtonRelease) {
+      if (mouseData_.pressData.iind.isValid()) {
+        setExpanded(mouseData_.pressData.iind, ! isExpanded(mouseData_.pressData.iind));
+        return;
+      }
+    }
+  }
+}
+
+void
+CQModelView::
+mouseDoubleClickEvent(QMouseEvent *e)
+{
+  if (e->button() != Qt::LeftButton)
+    return;
+
+  mouseData_.pressData.pos = e->pos();
+
+  cellPositionToIndex(mouseData_.pressData);
+
+  handleMouseRelease();
+
+  if      (mouseData_.pressData.ind.isValid()) {
+    auto persistent = QPersistentModelIndex(mouseData_.pressData.ind);
+
+    if (edit(persistent, DoubleClicked, e))
+      return;
+
+    if (expandsOnDoubleClick())
+      setExpanded(mouseData_.pressData.ind, ! isExpanded(mouseData_.pressData.ind));
+
+    QStyleOptionViewItem option;
+
+    if (style()->styleHint(QStyle::SH_ItemView_ActivateItemOnSingleClick, &option, this))
+      emit activated(mouseData_.pressData.ind);
+  }
+  else if (mouseData_.pressData.iind.isValid()) {
+    if (expandsOnDoubleClick())
+      setExpanded(mouseData_.pressData.iind, ! isExpanded(mouseData_.pressData.iind));
+  }
+}
+
+void
+CQModelView::
+handleMouseDoubleClick()
+{
+  if      (mouseData_.pressData.hsection >= 0) {
+    if (headerEditor_) {
+      headerEditor_->deleteLater();
+
+      headerEditor_ = nullptr;
+    }
+
+    headerEditor_ = new CQModelViewHeaderEdit(this, mouseData_.pressData.hsection);
+
+    headerEditor_->setGeometry(mouseData_.pressData.rect);
+
+    auto text = model_->headerData(mouseData_.pressData.hsection, Qt::Horizontal, Qt::DisplayRole);
+
+    headerEditor_->setText(text.toString());
+    headerEditor_->setFocus();
+
+    headerEditor_->show();
+  }
+  else if (mouseData_.pressData.hsectionh >= 0) {
+    resizeColumnToContents(mouseData_.pressData.hsectionh);
+
+    redraw();
+  }
+  else if (mouseData_.pressData.vsection >= 0) {
+  }
+  else if (mouseData_.pressData.ind.isValid()) {
+  }
+}
+
+void
+CQModelView::
+keyPressEvent(QKeyEvent *e)
+{
+  auto current = currentIndex();
+
+  // search
+  if      (e->key() == Qt::Key_Slash) {
+    setShowFilter(! isShowFilter());
+  }
+  else if (e->key() == Qt::Key_Asterisk) {
+    if (isHierarchical()) {
+      std::vector<QModelIndex> parents;
+
+      parents.push_back(current);
+
+      while (! parents.empty()) {
+        auto parent = parents.back();
+
+        parents.pop_back();
+
+        int nr = model()->rowCount(parent);
+
+        for (int r = 0; r < nr; ++r) {
+          auto child = model()->index(r, 0, parent);
+
+          if (! child.isValid())
+            break;
+
+          parents.push_back(child);
+
+          expand(child);
+        }
+      }
+
+      expand(current);
+    }
+  }
+  else if (e->key() == Qt::Key_Plus) {
+    if (isHierarchical()) {
+      expand(current);
+    }
+  }
+  else if (e->key() == Qt::Key_Minus) {
+    if (isHierarchical()) {
+      collapse(current);
+    }
+  }
+
+  QAbstractItemView::keyPressEvent(e);
+}
+
+void
+CQModelView::
+leaveEvent(QEvent *)
+{
+  mouseData_.reset();
+
+  redraw();
+}
+
+void
+CQModelView::
+contextMenuEvent(QContextMenuEvent *e)
+{
+  mouseData_.menuData.pos = e->pos();
+
+  cellPositionToIndex(mouseData_.menuData);
+
+  showMenu(e->globalPos());
+}
+
+void
+CQModelView::
+showMenu(const QPoint &pos)
+{
+  updateVisColumns();
+
+  //---
+
+  auto *menu = new QMenu;
+
+  //---
+
+  addMenuActions(menu);
+
+  //---
+
+  (void) menu->exec(pos);
+
+  delete menu;
+}
+
+void
+CQModelView::
+addMenuActions(QMenu *menu)
+{
+  int is = QFontMetrics(font()).height() + 6;
+
+  //---
+
+  int column = mouseData_.menuData.column();
+
+  //---
+
+  auto addMenu = [&](const QString &name) {
+    auto *subMenu = new QMenu(name);
+
+    menu->addMenu(subMenu);
+
+    return subMenu;
+  };
+
+  auto addAction = [&](QMenu *menu, const QString &name, const char *slotName=nullptr) {
+    auto *action = menu->addAction(name);
+
+    if (slotName)
+      connect(action, SIGNAL(triggered()), this, slotName);
+
+    return action;
+  };
+
+  auto addCheckedAction = [&](QMenu *menu, const QString &name, bool checked,
+                              const char *slotName=nullptr) {
+    auto *action = menu->addAction(name);
+
+    action->setCheckable(true);
+    action->setChecked  (checked);
+
+    if (slotName)
+      connect(action, SIGNAL(triggered(bool)), this, slotName);
 
     return action;
   };
 
-  auto addCheckedAction = [&](QMenu *menu, const QString &name, bool checked,
-                              const char *slotName=nullptr) {
-    auto *action = menu->addAction(name);
+  auto addActionGroup = [&](QMenu *menu, const char *slotName) {
+    auto *actionGroup = new QActionGroup(menu);
+
+    connect(actionGroup, SIGNAL(triggered(QAction *)), this, slotName);
+
+    return actionGroup;
+  };
+
+  //---
+
+  auto *optionMenu = addMenu("Options");
+
+  addCheckedAction(optionMenu, "Alternating Row Colors", alternatingRowColors(),
+                   SLOT(alternatingRowColorsSlot(bool)));
+
+  addCheckedAction(optionMenu, "Freeze First Column", isFreezeFirstColumn(),
+                   SLOT(freezeFirstColumnSlot(bool)));
+  addCheckedAction(optionMenu, "Stretch Last Column", isStretchLastColumn(),
+                   SLOT(stretchLastColumnSlot(bool)));
+  addCheckedAction(optionMenu, "Multi Header Lines", isMultiHeaderLines(),
+                   SLOT(multiHeaderLinesSlot(bool)));
+
+  if (isHierarchical())
+    addCheckedAction(optionMenu, "Root Is Decorated", rootIsDecorated(),
+                     SLOT(rootIsDecoratedSlot(bool)));
+
+  addCheckedAction(optionMenu, "Grid", isShowGrid(),
+                   SLOT(showGridSlot(bool)));
+
+  //---
+
+  auto *horizontalMenu = addMenu("Horizontal Header");
+
+  addCheckedAction(horizontalMenu, "Bottom", isHeaderOnBottom(),
+                   SLOT(setHeaderOnBottomSlot(bool)));
+
+  //---
+
+  auto *verticalMenu = addMenu("Vertical Header");
+
+  addCheckedAction(verticalMenu, "Visible", isShowVerticalHeader(),
+                   SLOT(showVerticalHeaderSlot(bool)));
+  addCheckedAction(verticalMenu, "Text"      , (verticalType() == VerticalType::TEXT),
+                   SLOT(showVerticalTextSlot(bool)));
+  addCheckedAction(verticalMenu, "Row Number", (verticalType() == VerticalType::NUMBER),
+                   SLOT(showVerticalNumberSlot(bool)));
+  addCheckedAction(verticalMenu, "Empty"     , (verticalType() == VerticalType::EMPTY),
+                   SLOT(showVerticalEmptySlot(bool)));
+  addCheckedAction(verticalMenu, "Right"     , isHeaderOnRight(),
+                   SLOT(setHeaderOnRightSlot(bool)));
+
+  //---
+
+  auto *sortMenu = addMenu("Sort");
+
+  addCheckedAction(sortMenu, "Enabled", isSortingEnabled(),
+                   SLOT(sortingEnabledSlot(bool)));
+  addCheckedAction(sortMenu, "View Sort", isViewSort(),
+                   SLOT(viewSortSlot(bool)));
+
+  if (column >= 0) {
+    bool isCurrent = (isSortingEnabled() && column == hh_->sortIndicatorSection());
+
+    bool isAscending  = (isCurrent && hh_->sortIndicatorOrder() == Qt::AscendingOrder );
+    bool isDescending = (isCurrent && hh_->sortIndicatorOrder() == Qt::DescendingOrder);
+
+    addCheckedAction(sortMenu, "Increasing", isAscending, SLOT(sortIncreasingSlot()))->
+      setIcon(QIcon(QPixmap::fromImage(SORT_AZ_SVG().image(is, is))));
+
+    addCheckedAction(sortMenu, "Decreasing", isDescending, SLOT(sortDecreasingSlot()))->
+      setIcon(QIcon(QPixmap::fromImage(SORT_ZA_SVG().image(is, is))));
+  }
+
+  //---
+
+  auto *selectMenu = addMenu("Select");
+
+  auto *selectActionGroup = addActionGroup(selectMenu, SLOT(selectionBehaviorSlot(QAction *)));
+
+  selectActionGroup->addAction(
+    addCheckedAction(selectMenu, "Items"  , selectionBehavior() == SelectItems  ));
+  selectActionGroup->addAction(
+    addCheckedAction(selectMenu, "Rows"   , selectionBehavior() == SelectRows   ));
+  selectActionGroup->addAction(
+    addCheckedAction(selectMenu, "Columns", selectionBehavior() == SelectColumns));
+
+  selectMenu->addActions(selectActionGroup->actions());
+
+  selectMenu->addSeparator();
+
+  addAction(selectMenu, "Invert Selection", SLOT(invertSelectionSlot()));
+
+  //---
+
+  auto *filterMenu = addMenu("Filter");
+
+  addCheckedAction(filterMenu, "Show Filter", isShowFilter(), SLOT(showFilterSlot(bool)))->
+    setIcon(QIcon(QPixmap::fromImage(FILTER_SVG().image(is, is))));
+
+  if (mouseData_.menuData.calcInd().isValid())
+    addAction(filterMenu, "Filter by Value", SLOT(filterByValueSlot()));
+
+  if (isHierarchical()) {
+    addCheckedAction(filterMenu, "Filter Tree", isFilterTree(), SLOT(filterTreeSlot(bool)));
+    addCheckedAction(filterMenu, "Expand Matches", isFilterExpand(),
+                     SLOT(filterExpandSlot(bool)));
+  }
+
+  //---
+
+  auto *fitMenu = addMenu("Fit");
+
+  addAction(fitMenu, "Fit All Columns", SLOT(fitAllColumnsSlot()))->
+    setIcon(QIcon(QPixmap::fromImage(FIT_ALL_COLUMNS_SVG().image(is, is))));
+
+  if (column >= 0) {
+    addAction(fitMenu, "Fit Column", SLOT(fitColumnSlot()))->
+      setIcon(QIcon(QPixmap::fromImage(FIT_COLUMN_SVG().image(is, is))));
+  }
+
+  addAction(fitMenu, "Fit No Scroll", SLOT(fitNoScrollSlot()));
+
+  //--
+
+  auto *showHideMenu = addMenu("Show/Hide");
+
+  addAction(showHideMenu, "Hide Column", SLOT(hideColumnSlot()));
+
+  if (nvc_ != nc_)
+    addAction(showHideMenu, "Show All Columns", SLOT(showAllColumnsSlot()));
+
+  //--
+
+  if (isHierarchical()) {
+    auto *expandCollapseMenu = addMenu("Expand/Collapse");
+
+    if (mouseData_.menuData.calcInd().isValid()) {
+      bool expanded = isExpanded(mouseData_.menuData.calcInd());
+
+      if (expanded)
+        addAction(expandCollapseMenu, "Collapse", SLOT(collapseSlot()));
+      else
+        addAction(expandCollapseMenu, "Expand", SLOT(expandSlot()));
+    }
+
+    addAction(expandCollapseMenu, "Expand All"  , SLOT(expandAll()));
+    addAction(expandCollapseMenu, "Collapse All", SLOT(collapseAll()));
+  }
+
+  //---
+
+  if (column >= 0) {
+    auto *delegate  = itemDelegate();
+    auto *idelegate = qobject_cast<CQItemDelegate *>(delegate);
+
+    if (idelegate && idelegate->isNumericColumn(column)) {
+      auto *decorationMenu = addMenu("Decoration");
+
+      const ColumnData &columnData = columnDatas_[uint(column)];
+
+      addCheckedAction(decorationMenu, "Show Heatmap", columnData.heatmap,
+                       SLOT(setHeatmapSlot(bool)));
+    }
+  }
+
+  //---
+
+  if (isHierarchical()) {
+    auto *rootMenu = addMenu("Root");
+
+    addAction(rootMenu, "Set Root", SLOT(setRootSlot()));
+
+    if (rootIndex() != QModelIndex())
+      addAction(rootMenu, "Reset Root", SLOT(resetRootSlot()));
+  }
+}
+
+void
+CQModelView::
+redraw()
+{
+  redraw(viewport()->rect());
+}
+
+// pixels of last paint can be scrolled if only scroll position changed since
+bool
+CQModelView::
+canScrollBlit() const
+{
+  return ! (state_.updateScrollBars || state_.updateRowDatas   || state_.updateVisRows  ||
+            state_.updateColumnOffs || state_.updateVisColumns || state_.updateVisCells ||
+            state_.updateGeometries);
+}
+
+// scroll cells and matching header by pixel shift so only exposed strip is repainted
+// (frozen column area is not scrolled horizontally)
+void
+CQModelView::
+scrollBlit(int dx, int dy)
+{
+  ++numRedraws_;
+
+  if (dx != 0) {
+    int fw = std::max(freezeWidth_, 0);
+
+    auto vrect = viewport()->rect();
+    auto hrect = hh_->viewport()->rect();
+
+    viewport()->scroll(dx, 0, QRect(fw, 0, vrect.width() - fw, vrect.height()));
+
+    hh_->viewport()->scroll(dx, 0, QRect(fw, 0, hrect.width() - fw, hrect.height()));
+  }
+
+  if (dy != 0) {
+    viewport()->scroll(0, dy);
+
+    vh_->viewport()->scroll(0, dy);
+  }
+}
+
+void
+CQModelView::
+redraw(const QRect &rect)
+{
+  ++numRedraws_;
+
+  // draw horizontal header (for widths)
+  hh_->redraw();
+
+  // draw vertical header (for alternate)
+  vh_->redraw();
+
+  // draw cells
+  viewport()->update(rect);
+  update(rect);
+}
+
+void
+CQModelView::
+alternatingRowColorsSlot(bool b)
+{
+  setAlternatingRowColors(b);
+
+  redraw();
+}
+
+void
+CQModelView::
+freezeFirstColumnSlot(bool b)
+{
+  setFreezeFirstColumn(b);
+}
+
+void
+CQModelView::
+stretchLastColumnSlot(bool b)
+{
+  setStretchLastColumn(b);
+
+  state_.updateVisColumns = true;
+  state_.updateVisCells   = true;
+
+  redraw();
+}
+
+void
+CQModelView::
+multiHeaderLinesSlot(bool b)
+{
+  setMultiHeaderLines(b);
+}
+
+void
+CQModelView::
+rootIsDecoratedSlot(bool b)
+{
+  setRootIsDecorated(b);
+}
+
+void
+CQModelView::
+showGridSlot(bool b)
+{
+  setShowGrid(b);
+}
+
+void
+CQModelView::
+sortingEnabledSlot(bool b)
+{
+  setSortingEnabled(b);
+}
+
+void
+CQModelView::
+sortIncreasingSlot()
+{
+  if (! isSortingEnabled())
+    setSortingEnabled(true);
+
+  sortByColumn(mouseData_.menuData.column(), Qt::AscendingOrder);
+}
+
+void
+CQModelView::
+sortDecreasingSlot()
+{
+  if (! isSortingEnabled())
+    setSortingEnabled(true);
+
+  sortByColumn(mouseData_.menuData.column(), Qt::DescendingOrder);
+}
+
+void
+CQModelView::
+selectionBehaviorSlot(QAction *action)
+{
+  if      (action->text() == "Items")
+    setSelectionBehavior(SelectItems);
+  else if (action->text() == "Rows")
+    setSelectionBehavior(SelectRows);
+  else if (action->text() == "Columns")
+    setSelectionBehavior(SelectColumns);
+  else
+    assert(false);
+}
+
+//---
+
+void
+CQModelView::
+setHeaderOnBottomSlot(bool b)
+{
+  setHeaderOnBottom(b);
+}
+
+void
+CQModelView::
+setHeaderOnRightSlot(bool b)
+{
+  setHeaderOnRight(b);
+}
+
+//------
+
+void
+CQModelView::
+hideColumnSlot()
+{
+  hideColumn(mouseData_.menuData.column());
+}
+
+void
+CQModelView::
+showAllColumnsSlot()
+{
+  for (int c = 0; c < nc_; ++c)
+    showColumn(c);
+
+  redraw();
+}
+
+void
+CQModelView::
+hideColumn(int column)
+{
+  hh_->hideSection(column);
+
+  //---
+
+  state_.updateLayout();
+
+  emit stateChanged();
+
+  //---
+
+  redraw();
+}
+
+void
+CQModelView::
+showColumn(int column)
+{
+  hh_->showSection(column);
+
+  //---
+
+  state_.updateLayout();
+
+  emit stateChanged();
+
+  //---
+
+  redraw();
+}
+
+bool
+CQModelView::
+isColumnHidden(int column) const
+{
+  return hh_->isSectionHidden(column);
+}
+
+void
+CQModelView::
+setColumnHidden(int column, bool hide)
+{
+  if (column < 0 || column >= nc_)
+    return;
+
+  hh_->setSectionHidden(column, hide);
+
+  //---
+
+  state_.updateLayout();
+
+  emit stateChanged();
+
+  //---
+
+  redraw();
+}
+
+//------
+
+void
+CQModelView::
+hideRow(int row)
+{
+  setRowHidden(row, rootIndex(), true);
+}
+
+void
+CQModelView::
+showRow(int row)
+{
+  setRowHidden(row, rootIndex(), false);
+}
+
+bool
+CQModelView::
+isRowHidden(int row, const QModelIndex &parent) const
+{
+  return hiddenRows_->isHidden(parent, row);
+}
+
+void
+CQModelView::
+setRowHidden(int row, const QModelIndex &parent, bool hide)
+{
+  if (! model_)
+    return;
+
+  int nr = model_->rowCount(parent);
+
+  if (row < 0 || row >= nr)
+    return;
+
+  if (userHiddenRows_->isHidden(parent, row) == hide)
+    return;
+
+  userHiddenRows_->setHidden(parent, nr, row, hide);
+
+  // row also hidden if hidden by filter
+  bool hidden = (hide || filterHiddenRows_->isHidden(parent, row));
+
+  if (hiddenRows_->isHidden(parent, row) == hidden)
+    return;
+
+  hiddenRows_->setHidden(parent, nr, row, hidden);
+
+  updateHiddenRows(parent, row, row);
+
+  //--
+
+  redraw();
+
+  emit stateChanged();
+}
+
+void
+CQModelView::
+setRowsHidden(const QModelIndex &parent, const std::vector<bool> &hidden)
+{
+  if (! model_)
+    return;
+
+  int nr = model_->rowCount(parent);
+
+  CRankBitset rows;
+
+  rows.assign(hidden);
+
+  rows.resize(nr);
+
+  userHiddenRows_->setRows(parent, rows);
+
+  unionHiddenRows(parent);
+}
+
+// update hidden rows of parent from rows hidden by user or filter
+void
+CQModelView::
+unionHiddenRows(const QModelIndex &parent)
+{
+  if (! model_)
+    return;
+
+  int nr = model_->rowCount(parent);
+
+  CRankBitset rows;
+
+  const auto *userRows   = userHiddenRows_  ->rows(parent);
+  const auto *filterRows = filterHiddenRows_->rows(parent);
+
+  if (userRows)
+    rows = *userRows;
+
+  if (filterRows)
+    rows |= *filterRows;
+
+  rows.resize(nr);
+
+  const auto *oldRows = hiddenRows_->rows(parent);
+
+  if (oldRows ? (*oldRows == rows) : rows.none())
+    return;
+
+  hiddenRows_->setRows(parent, rows);
+
+  updateHiddenRows(parent, 0, nr - 1);
+
+  //--
+
+  redraw();
+
+  emit stateChanged();
+}
+
+// set hidden rows of all parents from rows hidden by user or filter (nodes must be
+// rebuilt)
+void
+CQModelView::
+unionHiddenRows()
+{
+  *hiddenRows_ = *userHiddenRows_;
+
+  hiddenRows_->unite(*filterHiddenRows_);
+}
+
+int
+CQModelView::
+numVisibleRows(const QModelIndex &parent, int row) const
+{
+  if (! model_)
+    return 0;
+
+  int nr = model_->rowCount(parent);
+
+  if (row < 0 || row > nr)
+    row = nr;
+
+  const auto *hidden = hiddenRows_->rows(parent);
+
+  if (! hidden)
+    return row;
+
+  return row - hidden->rank(std::min(row, hidden->size()));
+}
+
+//------
+
+void
+CQModelView::
+expand(const QModelIndex &index)
+{
+  if (isIndexExpanded(index))
+    return;
+
+  // build parent node for old expanded state
+  if (model_ && ! state_.updateRowDatas)
+    (void) findExpandNode(index.parent());
+
+  expanded_.insert(index);
+
+  expandedChanged();
+
+  if (model_ && model_->canFetchMore(index))
+    model_->fetchMore(index);
+
+  //---
+
+  // add children to flat rows
+  expandRowDatas(index, true);
+
+  emit expanded(index);
+
+  emit stateChanged();
+}
+
+void
+CQModelView::
+collapse(const QModelIndex &index)
+{
+  if (! isIndexExpanded(index))
+    return;
+
+  // build parent node for old expanded state
+  if (model_ && ! state_.updateRowDatas)
+    (void) findExpandNode(index.parent());
+
+  auto p = expanded_.find(index);
+
+  if (p != expanded_.end())
+    expanded_.erase(p);
+
+  expandedChanged();
+
+  //---
+
+  // remove descendants from flat rows
+  expandRowDatas(index, false);
+
+  emit collapsed(index);
+
+  emit stateChanged();
+}
+
+// add index expanded node (expand) or remove index expanded node (collapse),
+// returns false if index is not laid out (no visible change)
+bool
+CQModelView::
+expandRowDatas(const QModelIndex &index, bool expand)
+{
+  // full update pending
+  if (! model_ || ! rootNode_ || state_.updateRowDatas) {
+    redraw();
+    return true;
+  }
+
+  auto *node = findExpandNode(index.parent());
+  if (! node) return false;
+
+  int r = index.row();
+
+  if (r >= node->numRows() || ! node->rowFlatRows(r))
+    return false;
+
+  auto pc = node->children.find(r);
+
+  if (expand) {
+    if (pc != node->children.end() || ! model_->hasChildren(index))
+      return false;
+
+    auto *child = createExpandNode(index, node, r, node->depth + 1, expandedRows());
+
+    node->children[r] = child;
+
+    addExpandNodeFlatRows(node, r, child->numFlatRows());
+  }
+  else {
+    if (pc == node->children.end())
+      return false;
+
+    int n = (*pc).second->numFlatRows();
+
+    delete (*pc).second;
+
+    node->children.erase(pc);
+
+    addExpandNodeFlatRows(node, r, -n);
+  }
+
+  //---
+
+  rowDatasChanged();
+
+  redrawFlatRows(indexFlatRow(index));
+
+  return true;
+}
+
+// redraw cells of flat rows [flatRow1, flatRow2) (if visible), rows are positioned from
+// bottom when scrolled to end
+void
+CQModelView::
+redrawFlatRowRange(int flatRow1, int flatRow2)
+{
+  auto rect = viewport()->rect();
+
+  int rh = rowHeight(0);
+
+  int y = 0;
+
+  if (vs_->isVisible() && vs_->value() == vs_->maximum())
+    y = -(nvr_*rh - rect.height());
+  else
+    y = -verticalOffset()*rh;
+
+  int y1 = y + flatRow1*rh;
+  int y2 = y + flatRow2*rh;
+
+  rect = rect.intersected(QRect(rect.left(), y1, rect.width(), y2 - y1 + 1));
+
+  if (rect.isValid()) {
+    viewport()->update(rect);
+    update(rect);
+  }
+}
+
+// redraw from flat row to bottom of view
+void
+CQModelView::
+redrawFlatRows(int flatRow)
+{
+  // find current position of flat row (if visible), rows are positioned
+  // from bottom when scrolled to end so all rows move
+  auto rect = viewport()->rect();
+
+  bool atEnd = (vs_->isVisible() && vs_->value() == vs_->maximum());
+
+  if (! atEnd && ! visFlatRows_.empty() && flatRow >= visFlatRows_.front()) {
+    // below visible rows
+    if (flatRow > visFlatRows_.back())
+      rect = QRect();
+    else {
+      int y = rect.top() + (flatRow - verticalOffset())*rowHeight(0);
+
+      if (y > rect.top())
+        rect.setTop(y);
+    }
+  }
+
+  ++numRedraws_;
+
+  // scrollbars and headers
+  hh_->redraw();
+  vh_->redraw();
+
+  if (rect.isValid()) {
+    viewport()->update(rect);
+    update(rect);
+  }
+}
+
+bool
+CQModelView::
+isExpanded(const QModelIndex &index) const
+{
+  if (! model_) return false;
+
+  assert(index.model() == model());
+
+  return isIndexExpanded(index);
+}
+
+void
+CQModelView::
+setExpanded(const QModelIndex &index, bool expanded)
+{
+  if (! model_) return;
+
+  assert(index.model() == model());
+
+  if (expanded) {
+    if (index.parent().isValid() && ! isExpanded(index.parent()))
+      expand(index.parent());
+
+    expand(index);
+  }
+  else
+    collapse(index);
+}
+
+void
+CQModelView::
+expandAll()
+{
+  if (! model_) return;
+
+  // add all rows with children to expanded state and count nodes (nodes are built
+  // when displayed)
+  auto oldExpanded = expanded_;
+
+  addExpandedRows(rootIndex());
+
+  expandedChanged();
+
+  state_.updateAll();
+
+  updateRowDatas();
+
+  //---
+
+  for (const auto &index : expanded_) {
+    if (oldExpanded.find(index) == oldExpanded.end())
+      emit expanded(index);
+  }
+
+  emit stateChanged();
+
+  //---
+
+  redraw();
+}
+
+void
+CQModelView::
+collapseAll()
+{
+  auto inds = expanded_;
+
+  expanded_.clear();
+
+  expandedChanged();
+
+  //---
+
+  state_.updateAll();
+
+  for (const auto &index : inds)
+    emit collapsed(index);
+
+  emit stateChanged();
+
+  //---
+
+  redraw();
+}
+
+void
+CQModelView::
+expandToDepth(int /*depth*/)
+{
+  // TODO:
+  assert(false);
+}
+
+bool
+CQModelView::
+isIndexExpanded(const QModelIndex &index) const
+{
+  if (expanded_.empty())
+    return false;
+
+  auto p = expanded_.find(index);
+
+  return (p != expanded_.end());
+}
+
+void
+CQModelView::
+expandSlot()
+{
+  expand(mouseData_.menuData.calcInd());
+}
+
+void
+CQModelView::
+collapseSlot()
+{
+  collapse(mouseData_.menuData.calcInd());
+}
+
+void
+CQModelView::
+expandedIndices(QModelIndexList &inds) const
+{
+  for (auto &ind : expanded_)
+    inds.push_back(ind);
+}
+
+//------
+
+void
+CQModelView::
+setRootSlot()
+{
+  setRootIndex(mouseData_.menuData.calcInd());
+}
+
+void
+CQModelView::
+resetRootSlot()
+{
+  setRootIndex(QModelIndex());
+}
+
+//------
+
+void
+CQModelView::
+showVerticalHeaderSlot(bool b)
+{
+  setShowVerticalHeader(b);
+}
+
+void
+CQModelView::
+showVerticalTextSlot(bool b)
+{
+  setVerticalType(b ? VerticalType::TEXT : verticalType());
+}
+
+void
+CQModelView::
+showVerticalNumberSlot(bool b)
+{
+  setVerticalType(b ? VerticalType::NUMBER : VerticalType::TEXT);
+}
+
+void
+CQModelView::
+showVerticalEmptySlot(bool b)
+{
+  setVerticalType(b ? VerticalType::EMPTY : VerticalType::TEXT);
+}
+
+void
+CQModelView::
+showFilterSlot(bool b)
+{
+  setShowFilter(b);
+}
+
+void
+CQModelView::
+filterTreeSlot(bool b)
+{
+  setFilterTree(b);
+}
+
+void
+CQModelView::
+filterExpandSlot(bool b)
+{
+  setFilterExpand(b);
+}
+
+void
+CQModelView::
+viewSortSlot(bool b)
+{
+  setViewSort(b);
+}
+
+void
+CQModelView::
+filterByValueSlot()
+{
+  if (! isShowFilter())
+    setShowFilter(true);
 
-    action->setCheckable(true);
-    action->setChecked  (checked);
+  auto ind = mouseData_.menuData.calcInd();
 
-    if (slotName)
-      connect(action, SIGNAL(triggered(bool)), this, slotName);
+  if (ind.isValid()) {
+    auto str = model_->data(ind, Qt::DisplayRole).toString();
+
+    auto *le = filterEdits_[uint(ind.column())];
+
+    le->setText(str);
+
+    applyFilters();
+  }
+}
+
+//------
+
+void
+CQModelView::
+fitAllColumnsSlot()
+{
+  for (int c = 0; c < nc_; ++c)
+    resizeColumnToContents(c);
+
+  redraw();
+}
+
+void
+CQModelView::
+fitColumnSlot()
+{
+  resizeColumnToContents(mouseData_.menuData.column());
+
+  redraw();
+}
+
+void
+CQModelView::
+fitNoScrollSlot()
+{
+  int vw = viewport()->rect().width();
+
+  int w = (nc_ > 0 ? vw/nc_ : 0);
+
+  for (int c = 0; c < nc_; ++c)
+    setColumnWidth(c, w);
+
+  redraw();
+}
+
+void
+CQModelView::
+resizeColumnToContents(int column)
+{
+  assert(column >= 0);
+
+  int maxWidth = 0;
+
+  //---
+
+  // TODO: SizeHintRole
+
+  auto data = model_->headerData(column, Qt::Horizontal, Qt::DisplayRole);
+
+  auto str = data.toString();
+
+  int w = 0;
+
+  if (isMultiHeaderLines()) {
+    auto strs = str.split(QRegExp("\n|\r\n|\r"));
+
+    for (int i = 0; i < strs.length(); ++i)
+      w = std::max(w, paintData_.fm.horizontalAdvance(strs[i]));
+  }
+  else
+    w = std::max(w, paintData_.fm.horizontalAdvance(str));
+
+  maxWidth = std::max(maxWidth, w);
+
+  //---
+
+  int margin = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
+  int ispace = 4;
+
+  maxWidth += 2*margin + 2*ispace;
+
+  if (hh_->isSortIndicatorShown())
+    maxWidth += paintData_.fm.height() + margin;
+
+  //---
+
+  int maxRows = hh_->resizeContentsPrecision();
+
+  int nvr = 0;
+
+  auto parent = rootIndex();
+
+  int dataMaxWidth = 0;
+
+  maxColumnWidth(column, parent, 0, nvr, dataMaxWidth, maxRows);
+
+  dataMaxWidth += 2*margin + 2*ispace;
+
+  maxWidth = std::max(maxWidth, dataMaxWidth);
+
+  //---
+
+  ColumnData &columnData = columnDatas_[uint(column)];
+
+  columnData.width = std::max(maxWidth, 16);
+
+  hh_->resizeSection(column, columnData.width);
+
+  //---
+
+  state_.updateLayout();
+
+  redraw();
+
+  emit stateChanged();
+}
+
+bool
+CQModelView::
+maxColumnWidth(int column, const QModelIndex &parent, int depth,
+               int &nvr, int &maxWidth, int maxRows)
+{
+  auto *delegate = itemDelegate();
+
+  //---
+
+  // init style data
+  QStyleOptionViewItem option;
+
+  if (delegate) {
+    option.init(this);
+
+    option.state    &= ~QStyle::State_MouseOver;
+    option.state    &= ~QStyle::State_HasFocus;
+    option.features &= ~QStyleOptionViewItem::Alternate;
+
+    option.widget              = this;
+    option.rect                = QRect(0, 0, 100, paintData_.rowHeight);
+    option.font                = font();
+    option.fontMetrics         = QFontMetrics(option.font);
+    option.decorationSize      = paintData_.decorationSize;
+    option.decorationPosition  = QStyleOptionViewItem::Left;
+    option.decorationAlignment = Qt::AlignCenter;
+    option.displayAlignment    = Qt::AlignHCenter | Qt::AlignVCenter;
+    option.textElideMode       = textElideMode();
+  }
+
+  //---
+
+  if (model_ && model_->canFetchMore(parent))
+    model_->fetchMore(parent);
+
+  int nr = model_->rowCount(parent);
+
+  for (int r = 0; r < nr; ++r) {
+    if (isRowHidden(r, parent))
+      continue;
+
+    // TODO: SizeHintRole and delegate sizeHint
+
+    auto ind = model_->index(r, column, parent);
+
+    //---
+
+    int  w       = 0;
+    bool useData = true;
+
+    if (delegate) {
+      auto size = delegate->sizeHint(option, ind);
+
+      if (size.isValid()) {
+        w       = size.width();
+        useData = false;
+      }
+    }
+
+    //---
+
+    if (useData) {
+      // get cell data
+      auto data = model_->data(ind, Qt::DisplayRole);
+
+    //---
+
+      // get max string width
+#if 1
+      auto strs = data.toString().split("\n");
+
+      int nl = strs.length();
+
+      for (int i = 0; i < nl; ++i) {
+        const auto &str = strs[i];
+
+        w = std::max(w, paintData_.fm.horizontalAdvance(str));
+      }
+#else
+      w = paintData_.fm.horizontalAdvance(data.toString());
+#endif
+    }
+
+    //---
+
+    // add hierarchical depth indent
+    if (isHierarchical() && column == 0)
+      w += (depth + rootIsDecorated())*indentation();
+
+    //---
+
+    // update max width
+    maxWidth = std::max(maxWidth, w);
+
+    //---
+
+    // update rows and stop if max
+    ++nvr;
+
+    if (nvr > maxRows)
+      return false;
+
+    //---
+
+    // check expanded parent
+    auto ind1 = model_->index(r, 0, parent);
+
+    if (model_->hasChildren(ind1) && isExpanded(ind1)) {
+      if (! maxColumnWidth(column, ind1, depth + 1, nvr, maxWidth, maxRows))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+//------
+
+void
+CQModelView::
+setHeatmapSlot(bool b)
+{
+  ColumnData &columnData = columnDatas_[uint(mouseData_.menuData.column())];
 
-    return action;
-  };
+  columnData.heatmap = b;
 
-  auto addActionGroup = [&](QMenu *menu, const char *slotName) {
-    auto *actionGroup = new QActionGroup(menu);
+  redraw();
+}
 
-    connect(actionGroup, SIGNAL(triggered(QAction *)), this, slotName);
+//------
 
-    return actionGroup;
-  };
+QRect
+CQModelView::
+visualRect(const QModelIndex &ind) const
+{
+  const_cast<CQModelView*>(this)->updateVisCells();
 
   //---
 
-  auto *optionMenu = addMenu("Options");
-
-  addCheckedAction(optionMenu, "Alternating Row Colors", alternatingRowColors(),
-                   SLOT(alternatingRowColorsSlot(bool)));
+  int slot = visCellSlots_->find(ind);
 
-  addCheckedAction(optionMenu, "Freeze First Column", isFreezeFirstColumn(),
-                   SLOT(freezeFirstColumnSlot(bool)));
-  addCheckedAction(optionMenu, "Stretch Last Column", isStretchLastColumn(),
-                   SLOT(stretchLastColumnSlot(bool)));
-  addCheckedAction(optionMenu, "Multi Header Lines", isMultiHeaderLines(),
-                   SLOT(multiHeaderLinesSlot(bool)));
+  if (slot >= 0)
+    return visCellDatas_[uint(slot)].rect;
 
-  if (isHierarchical())
-    addCheckedAction(optionMenu, "Root Is Decorated", rootIsDecorated(),
-                     SLOT(rootIsDecoratedSlot(bool)));
+  return QRect();
+}
 
-  addCheckedAction(optionMenu, "Grid", isShowGrid(),
-                   SLOT(showGridSlot(bool)));
+void
+CQModelView::
+scrollTo(const QModelIndex &index, ScrollHint)
+{
+  if (! index.isValid())
+    return;
 
-  //---
+  updateVisRows();
 
-  auto *horizontalMenu = addMenu("Horizontal Header");
+  int flatRow = indexFlatRow(index);
+  if (flatRow < 0) return;
 
-  addCheckedAction(horizontalMenu, "Bottom", isHeaderOnBottom(),
-                   SLOT(setHeaderOnBottomSlot(bool)));
+  int rowHeight = this->rowHeight(0);
 
-  //---
+  int y1 = visRowsY_ + flatRow*rowHeight;
+  int y2 = y1 + rowHeight;
 
-  auto *verticalMenu = addMenu("Vertical Header");
+  int vh = viewport()->geometry().height();
 
-  addCheckedAction(verticalMenu, "Visible", isShowVerticalHeader(),
-                   SLOT(showVerticalHeaderSlot(bool)));
-  addCheckedAction(verticalMenu, "Text"      , (verticalType() == VerticalType::TEXT),
-                   SLOT(showVerticalTextSlot(bool)));
-  addCheckedAction(verticalMenu, "Row Number", (verticalType() == VerticalType::NUMBER),
-                   SLOT(showVerticalNumberSlot(bool)));
-  addCheckedAction(verticalMenu, "Empty"     , (verticalType() == VerticalType::EMPTY),
-                   SLOT(showVerticalEmptySlot(bool)));
-  addCheckedAction(verticalMenu, "Right"     , isHeaderOnRight(),
-                   SLOT(setHeaderOnRightSlot(bool)));
+  bool visible = (y2 > 0 && y1 <= vh);
 
-  //---
+  if (visible)
+    return;
 
-  auto *sortMenu = addMenu("Sort");
+  int ys;
 
-  addCheckedAction(sortMenu, "Enabled", isSortingEnabled(),
-                   SLOT(sortingEnabledSlot(bool)));
+  if (y2 <= 0)
+    ys = flatRow;
+  else
+    ys = flatRow - scrollData_.nv + 1;
 
-  if (column >= 0) {
-    bool isCurrent = (isSortingEnabled() && column == hh_->sortIndicatorSection());
+  vs_->setValue(std::min(std::max(ys, vs_->minimum()), vs_->maximum()));
 
-    bool isAscending  = (isCurrent && hh_->sortIndicatorOrder() == Qt::AscendingOrder );
-    bool isDescending = (isCurrent && hh_->sortIndicatorOrder() == Qt::DescendingOrder);
+  redraw();
+}
 
-    addCheckedAction(sortMenu, "Increasing", isAscending, SLOT(sortIncreasingSlot()))->
-      setIcon(QIcon(QPixmap::fromImage(SORT_AZ_SVG().image(is, is))));
+QModelIndex
+CQModelView::
+indexAt(const QPoint &p) const
+{
+  PositionData posData;
 
-    addCheckedAction(sortMenu, "Decreasing", isDescending, SLOT(sortDecreasingSlot()))->
-      setIcon(QIcon(QPixmap::fromImage(SORT_ZA_SVG().image(is, is))));
-  }
+  posData.pos = p;
 
-  //---
+  cellPositionToIndex(posData);
 
-  auto *selectMenu = addMenu("Select");
+  return posData.ind;
+}
 
-  auto *selectActionGroup = addActionGroup(selectMenu, SLOT(selectionBehaviorSlot(QAction *)));
+QModelIndex
+CQModelView::
+moveCursor(CursorAction action, Qt::KeyboardModifiers modifiers)
+{
+  Q_UNUSED(modifiers);
 
-  selectActionGroup->addAction(
-    addCheckedAction(selectMenu, "Items"  , selectionBehavior() == SelectItems  ));
-  selectActionGroup->addAction(
-    addCheckedAction(selectMenu, "Rows"   , selectionBehavior() == SelectRows   ));
-  selectActionGroup->addAction(
-    addCheckedAction(selectMenu, "Columns", selectionBehavior() == SelectColumns));
+  auto current = currentIndex();
 
-  selectMenu->addActions(selectActionGroup->actions());
+  if (! current.isValid())
+    return QModelIndex();
 
   //---
 
-  auto *filterMenu = addMenu("Filter");
+  updateVisColumns();
+  updateVisRows   ();
 
-  addCheckedAction(filterMenu, "Show Filter", isShowFilter(), SLOT(showFilterSlot(bool)))->
-    setIcon(QIcon(QPixmap::fromImage(FILTER_SVG().image(is, is))));
+  //---
 
-  if (mouseData_.menuData.calcInd().isValid())
-    addAction(filterMenu, "Filter by Value", SLOT(filterByValueSlot()));
+  int  r      = current.row   ();
+  int  c      = current.column();
+  auto parent = current.parent();
 
   //---
 
-  auto *fitMenu = addMenu("Fit");
-
-  addAction(fitMenu, "Fit All Columns", SLOT(fitAllColumnsSlot()))->
-    setIcon(QIcon(QPixmap::fromImage(FIT_ALL_COLUMNS_SVG().image(is, is))));
+  auto prevRow = [&](int r, int c, const QModelIndex &parent) {
+    int flatRow = indexFlatRow(model_->index(r, 0, parent));
+    if (flatRow < 0) return QModelIndex();
 
-  if (column >= 0) {
-    addAction(fitMenu, "Fit Column", SLOT(fitColumnSlot()))->
-      setIcon(QIcon(QPixmap::fromImage(FIT_COLUMN_SVG().image(is, is))));
-  }
+    if (flatRow == 0)
+      return model_->index(r, c, parent);
 
-  addAction(fitMenu, "Fit No Scroll", SLOT(fitNoScrollSlot()));
+    return flatRowIndex(flatRow - 1, c);
+  };
 
-  //--
+  auto nextRow = [&](int r, int c, const QModelIndex &parent) {
+    int flatRow = indexFlatRow(model_->index(r, 0, parent));
+    if (flatRow < 0) return QModelIndex();
 
-  auto *showHideMenu = addMenu("Show/Hide");
+    if (flatRow == nvr_ - 1)
+      return model_->index(r, c, parent);
 
-  addAction(showHideMenu, "Hide Column", SLOT(hideColumnSlot()));
+    return flatRowIndex(flatRow + 1, c);
+  };
 
-  if (int(visColumnDatas_.size()) != nc_)
-    addAction(showHideMenu, "Show All Columns", SLOT(showAllColumnsSlot()));
+  //---
 
-  //--
+  auto prevCol = [&](int r, int c, const QModelIndex &parent) {
+    if (c == 0 && isHierarchical()) {
+      if (currentFlatRow_ >= 0 && currentFlatRow_ < nvr_) {
+        auto rowData = flatRowData(currentFlatRow_);
 
-  if (isHierarchical()) {
-    auto *expandCollapseMenu = addMenu("Expand/Collapse");
+        if (rowData.children && rowData.expanded) {
+          auto ind = model_->index(r, c, parent);
 
-    if (mouseData_.menuData.calcInd().isValid()) {
-      bool expanded = isExpanded(mouseData_.menuData.calcInd());
+          collapse(ind);
 
-      if (expanded)
-        addAction(expandCollapseMenu, "Collapse", SLOT(collapseSlot()));
-      else
-        addAction(expandCollapseMenu, "Expand", SLOT(expandSlot()));
+          return ind;
+        }
+      }
     }
 
-    addAction(expandCollapseMenu, "Expand All"  , SLOT(expandAll()));
-    addAction(expandCollapseMenu, "Collapse All", SLOT(collapseAll()));
-  }
-
-  //---
+    int pc = c - 1;
 
-  if (column >= 0) {
-    auto *delegate  = itemDelegate();
-    auto *idelegate = qobject_cast<CQItemDelegate *>(delegate);
+    while (pc >= 0 && isColumnHidden(pc))
+      --pc;
 
-    if (idelegate && idelegate->isNumericColumn(column)) {
-      auto *decorationMenu = addMenu("Decoration");
+    if (pc < 0)
+      return prevRow(r, (nc_ > 0 ? nc_ - 1 : 0), parent);
 
-      const ColumnData &columnData = columnDatas_[uint(column)];
+    return model_->index(r, pc, parent);
+  };
 
-      addCheckedAction(decorationMenu, "Show Heatmap", columnData.heatmap,
-                       SLOT(setHeatmapSlot(bool)));
-    }
-  }
+  auto nextCol = [&](int r, int c, const QModelIndex &parent) {
+    if (c == 0 && isHierarchical()) {
+      if (currentFlatRow_ >= 0 && currentFlatRow_ < nvr_) {
+        auto rowData = flatRowData(currentFlatRow_);
 
-  //---
+        if (rowData.children && ! rowData.expanded) {
+          auto ind = model_->index(r, c, parent);
 
-  if (isHierarchical()) {
-    auto *rootMenu = addMenu("Root");
+          expand(ind);
 
-    addAction(rootMenu, "Set Root", SLOT(setRootSlot()));
+          return ind;
+        }
+      }
+    }
 
-    if (rootIndex() != QModelIndex())
-      addAction(rootMenu, "Reset Root", SLOT(resetRootSlot()));
-  }
-}
+    int nc = c + 1;
 
-void
-CQModelView::
-redraw()
-{
-  redraw(viewport()->rect());
-}
+    while (nc < nc_ && isColumnHidden(nc))
+      ++nc;
 
-void
-CQModelView::
-redraw(const QRect &rect)
-{
-  ++numRedraws_;
+    if (nc >= nc_)
+      return nextRow(r, 0, parent);
 
-  // draw horizontal header (for widths)
-  hh_->redraw();
+    return model_->index(r, nc, parent);
+  };
 
-  // draw vertical header (for alternate)
-  vh_->redraw();
+  switch (action) {
+    case MoveUp:
+      return prevRow(r, c, parent);
+    case MoveDown:
+      return nextRow(r, c, parent);
+    case MovePrevious:
+    case MoveLeft:
+      return prevCol(r, c, parent);
+    case MoveNext:
+    case MoveRight:
+      return nextCol(r, c, parent);
+    case MoveHome:
+      if (! isFlatRowOrder())
+        return flatRowIndex(0, 0);
 
-  // draw cells
-  viewport()->update(rect);
-  update(rect);
-}
+      return model_->index(0, 0, parent);
+    case MoveEnd:
+      if (! isFlatRowOrder())
+        return flatRowIndex(nvr_ - 1, (nc_ > 0 ? nc_ - 1 : 0));
 
-void
-CQModelView::
-alternatingRowColorsSlot(bool b)
-{
-  setAlternatingRowColors(b);
+      // TODO: ensure valid column
+      return model_->index((nr_ > 0 ? nr_ - 1 : 0), (nc_ > 0 ? nc_ - 1 : 0), parent);
+    case MovePageUp:
+      if (! isFlatRowOrder()) {
+        int flatRow = indexFlatRow(model_->index(r, 0, parent));
+        if (flatRow < 0) return QModelIndex();
 
-  redraw();
-}
+        return flatRowIndex(std::max(flatRow - scrollData_.nv, 0), c);
+      }
 
-void
-CQModelView::
-freezeFirstColumnSlot(bool b)
-{
-  setFreezeFirstColumn(b);
-}
+      return model_->index(std::max(r - scrollData_.nv, 0), c, parent);
+    case MovePageDown:
+      if (! isFlatRowOrder()) {
+        int flatRow = indexFlatRow(model_->index(r, 0, parent));
+        if (flatRow < 0) return QModelIndex();
 
-void
-CQModelView::
-stretchLastColumnSlot(bool b)
-{
-  setStretchLastColumn(b);
+        return flatRowIndex(std::min(flatRow + scrollData_.nv, nvr_ - 1), c);
+      }
 
-  state_.updateVisColumns = true;
-  state_.updateVisCells   = true;
+      return model_->index(std::min(r + scrollData_.nv, nr_ - 1), c, parent);
+  }
 
-  redraw();
+  return QModelIndex();
 }
 
-void
+int
 CQModelView::
-multiHeaderLinesSlot(bool b)
+horizontalOffset() const
 {
-  setMultiHeaderLines(b);
+  return scrollData_.hpos;
 }
 
-void
+int
 CQModelView::
-rootIsDecoratedSlot(bool b)
+verticalOffset() const
 {
-  setRootIsDecorated(b);
+  return scrollData_.vpos;
 }
 
-void
+bool
 CQModelView::
-showGridSlot(bool b)
+isIndexHidden(const QModelIndex &index) const
 {
-  setShowGrid(b);
+  int r = index.row();
+  int c = index.column();
+
+  if (isColumnHidden(c))
+    return true;
+
+  if (isRowHidden(r, index.parent()))
+    return true;
+
+  return false;
 }
 
 void
 CQModelView::
-sortingEnabledSlot(bool b)
+setSelection(const QRect &rect, QItemSelectionModel::SelectionFlags flags)
 {
-  setSortingEnabled(b);
+  if (! sm_)
+    return;
+
+  updateVisCells();
+
+  QItemSelection selection;
+
+  for (const auto &visCellData : visCellDatas_) {
+    if (visCellData.rect.intersects(rect))
+      selection.select(visCellData.ind, visCellData.ind);
+  }
+
+  sm_->select(selection, flags);
+
+  // TODO: current index ?
 }
 
-void
+QRegion
 CQModelView::
-sortIncreasingSlot()
+visualRegionForSelection(const QItemSelection &) const
 {
-  if (! isSortingEnabled())
-    setSortingEnabled(true);
+  // TODO: used as update region for selection change
+  QRegion r;
 
-  sortByColumn(mouseData_.menuData.column(), Qt::AscendingOrder);
+  return r;
 }
 
-void
+//------
+
+bool
 CQModelView::
-sortDecreasingSlot()
+cellPositionToIndex(PositionData &posData) const
 {
-  if (! isSortingEnabled())
-    setSortingEnabled(true);
+  const_cast<CQModelView *>(this)->updateVisCells();
 
-  sortByColumn(mouseData_.menuData.column(), Qt::DescendingOrder);
+  //---
+
+  posData.reset();
+
+  if (! model_)
+    return false;
+
+  int flatRow = positionFlatRow(posData.pos.y());
+  if (flatRow < 0) return false;
+
+  int c = positionCellColumn(posData.pos.x());
+  if (c < 0) return false;
+
+  int slot = visCellSlot(flatRow, c);
+  if (slot < 0) return false;
+
+  const auto &visCellData = visCellDatas_[uint(slot)];
+
+  if (visCellData.rect.contains(posData.pos)) {
+    posData.ind     = visCellData.ind;
+    posData.rect    = visCellData.rect;
+    posData.flatRow = visCellData.flatRow;
+    return true;
+  }
+
+  // tree indent area at left of first column
+  if (isHierarchical() && c == 0) {
+    const auto &ivisCellData = ivisCellDatas_[uint(slot/visCellNc_)];
+
+    if (ivisCellData.rect.contains(posData.pos)) {
+      posData.iind    = ivisCellData.ind;
+      posData.rect    = ivisCellData.rect;
+      posData.flatRow = ivisCellData.flatRow;
+      return true;
+    }
+  }
+
+  return false;
 }
 
-void
+bool
 CQModelView::
-selectionBehaviorSlot(QAction *action)
+hheaderPositionToIndex(PositionData &posData) const
 {
-  if      (action->text() == "Items")
-    setSelectionBehavior(SelectItems);
-  else if (action->text() == "Rows")
-    setSelectionBehavior(SelectRows);
-  else if (action->text() == "Columns")
-    setSelectionBehavior(SelectColumns);
-  else
-    assert(false);
-}
+  const_cast<CQModelView *>(this)->updateVisColumns();
 
-//---
+  //---
 
-void
-CQModelView::
-setHeaderOnBottomSlot(bool b)
-{
-  setHeaderOnBottom(b);
+  posData.reset();
+
+  int c = positionHeaderColumn(posData.pos.x());
+  if (c < 0) return false;
+
+  auto pc = visColumnDatas_.find(c);
+  if (pc == visColumnDatas_.end()) return false;
+
+  const auto &visColumnData = (*pc).second;
+
+  if (visColumnData.rect.contains(posData.pos)) {
+    posData.hsection = c;
+    posData.rect     = visColumnData.rect;
+    return true;
+  }
+
+  if (visColumnData.hrect.contains(posData.pos)) {
+    posData.hsectionh = c;
+    posData.rect      = visColumnData.hrect;
+    return true;
+  }
+
+  return false;
 }
 
-void
+bool
 CQModelView::
-setHeaderOnRightSlot(bool b)
+vheaderPositionToIndex(PositionData &posData) const
 {
-  setHeaderOnRight(b);
-}
+  const_cast<CQModelView *>(this)->updateVisRows();
 
-//------
+  //---
 
-void
-CQModelView::
-hideColumnSlot()
-{
-  hideColumn(mouseData_.menuData.column());
+  posData.reset();
+
+  int flatRow = positionFlatRow(posData.pos.y());
+  if (flatRow < 0) return false;
+
+  const auto *pvisRowData = visFlatRowData(flatRow);
+  if (! pvisRowData) return false;
+
+  const auto &visRowData = *pvisRowData;
+
+  if (visRowData.rect.contains(posData.pos)) {
+    posData.vsection = visRowData.flatRow;
+    posData.rect     = visRowData.rect;
+    return true;
+  }
+
+  return false;
 }
 
-void
+// visible flat row at y (rows have fixed height so no search needed)
+int
 CQModelView::
-showAllColumnsSlot()
+positionFlatRow(int y) const
 {
-  for (int c = 0; c < nc_; ++c)
-    showColumn(c);
+  if (visFlatRows_.empty())
+    return -1;
 
-  redraw();
+  int rowHeight = this->rowHeight(0);
+  if (rowHeight <= 0) return -1;
+
+  int dy = y - visRowsY_;
+  if (dy < 0) return -1;
+
+  int flatRow = dy/rowHeight;
+
+  if (flatRow < visFlatRows_.front() || flatRow > visFlatRows_.back())
+    return -1;
+
+  return flatRow;
 }
 
-void
+// column of cell area at x. Frozen column is drawn over scrolled columns so
+// checked first, other columns binary searched on their right x
+int
 CQModelView::
-hideColumn(int column)
+positionCellColumn(int x) const
 {
-  hh_->hideSection(column);
-
-  //---
+  if (freezeColumn_ >= 0) {
+    auto pc = visColumnDatas_.find(freezeColumn_);
 
-  state_.updateAll();
+    if (pc != visColumnDatas_.end()) {
+      const auto &rect = (*pc).second.rect;
 
-  emit stateChanged();
+      if (x >= rect.left() - paintData_.margin && x <= rect.right() + paintData_.margin)
+        return freezeColumn_;
+    }
+  }
 
-  //---
+  auto px = std::lower_bound(visColumnCellX2_.begin(), visColumnCellX2_.end(), x);
+  if (px == visColumnCellX2_.end()) return -1;
 
-  redraw();
+  return visColumnOrder_[size_t(px - visColumnCellX2_.begin())];
 }
 
-void
+// column of header section or resize handle at x
+int
 CQModelView::
-showColumn(int column)
+positionHeaderColumn(int x) const
 {
-  hh_->showSection(column);
-
-  //---
+  if (freezeColumn_ >= 0) {
+    auto pc = visColumnDatas_.find(freezeColumn_);
 
-  state_.updateAll();
+    if (pc != visColumnDatas_.end()) {
+      const auto &visColumnData = (*pc).second;
 
-  emit stateChanged();
+      if (x >= visColumnData.rect.left() && x <= visColumnData.hrect.right())
+        return freezeColumn_;
+    }
+  }
 
-  //---
+  auto px = std::lower_bound(visColumnHeadX2_.begin(), visColumnHeadX2_.end(), x);
+  if (px == visColumnHeadX2_.end()) return -1;
 
-  redraw();
+  return visColumnOrder_[size_t(px - visColumnHeadX2_.begin())];
 }
 
-bool
+void
 CQModelView::
-isColumnHidden(int column) const
+setRolePen(QPainter *painter, ColorRole role, double alpha) const
 {
-  return hh_->isSectionHidden(column);
+  if (role != paintData_.penRole || alpha != paintData_.penAlpha) {
+    paintData_.penRole  = role;
+    paintData_.penAlpha = alpha;
+
+    if (paintData_.penRole != ColorRole::None) {
+      if (role == ColorRole::GridFg) {
+        painter->setPen(paintData_.gridPen);
+      }
+      else {
+        auto p = paintData_.roleColors.find(paintData_.penRole);
+
+        if (p == paintData_.roleColors.end()) {
+          auto c = roleColor(role);
+
+          c.setAlphaF(alpha);
+
+          p = paintData_.roleColors.insert(p, RoleColors::value_type(paintData_.penRole, c));
+        }
+
+        painter->setPen((*p).second);
+      }
+    }
+    else
+      painter->setPen(Qt::NoPen);
+  }
 }
 
 void
 CQModelView::
-setColumnHidden(int column, bool hide)
+setRoleBrush(QPainter *painter, ColorRole role, double alpha) const
 {
-  if (column < 0 || column >= nc_)
-    return;
-
-  hh_->setSectionHidden(column, hide);
+  if (role != paintData_.brushRole || alpha != paintData_.brushAlpha) {
+    paintData_.brushRole  = role;
+    paintData_.brushAlpha = alpha;
 
-  //---
+    if (paintData_.brushRole != ColorRole::None) {
+      auto p = paintData_.roleColors.find(paintData_.brushRole);
 
-  state_.updateAll();
+      if (p == paintData_.roleColors.end()) {
+        auto c = roleColor(role);
 
-  emit stateChanged();
+        c.setAlphaF(alpha);
 
-  //---
+        p = paintData_.roleColors.insert(p, RoleColors::value_type(paintData_.brushRole, c));
+      }
 
-  redraw();
+      painter->setBrush((*p).second);
+    }
+    else
+      painter->setBrush(Qt::NoBrush);
+  }
 }
 
-//------
+QColor
+CQModelView::
+roleColor(ColorRole role) const
+{
+  switch (role) {
+    case ColorRole::Window      : return palette().color(QPalette::Window);
+    case ColorRole::Base        : return palette().color(QPalette::Base);
+    case ColorRole::Text        : return palette().color(QPalette::Text);
+    case ColorRole::HeaderBg    : return headerBg();
+    case ColorRole::HeaderFg    : return textColor(roleColor(ColorRole::HeaderBg));
+    case ColorRole::HeaderLineFg: return blendColors(roleColor(ColorRole::HeaderFg),
+                                                     palette().color(QPalette::Window), 0.5);
+    case ColorRole::MouseOverBg : return blendColors(palette().color(QPalette::Highlight),
+                                                     palette().color(QPalette::Window), 0.5);
+    case ColorRole::MouseOverFg : return textColor(roleColor(ColorRole::MouseOverBg));
+    case ColorRole::HighlightBg : return palette().color(QPalette::Highlight);
+    case ColorRole::HighlightFg : return palette().color(QPalette::HighlightedText);
+    case ColorRole::AlternateBg : return palette().color(QPalette::AlternateBase);
+    case ColorRole::AlternateFg : return palette().color(QPalette::Text);
+    case ColorRole::SelectionBg : return selectionBg();
+    case ColorRole::SelectionFg : return selectionFg();
+    default: assert(false); return QColor();
+  }
+}
 
-void
+QColor
 CQModelView::
-hideRow(int row)
+textColor(const QColor &c) const
 {
-  vh_->hideSection(row);
-
-  //--
-
-  state_.updateAll();
-
-  emit stateChanged();
-
-  //--
+  int g = qGray(c.red(), c.green(), c.blue());
 
-  redraw();
+  return (g < 127 ? Qt::white : Qt::black);
 }
 
-void
+QColor
 CQModelView::
-showRow(int row)
+blendColors(const QColor &c1, const QColor &c2, double f) const
 {
-  vh_->showSection(row);
-
-  //---
-
-  state_.updateAll();
+  auto clamp = [](int i, int low, int high) { return std::min(std::max(i, low), high); };
 
-  emit stateChanged();
+  double f1 = 1.0 - f;
 
-  //---
+  double r = c1.redF  ()*f + c2.redF  ()*f1;
+  double g = c1.greenF()*f + c2.greenF()*f1;
+  double b = c1.blueF ()*f + c2.blueF ()*f1;
 
-  redraw();
+  return QColor(clamp(int(255*r), 0, 255),
+                clamp(int(255*g), 0, 255),
+                clamp(int(255*b), 0, 255));
 }
 
-bool
+QSizeF
 CQModelView::
-isRowHidden(int row, const QModelIndex &) const
+viewItemTextLayout(QTextLayout &textLayout, int lineWidth) const
 {
-  return vh_->isSectionHidden(row);
-}
+  double height    = 0;
+  double widthUsed = 0;
 
-void
-CQModelView::
-setRowHidden(int row, const QModelIndex &, bool hide)
-{
-  if (row < 0 || row >= nr_)
-    return;
+  textLayout.beginLayout();
+
+  while (true) {
+    auto line = textLayout.createLine();
 
-  vh_->setSectionHidden(row, hide);
+    if (! line.isValid())
+      break;
 
-  //--
+    line.setLineWidth(lineWidth);
+    line.setPosition(QPointF(0, height));
 
-  state_.updateAll();
+    height += line.height();
 
-  emit stateChanged();
+    widthUsed = std::max(widthUsed, line.naturalTextWidth());
+  }
 
-  //---
+  textLayout.endLayout();
 
-  redraw();
+  return QSizeF(widthUsed, height);
 }
 
 //------
 
-void
-CQModelView::
-expand(const QModelIndex &index)
-{
-  if (isIndexExpanded(index))
-    return;
+// Selection of one parent stored as intervals: fully selected rows, fully selected
+// columns and, for the remaining sparse picks, ranges of rows with the same selected
+// columns (ranges are only split at selection range boundaries). The three parts are
+// kept disjoint (cells never lie in a selected row or column).
+struct CQModelViewSelectionModel::ParentSelection {
+  // selected cells rectangle [r1, r2] x [c1, c2]
+  struct Rect {
+    int r1 { 0 }, r2 { -1 };
+    int c1 { 0 }, c2 { -1 };
+
+    Rect(int r1, int r2, int c1, int c2) :
+     r1(r1), r2(r2), c1(c1), c2(c2) {
+    }
+  };
 
-  expanded_.insert(index);
+  using Rects = std::vector<Rect>;
 
-  if (model_ && model_->canFetchMore(index))
-    model_->fetchMore(index);
+  // rows [start, end] with same selected columns
+  struct RowCells {
+    int          end { -1 };
+    CIntervalSet columns;
 
-  //---
+    RowCells() { }
 
-  state_.updateAll();
+    RowCells(int end, const CIntervalSet &columns) :
+     end(end), columns(columns) {
+    }
+  };
 
-  emit expanded(index);
+  using CellRows  = std::map<int, RowCells>; // start row -> rows
+  using ColumnsOp = std::function<void(CIntervalSet &)>;
 
-  emit stateChanged();
+  int          nr { 0 };
+  int          nc { 0 };
+  CIntervalSet rows;    // rows with all columns selected
+  CIntervalSet columns; // columns with all rows selected
+  CellRows     cells;   // other selected columns per row range
 
-  //---
+  ParentSelection(int nr, int nc) :
+   nr(nr), nc(nc) {
+  }
 
-  redraw();
-}
+  bool isEmpty() const {
+    return (rows.empty() && columns.empty() && cells.empty());
+  }
 
-void
-CQModelView::
-collapse(const QModelIndex &index)
-{
-  if (! isIndexExpanded(index))
-    return;
+  // get selected cell columns of row (nullptr if none)
+  const CIntervalSet *rowCells(int r) const {
+    auto pc = cells.upper_bound(r);
+    if (pc == cells.begin()) return nullptr;
 
-  auto p = expanded_.find(index);
+    --pc;
 
-  if (p != expanded_.end())
-    expanded_.erase(p);
+    return (r <= (*pc).second.end ? &(*pc).second.columns : nullptr);
+  }
 
-  //---
+  bool isSelected(int r, int c) const {
+    if (rows.contains(r) || columns.contains(c))
+      return true;
 
-  state_.updateAll();
+    const auto *rowCells = this->rowCells(r);
 
-  emit collapsed(index);
+    return (rowCells && rowCells->contains(c));
+  }
 
-  emit stateChanged();
+  bool isRowSelected(int r) const {
+    return (rows.contains(r) || ! columns.empty() || rowCells(r));
+  }
 
-  //---
+  // all columns of row selected
+  bool isRowFull(int r) const {
+    if (rows.contains(r))
+      return true;
 
-  redraw();
-}
+    const auto *rowCells = this->rowCells(r);
 
-bool
-CQModelView::
-isExpanded(const QModelIndex &index) const
-{
-  if (! model_) return false;
+    return (nc > 0 && columns.count() + (rowCells ? rowCells->count() : 0) >= nc);
+  }
 
-  assert(index.model() == model());
+  // all rows of column selected (O(ranges))
+  bool isColumnFull(int c) const {
+    if (columns.contains(c))
+      return true;
 
-  return isIndexExpanded(index);
-}
+    auto colRows = rows;
 
-void
-CQModelView::
-setExpanded(const QModelIndex &index, bool expanded)
-{
-  if (! model_) return;
+    for (const auto &pc : cells) {
+      if (pc.second.columns.contains(c))
+        colRows.add(pc.first, pc.second.end);
+    }
 
-  assert(index.model() == model());
+    return (nr > 0 && colRows.containsAll(0, nr - 1));
+  }
 
-  if (expanded) {
-    if (index.parent().isValid() && ! isExpanded(index.parent()))
-      expand(index.parent());
+  bool isColumnSelected(int c) const {
+    if (columns.contains(c) || ! rows.empty())
+      return true;
 
-    expand(index);
-  }
-  else
-    collapse(index);
-}
+    for (const auto &pc : cells) {
+      if (pc.second.columns.contains(c))
+        return true;
+    }
 
-void
-CQModelView::
-expandAll()
-{
-  state_.updateAll();
+    return false;
+  }
 
-  ignoreExpanded_ = true;
+  // add columns with any selected cell (O(ranges))
+  void addSelectedColumns(CIntervalSet &selColumns) const {
+    if (! rows.empty()) {
+      selColumns.add(0, nc - 1);
+      return;
+    }
 
-  updateRowDatas();
+    for (const auto &pc : columns)
+      selColumns.add(pc.first, pc.second);
 
-  ignoreExpanded_ = false;
+    for (const auto &pc : cells) {
+      for (const auto &pc1 : pc.second.columns)
+        selColumns.add(pc1.first, pc1.second);
+    }
+  }
 
   //---
 
-  IndexSet inds;
+  // split row range containing r so a range starts at r
+  void splitCells(int r) {
+    auto pc = cells.upper_bound(r);
+    if (pc == cells.begin()) return;
 
-  for (const auto &pr : rowDatas_) {
-    const auto &rowData = pr.second;
+    --pc;
 
-    if (rowData.children && rowData.expanded) {
-      auto index = model_->index(rowData.row, 0, rowData.parent);
+    auto &rowCells = (*pc).second;
 
-      auto p = expanded_.find(index);
+    if ((*pc).first == r || rowCells.end < r)
+      return;
 
-      if (p == expanded_.end()) {
-        inds.insert(index);
+    RowCells rowCells1(rowCells.end, rowCells.columns);
 
-        expanded_.insert(index);
-      }
-    }
-  }
+    rowCells.end = r - 1;
 
-  //---
+    cells.emplace_hint(std::next(pc), r, std::move(rowCells1));
+  }
 
-  state_.updateAll();
+  // merge adjacent row ranges with same columns in [r1, r2]
+  void mergeCells(int r1, int r2) {
+    auto pc = cells.upper_bound(r1);
 
-  for (const auto &index : inds)
-    emit expanded(index);
+    if (pc != cells.begin())
+      --pc;
 
-  emit stateChanged();
+    while (pc != cells.end() && (*pc).first <= r2) {
+      auto pn = std::next(pc);
 
-  //---
+      if (pn != cells.end() && (*pc).second.end + 1 == (*pn).first &&
+          (*pc).second.columns == (*pn).second.columns) {
+        (*pc).second.end = (*pn).second.end;
 
-  redraw();
-}
+        cells.erase(pn);
+      }
+      else
+        pc = pn;
+    }
+  }
 
-void
-CQModelView::
-collapseAll()
-{
-  IndexSet inds = expanded_;
+  // apply op to cell columns of row ranges in [r1, r2] (rows without cells are added
+  // if addRows), empty ranges are removed and completed rows promoted to full rows
+  void updateCells(int r1, int r2, const ColumnsOp &op, bool addRows) {
+    if (r1 > r2)
+      return;
 
-  expanded_.clear();
+    splitCells(r1);
+    splitCells(r2 + 1);
 
-  //---
+    if (addRows) {
+      auto pc = cells.lower_bound(r1);
 
-  state_.updateAll();
+      for (int r = r1; r <= r2; ) {
+        if (pc != cells.end() && (*pc).first == r) {
+          r = (*pc).second.end + 1;
 
-  for (const auto &index : inds)
-    emit collapsed(index);
+          ++pc;
 
-  emit stateChanged();
+          continue;
+        }
 
-  //---
+        int r3 = (pc != cells.end() && (*pc).first <= r2 ? (*pc).first - 1 : r2);
 
-  redraw();
-}
+        pc = cells.emplace_hint(pc, r, RowCells(r3, CIntervalSet()));
 
-void
-CQModelView::
-expandToDepth(int /*depth*/)
-{
-  // TODO:
-  assert(false);
-}
+        ++pc;
 
-bool
-CQModelView::
-isIndexExpanded(const QModelIndex &index) const
-{
-  auto p = expanded_.find(index);
+        r = r3 + 1;
+      }
+    }
 
-  return (p != expanded_.end());
-}
+    for (auto pc = cells.lower_bound(r1); pc != cells.end() && (*pc).first <= r2; ) {
+      auto &rowCells = (*pc).second;
 
-void
-CQModelView::
-expandSlot()
-{
-  expand(mouseData_.menuData.calcInd());
-}
+      op(rowCells.columns);
 
-void
-CQModelView::
-collapseSlot()
-{
-  collapse(mouseData_.menuData.calcInd());
-}
+      if      (rowCells.columns.empty())
+        pc = cells.erase(pc);
+      else if (columns.count() + rowCells.columns.count() >= nc) {
+        rows.add((*pc).first, rowCells.end);
 
-void
-CQModelView::
-expandedIndices(QModelIndexList &inds) const
-{
-  for (auto &ind : expanded_)
-    inds.push_back(ind);
-}
+        pc = cells.erase(pc);
+      }
+      else
+        ++pc;
+    }
 
-//------
+    mergeCells(r1 - 1, r2 + 1);
+  }
 
-void
-CQModelView::
-setRootSlot()
-{
-  setRootIndex(mouseData_.menuData.calcInd());
-}
+  // add columns [c1, c2] (not in selected columns) to rows [r1, r2] (not in selected rows)
+  void selectCells(int r1, int r2, int c1, int c2) {
+    auto gaps = columns.complement(c1, c2);
 
-void
-CQModelView::
-resetRootSlot()
-{
-  setRootIndex(QModelIndex());
-}
+    auto op = [&](CIntervalSet &rowCells) {
+      for (const auto &gap : gaps)
+        rowCells.add(gap.start, gap.end);
+    };
 
-//------
+    for (const auto &gap : rows.complement(r1, r2))
+      updateCells(gap.start, gap.end, op, /*addRows*/true);
+  }
 
-void
-CQModelView::
-showVerticalHeaderSlot(bool b)
-{
-  setShowVerticalHeader(b);
-}
+  // set cells of rows to all columns except selected columns and [c1, c2]
+  void setCellsExcept(int r1, int r2, int c1, int c2) {
+    CIntervalSet rowCells;
 
-void
-CQModelView::
-showVerticalTextSlot(bool b)
-{
-  setVerticalType(b ? VerticalType::TEXT : verticalType());
-}
+    for (const auto &gap : columns.complement(0, nc - 1))
+      rowCells.add(gap.start, gap.end);
 
-void
-CQModelView::
-showVerticalNumberSlot(bool b)
-{
-  setVerticalType(b ? VerticalType::NUMBER : VerticalType::TEXT);
-}
+    rowCells.remove(c1, c2);
 
-void
-CQModelView::
-showVerticalEmptySlot(bool b)
-{
-  setVerticalType(b ? VerticalType::EMPTY : VerticalType::TEXT);
-}
+    eraseCells(r1, r2);
 
-void
-CQModelView::
-showFilterSlot(bool b)
-{
-  setShowFilter(b);
-}
+    if (! rowCells.empty()) {
+      cells[r1] = RowCells(r2, rowCells);
 
-void
-CQModelView::
-filterByValueSlot()
-{
-  if (! isShowFilter())
-    setShowFilter(true);
+      mergeCells(r1 - 1, r2 + 1);
+    }
+  }
 
-  auto ind = mouseData_.menuData.calcInd();
+  void eraseCells(int r1, int r2) {
+    splitCells(r1);
+    splitCells(r2 + 1);
 
-  if (ind.isValid()) {
-    auto str = model_->data(ind, Qt::DisplayRole).toString();
+    cells.erase(cells.lower_bound(r1), cells.lower_bound(r2 + 1));
+  }
 
-    auto *le = filterEdits_[uint(ind.column())];
+  // convert selected columns in [c1, c2] to row cells for all rows except [r1, r2]
+  // (empty row range for all rows)
+  void splitColumns(int c1, int c2, int r1, int r2) {
+    auto hits = columns.intersection(c1, c2);
 
-    le->setText(str);
+    if (hits.empty())
+      return;
+
+    columns.remove(c1, c2);
+
+    // row may have been complete through selected columns alone (promoted)
+    auto op = [&](CIntervalSet &rowCells) {
+      for (const auto &hit : hits)
+        rowCells.add(hit.start, hit.end);
+    };
 
-    filterColumn(ind.column());
+    for (const auto &gap : rows.complement(0, nr - 1)) {
+      if (r1 > r2 || gap.end < r1 || gap.start > r2) {
+        updateCells(gap.start, gap.end, op, /*addRows*/true);
+        continue;
+      }
+
+      updateCells(gap.start, r1 - 1  , op, /*addRows*/true);
+      updateCells(r2 + 1   , gap.end , op, /*addRows*/true);
+    }
   }
-}
 
-//------
+  //---
 
-void
-CQModelView::
-fitAllColumnsSlot()
-{
-  for (int c = 0; c < nc_; ++c)
-    resizeColumnToContents(c);
+  void select(int r1, int r2, int c1, int c2) {
+    if      (c1 <= 0 && c2 >= nc - 1) {
+      rows.add(r1, r2);
 
-  redraw();
-}
+      eraseCells(r1, r2);
+    }
+    else if (r1 <= 0 && r2 >= nr - 1) {
+      columns.add(c1, c2);
 
-void
-CQModelView::
-fitColumnSlot()
-{
-  resizeColumnToContents(mouseData_.menuData.column());
+      // keep cells disjoint from columns and promote completed rows
+      auto removeOp = [&](CIntervalSet &rowCells) { rowCells.remove(c1, c2); };
 
-  redraw();
-}
+      if (! cells.empty())
+        updateCells(cells.begin()->first, cells.rbegin()->second.end, removeOp,
+                    /*addRows*/false);
+    }
+    else
+      selectCells(r1, r2, c1, c2);
+  }
 
-void
-CQModelView::
-fitNoScrollSlot()
-{
-  int vw = viewport()->rect().width();
+  void deselect(int r1, int r2, int c1, int c2) {
+    bool allRows    = (r1 <= 0 && r2 >= nr - 1);
+    bool allColumns = (c1 <= 0 && c2 >= nc - 1);
 
-  int w = (nc_ > 0 ? vw/nc_ : 0);
+    // selected columns stay selected outside the row range
+    if (allRows)
+      columns.remove(c1, c2);
+    else
+      splitColumns(c1, c2, r1, r2);
 
-  for (int c = 0; c < nc_; ++c)
-    setColumnWidth(c, w);
+    // selected rows keep the columns outside the column range
+    auto rowHits = rows.intersection(r1, r2);
 
-  redraw();
-}
+    rows.remove(r1, r2);
 
-void
-CQModelView::
-resizeColumnToContents(int column)
-{
-  assert(column >= 0);
+    if (! allColumns) {
+      for (const auto &hit : rowHits)
+        setCellsExcept(hit.start, hit.end, c1, c2);
+    }
 
-  int maxWidth = 0;
+    // remove row cells in range
+    auto removeOp = [&](CIntervalSet &rowCells) { rowCells.remove(c1, c2); };
 
-  //---
+    if (allColumns)
+      eraseCells(r1, r2);
+    else
+      updateCells(r1, r2, removeOp, /*addRows*/false);
+  }
 
-  // TODO: SizeHintRole
+  //---
 
-  auto data = model_->headerData(column, Qt::Horizontal, Qt::DisplayRole);
+  // selected cells as disjoint rectangles (selected columns are split at selected rows)
+  Rects rects() const {
+    Rects rects;
 
-  auto str = data.toString();
+    for (const auto &pr : rows)
+      rects.emplace_back(pr.first, pr.second, 0, nc - 1);
 
-  int w = 0;
+    if (! columns.empty()) {
+      for (const auto &gap : rows.complement(0, nr - 1)) {
+        for (const auto &pc : columns)
+          rects.emplace_back(gap.start, gap.end, pc.first, pc.second);
+      }
+    }
 
-  if (isMultiHeaderLines()) {
-    auto strs = str.split(QRegExp("\n|\r\n|\r"));
+    for (const auto &pc : cells) {
+      for (const auto &pc1 : pc.second.columns)
+        rects.emplace_back(pc.first, pc.second.end, pc1.first, pc1.second);
+    }
 
-    for (int i = 0; i < strs.length(); ++i)
-      w = std::max(w, paintData_.fm.horizontalAdvance(strs[i]));
+    return rects;
   }
-  else
-    w = std::max(w, paintData_.fm.horizontalAdvance(str));
 
-  maxWidth = std::max(maxWidth, w);
+  // add selected cells (not in other selection if specified) as ranges of parent
+  void addRanges(QAbstractItemModel *model, const QModelIndex &parent,
+                 QItemSelection &selection, const ParentSelection *other=nullptr) const {
+    auto addRects = [&](const Rects &rects) {
+      for (const auto &rect : rects)
+        selection.append(QItemSelectionRange(model->index(rect.r1, rect.c1, parent),
+                                             model->index(rect.r2, rect.c2, parent)));
+    };
 
-  //---
+    if (! other)
+      return addRects(rects());
 
-  int margin = style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, hh_);
-  int ispace = 4;
+    auto diff = *this;
 
-  maxWidth += 2*margin + 2*ispace;
+    for (const auto &rect : other->rects())
+      diff.deselect(rect.r1, rect.r2, rect.c1, rect.c2);
 
-  if (hh_->isSortIndicatorShown())
-    maxWidth += paintData_.fm.height() + margin;
+    addRects(diff.rects());
+  }
 
   //---
 
-  int maxRows = hh_->resizeContentsPrecision();
+  // move row ranges of cells starting at or after row r by n rows
+  void shiftCells(int r, int n) {
+    CellRows moved;
 
-  int nvr = 0;
+    auto pc1 = cells.lower_bound(r);
 
-  auto parent = rootIndex();
+    for (auto pc = pc1; pc != cells.end(); ++pc) {
+      auto rowCells = (*pc).second;
 
-  int dataMaxWidth = 0;
+      rowCells.end += n;
 
-  maxColumnWidth(column, parent, 0, nvr, dataMaxWidth, maxRows);
+      moved.emplace_hint(moved.end(), (*pc).first + n, rowCells);
+    }
 
-  dataMaxWidth += 2*margin + 2*ispace;
+    cells.erase(pc1, cells.end());
 
-  maxWidth = std::max(maxWidth, dataMaxWidth);
+    cells.insert(moved.begin(), moved.end());
+  }
 
-  //---
+  // insert n unselected rows at row r (selected columns no longer have all rows
+  // selected so become cells of the other rows)
+  void insertRows(int r, int n) {
+    splitCells(r);
 
-  ColumnData &columnData = columnDatas_[uint(column)];
+    shiftCells(r, n);
 
-  columnData.width = std::max(maxWidth, 16);
+    rows.insert(r, n);
 
-  hh_->resizeSection(column, columnData.width);
+    nr += n;
 
-  //---
+    splitColumns(0, nc - 1, r, r + n - 1);
+  }
 
-  state_.updateAll();
+  // remove n rows at row r
+  void removeRows(int r, int n) {
+    eraseCells(r, r + n - 1);
 
-  redraw();
+    shiftCells(r + n, -n);
 
-  emit stateChanged();
-}
+    rows.erase(r, n);
 
-bool
-CQModelView::
-maxColumnWidth(int column, const QModelIndex &parent, int depth,
-               int &nvr, int &maxWidth, int maxRows)
-{
-  auto *delegate = itemDelegate();
+    nr -= n;
 
-  //---
+    if (nr <= 0)
+      columns.clear();
 
-  // init style data
-  QStyleOptionViewItem option;
+    mergeCells(r - 1, r);
+  }
 
-  if (delegate) {
-    option.init(this);
+  // insert n unselected columns at column c (selected rows no longer have all columns
+  // selected so become cells of the other columns)
+  void insertColumns(int c, int n) {
+    columns.insert(c, n);
 
-    option.state    &= ~QStyle::State_MouseOver;
-    option.state    &= ~QStyle::State_HasFocus;
-    option.features &= ~QStyleOptionViewItem::Alternate;
+    for (auto &pc : cells)
+      pc.second.columns.insert(c, n);
 
-    option.widget              = this;
-    option.rect                = QRect(0, 0, 100, paintData_.rowHeight);
-    option.font                = font();
-    option.fontMetrics         = QFontMetrics(option.font);
-    option.decorationSize      = paintData_.decorationSize;
-    option.decorationPosition  = QStyleOptionViewItem::Left;
-    option.decorationAlignment = Qt::AlignCenter;
-    option.displayAlignment    = Qt::AlignHCenter | Qt::AlignVCenter;
-    option.textElideMode       = textElideMode();
+    nc += n;
+
+    auto rowHits = rows.intervals();
+
+    rows.clear();
+
+    for (const auto &hit : rowHits)
+      setCellsExcept(hit.start, hit.end, c, c + n - 1);
+  }
+
+  // remove n columns at column c (rows completed by removal become selected rows)
+  void removeColumns(int c, int n) {
+    columns.erase(c, n);
+
+    nc -= n;
+
+    if (nc <= 0) {
+      rows   .clear();
+      columns.clear();
+      cells  .clear();
+      return;
+    }
+
+    auto eraseOp = [&](CIntervalSet &rowCells) { rowCells.erase(c, n); };
+
+    if (! cells.empty())
+      updateCells(cells.begin()->first, cells.rbegin()->second.end, eraseOp,
+                  /*addRows*/false);
   }
 
   //---
 
-  if (model_ && model_->canFetchMore(parent))
-    model_->fetchMore(parent);
+  void toggle(int r1, int r2, int c1, int c2) {
+    bool allRows    = (r1 <= 0 && r2 >= nr - 1);
+    bool allColumns = (c1 <= 0 && c2 >= nc - 1);
 
-  int nr = model_->rowCount(parent);
+    // whole rows with no column selection: flip row intervals (O(ranges))
+    if (allColumns && columns.empty()) {
+      splitCells(r1);
+      splitCells(r2 + 1);
 
-  for (int r = 0; r < nr; ++r) {
-    if (isRowHidden(r, parent))
-      continue;
+      std::vector<std::pair<int, RowCells>> rowCells;
 
-    // TODO: SizeHintRole and delegate sizeHint
+      for (auto pc = cells.lower_bound(r1); pc != cells.end() && (*pc).first <= r2; ++pc)
+        rowCells.emplace_back((*pc).first, (*pc).second);
 
-    auto ind = model_->index(r, column, parent);
+      eraseCells(r1, r2);
 
-    //---
+      rows.toggle(r1, r2);
 
-    int  w       = 0;
-    bool useData = true;
+      for (const auto &rc : rowCells) {
+        rows.remove(rc.first, rc.second.end);
 
-    if (delegate) {
-      auto size = delegate->sizeHint(option, ind);
+        CIntervalSet rowCells1;
 
-      if (size.isValid()) {
-        w       = size.width();
-        useData = false;
+        for (const auto &gap : rc.second.columns.complement(0, nc - 1))
+          rowCells1.add(gap.start, gap.end);
+
+        cells[rc.first] = RowCells(rc.second.end, rowCells1);
       }
+
+      mergeCells(r1 - 1, r2 + 1);
+
+      return;
     }
 
-    //---
+    // whole columns with no row selection: flip column intervals (O(ranges))
+    if (allRows && rows.empty() && cells.empty()) {
+      columns.toggle(c1, c2);
+      return;
+    }
 
-    if (useData) {
-      // get cell data
-      auto data = model_->data(ind, Qt::DisplayRole);
+    // general case: split selected columns into cells of all rows, selected rows become
+    // cells except toggled columns and cells of other rows are toggled
+    splitColumns(c1, c2, 0, -1);
 
-    //---
+    auto rowHits = rows.intersection(r1, r2);
+    auto rowGaps = rows.complement  (r1, r2);
 
-      // get max string width
-#if 1
-      auto strs = data.toString().split("\n");
+    rows.remove(r1, r2);
 
-      int nl = strs.length();
+    for (const auto &hit : rowHits)
+      setCellsExcept(hit.start, hit.end, c1, c2);
 
-      for (int i = 0; i < nl; ++i) {
-        const auto &str = strs[i];
+    auto toggleOp = [&](CIntervalSet &rowCells) { rowCells.toggle(c1, c2); };
 
-        w = std::max(w, paintData_.fm.horizontalAdvance(str));
-      }
-#else
-      w = paintData_.fm.horizontalAdvance(data.toString());
-#endif
-    }
+    for (const auto &gap : rowGaps)
+      updateCells(gap.start, gap.end, toggleOp, /*addRows*/true);
+  }
+};
 
-    //---
+//---
 
-    // add hierarchical depth indent
-    if (isHierarchical() && column == 0)
-      w += (depth + rootIsDecorated())*indentation();
+// selected columns of parent saved over layout change
+struct CQModelViewSelectionModel::LayoutColumns {
+  QPersistentModelIndex parent;
+  bool                  root { false };
+  CIntervalSet          columns;
 
-    //---
+  LayoutColumns(const QModelIndex &parent, bool root, const CIntervalSet &columns) :
+   parent(parent), root(root), columns(columns) {
+  }
+};
 
-    // update max width
-    maxWidth = std::max(maxWidth, w);
+// selected columns of row saved over layout change
+struct CQModelViewSelectionModel::LayoutRow {
+  QPersistentModelIndex ind;
+  int                   c1 { 0 };
+  int                   c2 { -1 };
 
-    //---
+  LayoutRow(const QModelIndex &ind, int c1, int c2) :
+   ind(ind), c1(c1), c2(c2) {
+  }
+};
 
-    // update rows and stop if max
-    ++nvr;
+//---
 
-    if (nvr > maxRows)
-      return false;
+CQModelViewSelectionModel::
+CQModelViewSelectionModel(CQModelView *view) :
+ view_(view)
+{
+  assert(view_);
 
-    //---
+  selectionColumns_ = new CIntervalSet;
 
-    // check expanded parent
-    auto ind1 = model_->index(r, 0, parent);
+  connect(this, SIGNAL(modelChanged(QAbstractItemModel *)), this, SLOT(modelChangedSlot()));
+}
 
-    if (model_->hasChildren(ind1) && isExpanded(ind1)) {
-      if (! maxColumnWidth(column, ind1, depth + 1, nvr, maxWidth, maxRows))
-        return false;
-    }
-  }
+CQModelViewSelectionModel::
+~CQModelViewSelectionModel()
+{
+  clearSelectionData(parentSelections_);
+  clearSelectionData(currentBase_);
 
-  return true;
+  delete selectionColumns_;
 }
 
-//------
+void
+CQModelViewSelectionModel::
+setCurrentIndex(const QModelIndex &index, QItemSelectionModel::SelectionFlags command)
+{
+  QItemSelectionModel::setCurrentIndex(index, command);
+
+  view_->updateCurrentIndices();
+}
 
 void
-CQModelView::
-setHeatmapSlot(bool b)
+CQModelViewSelectionModel::
+select(const QModelIndex &index, QItemSelectionModel::SelectionFlags command)
 {
-  ColumnData &columnData = columnDatas_[uint(mouseData_.menuData.column())];
+  if (! model()) return;
+
+  select(QItemSelection(index, index), command);
+}
+
+// selection is only stored by the interval backend (base class selection is empty),
+// ranges are merged first so fewer interval updates are needed. The changed cells of
+// the updated parents are emitted as selected/deselected ranges
+void
+CQModelViewSelectionModel::
+select(const QItemSelection &selection, QItemSelectionModel::SelectionFlags command)
+{
+  if (! model())
+    return;
+
+  auto selection1 = mergeSelectionRanges(selection, command);
+
+  // save parents which can change (all for clear or current update)
+  bool allParents = (command & (QItemSelectionModel::Clear | QItemSelectionModel::Current));
+
+  ParentSelections oldSelections;
+
+  if (allParents)
+    copySelectionData(parentSelections_, oldSelections);
+  else {
+    for (const auto &range : selection1) {
+      QPersistentModelIndex parent(range.parent());
+
+      if (oldSelections.find(parent) != oldSelections.end())
+        continue;
+
+      const auto *parentSelection = findParentSelection(parent);
+
+      oldSelections[parent] = (parentSelection ? new ParentSelection(*parentSelection) : nullptr);
+    }
+  }
 
-  columnData.heatmap = b;
+  //---
 
-  redraw();
-}
+  if (command & QItemSelectionModel::Clear) {
+    clearSelectionData(parentSelections_);
+    clearSelectionData(currentBase_);
+  }
 
-//------
+  // current update replaces last current update (applied to selection before it)
+  if (command & QItemSelectionModel::Current) {
+    if (currentBaseValid_)
+      copySelectionData(currentBase_, parentSelections_);
+    else {
+      copySelectionData(parentSelections_, currentBase_);
 
-QRect
-CQModelView::
-visualRect(const QModelIndex &ind) const
-{
-  const_cast<CQModelView*>(this)->updateVisCells();
+      currentBaseValid_ = true;
+    }
+  }
+  else
+    commitCurrentSelection();
 
-  //---
+  applySelectionData(selection1, command);
 
-  auto p = visCellDatas_.find(ind);
+  //---
 
-  if (p != visCellDatas_.end())
-    return (*p).second.rect;
+  // emit changed cells of saved parents (and new parents if all saved)
+  QItemSelection selected, deselected;
 
-  return QRect();
-}
+  auto addChanged = [&](const QPersistentModelIndex &parent, const ParentSelection *oldSelection) {
+    const auto *newSelection = findParentSelection(parent);
 
-void
-CQModelView::
-scrollTo(const QModelIndex &index, ScrollHint)
-{
-  if (! index.isValid())
-    return;
+    if (oldSelection)
+      oldSelection->addRanges(model(), parent, deselected, newSelection);
 
-  updateVisRows();
+    if (newSelection)
+      newSelection->addRanges(model(), parent, selected, oldSelection);
+  };
 
-  auto pp = visRowDatas_.find(index.parent());
-  if (pp == visRowDatas_.end()) return;
+  for (const auto &ps : oldSelections)
+    addChanged(ps.first, ps.second);
 
-  const auto &rowVisRowDatas = (*pp).second;
+  if (allParents) {
+    for (const auto &ps : parentSelections_) {
+      if (oldSelections.find(ps.first) == oldSelections.end())
+        addChanged(ps.first, nullptr);
+    }
+  }
 
-  auto pr = rowVisRowDatas.find(index.row());
-  if (pr == rowVisRowDatas.end()) return;
+  clearSelectionData(oldSelections);
 
-  const auto &visRowData = (*pr).second;
+  selectionDataChanged();
 
-  int vh = viewport()->geometry().height();
+  if (! selected.empty() || ! deselected.empty())
+    emit selectionChanged(selected, deselected);
 
-  bool visible = (visRowData.rect.bottom() > 0 && visRowData.rect.top() <= vh);
+  view_->updateSelection();
+}
 
-  if (visible)
+void
+CQModelViewSelectionModel::
+clearSelection()
+{
+  if (parentSelections_.empty() && ! currentBaseValid_)
     return;
 
-  int ys;
-
-  if (visRowData.rect.bottom() <= 0)
-    ys = visRowData.flatRow;
-  else
-    ys = visRowData.flatRow - scrollData_.nv + 1;
+  select(QItemSelection(), QItemSelectionModel::Clear);
+}
 
-  vs_->setValue(std::min(std::max(ys, vs_->minimum()), vs_->maximum()));
+void
+CQModelViewSelectionModel::
+clear()
+{
+  clearSelection();
 
-  redraw();
+  QItemSelectionModel::clear();
 }
 
-QModelIndex
-CQModelView::
-indexAt(const QPoint &p) const
+void
+CQModelViewSelectionModel::
+reset()
 {
-  PositionData posData;
+  QItemSelectionModel::reset();
 
-  posData.pos = p;
+  clearSelectionData(parentSelections_);
 
-  cellPositionToIndex(posData);
+  commitCurrentSelection();
 
-  return posData.ind;
+  selectionDataChanged();
+
+  view_->updateSelection();
+  view_->updateCurrentIndices();
 }
 
-QModelIndex
-CQModelView::
-moveCursor(CursorAction action, Qt::KeyboardModifiers modifiers)
+void
+CQModelViewSelectionModel::
+clearCurrentIndex()
 {
-  Q_UNUSED(modifiers);
+  QItemSelectionModel::clearCurrentIndex();
 
-  auto current = currentIndex();
+  view_->updateCurrentIndices();
+}
 
-  if (! current.isValid())
-    return QModelIndex();
+//---
 
-  //---
+// selection ranges (built from intervals when first needed after a change)
+QItemSelection
+CQModelViewSelectionModel::
+selection() const
+{
+  if (! selectionValid_) {
+    selectionValid_ = true;
 
-  updateVisColumns();
-  updateVisRows   ();
+    selection_.clear();
 
-  //---
+    if (model()) {
+      for (const auto &ps : parentSelections_)
+        ps.second->addRanges(model(), ps.first, selection_);
+    }
+  }
 
-  int  r      = current.row   ();
-  int  c      = current.column();
-  auto parent = current.parent();
+  return selection_;
+}
 
-  //---
+bool
+CQModelViewSelectionModel::
+isSelected(const QModelIndex &ind) const
+{
+  return isCellSelected(ind);
+}
 
-  auto prevRow = [&](int r, int c, const QModelIndex &parent) {
-    auto pp = visRowDatas_.find(parent);
-    if (pp == visRowDatas_.end()) return QModelIndex();
+bool
+CQModelViewSelectionModel::
+isRowSelected(int row, const QModelIndex &parent) const
+{
+  const auto *parentSelection = findParentSelection(parent);
 
-    const auto &rowVisRowDatas = (*pp).second;
+  return (parentSelection && parentSelection->isRowFull(row));
+}
 
-    auto pr = rowVisRowDatas.find(r);
-    if (pr == rowVisRowDatas.end()) return QModelIndex();
+bool
+CQModelViewSelectionModel::
+isColumnSelected(int column, const QModelIndex &parent) const
+{
+  const auto *parentSelection = findParentSelection(parent);
 
-    int flatRow = (*pr).second.flatRow;
+  return (parentSelection && parentSelection->isColumnFull(column));
+}
 
-    if (flatRow == 0)
-      return model_->index(r, c, parent);
+bool
+CQModelViewSelectionModel::
+rowIntersectsSelection(int row, const QModelIndex &parent) const
+{
+  return isAnyRowCellSelected(row, parent);
+}
 
-    --flatRow;
+bool
+CQModelViewSelectionModel::
+columnIntersectsSelection(int column, const QModelIndex &parent) const
+{
+  return isAnyColumnCellSelected(column, parent);
+}
 
-    const RowData &rowData = rowDatas_[flatRow];
+bool
+CQModelViewSelectionModel::
+hasSelection() const
+{
+  return ! parentSelections_.empty();
+}
 
-    return model_->index(rowData.row, c, rowData.parent);
-  };
+QModelIndexList
+CQModelViewSelectionModel::
+selectedIndexes() const
+{
+  return selection().indexes();
+}
 
-  auto nextRow = [&](int r, int c, const QModelIndex &parent) {
-    auto pp = visRowDatas_.find(parent);
-    if (pp == visRowDatas_.end()) return QModelIndex();
+// get indices (in column) of fully selected rows of all parents
+QModelIndexList
+CQModelViewSelectionModel::
+selectedRows(int column) const
+{
+  QModelIndexList indices;
 
-    const auto &rowVisRowDatas = (*pp).second;
+  if (! model())
+    return indices;
 
-    auto pr = rowVisRowDatas.find(r);
-    if (pr == rowVisRowDatas.end()) return QModelIndex();
+  for (const auto &ps : parentSelections_) {
+    const auto *parentSelection = ps.second;
 
-    int flatRow = (*pr).second.flatRow;
+    CIntervalSet rows;
 
-    if (flatRow == nvr_ - 1)
-      return model_->index(r, c, parent);
+    if (parentSelection->columns.count() >= parentSelection->nc)
+      rows.add(0, parentSelection->nr - 1);
+    else {
+      rows = parentSelection->rows;
 
-    ++flatRow;
+      for (const auto &pc : parentSelection->cells) {
+        if (parentSelection->isRowFull(pc.first))
+          rows.add(pc.first, pc.second.end);
+      }
+    }
 
-    const RowData &rowData = rowDatas_[flatRow];
+    for (const auto &pr : rows) {
+      for (int r = pr.first; r <= pr.second; ++r)
+        indices.push_back(model()->index(r, column, ps.first));
+    }
+  }
 
-    return model_->index(rowData.row, c, rowData.parent);
-  };
+  return indices;
+}
 
-  //---
+// get indices (in row) of fully selected columns of all parents
+QModelIndexList
+CQModelViewSelectionModel::
+selectedColumns(int row) const
+{
+  QModelIndexList indices;
 
-  auto prevCol = [&](int r, int c, const QModelIndex &parent) {
-    if (c == 0 && isHierarchical()) {
-      auto pr = rowDatas_.find(currentFlatRow_);
+  if (! model())
+    return indices;
 
-      if (pr != rowDatas_.end()) {
-        const auto &rowData = (*pr).second;
+  for (const auto &ps : parentSelections_) {
+    const auto *parentSelection = ps.second;
 
-        if (rowData.children && rowData.expanded) {
-          auto ind = model_->index(r, c, parent);
+    CIntervalSet columns;
 
-          collapse(ind);
+    if (parentSelection->rows.count() >= parentSelection->nr)
+      columns.add(0, parentSelection->nc - 1);
+    else {
+      columns = parentSelection->columns;
 
-          return ind;
+      CIntervalSet cellColumns;
+
+      for (const auto &pc : parentSelection->cells) {
+        for (const auto &pc1 : pc.second.columns)
+          cellColumns.add(pc1.first, pc1.second);
+      }
+
+      for (const auto &pc : cellColumns) {
+        for (int c = pc.first; c <= pc.second; ++c) {
+          if (parentSelection->isColumnFull(c))
+            columns.add(c, c);
         }
       }
     }
 
-    auto p = visColumnDatas_.find(c);
-
-    if (p == visColumnDatas_.begin())
-      return prevRow(r, (nc_ > 0 ? nc_ - 1 : 0), parent);
+    for (const auto &pc : columns) {
+      for (int c = pc.first; c <= pc.second; ++c)
+        indices.push_back(model()->index(row, c, ps.first));
+    }
+  }
 
-    --p;
+  return indices;
+}
 
-    return model_->index(r, (*p).first, parent);
-  };
+//---
 
-  auto nextCol = [&](int r, int c, const QModelIndex &parent) {
-    if (c == 0 && isHierarchical()) {
-      auto pr = rowDatas_.find(currentFlatRow_);
+bool
+CQModelViewSelectionModel::
+isCellSelected(const QModelIndex &ind) const
+{
+  if (! ind.isValid())
+    return false;
 
-      if (pr != rowDatas_.end()) {
-        const auto &rowData = (*pr).second;
+  return isCellSelected(ind.row(), ind.column(), ind.parent());
+}
 
-        if (rowData.children && ! rowData.expanded) {
-          auto ind = model_->index(r, c, parent);
+bool
+CQModelViewSelectionModel::
+isCellSelected(int row, int column, const QModelIndex &parent) const
+{
+  const auto *parentSelection = findParentSelection(parent);
 
-          expand(ind);
+  return (parentSelection && parentSelection->isSelected(row, column));
+}
 
-          return ind;
-        }
-      }
-    }
+bool
+CQModelViewSelectionModel::
+isAnyRowCellSelected(int row, const QModelIndex &parent) const
+{
+  const auto *parentSelection = findParentSelection(parent);
 
-    auto p = visColumnDatas_.find(c);
+  return (parentSelection && parentSelection->isRowSelected(row));
+}
 
-    if (p != visColumnDatas_.end())
-      ++p;
+bool
+CQModelViewSelectionModel::
+isAnyColumnCellSelected(int column, const QModelIndex &parent) const
+{
+  const auto *parentSelection = findParentSelection(parent);
 
-    if (p == visColumnDatas_.end())
-      return nextRow(r, 0, parent);
+  return (parentSelection && parentSelection->isColumnSelected(column));
+}
 
-    return model_->index(r, (*p).first, parent);
-  };
+bool
+CQModelViewSelectionModel::
+isColumnInSelection(int column) const
+{
+  const_cast<CQModelViewSelectionModel *>(this)->updateSelectionColumns();
 
-  switch (action) {
-    case MoveUp:
-      return prevRow(r, c, parent);
-    case MoveDown:
-      return nextRow(r, c, parent);
-    case MovePrevious:
-    case MoveLeft:
-      return prevCol(r, c, parent);
-    case MoveNext:
-    case MoveRight:
-      return nextCol(r, c, parent);
-    case MoveHome:
-      return model_->index(0, 0, parent);
-    case MoveEnd:
-      // TODO: ensure valid column
-      return model_->index((nr_ > 0 ? nr_ - 1 : 0), (nc_ > 0 ? nc_ - 1 : 0), parent);
-    case MovePageUp:
-      return model_->index(std::max(r - scrollData_.nv, 0), c, parent);
-    case MovePageDown:
-      return model_->index(std::min(r + scrollData_.nv, nr_ - 1), c, parent);
-  }
+  return selectionColumns_->contains(column);
+}
 
-  return QModelIndex();
+bool
+CQModelViewSelectionModel::
+hasCellSelection() const
+{
+  return ! parentSelections_.empty();
 }
 
-int
-CQModelView::
-horizontalOffset() const
+//---
+
+void
+CQModelViewSelectionModel::
+modelChangedSlot()
 {
-  return scrollData_.hpos;
+  if (model_) {
+    disconnect(model_, SIGNAL(rowsInserted(QModelIndex, int, int)),
+               this, SLOT(rowsInsertedSlot(QModelIndex, int, int)));
+    disconnect(model_, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)),
+               this, SLOT(rowsAboutToBeRemovedSlot(QModelIndex, int, int)));
+    disconnect(model_, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+               this, SLOT(rowsRemovedSlot(QModelIndex, int, int)));
+    disconnect(model_, SIGNAL(columnsInserted(QModelIndex, int, int)),
+               this, SLOT(columnsInsertedSlot(QModelIndex, int, int)));
+    disconnect(model_, SIGNAL(columnsRemoved(QModelIndex, int, int)),
+               this, SLOT(columnsRemovedSlot(QModelIndex, int, int)));
+    disconnect(model_, SIGNAL(rowsAboutToBeMoved(QModelIndex, int, int, QModelIndex, int)),
+               this, SLOT(layoutAboutToBeChangedSlot()));
+    disconnect(model_, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)),
+               this, SLOT(layoutChangedSlot()));
+    disconnect(model_, SIGNAL(columnsAboutToBeMoved(QModelIndex, int, int, QModelIndex, int)),
+               this, SLOT(layoutAboutToBeChangedSlot()));
+    disconnect(model_, SIGNAL(columnsMoved(QModelIndex, int, int, QModelIndex, int)),
+               this, SLOT(layoutChangedSlot()));
+    disconnect(model_, SIGNAL(layoutAboutToBeChanged()), this, SLOT(layoutAboutToBeChangedSlot()));
+    disconnect(model_, SIGNAL(layoutChanged()), this, SLOT(layoutChangedSlot()));
+    disconnect(model_, SIGNAL(modelReset()), this, SLOT(modelResetSlot()));
+  }
+
+  model_ = model();
+
+  // intervals are updated for structure changes (rows and columns shifted, moved rows
+  // and layout changes remapped through persistent row indices)
+  if (model_) {
+    connect(model_, SIGNAL(rowsInserted(QModelIndex, int, int)),
+            this, SLOT(rowsInsertedSlot(QModelIndex, int, int)));
+    connect(model_, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)),
+            this, SLOT(rowsAboutToBeRemovedSlot(QModelIndex, int, int)));
+    connect(model_, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+            this, SLOT(rowsRemovedSlot(QModelIndex, int, int)));
+    connect(model_, SIGNAL(columnsInserted(QModelIndex, int, int)),
+            this, SLOT(columnsInsertedSlot(QModelIndex, int, int)));
+    connect(model_, SIGNAL(columnsRemoved(QModelIndex, int, int)),
+            this, SLOT(columnsRemovedSlot(QModelIndex, int, int)));
+    connect(model_, SIGNAL(rowsAboutToBeMoved(QModelIndex, int, int, QModelIndex, int)),
+            this, SLOT(layoutAboutToBeChangedSlot()));
+    connect(model_, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)),
+            this, SLOT(layoutChangedSlot()));
+    connect(model_, SIGNAL(columnsAboutToBeMoved(QModelIndex, int, int, QModelIndex, int)),
+            this, SLOT(layoutAboutToBeChangedSlot()));
+    connect(model_, SIGNAL(columnsMoved(QModelIndex, int, int, QModelIndex, int)),
+            this, SLOT(layoutChangedSlot()));
+    connect(model_, SIGNAL(layoutAboutToBeChanged()), this, SLOT(layoutAboutToBeChangedSlot()));
+    connect(model_, SIGNAL(layoutChanged()), this, SLOT(layoutChangedSlot()));
+    connect(model_, SIGNAL(modelReset()), this, SLOT(modelResetSlot()));
+  }
+
+  modelResetSlot();
 }
 
-int
-CQModelView::
-verticalOffset() const
+// shift selected rows of parent
+void
+CQModelViewSelectionModel::
+rowsInsertedSlot(const QModelIndex &parent, int start, int end)
 {
-  return scrollData_.vpos;
+  commitCurrentSelection();
+
+  // persistent indices already updated so map needs rebuild before lookup
+  rehashSelectionData();
+
+  auto *parentSelection = findParentSelection(parent);
+
+  if (parentSelection)
+    parentSelection->insertRows(start, end - start + 1);
 }
 
-bool
-CQModelView::
-isIndexHidden(const QModelIndex &index) const
+// remove selection of parents inside removed rows (while their indices are valid)
+void
+CQModelViewSelectionModel::
+rowsAboutToBeRemovedSlot(const QModelIndex &parent, int start, int end)
 {
-  int r = index.row();
-  int c = index.column();
+  commitCurrentSelection();
 
-  if (isColumnHidden(c))
-    return true;
+  auto isRemoved = [&](const QModelIndex &ind) {
+    for (auto ind1 = ind; ind1.isValid(); ind1 = ind1.parent()) {
+      if (ind1.parent() == parent && ind1.row() >= start && ind1.row() <= end)
+        return true;
+    }
 
-  if (isRowHidden(r, index.parent()))
-    return true;
+    return false;
+  };
 
-  return false;
+  for (auto ps = parentSelections_.begin(); ps != parentSelections_.end(); ) {
+    if (isRemoved((*ps).first)) {
+      delete (*ps).second;
+
+      ps = parentSelections_.erase(ps);
+    }
+    else
+      ++ps;
+  }
 }
 
+// remove selected rows of parent and shift later rows
 void
-CQModelView::
-setSelection(const QRect &rect, QItemSelectionModel::SelectionFlags flags)
+CQModelViewSelectionModel::
+rowsRemovedSlot(const QModelIndex &parent, int start, int end)
 {
-  if (! sm_)
-    return;
+  // persistent indices already updated so map needs rebuild before lookup
+  rehashSelectionData();
 
-  updateVisCells();
+  auto *parentSelection = findParentSelection(parent);
 
-  QItemSelection selection;
+  if (parentSelection)
+    parentSelection->removeRows(start, end - start + 1);
+}
 
-  for (const auto &cp : visCellDatas_) {
-    const auto &visCellData = cp.second;
+// shift selected columns of parent
+void
+CQModelViewSelectionModel::
+columnsInsertedSlot(const QModelIndex &parent, int start, int end)
+{
+  commitCurrentSelection();
 
-    if (visCellData.rect.intersects(rect))
-      selection.select(cp.first, cp.first);
-  }
+  // persistent indices already updated so map needs rebuild before lookup
+  rehashSelectionData();
 
-  sm_->select(selection, flags);
+  auto *parentSelection = findParentSelection(parent);
 
-  // TODO: current index ?
+  if (parentSelection)
+    parentSelection->insertColumns(start, end - start + 1);
 }
 
-QRegion
-CQModelView::
-visualRegionForSelection(const QItemSelection &) const
+// remove selected columns of parent and shift later columns
+void
+CQModelViewSelectionModel::
+columnsRemovedSlot(const QModelIndex &parent, int start, int end)
 {
-  // TODO: used as update region for selection change
-  QRegion r;
+  commitCurrentSelection();
 
-  return r;
-}
+  // persistent indices already updated so map needs rebuild before lookup
+  rehashSelectionData();
 
-//------
+  auto *parentSelection = findParentSelection(parent);
 
-bool
-CQModelView::
-cellPositionToIndex(PositionData &posData) const
+  if (parentSelection)
+    parentSelection->removeColumns(start, end - start + 1);
+}
+
+// rows may move so save selected cells as persistent row indices with column ranges
+// (fully selected columns are kept per parent)
+void
+CQModelViewSelectionModel::
+layoutAboutToBeChangedSlot()
 {
-  const_cast<CQModelView *>(this)->updateVisCells();
+  commitCurrentSelection();
 
-  //---
+  layoutColumns_.clear();
+  layoutRows_   .clear();
 
-  posData.reset();
+  if (! model_)
+    return;
 
-  for (const auto &cp : visCellDatas_) {
-    const auto &visCellData = cp.second;
+  for (const auto &ps : parentSelections_) {
+    const auto &parent          = ps.first;
+    const auto *parentSelection = ps.second;
 
-    if (visCellData.rect.contains(posData.pos)) {
-      posData.ind     = cp.first;
-      posData.rect    = visCellData.rect;
-      posData.flatRow = visCellData.flatRow;
-      return true;
-    }
-  }
+    if (! parentSelection->columns.empty())
+      layoutColumns_.emplace_back(parent, ! parent.isValid(), parentSelection->columns);
+
+    auto addRows = [&](int r1, int r2, int c1, int c2) {
+      for (int r = r1; r <= r2; ++r)
+        layoutRows_.emplace_back(model_->index(r, 0, parent), c1, c2);
+    };
 
-  for (const auto &cp : ivisCellDatas_) {
-    const auto &visCellData = cp.second;
+    for (const auto &pr : parentSelection->rows)
+      addRows(pr.first, pr.second, 0, parentSelection->nc - 1);
 
-    if (visCellData.rect.contains(posData.pos)) {
-      posData.iind    = cp.first;
-      posData.rect    = visCellData.rect;
-      posData.flatRow = visCellData.flatRow;
-      return true;
+    for (const auto &pc : parentSelection->cells) {
+      for (const auto &pc1 : pc.second.columns)
+        addRows(pc.first, pc.second.end, pc1.first, pc1.second);
     }
   }
-
-  return false;
 }
 
-bool
-CQModelView::
-hheaderPositionToIndex(PositionData &posData) const
+// rebuild intervals from saved selection at new row positions
+void
+CQModelViewSelectionModel::
+layoutChangedSlot()
 {
-  const_cast<CQModelView *>(this)->updateVisColumns();
+  clearSelectionData(parentSelections_);
 
-  //---
-
-  posData.reset();
+  if (model_) {
+    for (const auto &layoutColumns : layoutColumns_) {
+      if (! layoutColumns.parent.isValid() && ! layoutColumns.root)
+        continue;
 
-  for (const auto &vp : visColumnDatas_) {
-    const auto &visColumnData = vp.second;
+      auto *parentSelection = getParentSelection(layoutColumns.parent);
 
-    if (visColumnData.rect.contains(posData.pos)) {
-      posData.hsection = vp.first;
-      posData.rect     = visColumnData.rect;
-      return true;
+      for (const auto &pc : layoutColumns.columns)
+        parentSelection->select(0, parentSelection->nr - 1, pc.first, pc.second);
     }
 
-    if (visColumnData.hrect.contains(posData.pos)) {
-      posData.hsectionh = vp.first;
-      posData.rect      = visColumnData.hrect;
-      return true;
+    for (const auto &layoutRow : layoutRows_) {
+      if (! layoutRow.ind.isValid())
+        continue;
+
+      auto *parentSelection = getParentSelection(layoutRow.ind.parent());
+
+      int r = layoutRow.ind.row();
+
+      parentSelection->select(r, r, layoutRow.c1, layoutRow.c2);
     }
   }
 
-  return false;
+  layoutColumns_.clear();
+  layoutRows_   .clear();
+
+  selectionDataChanged();
 }
 
-bool
-CQModelView::
-vheaderPositionToIndex(PositionData &posData) const
+void
+CQModelViewSelectionModel::
+modelResetSlot()
 {
-  const_cast<CQModelView *>(this)->updateVisRows();
+  clearSelectionData(parentSelections_);
 
-  //---
+  commitCurrentSelection();
 
-  posData.reset();
+  selectionDataChanged();
+}
 
-  for (const auto &pp : visRowDatas_) {
-    const auto &rowVisRowDatas = pp.second;
+//---
 
-    for (const auto &pr : rowVisRowDatas) {
-      const auto &visRowData = pr.second;
+void
+CQModelViewSelectionModel::
+applySelectionData(const QItemSelection &selection, SelectionFlags command)
+{
+  bool isSelect   = (command & QItemSelectionModel::Select);
+  bool isDeselect = (command & QItemSelectionModel::Deselect);
+  bool isToggle   = (command & QItemSelectionModel::Toggle);
 
-      if (visRowData.rect.contains(posData.pos)) {
-        posData.vsection = visRowData.flatRow;
-        posData.rect     = visRowData.rect;
-        return true;
-      }
+  if (! isSelect && ! isDeselect && ! isToggle)
+    return;
 
-#if 0
-      if (visRowData.vrect.contains(posData.pos)) {
-        posData.vsectionh = visRowData.flatRow;
-        posData.rect      = visRowData.vrect;
-        return true;
-      }
-#endif
-    }
-  }
+  for (const auto &range : selection) {
+    if (! range.isValid())
+      continue;
 
-  return false;
-}
+    auto *parentSelection = getParentSelection(range.parent());
 
-void
-CQModelView::
-setRolePen(QPainter *painter, ColorRole role, double alpha) const
-{
-  if (role != paintData_.penRole || alpha != paintData_.penAlpha) {
-    paintData_.penRole  = role;
-    paintData_.penAlpha = alpha;
+    int r1 = range.top (), r2 = range.bottom();
+    int c1 = range.left(), c2 = range.right ();
 
-    if (paintData_.penRole != ColorRole::None) {
-      if (role == ColorRole::GridFg) {
-        painter->setPen(paintData_.gridPen);
-      }
-      else {
-        auto p = paintData_.roleColors.find(paintData_.penRole);
+    if (command & QItemSelectionModel::Rows) {
+      c1 = 0;
+      c2 = parentSelection->nc - 1;
+    }
 
-        if (p == paintData_.roleColors.end()) {
-          auto c = roleColor(role);
+    if (command & QItemSelectionModel::Columns) {
+      r1 = 0;
+      r2 = parentSelection->nr - 1;
+    }
 
-          c.setAlphaF(alpha);
+    if      (isToggle)
+      parentSelection->toggle(r1, r2, c1, c2);
+    else if (isDeselect)
+      parentSelection->deselect(r1, r2, c1, c2);
+    else
+      parentSelection->select(r1, r2, c1, c2);
+  }
 
-          p = paintData_.roleColors.insert(p, RoleColors::value_type(paintData_.penRole, c));
-        }
+  // remove empty parents
+  for (auto ps = parentSelections_.begin(); ps != parentSelections_.end(); ) {
+    if ((*ps).second->isEmpty()) {
+      delete (*ps).second;
 
-        painter->setPen((*p).second);
-      }
+      ps = parentSelections_.erase(ps);
     }
     else
-      painter->setPen(Qt::NoPen);
+      ++ps;
   }
 }
 
-void
-CQModelView::
-setRoleBrush(QPainter *painter, ColorRole role, double alpha) const
+// merge ranges with same parent and columns and adjacent (or overlapping if not toggle)
+// rows (e.g. per row ranges of visible rows)
+QItemSelection
+CQModelViewSelectionModel::
+mergeSelectionRanges(const QItemSelection &selection, SelectionFlags command) const
 {
-  if (role != paintData_.brushRole || alpha != paintData_.brushAlpha) {
-    paintData_.brushRole  = role;
-    paintData_.brushAlpha = alpha;
-
-    if (paintData_.brushRole != ColorRole::None) {
-      auto p = paintData_.roleColors.find(paintData_.brushRole);
+  if (selection.size() <= 1 || ! model())
+    return selection;
 
-      if (p == paintData_.roleColors.end()) {
-        auto c = roleColor(role);
+  bool isToggle = (command & QItemSelectionModel::Toggle);
 
-        c.setAlphaF(alpha);
+  std::vector<QItemSelectionRange> ranges;
 
-        p = paintData_.roleColors.insert(p, RoleColors::value_type(paintData_.brushRole, c));
-      }
+  ranges.reserve(uint(selection.size()));
 
-      painter->setBrush((*p).second);
-    }
-    else
-      painter->setBrush(Qt::NoBrush);
+  for (const auto &range : selection) {
+    if (range.isValid())
+      ranges.push_back(range);
   }
-}
 
-QColor
-CQModelView::
-roleColor(ColorRole role) const
-{
-  switch (role) {
-    case ColorRole::Window      : return palette().color(QPalette::Window);
-    case ColorRole::Base        : return palette().color(QPalette::Base);
-    case ColorRole::Text        : return palette().color(QPalette::Text);
-    case ColorRole::HeaderBg    : return headerBg();
-    case ColorRole::HeaderFg    : return textColor(roleColor(ColorRole::HeaderBg));
-    case ColorRole::HeaderLineFg: return blendColors(roleColor(ColorRole::HeaderFg),
-                                                     palette().color(QPalette::Window), 0.5);
-    case ColorRole::MouseOverBg : return blendColors(palette().color(QPalette::Highlight),
-                                                     palette().color(QPalette::Window), 0.5);
-    case ColorRole::MouseOverFg : return textColor(roleColor(ColorRole::MouseOverBg));
-    case ColorRole::HighlightBg : return palette().color(QPalette::Highlight);
-    case ColorRole::HighlightFg : return palette().color(QPalette::HighlightedText);
-    case ColorRole::AlternateBg : return palette().color(QPalette::AlternateBase);
-    case ColorRole::AlternateFg : return palette().color(QPalette::Text);
-    case ColorRole::SelectionBg : return selectionBg();
-    case ColorRole::SelectionFg : return selectionFg();
-    default: assert(false); return QColor();
-  }
-}
+  std::sort(ranges.begin(), ranges.end(),
+            [](const QItemSelectionRange &range1, const QItemSelectionRange &range2) {
+    if (range1.parent() != range2.parent()) return (range1.parent() < range2.parent());
+    if (range1.left  () != range2.left  ()) return (range1.left  () < range2.left  ());
+    if (range1.right () != range2.right ()) return (range1.right () < range2.right ());
 
-QColor
-CQModelView::
-textColor(const QColor &c) const
-{
-  int g = qGray(c.red(), c.green(), c.blue());
+    return (range1.top() < range2.top());
+  });
 
-  return (g < 127 ? Qt::white : Qt::black);
-}
+  QItemSelection selection1;
 
-QColor
-CQModelView::
-blendColors(const QColor &c1, const QColor &c2, double f) const
-{
-  auto clamp = [](int i, int low, int high) { return std::min(std::max(i, low), high); };
+  bool merged = false;
 
-  double f1 = 1.0 - f;
+  for (size_t i = 0; i < ranges.size(); ) {
+    const auto &range = ranges[i];
 
-  double r = c1.redF  ()*f + c2.redF  ()*f1;
-  double g = c1.greenF()*f + c2.greenF()*f1;
-  double b = c1.blueF ()*f + c2.blueF ()*f1;
+    auto parent = range.parent();
 
-  return QColor(clamp(int(255*r), 0, 255),
-                clamp(int(255*g), 0, 255),
-                clamp(int(255*b), 0, 255));
-}
+    int bottom = range.bottom();
 
-QSizeF
-CQModelView::
-viewItemTextLayout(QTextLayout &textLayout, int lineWidth) const
-{
-  double height    = 0;
-  double widthUsed = 0;
+    size_t j = i + 1;
 
-  textLayout.beginLayout();
+    for ( ; j < ranges.size(); ++j) {
+      const auto &range1 = ranges[j];
 
-  while (true) {
-    auto line = textLayout.createLine();
+      if (range1.parent() != parent ||
+          range1.left() != range.left() || range1.right() != range.right())
+        break;
 
-    if (! line.isValid())
-      break;
+      if (isToggle ? range1.top() != bottom + 1 : range1.top() > bottom + 1)
+        break;
 
-    line.setLineWidth(lineWidth);
-    line.setPosition(QPointF(0, height));
+      bottom = std::max(bottom, range1.bottom());
+    }
 
-    height += line.height();
+    if (j > i + 1) {
+      selection1.append(QItemSelectionRange(range.topLeft(),
+                          model()->index(bottom, range.right(), parent)));
 
-    widthUsed = std::max(widthUsed, line.naturalTextWidth());
-  }
+      merged = true;
+    }
+    else
+      selection1.append(range);
 
-  textLayout.endLayout();
+    i = j;
+  }
 
-  return QSizeF(widthUsed, height);
+  return (merged ? selection1 : selection);
 }
 
-//------
-
+void
 CQModelViewSelectionModel::
-CQModelViewSelectionModel(CQModelView *view) :
- view_(view)
+clearSelectionData(ParentSelections &parentSelections)
 {
-  assert(view_);
+  for (auto &ps : parentSelections)
+    delete ps.second;
+
+  parentSelections.clear();
+
+  if (&parentSelections == &currentBase_)
+    currentBaseValid_ = false;
 }
 
+void
 CQModelViewSelectionModel::
-~CQModelViewSelectionModel()
+copySelectionData(const ParentSelections &src, ParentSelections &dst)
 {
+  clearSelectionData(dst);
+
+  for (const auto &ps : src)
+    dst[ps.first] = new ParentSelection(*ps.second);
 }
 
+// current selection update is kept (no longer replaced by next current update)
 void
 CQModelViewSelectionModel::
-setCurrentIndex(const QModelIndex &index, QItemSelectionModel::SelectionFlags command)
+commitCurrentSelection()
 {
-  QItemSelectionModel::setCurrentIndex(index, command);
-
-  view_->updateCurrentIndices();
+  if (currentBaseValid_)
+    clearSelectionData(currentBase_);
 }
 
+// rebuild map after row/column shifts (persistent index order can change)
 void
 CQModelViewSelectionModel::
-select(const QModelIndex &index, QItemSelectionModel::SelectionFlags command)
+rehashSelectionData()
 {
-  if (! model()) return;
+  ParentSelections parentSelections;
 
-  QItemSelectionModel::select(index, command);
+  for (const auto &ps : parentSelections_) {
+    auto &parentSelection = parentSelections[QPersistentModelIndex(ps.first)];
 
-  view_->updateSelection();
+    delete parentSelection;
+
+    parentSelection = ps.second;
+  }
+
+  std::swap(parentSelections_, parentSelections);
+
+  selectionDataChanged();
 }
 
+// invalidate data derived from intervals
 void
 CQModelViewSelectionModel::
-select(const QItemSelection &selection, QItemSelectionModel::SelectionFlags command)
+selectionDataChanged()
 {
-  QItemSelectionModel::select(selection, command);
-
-  view_->updateSelection();
+  selectionValid_        = false;
+  selectionColumnsValid_ = false;
 }
 
+// merge selected columns of all parents
 void
 CQModelViewSelectionModel::
-clear()
+updateSelectionColumns()
 {
-  QItemSelectionModel::clear();
+  if (selectionColumnsValid_)
+    return;
 
-  view_->updateSelection();
+  selectionColumnsValid_ = true;
+
+  selectionColumns_->clear();
+
+  for (const auto &ps : parentSelections_)
+    ps.second->addSelectedColumns(*selectionColumns_);
 }
 
-void
+CQModelViewSelectionModel::ParentSelection *
 CQModelViewSelectionModel::
-reset()
+getParentSelection(const QModelIndex &parent)
 {
-  QItemSelectionModel::reset();
+  auto ps = parentSelections_.find(QPersistentModelIndex(parent));
 
-  view_->updateSelection();
-  view_->updateCurrentIndices();
+  if (ps == parentSelections_.end()) {
+    int nr = model()->rowCount   (parent);
+    int nc = model()->columnCount(parent);
+
+    ps = parentSelections_.emplace(QPersistentModelIndex(parent),
+                                   new ParentSelection(nr, nc)).first;
+  }
+
+  return (*ps).second;
 }
 
-void
+CQModelViewSelectionModel::ParentSelection *
 CQModelViewSelectionModel::
-clearCurrentIndex()
+findParentSelection(const QModelIndex &parent)
 {
-  QItemSelectionModel::clearCurrentIndex();
+  auto ps = parentSelections_.find(QPersistentModelIndex(parent));
 
-  view_->updateCurrentIndices();
+  return (ps != parentSelections_.end() ? (*ps).second : nullptr);
+}
+
+const CQModelViewSelectionModel::ParentSelection *
+CQModelViewSelectionModel::
+findParentSelection(const QModelIndex &parent) const
+{
+  if (parentSelections_.empty())
+    return nullptr;
+
+  auto ps = parentSelections_.find(QPersistentModelIndex(parent));
+
+  return (ps != parentSelections_.end() ? (*ps).second : nullptr);
 }
 
 //------
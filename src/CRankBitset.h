@@ -0,0 +1,272 @@
+#ifndef CRankBitset_H
+#define CRankBitset_H
+
+#include <CFenwickTree.h>
+#include <bitset>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+// Bitset with O(1) bit test and O(log n) rank (number of set bits before index)
+// and select (index of nth set bit) using per word bit counts.
+class CRankBitset {
+ public:
+  using Word  = uint64_t;
+  using Words = std::vector<Word>;
+
+  static const int WORD_BITS = 64;
+
+ public:
+  CRankBitset() { }
+
+  explicit CRankBitset(int n, bool value=false) {
+    resize(n, value);
+  }
+
+  int size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  // number of set bits
+  int count() const { return counts_.total(); }
+
+  bool any () const { return count() > 0; }
+  bool none() const { return count() == 0; }
+
+  void clear() {
+    words_ .clear();
+    counts_.clear();
+
+    size_ = 0;
+  }
+
+  // assign from bool array in O(n)
+  void assign(const std::vector<bool> &values) {
+    size_ = int(values.size());
+
+    words_.assign(size_t(numWords(size_)), Word(0));
+
+    for (int i = 0; i < size_; ++i) {
+      if (values[size_t(i)])
+        words_[size_t(i/WORD_BITS)] |= Word(1) << (i % WORD_BITS);
+    }
+
+    buildCounts();
+  }
+
+  void resize(int n, bool value=false) {
+    assert(n >= 0);
+
+    if (n > size_)
+      insert(size_, n - size_, value);
+    else if (n < size_)
+      erase(n, size_ - n);
+  }
+
+  bool test(int i) const {
+    assert(i >= 0 && i < size_);
+
+    return (words_[size_t(i/WORD_BITS)] >> (i % WORD_BITS)) & 1;
+  }
+
+  bool operator[](int i) const { return test(i); }
+
+  void set(int i, bool value=true) {
+    if (test(i) == value)
+      return;
+
+    int  w    = i/WORD_BITS;
+    Word mask = Word(1) << (i % WORD_BITS);
+
+    if (value)
+      words_[size_t(w)] |= mask;
+    else
+      words_[size_t(w)] &= ~mask;
+
+    counts_.addValue(w, value ? 1 : -1);
+  }
+
+  void reset(int i) { set(i, false); }
+
+  // number of set bits in [0, i)
+  int rank(int i) const {
+    assert(i >= 0 && i <= size_);
+
+    int w = i/WORD_BITS;
+    int b = i % WORD_BITS;
+
+    int n = counts_.prefixSum(w);
+
+    if (b > 0)
+      n += wordCount(words_[size_t(w)] & ((Word(1) << b) - 1));
+
+    return n;
+  }
+
+  // index of nth (0 based) set bit (returns size() if n >= count)
+  int select(int n) const {
+    if (n < 0 || n >= count())
+      return size_;
+
+    int w = counts_.lowerBound(n);
+
+    n -= counts_.prefixSum(w);
+
+    Word word = words_[size_t(w)];
+
+    for (int b = 0; b < WORD_BITS; ++b) {
+      if ((word >> b) & 1) {
+        if (n == 0)
+          return w*WORD_BITS + b;
+
+        --n;
+      }
+    }
+
+    assert(false);
+
+    return size_;
+  }
+
+  // insert n bits at index (O(size/64) unless at end)
+  void insert(int i, int n, bool value=false) {
+    assert(i >= 0 && i <= size_ && n >= 0);
+
+    if (n == 0)
+      return;
+
+    CRankBitset bits;
+
+    bits.size_ = size_ + n;
+
+    bits.words_.resize(size_t(numWords(bits.size_)));
+
+    copyBits(*this, 0, bits, 0, i);
+
+    if (value)
+      bits.fillBits(i, n);
+
+    copyBits(*this, i, bits, i + n, size_ - i);
+
+    bits.buildCounts();
+
+    *this = std::move(bits);
+  }
+
+  // erase n bits at index (O(size/64))
+  void erase(int i, int n) {
+    assert(i >= 0 && n >= 0 && i + n <= size_);
+
+    if (n == 0)
+      return;
+
+    CRankBitset bits;
+
+    bits.size_ = size_ - n;
+
+    bits.words_.resize(size_t(numWords(bits.size_)));
+
+    copyBits(*this, 0, bits, 0, i);
+    copyBits(*this, i + n, bits, i, size_ - i - n);
+
+    bits.buildCounts();
+
+    *this = std::move(bits);
+  }
+
+  // set bits set in other (size is extended to other size) in O(n/64)
+  CRankBitset &operator|=(const CRankBitset &rhs) {
+    if (rhs.size_ > size_)
+      resize(rhs.size_);
+
+    for (size_t w = 0; w < rhs.words_.size(); ++w)
+      words_[w] |= rhs.words_[w];
+
+    buildCounts();
+
+    return *this;
+  }
+
+  friend bool operator==(const CRankBitset &lhs, const CRankBitset &rhs) {
+    return (lhs.size_ == rhs.size_ && lhs.words_ == rhs.words_);
+  }
+
+  friend bool operator!=(const CRankBitset &lhs, const CRankBitset &rhs) {
+    return ! (lhs == rhs);
+  }
+
+ private:
+  static int numWords(int n) { return (n + WORD_BITS - 1)/WORD_BITS; }
+
+  static int wordCount(Word w) { return int(std::bitset<WORD_BITS>(w).count()); }
+
+  // get n (<= WORD_BITS) bits starting at index i
+  Word getBits(int i, int n) const {
+    int w = i/WORD_BITS;
+    int b = i % WORD_BITS;
+
+    Word word = words_[size_t(w)] >> b;
+
+    if (b > 0 && b + n > WORD_BITS)
+      word |= words_[size_t(w + 1)] << (WORD_BITS - b);
+
+    if (n < WORD_BITS)
+      word &= (Word(1) << n) - 1;
+
+    return word;
+  }
+
+  // or n (<= WORD_BITS) bits into index i (no counts update)
+  void orBits(int i, int n, Word word) {
+    int w = i/WORD_BITS;
+    int b = i % WORD_BITS;
+
+    words_[size_t(w)] |= word << b;
+
+    if (b > 0 && b + n > WORD_BITS)
+      words_[size_t(w + 1)] |= word >> (WORD_BITS - b);
+  }
+
+  void fillBits(int i, int n) {
+    for ( ; n > 0; ) {
+      int n1 = std::min(n, int(WORD_BITS));
+
+      orBits(i, n1, n1 < WORD_BITS ? (Word(1) << n1) - 1 : ~Word(0));
+
+      i += n1;
+      n -= n1;
+    }
+  }
+
+  static void copyBits(const CRankBitset &src, int i1, CRankBitset &dst, int i2, int n) {
+    for ( ; n > 0; ) {
+      int n1 = std::min(n, int(WORD_BITS));
+
+      dst.orBits(i2, n1, src.getBits(i1, n1));
+
+      i1 += n1;
+      i2 += n1;
+      n  -= n1;
+    }
+  }
+
+  void buildCounts() {
+    std::vector<int> counts;
+
+    counts.resize(words_.size());
+
+    for (size_t w = 0; w < words_.size(); ++w)
+      counts[w] = wordCount(words_[w]);
+
+    counts_.build(counts);
+  }
+
+ private:
+  Words             words_;      // bit words
+  CFenwickTree<int> counts_;     // set bit count per word
+  int               size_ { 0 }; // number of bits
+};
+
+#endif
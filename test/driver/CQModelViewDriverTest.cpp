@@ -0,0 +1,605 @@
+// Driver test of CQModelView filtering, view sorting and selection on a standard item
+// model (runs offscreen). Returns non-zero on failure.
+
+#include <CQModelView.h>
+
+#include <QApplication>
+#include <QStandardItemModel>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int numFailed = 0;
+
+void check(bool b, const std::string &msg, int line) {
+  if (! b) {
+    std::cerr << "FAIL: " << msg << " (line " << line << ")\n";
+
+    ++numFailed;
+  }
+}
+
+#define CHECK(b) check((b), #b, __LINE__)
+
+using Rows = std::vector<int>;
+
+// process events until condition true or timeout (filter and large sorts run in threads)
+bool
+waitFor(const std::function<bool()> &func, int msecs=10000)
+{
+  QElapsedTimer timer;
+
+  timer.start();
+
+  while (! func()) {
+    if (timer.elapsed() > msecs)
+      return false;
+
+    qApp->processEvents();
+
+    QThread::msleep(5);
+  }
+
+  return true;
+}
+
+// visible model rows of parent in view order
+Rows
+viewRows(CQModelView &view, const QModelIndex &parent=QModelIndex())
+{
+  auto *model = view.model();
+
+  std::vector<std::pair<int, int>> yrows;
+
+  for (int r = 0; r < model->rowCount(parent); ++r) {
+    auto rect = view.visualRect(model->index(r, 0, parent));
+
+    if (rect.isValid())
+      yrows.emplace_back(rect.top(), r);
+  }
+
+  std::sort(yrows.begin(), yrows.end());
+
+  Rows rows;
+
+  for (const auto &yr : yrows)
+    rows.push_back(yr.second);
+
+  return rows;
+}
+
+// model rows in order of values
+Rows
+sortedRows(QStandardItemModel &model, const std::function<bool(int, int)> &less)
+{
+  Rows rows;
+
+  for (int r = 0; r < model.rowCount(); ++r)
+    rows.push_back(r);
+
+  std::stable_sort(rows.begin(), rows.end(), less);
+
+  return rows;
+}
+
+QString
+cellText(QStandardItemModel &model, int r, int c)
+{
+  return model.item(r, c)->text();
+}
+
+// filter edit of column (edit columns are assigned when shown by widget geometry update)
+CQModelViewFilterEdit *
+filterEdit(CQModelView &view, int c)
+{
+  for (auto *le : view.findChildren<CQModelViewFilterEdit *>()) {
+    if (le->isVisible() && le->column() == c)
+      return le;
+  }
+
+  return nullptr;
+}
+
+void
+setFilterText(CQModelView &view, int c, const QString &text)
+{
+  CQModelViewFilterEdit *le = nullptr;
+
+  CHECK(waitFor([&]() { le = filterEdit(view, c); return le != nullptr; }));
+  if (! le) return;
+
+  le->setText(text);
+
+  emit le->editingFinished();
+}
+
+//---
+
+// 30 rows of name (reverse order), letter (a, b, c) and number
+void
+initFlatModel(QStandardItemModel &model)
+{
+  int nr = 30;
+
+  model.setRowCount(nr);
+  model.setColumnCount(3);
+
+  for (int r = 0; r < nr; ++r) {
+    model.setItem(r, 0, new QStandardItem(QString("name%1").arg(nr - r, 2, 10, QChar('0'))));
+    model.setItem(r, 1, new QStandardItem(QString(QChar('a' + r % 3))));
+    model.setItem(r, 2, new QStandardItem(QString::number((r*7) % 11)));
+  }
+}
+
+void
+testSort()
+{
+  QStandardItemModel model;
+
+  initFlatModel(model);
+
+  CQModelView view;
+
+  view.resize(600, 1200);
+  view.setModel(&model);
+  view.show();
+
+  qApp->processEvents();
+
+  Rows modelRows = sortedRows(model, [](int r1, int r2) { return r1 < r2; });
+
+  CHECK(viewRows(view) == modelRows);
+
+  //---
+
+  // view sort changes view row order only
+  view.setViewSort(true);
+
+  view.sortByColumn(0, Qt::AscendingOrder);
+
+  auto nameRows = sortedRows(model, [&](int r1, int r2) {
+    return cellText(model, r1, 0) < cellText(model, r2, 0); });
+
+  CHECK(view.isViewSorted());
+  CHECK(viewRows(view) == nameRows);
+  CHECK(cellText(model, 0, 0) == "name30");
+
+  view.sortByColumn(0, Qt::DescendingOrder);
+
+  std::reverse(nameRows.begin(), nameRows.end());
+
+  CHECK(viewRows(view) == nameRows);
+
+  //---
+
+  // multiple sort keys (letter then number then name)
+  view.sortByColumn (1, Qt::AscendingOrder);
+  view.addSortByColumn(2);
+  view.addSortByColumn(0);
+
+  auto keyRows = sortedRows(model, [&](int r1, int r2) {
+    auto l1 = cellText(model, r1, 1), l2 = cellText(model, r2, 1);
+    if (l1 != l2) return l1 < l2;
+
+    // collator numeric mode compares digits by value
+    int n1 = cellText(model, r1, 2).toInt(), n2 = cellText(model, r2, 2).toInt();
+    if (n1 != n2) return n1 < n2;
+
+    return cellText(model, r1, 0) < cellText(model, r2, 0); });
+
+  CHECK(viewRows(view) == keyRows);
+
+  // data change keeps view sorted
+  model.item(keyRows[0], 1)->setText("z");
+
+  qApp->processEvents();
+
+  CHECK(viewRows(view).back() == keyRows[0]);
+}
+
+// sort large enough to run in background thread
+void
+testBackgroundSort()
+{
+  int nr = 150000;
+
+  QStandardItemModel model(nr, 1);
+
+  for (int r = 0; r < nr; ++r)
+    model.setItem(r, 0, new QStandardItem(QString("v%1").arg(nr - r, 6, 10, QChar('0'))));
+
+  CQModelView view;
+
+  view.resize(400, 600);
+  view.setModel(&model);
+  view.show();
+
+  qApp->processEvents();
+
+  bool done = false;
+
+  QObject::connect(&view, &CQModelView::sortProgress, [&](int percent) {
+    if (percent >= 100) done = true; });
+
+  view.setViewSort(true);
+
+  view.sortByColumn(0, Qt::AscendingOrder);
+
+  CHECK(waitFor([&]() { return done; }));
+
+  qApp->processEvents();
+
+  // first visible rows are last model rows
+  auto rows = viewRows(view);
+
+  CHECK(! rows.empty());
+
+  for (int i = 0; i < int(rows.size()); ++i)
+    CHECK(rows[uint(i)] == nr - 1 - i);
+}
+
+void
+testFilter()
+{
+  QStandardItemModel model;
+
+  initFlatModel(model);
+
+  CQModelView view;
+
+  view.resize(600, 1200);
+  view.setModel(&model);
+  view.setShowFilter(true);
+  view.show();
+
+  qApp->processEvents();
+
+  auto letterRows = [&](const QString &letter, int skipRow) {
+    Rows rows;
+
+    for (int r = 0; r < model.rowCount(); ++r) {
+      if (r != skipRow && cellText(model, r, 1) == letter)
+        rows.push_back(r);
+    }
+
+    return rows;
+  };
+
+  // user hidden row is kept hidden by filter changes
+  view.setRowHidden(1, QModelIndex(), true);
+
+  CHECK(view.isRowHidden(1, QModelIndex()));
+
+  setFilterText(view, 1, "b");
+
+  auto bRows = letterRows("b", 1);
+
+  CHECK(waitFor([&]() { return viewRows(view) == bRows; }));
+
+  CHECK(  view.isRowHidden(0, QModelIndex()));
+  CHECK(! view.isRowHidden(4, QModelIndex()));
+
+  // refine filter (b rows with single digit number 1-5)
+  setFilterText(view, 2, "[1-5]");
+
+  auto numberRows = [&](const Rows &rows) {
+    Rows rows1;
+
+    for (const auto &r : rows) {
+      int n = cellText(model, r, 2).toInt();
+
+      if (n >= 1 && n <= 5)
+        rows1.push_back(r);
+    }
+
+    return rows1;
+  };
+
+  auto bnRows = numberRows(bRows);
+
+  CHECK(waitFor([&]() { return viewRows(view) == bnRows; }));
+
+  // data change drops refinement base so reapplied filter checks all rows (row 2 is
+  // c with number 3)
+  model.item(2, 1)->setText("b");
+
+  setFilterText(view, 2, "[1-5]");
+
+  auto bnRows1 = numberRows(letterRows("b", 1));
+
+  CHECK(std::find(bnRows1.begin(), bnRows1.end(), 2) != bnRows1.end());
+
+  CHECK(waitFor([&]() { return viewRows(view) == bnRows1; }));
+
+  // less strict filter checks all rows
+  setFilterText(view, 2, "");
+
+  auto bRows1 = letterRows("b", 1);
+
+  CHECK(waitFor([&]() { return viewRows(view) == bRows1; }));
+
+  // clear filter
+  setFilterText(view, 1, "");
+
+  auto allRows = letterRows("a", 1);
+
+  for (const auto &r : letterRows("b", 1)) allRows.push_back(r);
+  for (const auto &r : letterRows("c", 1)) allRows.push_back(r);
+
+  std::sort(allRows.begin(), allRows.end());
+
+  CHECK(waitFor([&]() { return viewRows(view) == allRows; }));
+
+  CHECK(view.isRowHidden(1, QModelIndex()));
+}
+
+// tree filter keeps ancestors of matching rows
+void
+testTreeFilter()
+{
+  QStandardItemModel model;
+
+  model.setColumnCount(1);
+
+  for (int p = 0; p < 3; ++p) {
+    auto *parentItem = new QStandardItem(QString("parent%1").arg(p));
+
+    for (int c = 0; c < 4; ++c) {
+      auto name = (p == 1 && c == 2 ? QString("match") : QString("child%1%2").arg(p).arg(c));
+
+      parentItem->appendRow(new QStandardItem(name));
+    }
+
+    model.appendRow(parentItem);
+  }
+
+  CQModelView view;
+
+  view.resize(600, 800);
+  view.setModel(&model);
+  view.setShowFilter(true);
+  view.setFilterTree(true);
+  view.setFilterExpand(true);
+  view.show();
+
+  qApp->processEvents();
+
+  CHECK(view.isHierarchical());
+
+  auto parent1 = model.index(1, 0);
+
+  setFilterText(view, 0, "match");
+
+  CHECK(waitFor([&]() { return view.isRowHidden(0, QModelIndex()); }));
+
+  CHECK(  view.isRowHidden(0, QModelIndex()));
+  CHECK(! view.isRowHidden(1, QModelIndex()));
+  CHECK(  view.isRowHidden(2, QModelIndex()));
+
+  CHECK(  view.isRowHidden(0, parent1));
+  CHECK(! view.isRowHidden(2, parent1));
+
+  CHECK(view.isExpanded(parent1));
+
+  setFilterText(view, 0, "");
+
+  CHECK(waitFor([&]() { return ! view.isRowHidden(0, QModelIndex()); }));
+
+  CHECK(! view.isRowHidden(0, parent1));
+}
+
+// selection backend queries match base item selection model
+void
+testSelection()
+{
+  QStandardItemModel model;
+
+  initFlatModel(model);
+
+  CQModelView view;
+
+  view.resize(600, 1200);
+  view.setModel(&model);
+  view.show();
+
+  qApp->processEvents();
+
+  auto *sm = qobject_cast<CQModelViewSelectionModel *>(view.selectionModel());
+
+  CHECK(sm);
+  if (! sm) return;
+
+  int nr = model.rowCount();
+  int nc = model.columnCount();
+
+  auto range = [&](int r1, int c1, int r2, int c2) {
+    return QItemSelection(model.index(r1, c1), model.index(r2, c2));
+  };
+
+  auto checkCells = [&]() {
+    for (int r = 0; r < nr; ++r) {
+      bool anyRow = false;
+
+      for (int c = 0; c < nc; ++c) {
+        // ranges built from intervals must match interval queries
+        bool selected = sm->selection().contains(model.index(r, c));
+
+        CHECK(sm->isCellSelected(r, c) == selected);
+
+        anyRow = anyRow || selected;
+      }
+
+      CHECK(sm->isAnyRowCellSelected(r) == anyRow);
+    }
+  };
+
+  // partial column range then deselect and toggle inside it
+  sm->select(range(2, 1, 20, 2), QItemSelectionModel::Select);
+
+  CHECK(  sm->isCellSelected(5, 1));
+  CHECK(! sm->isCellSelected(5, 0));
+  CHECK(! sm->isCellSelected(21, 1));
+
+  checkCells();
+
+  sm->select(range(10, 1, 12, 2), QItemSelectionModel::Deselect);
+
+  CHECK(! sm->isCellSelected(11, 1));
+  CHECK(  sm->isCellSelected(13, 2));
+
+  checkCells();
+
+  sm->select(range(0, 0, 3, 1), QItemSelectionModel::Toggle);
+
+  checkCells();
+
+  // several adjacent ranges in one selection
+  QItemSelection selection;
+
+  for (int r = 22; r < 28; ++r)
+    selection.select(model.index(r, 0), model.index(r, 1));
+
+  sm->select(selection, QItemSelectionModel::Select);
+
+  CHECK(sm->isCellSelected(25, 1) && ! sm->isCellSelected(25, 2));
+
+  checkCells();
+
+  // random operations
+  std::mt19937 rng(5);
+
+  auto rand = [&](int n) { return int(rng() % uint(n)); };
+
+  for (int i = 0; i < 50; ++i) {
+    int r1 = rand(nr), r2 = std::min(nr - 1, r1 + rand(8));
+    int c1 = rand(nc), c2 = std::min(nc - 1, c1 + rand(2));
+
+    QItemSelectionModel::SelectionFlags flags;
+
+    switch (rand(3)) {
+      case 0 : flags = QItemSelectionModel::Select  ; break;
+      case 1 : flags = QItemSelectionModel::Deselect; break;
+      default: flags = QItemSelectionModel::Toggle  ; break;
+    }
+
+    sm->select(range(r1, c1, r2, c2), flags);
+
+    checkCells();
+  }
+
+  // selection shifted by row insert/remove
+  using Cells = std::vector<std::vector<bool>>;
+
+  auto saveCells = [&]() {
+    auto cells = Cells(uint(nr), std::vector<bool>(uint(nc)));
+
+    for (int r = 0; r < nr; ++r)
+      for (int c = 0; c < nc; ++c)
+        cells[uint(r)][uint(c)] = sm->isCellSelected(r, c);
+
+    return cells;
+  };
+
+  auto checkShifted = [&](const Cells &cells, int r1, int n) {
+    for (int r = 0; r < nr; ++r) {
+      for (int c = 0; c < nc; ++c) {
+        bool selected = false;
+
+        if      (r < r1)
+          selected = cells[uint(r)][uint(c)];
+        else if (n < 0 || r >= r1 + n)
+          selected = cells[uint(r - n)][uint(c)];
+
+        CHECK(sm->isCellSelected(r, c) == selected);
+      }
+    }
+
+    checkCells();
+  };
+
+  auto cells = saveCells();
+
+  model.insertRows(5, 3);
+
+  nr = model.rowCount();
+
+  checkShifted(cells, 5, 3);
+
+  model.removeRows(5, 3);
+
+  nr = model.rowCount();
+
+  checkShifted(cells, 0, 0);
+
+  model.removeRows(2, 4);
+
+  nr = model.rowCount();
+
+  checkShifted(cells, 2, -4);
+
+  // row and all selection
+  sm->clear();
+
+  CHECK(! sm->hasCellSelection());
+
+  view.selectRow(4, Qt::NoModifier);
+
+  CHECK(sm->isCellSelected(4, 0) && sm->isCellSelected(4, nc - 1));
+  CHECK(! sm->isCellSelected(3, 0));
+
+  checkCells();
+
+  view.selectAll();
+
+  CHECK(sm->isCellSelected(0, 0) && sm->isCellSelected(nr - 1, nc - 1));
+
+  checkCells();
+
+  // selection follows view sort (selected model rows unchanged)
+  sm->clear();
+
+  sm->select(range(0, 0, 0, nc - 1), QItemSelectionModel::Select);
+
+  view.setViewSort(true);
+
+  view.sortByColumn(0, Qt::AscendingOrder);
+
+  CHECK(sm->isCellSelected(0, 0) && ! sm->isCellSelected(1, 0));
+
+  checkCells();
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+  // no display needed
+  if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QApplication app(argc, argv);
+
+  testSort          ();
+  testBackgroundSort();
+  testFilter        ();
+  testTreeFilter    ();
+  testSelection     ();
+
+  if (numFailed) {
+    std::cerr << numFailed << " checks failed\n";
+    return 1;
+  }
+
+  std::cout << "CQModelViewDriverTest: all tests passed\n";
+
+  return 0;
+}
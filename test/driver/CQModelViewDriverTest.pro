@@ -0,0 +1,40 @@
+TEMPLATE = app
+
+TARGET = CQModelViewDriverTest
+
+DEPENDPATH += .
+
+QMAKE_CXXFLAGS += -std=c++17
+
+CONFIG += console debug
+CONFIG -= app_bundle
+
+MOC_DIR = .moc
+
+QT += widgets svg
+
+# Input
+SOURCES += \
+CQModelViewDriverTest.cpp \
+
+DESTDIR     = ../../bin
+OBJECTS_DIR = ../../obj
+LIB_DIR     = ../../lib
+
+PRE_TARGETDEPS = $$LIB_DIR/libCQModelView.a
+
+INCLUDEPATH += \
+. \
+../../include \
+../../../CQBaseModel/include \
+
+unix:LIBS += \
+-L$$LIB_DIR \
+-L../../../CQBaseModel/lib \
+-L../../../CQUtil/lib \
+-L../../../CStrUtil/lib \
+-L../../../CRegExp/lib \
+-L../../../COS/lib \
+-lCQModelView -lCQBaseModel -lCQUtil \
+-lCRegExp -lCStrUtil -lCOS \
+-ltre
@@ -0,0 +1,529 @@
+// Unit tests of the header only helper classes (CFenwickTree, CRankBitset, CIntervalSet
+// and CBitGrid) against brute force models. Returns non-zero on failure.
+
+#include <CFenwickTree.h>
+#include <CRankBitset.h>
+#include <CIntervalSet.h>
+#include <CBitGrid.h>
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int numFailed = 0;
+
+void check(bool b, const std::string &msg, int line) {
+  if (! b) {
+    std::cerr << "FAIL: " << msg << " (line " << line << ")\n";
+
+    ++numFailed;
+  }
+}
+
+#define CHECK(b) check((b), #b, __LINE__)
+
+//---
+
+void
+testFenwickTree()
+{
+  std::mt19937 rng(1);
+
+  auto rand = [&](int n) { return int(rng() % size_t(n)); };
+
+  CFenwickTree<int> tree;
+  std::vector<int>  values;
+
+  auto checkSums = [&]() {
+    CHECK(tree.size() == int(values.size()));
+
+    int sum = 0;
+
+    for (int i = 0; i <= int(values.size()); ++i) {
+      CHECK(tree.prefixSum(i) == sum);
+
+      if (i < int(values.size())) {
+        CHECK(tree.value(i) == values[size_t(i)]);
+
+        sum += values[size_t(i)];
+      }
+    }
+
+    CHECK(tree.total() == sum);
+
+    // lowerBound returns index containing position
+    for (int s = 0; s <= sum; ++s) {
+      int i = tree.lowerBound(s);
+
+      int i1 = 0, sum1 = 0;
+
+      while (i1 < int(values.size()) && sum1 + values[size_t(i1)] <= s)
+        sum1 += values[size_t(i1++)];
+
+      CHECK(i == i1);
+    }
+  };
+
+  checkSums();
+
+  for (int i = 0; i < 40; ++i) {
+    int v = rand(4);
+
+    tree.append(v);
+    values.push_back(v);
+  }
+
+  checkSums();
+
+  for (int iter = 0; iter < 500; ++iter) {
+    int op = rand(5);
+    int n  = int(values.size());
+
+    if      (op == 0 && n > 0) {
+      int i = rand(n), v = rand(5);
+
+      tree.setValue(i, v);
+
+      values[size_t(i)] = v;
+    }
+    else if (op == 1 && n > 0) {
+      int i = rand(n), d = rand(3);
+
+      tree.addValue(i, d);
+
+      values[size_t(i)] += d;
+    }
+    else if (op == 2) {
+      int i = rand(n + 1), m = rand(4), v = rand(3);
+
+      tree.insert(i, m, v);
+
+      values.insert(values.begin() + i, size_t(m), v);
+    }
+    else if (op == 3 && n > 0) {
+      int i = rand(n), m = rand(n - i + 1);
+
+      tree.erase(i, m);
+
+      values.erase(values.begin() + i, values.begin() + i + m);
+    }
+    else {
+      int v = rand(4);
+
+      tree.append(v);
+      values.push_back(v);
+    }
+
+    checkSums();
+  }
+
+  CFenwickTree<int> tree1(values);
+
+  CHECK(tree1.total() == tree.total());
+  CHECK(tree1.rangeSum(0, tree1.size()) == tree.total());
+
+  tree.clear();
+
+  CHECK(tree.empty() && tree.total() == 0 && tree.lowerBound(0) == 0);
+}
+
+//---
+
+void
+testRankBitset()
+{
+  std::mt19937 rng(2);
+
+  auto rand = [&](int n) { return int(rng() % size_t(n)); };
+
+  CRankBitset       bits;
+  std::vector<bool> values;
+
+  auto checkBits = [&](const CRankBitset &bits, const std::vector<bool> &values) {
+    CHECK(bits.size() == int(values.size()));
+
+    int n = 0;
+
+    for (int i = 0; i < int(values.size()); ++i) {
+      CHECK(bits.rank(i) == n);
+      CHECK(bits.test(i) == values[size_t(i)]);
+
+      if (values[size_t(i)]) {
+        CHECK(bits.select(n) == i);
+
+        ++n;
+      }
+    }
+
+    CHECK(bits.rank(bits.size()) == n);
+    CHECK(bits.count() == n);
+    CHECK(bits.select(n) == bits.size());
+    CHECK(bits.any() == (n > 0));
+  };
+
+  for (int iter = 0; iter < 400; ++iter) {
+    int op = rand(5);
+    int n  = int(values.size());
+
+    if      (op == 0 && n > 0) {
+      int  i = rand(n);
+      bool b = rand(2);
+
+      bits.set(i, b);
+
+      values[size_t(i)] = b;
+    }
+    else if (op == 1) {
+      // inserts cross word boundaries at unaligned positions
+      int  i = rand(n + 1), m = rand(150);
+      bool b = rand(2);
+
+      bits.insert(i, m, b);
+
+      values.insert(values.begin() + i, size_t(m), b);
+    }
+    else if (op == 2 && n > 0) {
+      int i = rand(n), m = rand(std::min(n - i, 150) + 1);
+
+      bits.erase(i, m);
+
+      values.erase(values.begin() + i, values.begin() + i + m);
+    }
+    else if (op == 3) {
+      int m = rand(300);
+
+      bits.resize(m, true);
+
+      values.resize(size_t(m), true);
+    }
+    else {
+      // or with bitset of random size (extends to larger size)
+      int m = rand(300);
+
+      std::vector<bool> values1;
+
+      values1.resize(size_t(m));
+
+      for (int i = 0; i < m; ++i)
+        values1[size_t(i)] = (rand(4) == 0);
+
+      CRankBitset bits1;
+
+      bits1.assign(values1);
+
+      checkBits(bits1, values1);
+
+      bits |= bits1;
+
+      if (m > n)
+        values.resize(size_t(m), false);
+
+      for (int i = 0; i < m; ++i)
+        values[size_t(i)] = values[size_t(i)] || values1[size_t(i)];
+    }
+
+    checkBits(bits, values);
+  }
+
+  CRankBitset bits1;
+
+  bits1.assign(values);
+
+  CHECK(bits1 == bits);
+
+  if (bits1.size() > 0) {
+    bits1.set(0, ! bits1.test(0));
+
+    CHECK(bits1 != bits);
+  }
+
+  bits.clear();
+
+  CHECK(bits.empty() && bits.none());
+}
+
+//---
+
+void
+testIntervalSet()
+{
+  std::mt19937 rng(3);
+
+  auto rand = [&](int n) { return int(rng() % size_t(n)); };
+
+  const int N = 100;
+
+  CIntervalSet      set;
+  std::vector<bool> values(N);
+
+  auto checkSet = [&]() {
+    // intervals are sorted, disjoint and not touching
+    int  count = 0;
+    auto intervals = set.intervals();
+
+    for (size_t i = 0; i < intervals.size(); ++i) {
+      CHECK(intervals[i].start <= intervals[i].end);
+
+      if (i > 0)
+        CHECK(intervals[i - 1].end + 1 < intervals[i].start);
+
+      count += intervals[i].length();
+    }
+
+    CHECK(set.count() == count);
+    CHECK(set.numIntervals() == int(intervals.size()));
+
+    for (int i = 0; i < N; ++i)
+      CHECK(set.contains(i) == values[size_t(i)]);
+  };
+
+  auto checkRange = [&](int start, int end) {
+    bool all = true, any = false;
+
+    for (int i = start; i <= end; ++i) {
+      all = all && values[size_t(i)];
+      any = any || values[size_t(i)];
+    }
+
+    CHECK(set.containsAll(start, end) == all);
+    CHECK(set.intersects (start, end) == any);
+
+    int n = 0;
+
+    for (const auto &interval : set.intersection(start, end)) {
+      CHECK(interval.start >= start && interval.end <= end);
+
+      for (int i = interval.start; i <= interval.end; ++i)
+        CHECK(values[size_t(i)]);
+
+      n += interval.length();
+    }
+
+    for (const auto &interval : set.complement(start, end)) {
+      CHECK(interval.start >= start && interval.end <= end);
+
+      for (int i = interval.start; i <= interval.end; ++i)
+        CHECK(! values[size_t(i)]);
+
+      n += interval.length();
+    }
+
+    CHECK(n == end - start + 1);
+  };
+
+  for (int iter = 0; iter < 2000; ++iter) {
+    int op    = rand(3);
+    int start = rand(N);
+    int end   = std::min(start + rand(12), N - 1);
+
+    if      (op == 0) {
+      set.add(start, end);
+
+      for (int i = start; i <= end; ++i)
+        values[size_t(i)] = true;
+    }
+    else if (op == 1) {
+      set.remove(start, end);
+
+      for (int i = start; i <= end; ++i)
+        values[size_t(i)] = false;
+    }
+    else {
+      set.toggle(start, end);
+
+      for (int i = start; i <= end; ++i)
+        values[size_t(i)] = ! values[size_t(i)];
+    }
+
+    checkSet();
+
+    int start1 = rand(N);
+    int end1   = std::min(start1 + rand(20), N - 1);
+
+    checkRange(start1, end1);
+  }
+
+  // insert and erase of values shift later values (values past N are dropped)
+  for (int iter = 0; iter < 500; ++iter) {
+    int pos = rand(N);
+    int n   = 1 + rand(5);
+
+    if (rand(2)) {
+      set.insert(pos, n);
+      set.remove(N, N + n - 1);
+
+      values.insert(values.begin() + pos, size_t(n), false);
+      values.resize(size_t(N));
+    }
+    else {
+      n = std::min(n, N - pos);
+
+      set.erase(pos, n);
+
+      values.erase(values.begin() + pos, values.begin() + pos + n);
+      values.resize(size_t(N), false);
+    }
+
+    checkSet();
+
+    // keep set populated
+    int start = rand(N);
+    int end   = std::min(start + rand(6), N - 1);
+
+    set.add(start, end);
+
+    for (int i = start; i <= end; ++i)
+      values[size_t(i)] = true;
+  }
+
+  // empty ranges are ignored
+  auto set1 = set;
+
+  set1.add   (5, 4);
+  set1.remove(5, 4);
+
+  CHECK(set1 == set);
+  CHECK(set.containsAll(5, 4) && ! set.intersects(5, 4));
+
+  // touching intervals merge
+  CIntervalSet set2(1, 3);
+
+  set2.add(4, 6);
+
+  CHECK(set2.numIntervals() == 1 && set2.front() == 1 && set2.back() == 6);
+
+  set2.remove(3, 4);
+
+  CHECK(set2.numIntervals() == 2 && set2.count() == 4);
+
+  set2.clear();
+
+  CHECK(set2.empty() && set2.count() == 0);
+}
+
+//---
+
+void
+testBitGrid()
+{
+  std::mt19937 rng(4);
+
+  auto rand = [&](int n) { return int(rng() % size_t(n)); };
+
+  for (int iter = 0; iter < 200; ++iter) {
+    // widths cross word boundaries
+    int w = 1 + rand(150);
+    int h = 1 + rand(12);
+
+    CBitGrid grid(w, h);
+
+    std::vector<int> cells(size_t(w*h), 0);
+
+    // random rectangles so runs span several rows
+    int nr = rand(6);
+
+    for (int i = 0; i < nr; ++i) {
+      int x1 = rand(w), x2 = std::min(w - 1, x1 + rand(80));
+      int y1 = rand(h), y2 = std::min(h - 1, y1 + rand(5));
+
+      for (int y = y1; y <= y2; ++y) {
+        for (int x = x1; x <= x2; ++x) {
+          grid.set(x, y);
+
+          cells[size_t(y*w + x)] = 1;
+        }
+      }
+    }
+
+    // random noise
+    for (int i = 0; i < w*h/8; ++i) {
+      int x = rand(w), y = rand(h);
+      int b = rand(2);
+
+      grid.set(x, y, b);
+
+      cells[size_t(y*w + x)] = b;
+    }
+
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x)
+        CHECK(grid.test(x, y) == bool(cells[size_t(y*w + x)]));
+    }
+
+    // row runs are maximal runs of set bits
+    for (int y = 0; y < h; ++y) {
+      std::vector<int> row(size_t(w), 0);
+
+      int lastX2 = -2;
+
+      grid.rowRuns(y, [&](int x1, int x2) {
+        CHECK(x1 <= x2 && x1 > lastX2 + 1);
+
+        for (int x = x1; x <= x2; ++x)
+          row[size_t(x)] = 1;
+
+        lastX2 = x2;
+      });
+
+      for (int x = 0; x < w; ++x)
+        CHECK(row[size_t(x)] == cells[size_t(y*w + x)]);
+    }
+
+    // rectangles exactly cover set bits without overlap
+    std::vector<int> covered(size_t(w*h), 0);
+
+    for (const auto &rect : grid.rects()) {
+      CHECK(rect.isValid());
+      CHECK(rect.left >= 0 && rect.right () < w);
+      CHECK(rect.top  >= 0 && rect.bottom() < h);
+
+      for (int y = rect.top; y <= rect.bottom(); ++y) {
+        for (int x = rect.left; x <= rect.right(); ++x)
+          ++covered[size_t(y*w + x)];
+      }
+    }
+
+    CHECK(covered == cells);
+  }
+
+  // full rows merge into one rectangle
+  CBitGrid grid(70, 3);
+
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 2; x < 68; ++x)
+      grid.set(x, y);
+  }
+
+  auto rects = grid.rects();
+
+  CHECK(rects.size() == 1);
+  CHECK(rects.size() == 1 && rects[0].left == 2 && rects[0].width == 66 &&
+        rects[0].top == 0 && rects[0].height == 3);
+
+  grid.clear();
+
+  CHECK(grid.rects().empty());
+}
+
+}
+
+int
+main(int, char **)
+{
+  testFenwickTree();
+  testRankBitset ();
+  testIntervalSet();
+  testBitGrid    ();
+
+  if (numFailed) {
+    std::cerr << numFailed << " checks failed\n";
+    return 1;
+  }
+
+  std::cout << "CUtilTest: all tests passed\n";
+
+  return 0;
+}
@@ -0,0 +1,21 @@
+TEMPLATE = app
+
+TARGET = CUtilTest
+
+DEPENDPATH += .
+
+CONFIG += console debug
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -std=c++17
+
+# Input
+SOURCES += \
+CUtilTest.cpp \
+
+DESTDIR     = ../../bin
+OBJECTS_DIR = ../../obj
+
+INCLUDEPATH += \
+. \
+../../src \